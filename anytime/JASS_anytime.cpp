@@ -7,8 +7,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <atomic>
 #include <limits>
 #include <memory>
+#include <thread>
+#include <csignal>
 #include <fstream>
 #include <algorithm>
 
@@ -22,23 +25,31 @@
 #include "query_bucket.h"
 #include "channel_file.h"
 #include "channel_trec.h"
+#include "channel_socket.h"
 #include "query_maxblock.h"
+#include "query_heap_clean.h"
 #include "compress_integer.h"
 #include "JASS_anytime_stats.h"
+#include "JASS_anytime_delta.h"
 #include "JASS_anytime_query.h"
+#include "JASS_anytime_blocked.h"
+#include "JASS_anytime_partitions.h"
+#include "JASS_anytime_phase_times.h"
+#include "JASS_anytime_cost_model.h"
+#include "JASS_anytime_result_cache.h"
 #include "query_maxblock_heap.h"
+#include "accumulator_counter.h"
 #include "deserialised_jass_v1.h"
 #include "compress_integer_all.h"
 #include "JASS_anytime_thread_result.h"
 #include "JASS_anytime_segment_header.h"
+#include "accumulator_counter_interleaved.h"
 #include "compress_integer_qmx_jass_v1.h"
 #include "compress_integer_elias_gamma_simd.h"
 
 constexpr size_t MAX_QUANTUM = 0x0FFF;
 constexpr size_t MAX_TERMS_PER_QUERY = 1024;
-
-constexpr size_t MAX_DOCUMENTS = JASS::query::MAX_DOCUMENTS;
-constexpr size_t MAX_TOP_K = JASS::query::MAX_TOP_K;
+constexpr size_t CALIBRATION_TERMS = 1000;				///< The number of vocabulary terms used to learn the cost model
 
 /*
 	PARAMETERS
@@ -51,8 +62,31 @@ size_t parameter_threads = 1;								///< Number of concurrent queries
 size_t parameter_top_k = 10;								///< Number of results to return
 size_t accumulator_width = 7;								///< The width (2^accumulator_width) of the accumulator 2-D array (if they are being used).
 bool parameter_ascii_query_parser = false;			///< When true use the ASCII pre-casefolded query parser
+size_t parameter_budget_in_us = 0;						///< Wall-clock time limit per query in microseconds (0 = no limit)
+bool parameter_calibrate = false;						///< When true learn a cost model at startup and stop before the segment that would exceed the time budget
+size_t parameter_partitions = 1;							///< The number of threads (document-id partitions) to use for a single long query
+size_t parameter_partition_postings = 100'000;		///< Only queries that will process at least this many postings are processed in parallel
+size_t parameter_block_width = 0;						///< The number of document ids in a block for blocked processing (0 = off)
+size_t parameter_block_batch = 1'000'000;				///< With blocked processing, decode this many postings before adding them to the accumulators
+std::string parameter_server;								///< When set, serve queries on this socket (port number or Unix domain socket path) rather than from a query file
+std::string parameter_strategy = "heap-2d";				///< The top-k and accumulator strategy to use (see engines)
+size_t parameter_cache_entries = 0;						///< The number of results lists to keep in the result cache (0 = no cache)
+size_t parameter_cache_admit = 1;						///< Admit a query to the result cache once it has missed this many times
+std::string parameter_cache_eviction = "lru";			///< The result cache eviction policy (lru or fifo)
+bool parameter_rank_safe = false;						///< When true stop as soon as processing more postings cannot change the top-k (or its order)
+std::string parameter_delta;								///< Comma separated list of directories holding delta indexes to search alongside the main index
+size_t parameter_validation_threads = (std::max)(std::thread::hardware_concurrency(), 1U);		///< Check the checksums of a packed index (JASS.index) on this many threads at startup (0 = don't check)
 bool parameter_help = false;
 
+JASS_anytime_cost_model cost_model;						///< The learned segment cost model (predicts 0 unless --calibrate is used)
+JASS_anytime_result_cache result_cache;					///< The results lists of recent queries (shared by all threads, off unless --cache is used)
+std::vector<std::unique_ptr<JASS::deserialised_jass_v1>> delta_index;		///< The delta indexes (empty unless --delta is used)
+
+std::atomic<bool> server_stopping(false);				///< In server mode, set when the server has been asked to stop
+int server_listener = -1;									///< In server mode, the listening socket
+std::unique_ptr<std::atomic<int> []> server_clients;	///< In server mode, the connected socket of each worker (-1 if it has none)
+size_t server_workers = 0;									///< In server mode, the number of workers
+
 std::string parameters_errors;							///< Any errors as a result of command line parsing
 auto parameters = std::make_tuple						///< The  command line parameter block
 	(
@@ -63,98 +97,175 @@ auto parameters = std::make_tuple						///< The  command line parameter block
 	JASS::commandline::parameter("-k", "--top-k",     "<top-k>           Number of results to return to the user (top-k value) [default = -k10]", parameter_top_k),
 	JASS::commandline::parameter("-r", "--rho",       "<integer_percent> Percent of the collection size to use as max number of postings to process [default = -r100] (overrides -RHO)", rho),
 	JASS::commandline::parameter("-R", "--RHO",       "<integer_max>     Max number of postings to process [default is all] (overridden by -rho)", maximum_number_of_postings_to_process),
-	JASS::commandline::parameter("-w", "--width",     "<2^w>             The width of the 2d accumulator array (2^w is used)", accumulator_width)
+	JASS::commandline::parameter("-w", "--width",     "<2^w>             The width of the 2d accumulator array (2^w is used)", accumulator_width),
+	JASS::commandline::parameter("-s", "--strategy",  "<topk-accumulator> The top-k and accumulator strategy (-s? lists them) [default = -sheap-2d]", parameter_strategy),
+	JASS::commandline::parameter("-b", "--budget-us", "<microseconds>    Wall-clock time budget per query, checked between impact segments [default is no limit]", parameter_budget_in_us),
+	JASS::commandline::parameter("-e", "--rank-safe", "Stop early, but only once processing more postings cannot change the top-k or its order (heap and heapsimd strategies only, the rsvs reported may be lower)", parameter_rank_safe),
+	JASS::commandline::parameter("-c", "--calibrate", "Learn a segment cost model at startup and use it to predict whether the next segment fits in the budget", parameter_calibrate),
+	JASS::commandline::parameter("-p", "--partitions", "<partitions>     Process long queries on this many threads, each responsible for a range of document ids [default = -p1]", parameter_partitions),
+	JASS::commandline::parameter("-P", "--partition-postings", "<postings> Only process queries with at least this many postings in parallel [default = -P100000]", parameter_partition_postings),
+	JASS::commandline::parameter("-B", "--block-width", "<documents>     Add the postings of a batch of segments to the accumulators one block of this many document ids at a time [default is off]", parameter_block_width),
+	JASS::commandline::parameter("-N", "--block-batch", "<postings>      With --block-width, the number of postings in a batch [default = -N1000000]", parameter_block_batch),
+	JASS::commandline::parameter("-S", "--server",    "<port|path>       Run as a search server on the loopback TCP port or Unix domain socket (one worker per thread)", parameter_server),
+	JASS::commandline::parameter("-A", "--cache-admit", "<misses>        Only admit a query to the result cache once it has missed this many times [default = -A1]", parameter_cache_admit),
+	JASS::commandline::parameter("-E", "--cache-evict", "<lru|fifo>      The result cache eviction policy [default = -Elru]", parameter_cache_eviction),
+	JASS::commandline::parameter("-C", "--cache",     "<entries>         Keep the results lists of this many queries in a result cache [default = -C0 (no cache)]", parameter_cache_entries),
+	JASS::commandline::parameter("-d", "--delta",     "<dir[,dir...]>    Also search the delta indexes in these directories (oldest first) and merge their top-k with the main index", parameter_delta),
+	JASS::commandline::parameter("-V", "--validate",  "<threadcount>     Check the checksums of a packed index (JASS.index) on this many threads before searching, -V0 to skip [default = all cores]", parameter_validation_threads)
 	);
 
 /*
-	ANYTIME()
-	---------
+	NEW_JASS_QUERY()
+	----------------
 */
-void anytime(JASS_anytime_thread_result &output, const JASS::deserialised_jass_v1 &index, std::vector<JASS_anytime_query> &query_list, size_t postings_to_process, size_t top_k)
+/*!
+	@brief Allocate and initialise a JASS query object for searching the given index
+	@param index [in] The index that will be searched
+	@param top_k [in] The number of results the query object should return
+	@param documents [in] The number of accumulators (the number of documents in the index, or in a partition of it)
+	@return The query object (which owns the decompressor for the index)
+	@details With --rank-safe (and a query object that can stop early) the query object tracks one more result than is returned
+	because the (top_k + 1)-th document is the highest scoring document that might overtake the top-k (see query::top_k_is_final()).
+	export_results() drops it.
+*/
+template <typename QUERY>
+std::unique_ptr<QUERY> new_jass_query(const JASS::deserialised_jass_v1 &index, size_t top_k, size_t documents)
 	{
-	/*
-		Allocate the Score-at-a-Time table
-	*/
-	JASS_anytime_segment_header *segment_order = new JASS_anytime_segment_header[MAX_TERMS_PER_QUERY * MAX_QUANTUM];
-
-	/*
-		Allocate a JASS query object
-	*/
 	std::string codex_name;
 	int32_t d_ness;
-	std::unique_ptr<JASS::compress_integer> jass_query = index.codex(codex_name, d_ness);
+	auto jass_query = std::make_unique<QUERY>();
+	jass_query->set_codex(index.codex(codex_name, d_ness));
+	if (parameter_rank_safe && QUERY::can_stop_early)
+		top_k++;
 
 	try
 		{
-		jass_query->init(index.primary_keys(), index.document_count(), top_k, accumulator_width);
+		jass_query->init(index.primary_keys(), documents, top_k, accumulator_width);
+		}
+	catch (std::bad_alloc &ers)
+		{
+		exit(printf("Can't allocate the accumulators for the %llu documents in this index\n", (unsigned long long)documents));
 		}
-	catch (std::bad_array_new_length &ers)
+
+	return jass_query;
+	}
+
+/*
+	EXTRACT_QUERY_ID()
+	------------------
+*/
+/*!
+	@brief Split a query line into the query ID and the query
+	@param query_id [out] The query ID (or "" if there isn't one)
+	@param query [in/out] The query line, which is replaced by the query with the ID removed
+*/
+void extract_query_id(std::string &query_id, std::string &query)
+	{
+	static const std::string seperators_between_id_and_query = " \t:";
+
+	auto end_of_id = query.find_first_of(seperators_between_id_and_query);
+	if (end_of_id == std::string::npos)
+		query_id = "";
+	else
 		{
-		exit(printf("Can't load index as the number of documents is too large - change MAX_DOCUMENTS in query.h\n"));
+		query_id = query.substr(0, end_of_id);
+		auto start_of_query = query.substr(end_of_id, std::string::npos).find_first_not_of(seperators_between_id_and_query);
+		if (start_of_query == std::string::npos)
+			query = query.substr(end_of_id, std::string::npos);
+		else
+			query = query.substr(end_of_id + start_of_query, std::string::npos);
 		}
+	}
 
+/*
+	PARSE_QUERY()
+	-------------
+*/
+/*!
+	@brief Parse a query into the query object ready for search()
+	@param jass_query [in/out] The query object to use (it is re-used from query to query)
+	@param query [in] The query (without the query ID)
+*/
+template <typename QUERY>
+void parse_query(QUERY &jass_query, const std::string &query)
+	{
 	/*
-		Start the timer
+		The terms of the previous query are still there if it was answered from the result cache
 	*/
-	auto total_search_time = JASS::timer::start();
+	jass_query.terms().clear();
+
+	if (parameter_ascii_query_parser)
+		jass_query.parse(query, JASS::parser_query::parser_type::raw);
+	else
+		jass_query.parse(query);
+	}
+
+/*
+	SEARCH()
+	--------
+*/
+/*!
+	@brief Resolve a single parsed query (see parse_query()) using the anytime algorithm, leaving the results in jass_query
+	@param jass_query [in/out] The query object to use (it is re-used from query to query)
+	@param query_time [in] The stop watch started when the query arrived (the time budget is measured from here)
+	@param segment_order [in] The Score-at-a-Time table (MAX_TERMS_PER_QUERY * MAX_QUANTUM entries)
+	@param index [in] The index to search
+	@param postings_to_process [in] The maximum number of postings to process
+	@param budget_in_ns [in] The wall-clock time limit for this query in nanoseconds (0 for no limit)
+	@param partitions [in/out] The intra-query parallel partitions (if this query is long enough to use them, the results are left in here)
+	@param blocked [in/out] The batch used for blocked processing (if it is turned on)
+	@param phases [in/out] The time spent in each phase of search (laps are added for each phase from VOCABULARY on)
+	@return The number of postings that were processed
+*/
+template <typename QUERY>
+size_t search(QUERY &jass_query, decltype(JASS::timer::start()) query_time, JASS_anytime_segment_header *segment_order, const JASS::deserialised_jass_v1 &index, size_t postings_to_process, size_t budget_in_ns, JASS_anytime_partitions<QUERY> &partitions, JASS_anytime_blocked &blocked, JASS_anytime_phase_times &phases)
+	{
+	partitions.rewind();
+
+	auto &terms = jass_query.terms();
 
 	/*
-		Now start searching
+		Parse the query and extract the list of impact segments
 	*/
-	size_t next_query = 0;
-	std::string query = JASS_anytime_query::get_next_query(query_list, next_query);
-	std::string query_id;
-
-	while (query.size() != 0)
+	JASS_anytime_segment_header *current_segment = segment_order;
+	JASS::query::ACCUMULATOR_TYPE largest_possible_rsv = (std::numeric_limits<decltype(largest_possible_rsv)>::min)();
+	JASS::query::ACCUMULATOR_TYPE smallest_possible_rsv = (std::numeric_limits<decltype(smallest_possible_rsv)>::max)();
+	size_t remaining_rsv = 0;
+//std::cout << "\n";
+	for (const auto &term : terms)
 		{
-		static const std::string seperators_between_id_and_query = " \t:";
-
-		/*
-			Extract the query ID from the query
-		*/
-		auto end_of_id = query.find_first_of(seperators_between_id_and_query);
-		if (end_of_id == std::string::npos)
-			query_id = "";
-		else
-			{
-			query_id = query.substr(0, end_of_id);
-			auto start_of_query = query.substr(end_of_id, std::string::npos).find_first_not_of(seperators_between_id_and_query);
-			if (start_of_query == std::string::npos)
-				query = query.substr(end_of_id, std::string::npos);
-			else
-				query = query.substr(end_of_id + start_of_query, std::string::npos);
-			}
+//std::cout << "TERM:" << term << " ";
 
 		/*
-			Process the query
+			Get the metadata for this term (and if this term isn't in the vocab them move on to the next term)
 		*/
-		if (parameter_ascii_query_parser)
-			jass_query->parse(query, JASS::parser_query::parser_type::raw);
-		else
-			jass_query->parse(query);
-		auto &terms = jass_query->terms();
+		JASS::deserialised_jass_v1::metadata metadata;
+		bool found = index.postings_details(metadata, term);
+		phases.lap(JASS_anytime_phase_times::VOCABULARY);
+		if (!found)
+			continue;
 
 		/*
-			Parse the query and extract the list of impact segments
+			Add to the list of impact segments that need to be processed
 		*/
-		JASS_anytime_segment_header *current_segment = segment_order;
-		JASS::query::ACCUMULATOR_TYPE largest_possible_rsv = (std::numeric_limits<decltype(largest_possible_rsv)>::min)();
-		JASS::query::ACCUMULATOR_TYPE smallest_possible_rsv = (std::numeric_limits<decltype(smallest_possible_rsv)>::max)();
-//std::cout << "\n";
-		for (const auto &term : terms)
+		JASS_anytime_segment_header *first_segment_of_term = current_segment;
+		if (index.version() == 2)
 			{
-//std::cout << "TERM:" << term << " ";
-
 			/*
-				Get the metadata for this term (and if this term isn't in the vocab them move on to the next term)
-			*/
-			JASS::deserialised_jass_v1::metadata metadata;
-			if (!index.postings_details(metadata, term))
-				continue;
-
-			/*
-				Add to the list of impact segments that need to be processed
+				A JASS v2 index stores the segment headers of a term as (aligned) arrays, so walk the arrays
 			*/
+			auto segments = index.segments(metadata);
+			for (uint64_t segment = 0; segment < metadata.impacts; segment++)
+				{
+				current_segment->impact = segments.impact[segment] * term.frequency();
+				current_segment->offset = segments.offset[segment];
+				current_segment->end = segments.offset[segment] + segments.length[segment];
+				current_segment->segment_frequency = segments.segment_frequency[segment];
+				current_segment++;
+				}
+			}
+		else
+			{
 			for (uint64_t segment = 0; segment < metadata.impacts; segment++)
 				{
 				uint64_t *postings_list = (uint64_t *)metadata.offset;
@@ -169,74 +280,332 @@ void anytime(JASS_anytime_thread_result &output, const JASS::deserialised_jass_v
 				current_segment++;
 				}
 //std::cout << "\n";
+			}
+
+		/*
+			A JASS v2 index stores the highest and lowest impact of each term in the vocabulary.  Otherwise look at the first and last segments,
+			normally the highest impact is the first impact, but binary_to_JASS gets it wrong and puts the highest impact last!
+		*/
+		uint16_t highest_term_impact = metadata.highest_impact;
+		uint16_t lowest_term_impact = metadata.lowest_impact;
+		if (highest_term_impact == 0)
+			{
+			auto first_segment_in_postings_list = index.segment(metadata, 0);
+			auto last_segment_in_postings_list = index.segment(metadata, metadata.impacts - 1);
+			highest_term_impact = JASS::maths::maximum(first_segment_in_postings_list.impact, last_segment_in_postings_list.impact);
+			lowest_term_impact = JASS::maths::minimum(first_segment_in_postings_list.impact, last_segment_in_postings_list.impact);
+			}
+		largest_possible_rsv += highest_term_impact;
+
+		smallest_possible_rsv = JASS::maths::minimum(smallest_possible_rsv, decltype(smallest_possible_rsv)(lowest_term_impact));
+
+		/*
+			For rank-safe early termination each segment records the impact of the next lower segment of its term.  The segments of a term are
+			processed from highest to lowest impact so once a segment has been processed the most any document can still gain from that term is
+			the next lower impact, and the most any document can gain from the whole query (remaining_rsv) is the sum of those over the terms.
+		*/
+		if (parameter_rank_safe && QUERY::can_stop_early && current_segment != first_segment_of_term)
+			{
+			JASS_anytime_segment_header *last_segment_of_term = current_segment - 1;
+			bool descending = first_segment_of_term->impact >= last_segment_of_term->impact;
+			for (auto *segment = first_segment_of_term; segment <= last_segment_of_term; segment++)
+				if (descending)
+					segment->next_impact = segment == last_segment_of_term ? 0 : (segment + 1)->impact;
+				else
+					segment->next_impact = segment == first_segment_of_term ? 0 : (segment - 1)->impact;
+			remaining_rsv += JASS::maths::maximum(first_segment_of_term->impact, last_segment_of_term->impact);
+			}
+		phases.lap(JASS_anytime_phase_times::COLLECT);
+		}
+
+	/*
+		Sort the segments from highest impact to lowest impact
+	*/
+	std::sort
+		(
+		segment_order,
+		current_segment,
+		[postings = index.postings()](JASS_anytime_segment_header &lhs, JASS_anytime_segment_header &rhs)
+			{
 
 			/*
-				Normally the highest impact is the first impact, but binary_to_JASS gets it wrong and puts the highest impact last!
+				sort from highest to lowest impact, but break ties by placing the lowest quantum-frequency first and the highest quantum-frequency last
 			*/
-			auto *first_segment_in_postings_list = (JASS::deserialised_jass_v1::segment_header *)(index.postings() + ((uint64_t *)metadata.offset)[0]);
-			auto *last_segment_in_postings_list = (JASS::deserialised_jass_v1::segment_header *)(index.postings() + ((uint64_t *)metadata.offset)[metadata.impacts - 1]);
+			if (lhs.impact < rhs.impact)
+				return false;
+			else if (lhs.impact > rhs.impact)
+				return true;
+			else			// impact scores are the same, so tie break on the length of the segment
+				return lhs.segment_frequency < rhs.segment_frequency;
+			}
+		);
 
-			size_t highest_term_impact = JASS::maths::maximum(first_segment_in_postings_list->impact, last_segment_in_postings_list->impact);
-			largest_possible_rsv += highest_term_impact;
+	/*
+		0 terminate the list of segments by setting the impact score to zero
+	*/
+	current_segment->impact = 0;
+	phases.lap(JASS_anytime_phase_times::ORDER);
 
-			smallest_possible_rsv = JASS::maths::minimum(smallest_possible_rsv, decltype(smallest_possible_rsv)(first_segment_in_postings_list->impact), decltype(smallest_possible_rsv)(last_segment_in_postings_list->impact));
+	/*
+		Process the segments
+	*/
+	jass_query.rewind(smallest_possible_rsv, segment_order->impact, largest_possible_rsv);
+
+	/*
+		If this is a long query (and we're asked to) then split the document ids across several threads.  Apply the postings limit first so that
+		every partition processes the same segments.
+	*/
+	if (partitions.size() != 0)
+		{
+		size_t postings_in_query = 0;
+		auto *end_of_segments = segment_order;
+		while (end_of_segments < current_segment && postings_in_query + end_of_segments->segment_frequency <= postings_to_process)
+			postings_in_query += (end_of_segments++)->segment_frequency;
+
+		if (postings_in_query >= parameter_partition_postings)
+			{
+			size_t postings_processed = partitions.process(segment_order, end_of_segments, index.postings(), smallest_possible_rsv, largest_possible_rsv, query_time, budget_in_ns, cost_model, jass_query.top_k, parameter_rank_safe && QUERY::can_stop_early, remaining_rsv);
+			phases.lap(JASS_anytime_phase_times::PROCESS);
+			return postings_processed;
 			}
+		}
+//std::cout << "MAXRSV:" << largest_possible_rsv << " MINRSV:" << smallest_possible_rsv << "\n";
+
+	size_t postings_processed = 0;
+	for (auto *header = segment_order; header < current_segment; header++)
+		{
+//std::cout << "Process Segment->(" << header->impact << ":" << header->segment_frequency << ")\n";
+		/*
+			The anytime algorithms basically boils down to this... have we processed enough postings yet?  If so then stop
+			The definition of "enough" is that processing the next segment will exceed postings_to_process so we wil be over
+			the "time limit" so we must not do it.
+		*/
+		if (postings_processed + header->segment_frequency > postings_to_process)
+			break;
 
 		/*
-			Sort the segments from highest impact to lowest impact
+			With a time budget the limit is on wall-clock time instead.  Stop if we are out of time or if the cost model predicts that
+			this segment will take us over (without --calibrate the model predicts zero so we stop only once the time is used up).
+			With blocked processing the postings of a batch are only added once the batch is full, so we can go over by up to one batch.
 		*/
-		std::sort
-			(
-			segment_order,
-			current_segment,
-			[postings = index.postings()](JASS_anytime_segment_header &lhs, JASS_anytime_segment_header &rhs)
-				{
+		if (budget_in_ns != 0)
+			if (static_cast<size_t>(JASS::timer::stop(query_time).nanoseconds()) + cost_model.predict(header->segment_frequency) > budget_in_ns)
+				break;
 
-				/*
-					sort from highest to lowest impact, but break ties by placing the lowest quantum-frequency first and the highest quantum-frequency last
-				*/
-				if (lhs.impact < rhs.impact)
-					return false;
-				else if (lhs.impact > rhs.impact)
-					return true;
-				else			// impact scores are the same, so tie break on the length of the segment
-					return lhs.segment_frequency < rhs.segment_frequency;
-				}
-			);
+		postings_processed += header->segment_frequency;
 
 		/*
-			0 terminate the list of segments by setting the impact score to zero
+			Process the postings (either now, or as part of a batch of segments)
 		*/
-		current_segment->impact = 0;
+		bool top_k_is_up_to_date = true;
+		if (blocked.size() != 0)
+			top_k_is_up_to_date = blocked.add(jass_query, *header, index.postings());
+		else
+			{
+			JASS::query::ACCUMULATOR_TYPE impact = header->impact;
+			jass_query.decode_and_process(impact, header->segment_frequency, index.postings() + header->offset, header->end - header->offset);
+			}
 
 		/*
-			Process the segments
+			Rank-safe early termination: stop once no document can gain enough to change the top-k or its order.
 		*/
-		jass_query->rewind(smallest_possible_rsv, segment_order->impact, largest_possible_rsv);
-//std::cout << "MAXRSV:" << largest_possible_rsv << " MINRSV:" << smallest_possible_rsv << "\n";
-
-		size_t postings_processed = 0;
-		for (auto *header = segment_order; header < current_segment; header++)
+		if (parameter_rank_safe && QUERY::can_stop_early)
 			{
-//std::cout << "Process Segment->(" << header->impact << ":" << header->segment_frequency << ")\n";
-			/*
-				The anytime algorithms basically boils down to this... have we processed enough postings yet?  If so then stop
-				The definition of "enough" is that processing the next segment will exceed postings_to_process so we wil be over
-				the "time limit" so we must not do it.
-			*/
-			if (postings_processed + header->segment_frequency > postings_to_process)
+			remaining_rsv -= header->impact - header->next_impact;
+			if (top_k_is_up_to_date && jass_query.top_k_is_final(remaining_rsv))
 				break;
-			postings_processed += header->segment_frequency;
+			}
+		}
 
-			/*
-				Process the postings
-			*/
-			JASS::query::ACCUMULATOR_TYPE impact = header->impact;
-			jass_query->decode_and_process(impact, header->segment_frequency, index.postings() + header->offset, header->end - header->offset);
+	if (blocked.pending() != 0)
+		blocked.flush(jass_query);
+	phases.lap(JASS_anytime_phase_times::PROCESS);
+
+	jass_query.sort();
+	phases.lap(JASS_anytime_phase_times::TOP_K);
+
+	return postings_processed;
+	}
+
+/*
+	SEARCH_DELTAS()
+	---------------
+*/
+/*!
+	@brief Search each delta index (before the main index is searched, see merge_deltas())
+	@details With a time budget each delta gets a share of the budget in proportion to the number of documents in it, and the main index
+	gets whatever is left.  If the deltas were searched after the main index it would already have used the whole budget.
+	@param deltas [in/out] The delta indexes and their query objects
+	@param index [in] The main index
+	@param query [in] The query (without its query ID)
+	@param query_time [in] The stop watch started when the query arrived (the time budget is measured from here)
+	@param segment_order [in] The Score-at-a-Time table (MAX_TERMS_PER_QUERY * MAX_QUANTUM entries)
+	@param postings_to_process [in] The maximum number of postings to process in each delta
+	@param budget_in_ns [in] The wall-clock time limit for this query in nanoseconds (0 for no limit)
+	@param phases [in/out] The time spent in each phase of search
+	@return The number of postings that were processed (over all the deltas)
+*/
+template <typename QUERY>
+size_t search_deltas(JASS_anytime_delta<QUERY> &deltas, const JASS::deserialised_jass_v1 &index, const std::string &query, decltype(JASS::timer::start()) query_time, JASS_anytime_segment_header *segment_order, size_t postings_to_process, size_t budget_in_ns, JASS_anytime_phase_times &phases)
+	{
+	/*
+		The deltas are small so they are searched on this thread without blocking
+	*/
+	JASS_anytime_partitions<QUERY> no_partitions;
+	JASS_anytime_blocked no_blocking;
+	size_t postings_processed = 0;
+
+	size_t documents = index.document_count();
+	for (size_t which = 0; which < deltas.size(); which++)
+		documents += deltas.delta_index(which).document_count();
+
+	size_t documents_so_far = 0;
+	for (size_t which = 0; which < deltas.size(); which++)
+		{
+		/*
+			Each delta must stop by the end of its share of the budget (counted from the start of the query), which is never 0 (no limit)
+		*/
+		documents_so_far += deltas.delta_index(which).document_count();
+		size_t deadline = budget_in_ns == 0 ? 0 : (std::max)(static_cast<size_t>(1), static_cast<size_t>(static_cast<double>(budget_in_ns) * documents_so_far / documents));
+
+		QUERY &delta_query = deltas.query_object(which);
+		parse_query(delta_query, query);
+		postings_processed += search(delta_query, query_time, segment_order, deltas.delta_index(which), postings_to_process, deadline, no_partitions, no_blocking, phases);
+		}
+
+	return postings_processed;
+	}
+
+/*
+	MERGE_DELTAS()
+	--------------
+*/
+/*!
+	@brief Merge the top-k of the main index with those of the deltas (both must already have been searched, see search_deltas())
+	@param deltas [in/out] The delta indexes and their query objects (the merged results are left in here)
+	@param jass_query [in] The query object that searched the main index
+	@param partitions [in] The intra-query parallel partitions, which hold the results of the main index if search() used them
+	@param phases [in/out] The time spent in each phase of search
+*/
+template <typename QUERY>
+void merge_deltas(JASS_anytime_delta<QUERY> &deltas, QUERY &jass_query, JASS_anytime_partitions<QUERY> &partitions, JASS_anytime_phase_times &phases)
+	{
+	if (partitions.answered_query())
+		deltas.merge(partitions, jass_query.top_k);
+	else
+		deltas.merge(jass_query, jass_query.top_k);
+	phases.lap(JASS_anytime_phase_times::TOP_K);
+	}
+
+/*
+	EXPORT_RESULTS()
+	----------------
+*/
+/*!
+	@brief Serialise the results list of a query in TREC run format
+	@param results_list [out] The results list
+	@param query_id [in] The query ID
+	@param jass_query [in] The query object that holds the results (after search())
+	@param partitions [in] The intra-query parallel partitions, which hold the results if search() used them
+	@param deltas [in] The delta indexes, which hold the merged results if there are any
+*/
+template <typename QUERY>
+void export_results(std::string &results_list, const std::string &query_id, QUERY &jass_query, JASS_anytime_partitions<QUERY> &partitions, JASS_anytime_delta<QUERY> &deltas)
+	{
+	std::ostringstream results;
+
+	if (deltas.size() != 0)
+		JASS::run_export(JASS::run_export::TREC, results, query_id.c_str(), deltas, "JASSv2", true, false);
+	else if (partitions.answered_query())
+		JASS::run_export(JASS::run_export::TREC, results, query_id.c_str(), partitions, "JASSv2", true, false);
+	else
+		JASS::run_export(JASS::run_export::TREC, results, query_id.c_str(), jass_query, "JASSv2", true, QUERY::run_is_ascending);
+
+	results_list = results.str();
+
+	/*
+		With --rank-safe the query object might have one more result than was asked for (see new_jass_query()), and it's the last line
+	*/
+	if (parameter_rank_safe && QUERY::can_stop_early)
+		{
+		size_t keep = 0;
+		for (size_t line = 0; line < parameter_top_k && keep < results_list.size(); line++)
+			{
+			size_t end_of_line = results_list.find('\n', keep);
+			keep = end_of_line == std::string::npos ? results_list.size() : end_of_line + 1;
+			}
+		results_list.erase(keep);
+		}
+	}
+
+/*
+	ANYTIME()
+	---------
+*/
+template <typename QUERY>
+void anytime(JASS_anytime_thread_result &output, const JASS::deserialised_jass_v1 &index, std::vector<JASS_anytime_query> &query_list, size_t postings_to_process, size_t budget_in_ns, size_t top_k)
+	{
+	/*
+		Allocate the Score-at-a-Time table
+	*/
+	JASS_anytime_segment_header *segment_order = new JASS_anytime_segment_header[MAX_TERMS_PER_QUERY * MAX_QUANTUM];
+
+	/*
+		Allocate a JASS query object
+	*/
+	std::unique_ptr<QUERY> jass_query = new_jass_query<QUERY>(index, top_k, index.document_count());
+
+	/*
+		Allocate the intra-query parallel partitions and the blocked processing batch (if they are being used)
+	*/
+	JASS_anytime_partitions<QUERY> partitions;
+	partitions.init(parameter_partitions, [&index, top_k](size_t documents){return new_jass_query<QUERY>(index, top_k, documents);}, index.primary_keys(), index.document_count());
+	JASS_anytime_blocked blocked;
+	blocked.init(parameter_block_width, parameter_block_batch, index.document_count());
+	JASS_anytime_delta<QUERY> deltas;
+	deltas.init(delta_index, index.document_count(), [top_k](const JASS::deserialised_jass_v1 &delta){return new_jass_query<QUERY>(delta, top_k, delta.document_count());});
+
+	/*
+		Start the timer
+	*/
+	auto total_search_time = JASS::timer::start();
+
+	/*
+		Now start searching
+	*/
+	size_t next_query = 0;
+	std::string query = JASS_anytime_query::get_next_query(query_list, next_query);
+	std::string query_id;
+	std::string results_list;
+	JASS_anytime_phase_times phases;
+
+	while (query.size() != 0)
+		{
+		/*
+			Extract the query ID from the query
+		*/
+		extract_query_id(query_id, query);
+
+		/*
+			Process the query (unless its results list is in the result cache)
+		*/
+		auto query_time = JASS::timer::start();
+		phases.start(query_time);
+		parse_query(*jass_query, query);
+		std::string key = result_cache.key(jass_query->terms(), top_k, postings_to_process, budget_in_ns);
+		bool cached = result_cache.find(results_list, key, query_id);
+		phases.lap(JASS_anytime_phase_times::PARSE);
+
+		size_t postings_processed = 0;
+		if (!cached)
+			{
+			if (deltas.size() != 0)
+				postings_processed += search_deltas(deltas, index, query, query_time, segment_order, postings_to_process, budget_in_ns, phases);
+			postings_processed += search(*jass_query, query_time, segment_order, index, postings_to_process, budget_in_ns, partitions, blocked, phases);
+			if (deltas.size() != 0)
+				merge_deltas(deltas, *jass_query, partitions, phases);
 			}
 
-		jass_query->sort();
-		
 		/*
 			stop the timer
 		*/
@@ -245,16 +614,16 @@ void anytime(JASS_anytime_thread_result &output, const JASS::deserialised_jass_v
 		/*
 			Serialise the results list (don't time this)
 		*/
-		std::ostringstream results_list;
-#if defined(ACCUMULATOR_64s) || defined(QUERY_HEAP) || defined(QUERY_MAXBLOCK_HEAP)
-		JASS::run_export(JASS::run_export::TREC, results_list, query_id.c_str(), *jass_query, "JASSv2", true, true);
-#else
-		JASS::run_export(JASS::run_export::TREC, results_list, query_id.c_str(), *jass_query, "JASSv2", true, false);
-#endif
+		if (!cached)
+			{
+			export_results(results_list, query_id, *jass_query, partitions, deltas);
+			result_cache.insert(key, results_list);
+			}
+
 		/*
 			Store the results (and the time it took)
 		*/
-		output.push_back(query_id, query, results_list.str(), postings_processed, time_taken);
+		output.push_back(query_id, query, results_list, postings_processed, time_taken, phases);
 
 		/*
 			Re-start the timer
@@ -273,6 +642,262 @@ void anytime(JASS_anytime_thread_result &output, const JASS::deserialised_jass_v
 	delete [] segment_order;
 	}
 
+/*
+	STOP_SERVER()
+	-------------
+*/
+/*!
+	@brief Stop the search server: no more connections are accepted and each worker returns once it has answered the query it is resolving.
+	@details Called when a client sends ".quit" or when the process gets SIGINT or SIGTERM (so it only does async-signal-safe things).  Shutting down
+	the sockets wakes the workers waiting in accept() and those waiting for their client to send a query.
+*/
+void stop_server(void)
+	{
+	server_stopping = true;
+	JASS::channel_socket::shutdown(server_listener);
+	for (size_t which = 0; which < server_workers; which++)
+		JASS::channel_socket::shutdown(server_clients[which]);
+	}
+
+/*
+	STOP_SERVER_ON_SIGNAL()
+	-----------------------
+*/
+/*!
+	@brief Signal handler for SIGINT and SIGTERM in server mode.
+	@param signal [in] The signal (unused).
+*/
+void stop_server_on_signal(int signal)
+	{
+	stop_server();
+	}
+
+/*
+	SERVE()
+	-------
+*/
+/*!
+	@brief A search server worker.  Accept connections on the listener and resolve the queries sent down each connection.
+	@details Each worker owns its own warm query object and Score-at-a-Time table so nothing is allocated per query.  The
+	protocol is line based: the client sends one query per line (prefixed with the query-id, as in a query file) and
+	the server replies with the TREC-format results list followed by an empty line.  The connection is closed when
+	the client closes its end.  The worker returns once the server is stopped (see stop_server()).
+	@param worker [in] The number of this worker (counting from 0)
+	@param listener [in] The listening socket (shared by all workers)
+	@param index [in] The index to search
+	@param postings_to_process [in] The maximum number of postings to process
+	@param budget_in_ns [in] The wall-clock time limit per query in nanoseconds (0 for no limit)
+	@param top_k [in] The number of results to return
+*/
+template <typename QUERY>
+void serve(size_t worker, int listener, const JASS::deserialised_jass_v1 &index, size_t postings_to_process, size_t budget_in_ns, size_t top_k)
+	{
+	std::unique_ptr<JASS_anytime_segment_header []> segment_order(new JASS_anytime_segment_header[MAX_TERMS_PER_QUERY * MAX_QUANTUM]);
+	std::unique_ptr<QUERY> jass_query = new_jass_query<QUERY>(index, top_k, index.document_count());
+	JASS_anytime_partitions<QUERY> partitions;
+	partitions.init(parameter_partitions, [&index, top_k](size_t documents){return new_jass_query<QUERY>(index, top_k, documents);}, index.primary_keys(), index.document_count());
+	JASS_anytime_blocked blocked;
+	blocked.init(parameter_block_width, parameter_block_batch, index.document_count());
+	JASS_anytime_delta<QUERY> deltas;
+	deltas.init(delta_index, index.document_count(), [top_k](const JASS::deserialised_jass_v1 &delta){return new_jass_query<QUERY>(delta, top_k, delta.document_count());});
+	std::string query;
+	std::string query_id;
+	std::string cached_results;
+	std::ostringstream results_list;
+	JASS_anytime_phase_times phases;
+
+	int client;
+	while (!server_stopping && (client = JASS::channel_socket::accept(listener)) >= 0)
+		{
+		JASS::channel_socket connection(client);
+
+		/*
+			Register the connection so that stop_server() can wake this worker if it is waiting for the client.  The flag is checked after
+			registering so that either this worker sees it or stop_server() sees the connection.
+		*/
+		server_clients[worker] = client;
+		if (server_stopping)
+			{
+			server_clients[worker] = -1;
+			break;
+			}
+
+		for (connection.gets(query); query.size() != 0 && !server_stopping; connection.gets(query))
+			{
+			std::size_t found = query.find_last_not_of(" \t\f\v\n\r");
+			if (found != std::string::npos)
+				{
+				query.erase(found + 1);
+				if (query == ".quit")
+					{
+					stop_server();
+					break;
+					}
+				extract_query_id(query_id, query);
+
+				auto query_time = JASS::timer::start();
+				phases.start(query_time);
+				parse_query(*jass_query, query);
+				std::string key = result_cache.key(jass_query->terms(), top_k, postings_to_process, budget_in_ns);
+				if (result_cache.find(cached_results, key, query_id))
+					results_list << cached_results;
+				else
+					{
+					if (deltas.size() != 0)
+						search_deltas(deltas, index, query, query_time, segment_order.get(), postings_to_process, budget_in_ns, phases);
+					search(*jass_query, query_time, segment_order.get(), index, postings_to_process, budget_in_ns, partitions, blocked, phases);
+					if (deltas.size() != 0)
+						merge_deltas(deltas, *jass_query, partitions, phases);
+					export_results(cached_results, query_id, *jass_query, partitions, deltas);
+					results_list << cached_results;
+					result_cache.insert(key, cached_results);
+					}
+				}
+
+			/*
+				A blank line marks the end of the results list (a blank query gets an empty results list).
+			*/
+			results_list << '\n';
+			connection << results_list.str();
+			results_list.str("");
+			}
+		server_clients[worker] = -1;
+		}
+	}
+
+/*
+	CALIBRATE()
+	-----------
+*/
+/*!
+	@brief Learn the cost of processing a segment by timing the segments of a sample of the vocabulary.
+	@details The sample is processed twice and only the second pass is measured so that the model reflects a warm index.
+	@param model [out] The model to train.
+	@param index [in] The index to sample.
+	@param top_k [in] The number of results the query objects will return.
+*/
+template <typename QUERY>
+void calibrate(JASS_anytime_cost_model &model, JASS::deserialised_jass_v1 &index, size_t top_k)
+	{
+	std::unique_ptr<QUERY> jass_query = new_jass_query<QUERY>(index, top_k, index.document_count());
+	size_t terms = index.term_count();
+	size_t stride = JASS::maths::maximum(static_cast<size_t>(1), terms / CALIBRATION_TERMS);
+
+	for (size_t pass = 0; pass < 2; pass++)
+		for (size_t which = 0; which < terms; which += stride)
+			{
+			auto metadata = index.vocabulary_term(which);
+			if (metadata.impacts == 0)
+				continue;
+
+			JASS::query::ACCUMULATOR_TYPE highest = metadata.highest_impact;
+			JASS::query::ACCUMULATOR_TYPE lowest = metadata.lowest_impact;
+			if (highest == 0)
+				{
+				auto first_segment_in_postings_list = index.segment(metadata, 0);
+				auto last_segment_in_postings_list = index.segment(metadata, metadata.impacts - 1);
+				highest = JASS::maths::maximum(first_segment_in_postings_list.impact, last_segment_in_postings_list.impact);
+				lowest = JASS::maths::minimum(first_segment_in_postings_list.impact, last_segment_in_postings_list.impact);
+				}
+
+			/*
+				Each document occurs only once in a postings list so the largest possible rsv is the largest impact
+			*/
+			jass_query->rewind(lowest, highest, highest);
+			for (uint64_t segment = 0; segment < metadata.impacts; segment++)
+				{
+				auto header = index.segment(metadata, segment);
+				auto segment_time = JASS::timer::start();
+				jass_query->decode_and_process(header.impact, header.segment_frequency, index.postings() + header.offset, header.end - header.offset);
+				auto time_taken = JASS::timer::stop(segment_time).nanoseconds();
+				if (pass != 0)
+					model.add(header.segment_frequency, time_taken);
+				}
+			}
+
+	model.fit();
+	}
+
+/*
+	CLASS ENGINE
+	------------
+*/
+/*!
+	@brief A top-k strategy paired with an accumulator strategy, and the search methods instantiated for that pair.
+*/
+class engine
+	{
+	public:
+		const char *name;																																								///< The name of the strategy (as given to -s)
+		void (*anytime)(JASS_anytime_thread_result &, const JASS::deserialised_jass_v1 &, std::vector<JASS_anytime_query> &, size_t, size_t, size_t);	///< Resolve a list of queries (see anytime())
+		void (*serve)(size_t, int, const JASS::deserialised_jass_v1 &, size_t, size_t, size_t);																	///< Serve queries on a socket (see serve())
+		void (*calibrate)(JASS_anytime_cost_model &, JASS::deserialised_jass_v1 &, size_t);																	///< Learn the segment cost model (see calibrate())
+	};
+
+/*
+	MAKE_ENGINE()
+	-------------
+*/
+/*!
+	@brief Instantiate the search methods for the given query class.
+	@param name [in] The name of the strategy (as given to -s).
+	@return The engine.
+*/
+template <typename QUERY>
+engine make_engine(const char *name)
+	{
+	return engine{name, anytime<QUERY>, serve<QUERY>, calibrate<QUERY>};
+	}
+
+/*
+	The accumulator strategies
+*/
+typedef JASS::accumulator_2d<JASS::query::ACCUMULATOR_TYPE> accumulator_2d;
+typedef JASS::accumulator_counter<JASS::query::ACCUMULATOR_TYPE, 8> accumulator_counter_8;
+typedef JASS::accumulator_counter<JASS::query::ACCUMULATOR_TYPE, 4> accumulator_counter_4;
+typedef JASS::accumulator_counter_interleaved<JASS::query::ACCUMULATOR_TYPE, 8> accumulator_interleaved_8;
+typedef JASS::accumulator_counter_interleaved<JASS::query::ACCUMULATOR_TYPE, 8, 1> accumulator_interleaved_8_1;
+typedef JASS::accumulator_counter_interleaved<JASS::query::ACCUMULATOR_TYPE, 4> accumulator_interleaved_4;
+
+/*
+	ENGINES
+	-------
+	The strategies that can be chosen with -s.  The first is the default.
+*/
+const engine engines[] =
+	{
+	make_engine<JASS::query_heap_clean<accumulator_2d>>("heap-2d"),
+	make_engine<JASS::query_heap_clean<accumulator_counter_8>>("heap-counter8"),
+	make_engine<JASS::query_heap_clean<accumulator_counter_4>>("heap-counter4"),
+	make_engine<JASS::query_heap_clean<accumulator_interleaved_8>>("heap-interleaved8"),
+	make_engine<JASS::query_heap_clean<accumulator_interleaved_8_1>>("heap-interleaved8_1"),
+	make_engine<JASS::query_heap_clean<accumulator_interleaved_4>>("heap-interleaved4"),
+	make_engine<JASS::query_heap<accumulator_2d>>("heapsimd-2d"),
+	make_engine<JASS::query_heap<accumulator_counter_8>>("heapsimd-counter8"),
+	make_engine<JASS::query_heap<accumulator_counter_4>>("heapsimd-counter4"),
+	make_engine<JASS::query_heap<accumulator_interleaved_8>>("heapsimd-interleaved8"),
+	make_engine<JASS::query_heap<accumulator_interleaved_8_1>>("heapsimd-interleaved8_1"),
+	make_engine<JASS::query_heap<accumulator_interleaved_4>>("heapsimd-interleaved4"),
+	make_engine<JASS::query_bucket<accumulator_2d>>("bucket-2d"),
+	make_engine<JASS::query_bucket<accumulator_counter_8>>("bucket-counter8"),
+	make_engine<JASS::query_bucket<accumulator_counter_4>>("bucket-counter4"),
+	make_engine<JASS::query_bucket<accumulator_interleaved_8>>("bucket-interleaved8"),
+	make_engine<JASS::query_bucket<accumulator_interleaved_8_1>>("bucket-interleaved8_1"),
+	make_engine<JASS::query_bucket<accumulator_interleaved_4>>("bucket-interleaved4"),
+	make_engine<JASS::query_maxblock<accumulator_2d>>("maxblock-2d"),
+	make_engine<JASS::query_maxblock<accumulator_counter_8>>("maxblock-counter8"),
+	make_engine<JASS::query_maxblock<accumulator_counter_4>>("maxblock-counter4"),
+	make_engine<JASS::query_maxblock<accumulator_interleaved_8>>("maxblock-interleaved8"),
+	make_engine<JASS::query_maxblock<accumulator_interleaved_8_1>>("maxblock-interleaved8_1"),
+	make_engine<JASS::query_maxblock<accumulator_interleaved_4>>("maxblock-interleaved4"),
+	make_engine<JASS::query_maxblock_heap<accumulator_2d>>("maxblockheap-2d"),
+	make_engine<JASS::query_maxblock_heap<accumulator_counter_8>>("maxblockheap-counter8"),
+	make_engine<JASS::query_maxblock_heap<accumulator_counter_4>>("maxblockheap-counter4"),
+	make_engine<JASS::query_maxblock_heap<accumulator_interleaved_8>>("maxblockheap-interleaved8"),
+	make_engine<JASS::query_maxblock_heap<accumulator_interleaved_8_1>>("maxblockheap-interleaved8_1"),
+	make_engine<JASS::query_maxblock_heap<accumulator_interleaved_4>>("maxblockheap-interleaved4")
+	};
+
 /*
 	MAKE_INPUT_CHANNEL()
 	--------------------
@@ -323,12 +948,32 @@ int main_event(int argc, const char *argv[])
 	if (parameter_help)
 		exit(usage(argv[0]));
 
-	if (parameter_top_k > MAX_TOP_K)
+	/*
+		Find the top-k and accumulator strategy
+	*/
+	const engine *strategy = nullptr;
+	for (const auto &candidate : engines)
+		if (parameter_strategy == candidate.name)
+			strategy = &candidate;
+	if (strategy == nullptr)
 		{
-		std::cout << "top-k specified (" << parameter_top_k << ") is larger than maximum TOP-K (" << MAX_TOP_K << "), change MAX_TOP_K in " << __FILE__  << " and recompile.\n";
+		std::cout << "Unknown strategy (" << parameter_strategy << "), the strategies are:";
+		for (const auto &candidate : engines)
+			std::cout << ' ' << candidate.name;
+		std::cout << "\n";
 		exit(1);
 		}
 
+	/*
+		Set up the result cache
+	*/
+	if (parameter_cache_eviction != "lru" && parameter_cache_eviction != "fifo")
+		{
+		std::cout << "Unknown result cache eviction policy (" << parameter_cache_eviction << "), the policies are: lru fifo\n";
+		exit(1);
+		}
+	result_cache.init(parameter_cache_entries, parameter_cache_admit, parameter_cache_eviction == "lru" ? JASS_anytime_result_cache::LRU : JASS_anytime_result_cache::FIFO);
+
 	/*
 		Run-time statistics
 	*/
@@ -339,15 +984,44 @@ int main_event(int argc, const char *argv[])
 		Read the index
 	*/
 	JASS::deserialised_jass_v1 index(true);
-	index.read_index();
-
-	if (index.document_count() > MAX_DOCUMENTS)
+	if (index.read_index_directory(".", parameter_validation_threads) == 0)
 		{
-		std::cout << "There are " << index.document_count() << " documents in this index which is larger than MAX_DOCUMENTS (" << MAX_DOCUMENTS << "), change MAX_DOCUMENTS in " << __FILE__ << " and recompile.\n";
+		std::cout << "Cannot read the index\n";
 		exit(1);
 		}
+
 	stats.number_of_documents = index.document_count();
 
+	/*
+		Read the delta indexes (each is a JASS index in its own directory)
+	*/
+	for (size_t start = 0; start < parameter_delta.size(); )
+		{
+		size_t comma = parameter_delta.find(',', start);
+		std::string directory = parameter_delta.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+		start = comma == std::string::npos ? parameter_delta.size() : comma + 1;
+		if (directory.size() == 0)
+			continue;
+
+		auto delta = std::make_unique<JASS::deserialised_jass_v1>(true);
+		if (delta->read_index_directory(directory, parameter_validation_threads) == 0)
+			{
+			std::cout << "Cannot read the delta index in " << directory << "\n";
+			exit(1);
+			}
+		stats.number_of_documents += delta->document_count();
+		delta_index.push_back(std::move(delta));
+		}
+
+	/*
+		Rank-safe early termination reports lower bounds on the rsvs, and those from different indexes cannot be merged
+	*/
+	if (delta_index.size() != 0 && parameter_rank_safe)
+		{
+		std::cout << "--rank-safe is ignored when searching delta indexes\n";
+		parameter_rank_safe = false;
+		}
+
 	/*
 		Set the Anytime stopping criteria
 	*/
@@ -361,6 +1035,51 @@ int main_event(int argc, const char *argv[])
 
 std::cout << "Maximum number of postings to process:" << postings_to_process << "\n";
 
+	/*
+		Set the time budget and, if asked for, learn how long segments take to process
+	*/
+	size_t budget_in_ns = parameter_budget_in_us * 1000;
+	if (budget_in_ns != 0)
+		std::cout << "Time budget per query:" << parameter_budget_in_us << " us\n";
+
+	if (parameter_calibrate)
+		{
+		strategy->calibrate(cost_model, index, parameter_top_k);
+		std::cout << "Segment cost model:" << cost_model.fixed_cost_in_ns << " ns + " << cost_model.cost_per_posting_in_ns << " ns/posting (" << cost_model.postings_per_ns() << " postings/ns)\n";
+		}
+
+	/*
+		In server mode the index stays loaded and each worker thread serves connections until a client sends ".quit" or the process gets SIGINT or SIGTERM.
+	*/
+	if (parameter_server.size() != 0)
+		{
+		int listener = JASS::channel_socket::listen(parameter_server);
+		if (listener < 0)
+			{
+			std::cout << "Cannot listen on " << parameter_server << "\n";
+			exit(1);
+			}
+		std::cout << "Serving on " << parameter_server << " with " << parameter_threads << " worker" << (parameter_threads == 1 ? "" : "s") << "\n" << std::flush;
+
+		server_listener = listener;
+		server_workers = parameter_threads;
+		server_clients.reset(new std::atomic<int>[server_workers]);
+		for (size_t which = 0; which < server_workers; which++)
+			server_clients[which] = -1;
+		std::signal(SIGINT, stop_server_on_signal);
+		std::signal(SIGTERM, stop_server_on_signal);
+
+		std::vector<JASS::thread> workers;
+		for (size_t which = 0; which < parameter_threads; which++)
+			workers.push_back(JASS::thread(strategy->serve, which, listener, std::ref(index), postings_to_process, budget_in_ns, parameter_top_k));
+		for (auto &worker : workers)
+			worker.join();
+
+		JASS::channel_socket::close(listener);
+		std::cout << "Server stopped\n";
+		return 0;
+		}
+
 	/*
 		Read from the query file into a list of queries array.
 	*/
@@ -408,6 +1127,7 @@ std::cout << "Maximum number of postings to process:" << postings_to_process <<
 	int32_t d_ness;
 	index.codex(codex_name, d_ness);
 	std::cout << "Index compressed with " << codex_name << "-D" << d_ness << "\n";
+	std::cout << "Top-k and accumulator strategy:" << strategy->name << "\n";
 
 	/*
 		Start the work
@@ -415,7 +1135,7 @@ std::cout << "Maximum number of postings to process:" << postings_to_process <<
 	auto total_search_time = JASS::timer::start();
 	if (parameter_threads == 1)
 		{
-		anytime(output[0], index, query_list, postings_to_process, parameter_top_k);
+		strategy->anytime(output[0], index, query_list, postings_to_process, budget_in_ns, parameter_top_k);
 		}
 	else
 		{
@@ -423,7 +1143,7 @@ std::cout << "Maximum number of postings to process:" << postings_to_process <<
 			Multiple threads, so start each worker
 		*/
 		for (size_t which = 0; which < parameter_threads ; which++)
-			thread_pool.push_back(JASS::thread(anytime, std::ref(output[which]), std::ref(index), std::ref(query_list), postings_to_process, parameter_top_k));
+			thread_pool.push_back(JASS::thread(strategy->anytime, std::ref(output[which]), std::ref(index), std::ref(query_list), postings_to_process, budget_in_ns, parameter_top_k));
 		/*
 			Wait until they're all done (blocking on the completion of each thread in turn)
 		*/
@@ -432,6 +1152,8 @@ std::cout << "Maximum number of postings to process:" << postings_to_process <<
 		}
 
 	stats.wall_time_in_ns = JASS::timer::stop(total_search_time).nanoseconds();
+	stats.cache_hits = result_cache.hit_count();
+	stats.cache_misses = result_cache.miss_count();
 
 	/*
 		Compute the per-thread stats and dump the results in TREC format
@@ -442,7 +1164,14 @@ std::cout << "Maximum number of postings to process:" << postings_to_process <<
 	for (size_t which = 0; which < parameter_threads ; which++)
 		for (const auto &[query_id, result] : output[which])
 			{
-			stats_file << "<id>" << result.query_id << "</id><query>" << result.query << "</query><postings>" << result.postings_processed << "</postings><time_ns>" << result.search_time_in_ns << "</time_ns>\n";
+			stats_file << "<id>" << result.query_id << "</id><query>" << result.query << "</query><postings>" << result.postings_processed << "</postings><time_ns>" << result.search_time_in_ns << "</time_ns>";
+			for (size_t phase = 0; phase < JASS_anytime_phase_times::PHASES; phase++)
+				{
+				stats_file << '<' << JASS_anytime_phase_times::name[phase] << "_ns>" << result.phases.time_in_ns[phase] << "</" << JASS_anytime_phase_times::name[phase] << "_ns>";
+				stats.phase_latency[phase].add(result.phases.time_in_ns[phase]);
+				}
+			stats_file << '\n';
+			stats.latency.add(result.search_time_in_ns);
 			stats.sum_of_CPU_time_in_ns += result.search_time_in_ns;
 			TREC_file << result.results_list;
 			}
@@ -0,0 +1,206 @@
+/*
+	JASS_ANYTIME_BLOCKED.H
+	----------------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Blocked Score-at-a-Time processing that keeps the accumulators being written to in cache.
+	@author Andrew Trotman
+	@copyright 2021 Andrew Trotman
+*/
+#pragma once
+
+#include <vector>
+
+#include "simd.h"
+#include "maths.h"
+#include "query.h"
+#include "JASS_anytime_segment_header.h"
+
+/*
+	CLASS JASS_ANYTIME_BLOCKED
+	--------------------------
+*/
+/*!
+	@brief Process a batch of impact segments one range of document ids (a block) at a time.
+	@details On a large collection the accumulators do not fit in cache so processing a long segment is a walk over the whole
+	accumulator array, and the next segment walks it again.  Here the segments are decoded (and D1-decoded) into a batch as they
+	arrive, then, when the batch is full, the postings of every segment in the batch that fall in the first block of document
+	ids are added to the accumulators, then those in the second block, and so on.  With a cache-sized block the accumulators
+	(and the 2-d accumulator dirty flags) of a block stay in cache while all the segments of the batch are applied to them.
+	The postings of a segment are sorted so each segment needs only a cursor.  The postings are still added with the
+	query object's add_rsv() so the top-k heap (and its threshold) is maintained exactly as before, and once the batch has been
+	applied the accumulators and the top-k are identical to those of processing the segments one after the other.
+*/
+class JASS_anytime_blocked
+	{
+	private:
+		/*
+			CLASS JASS_ANYTIME_BLOCKED::SEGMENT
+			-----------------------------------
+		*/
+		/*!
+			@brief A decoded segment in the batch.
+		*/
+		class segment
+			{
+			public:
+				JASS::query::ACCUMULATOR_TYPE impact;		///< The impact score to add to each document in the segment
+				const JASS::query::DOCID_TYPE *current;	///< The next posting to process
+				const JASS::query::DOCID_TYPE *end;			///< One past the last posting in the segment
+			};
+
+	private:
+		static constexpr size_t alignment = sizeof(__m512i) / sizeof(JASS::query::DOCID_TYPE);		///< Each segment is decoded to a 64-byte aligned address
+		static constexpr size_t overflow = 64 * alignment;															///< Decoders can write this far past the end of a segment
+
+	private:
+		size_t block_width;												///< The number of document ids in a block (0 turns blocking off)
+		size_t batch_postings;											///< A batch is processed once it holds this many postings
+		std::vector<__m512i> buffer;									///< The decoded postings of the batch
+		size_t capacity;													///< The number of document ids the buffer can hold (less the decoder overflow)
+		size_t used;														///< The number of document ids of the buffer in use (including alignment)
+		size_t postings;													///< The number of postings in the batch
+		JASS::query::DOCID_TYPE largest_document_id;				///< The largest document id in the batch
+		std::vector<segment> batch;									///< The segments in the batch
+
+	public:
+		/*
+			JASS_ANYTIME_BLOCKED::JASS_ANYTIME_BLOCKED()
+			--------------------------------------------
+		*/
+		/*!
+			@brief Constructor
+		*/
+		JASS_anytime_blocked() :
+			block_width(0),
+			batch_postings(0),
+			capacity(0),
+			used(0),
+			postings(0),
+			largest_document_id(0)
+			{
+			/* Nothing */
+			}
+
+		/*
+			JASS_ANYTIME_BLOCKED::INIT()
+			----------------------------
+		*/
+		/*!
+			@brief Allocate the batch.
+			@param block_width [in] The number of document ids in a block (0 turns blocking off).
+			@param batch_postings [in] Process the batch once it holds at least this many postings.
+			@param documents [in] The number of documents in the collection (the longest possible segment).
+		*/
+		void init(size_t block_width, size_t batch_postings, size_t documents)
+			{
+			this->block_width = block_width;
+			if (block_width == 0)
+				return;
+
+			this->batch_postings = JASS::maths::maximum(batch_postings, static_cast<size_t>(1));
+			capacity = JASS::maths::maximum(this->batch_postings * 2, documents + alignment);
+			buffer.resize((capacity + overflow + alignment - 1) / alignment);
+			}
+
+		/*
+			JASS_ANYTIME_BLOCKED::SIZE()
+			----------------------------
+		*/
+		/*!
+			@brief Return the width of a block.
+			@return The number of document ids in a block (0 if blocking is off).
+		*/
+		size_t size(void) const
+			{
+			return block_width;
+			}
+
+		/*
+			JASS_ANYTIME_BLOCKED::PENDING()
+			-------------------------------
+		*/
+		/*!
+			@brief Return the number of postings that have been decoded but not yet added to the accumulators.
+			@return The number of postings in the batch.
+		*/
+		size_t pending(void) const
+			{
+			return postings;
+			}
+
+		/*
+			JASS_ANYTIME_BLOCKED::FLUSH()
+			-----------------------------
+		*/
+		/*!
+			@brief Add the postings of the batch to the accumulators one block at a time, and empty the batch.
+			@param jass_query [in/out] The query object holding the accumulators.
+		*/
+		template <typename QUERY>
+		void flush(QUERY &jass_query)
+			{
+			for (size_t block_end = block_width; batch.size() != 0; block_end += block_width)
+				{
+				for (auto &current : batch)
+					{
+					const JASS::query::DOCID_TYPE *document = current.current;
+					const JASS::query::DOCID_TYPE *end = current.end;
+					JASS::query::ACCUMULATOR_TYPE impact = current.impact;
+
+					while (document < end && *document < block_end)
+						jass_query.add_rsv(*document++, impact);
+					current.current = document;
+					}
+
+				if (block_end > largest_document_id)
+					break;
+				}
+
+			batch.clear();
+			used = 0;
+			postings = 0;
+			largest_document_id = 0;
+			}
+
+		/*
+			JASS_ANYTIME_BLOCKED::ADD()
+			---------------------------
+		*/
+		/*!
+			@brief Decode a segment into the batch, first processing the batch if the segment does not fit.
+			@param jass_query [in/out] The query object (which holds the decoder and the accumulators).
+			@param header [in] The segment to add.
+			@param postings_memory [in] The postings list memory.
+			@return true if the batch was processed (and is now empty, so the top-k is up to date), else false.
+		*/
+		template <typename QUERY>
+		bool add(QUERY &jass_query, const JASS_anytime_segment_header &header, const uint8_t *postings_memory)
+			{
+			size_t start = (used + alignment - 1) & ~(alignment - 1);
+			if (batch.size() != 0 && start + header.segment_frequency > capacity)
+				{
+				flush(jass_query);
+				start = 0;
+				}
+
+			JASS::query::DOCID_TYPE *into = reinterpret_cast<JASS::query::DOCID_TYPE *>(buffer.data()) + start;
+			jass_query.decode(into, header.segment_frequency, postings_memory + header.offset, header.end - header.offset);
+			JASS::simd::cumulative_sum(into, header.segment_frequency);
+
+			batch.push_back(segment{header.impact, into, into + header.segment_frequency});
+			used = start + header.segment_frequency;
+			postings += header.segment_frequency;
+			if (header.segment_frequency != 0)
+				largest_document_id = JASS::maths::maximum(largest_document_id, into[header.segment_frequency - 1]);
+
+			if (postings < batch_postings)
+				return false;
+
+			flush(jass_query);
+			return true;
+			}
+	};
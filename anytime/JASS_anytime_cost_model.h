@@ -0,0 +1,135 @@
+/*
+	JASS_ANYTIME_COST_MODEL.H
+	-------------------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief A linear model of the time it takes to process an impact segment.
+	@author Andrew Trotman
+	@copyright 2021 Andrew Trotman
+*/
+#pragma once
+
+#include <stddef.h>
+
+/*
+	CLASS JASS_ANYTIME_COST_MODEL
+	-----------------------------
+*/
+/*!
+	@brief A model of the time (in nanoseconds) it takes to decode and process an impact segment, learned from observations.
+	@details The model is time = fixed_cost + cost_per_posting * segment_frequency, fitted by least squares.  It is used
+	by the time-budgeted anytime stopping rule to predict whether the next segment will fit in the time that remains.
+*/
+class JASS_anytime_cost_model
+	{
+	private:
+		double observations;					///< The number of observations
+		double sum_of_postings;				///< Sum of the segment frequencies
+		double sum_of_times;					///< Sum of the times (in nanoseconds)
+		double sum_of_postings_squared;	///< Sum of the squares of the segment frequencies
+		double sum_of_products;				///< Sum of segment frequency times time
+
+	public:
+		double fixed_cost_in_ns;			///< The cost of processing a segment regardless of its length
+		double cost_per_posting_in_ns;	///< The cost of processing each posting in a segment
+
+	public:
+		/*
+			JASS_ANYTIME_COST_MODEL::JASS_ANYTIME_COST_MODEL()
+			--------------------------------------------------
+		*/
+		/*!
+			@brief Constructor
+		*/
+		JASS_anytime_cost_model() :
+			observations(0),
+			sum_of_postings(0),
+			sum_of_times(0),
+			sum_of_postings_squared(0),
+			sum_of_products(0),
+			fixed_cost_in_ns(0),
+			cost_per_posting_in_ns(0)
+			{
+			/* Nothing */
+			}
+
+		/*
+			JASS_ANYTIME_COST_MODEL::ADD()
+			------------------------------
+		*/
+		/*!
+			@brief Add an observation of the time it took to process a segment.
+			@param postings [in] The segment frequency (number of postings in the segment).
+			@param time_in_ns [in] How long the segment took to process.
+		*/
+		void add(size_t postings, size_t time_in_ns)
+			{
+			double x = static_cast<double>(postings);
+			double y = static_cast<double>(time_in_ns);
+
+			observations++;
+			sum_of_postings += x;
+			sum_of_times += y;
+			sum_of_postings_squared += x * x;
+			sum_of_products += x * y;
+			}
+
+		/*
+			JASS_ANYTIME_COST_MODEL::FIT()
+			------------------------------
+		*/
+		/*!
+			@brief Fit the model to the observations seen so far.  Neither cost is allowed to be negative.
+		*/
+		void fit(void)
+			{
+			if (observations == 0)
+				return;
+
+			double denominator = observations * sum_of_postings_squared - sum_of_postings * sum_of_postings;
+			if (denominator != 0)
+				{
+				cost_per_posting_in_ns = (observations * sum_of_products - sum_of_postings * sum_of_times) / denominator;
+				fixed_cost_in_ns = (sum_of_times - cost_per_posting_in_ns * sum_of_postings) / observations;
+				}
+
+			/*
+				If the line is nonsense (noisy timings or all segments the same length) fall back to a pure rate.
+			*/
+			if (denominator == 0 || cost_per_posting_in_ns <= 0 || fixed_cost_in_ns < 0)
+				{
+				fixed_cost_in_ns = 0;
+				cost_per_posting_in_ns = sum_of_postings == 0 ? 0 : sum_of_times / sum_of_postings;
+				}
+			}
+
+		/*
+			JASS_ANYTIME_COST_MODEL::PREDICT()
+			----------------------------------
+		*/
+		/*!
+			@brief Predict how long it will take to process a segment.
+			@param postings [in] The segment frequency (number of postings in the segment).
+			@return The predicted time in nanoseconds.
+		*/
+		size_t predict(size_t postings) const
+			{
+			return static_cast<size_t>(fixed_cost_in_ns + cost_per_posting_in_ns * static_cast<double>(postings));
+			}
+
+		/*
+			JASS_ANYTIME_COST_MODEL::POSTINGS_PER_NS()
+			------------------------------------------
+		*/
+		/*!
+			@brief The throughput of the model on long segments.
+			@return The number of postings processed per nanosecond.
+		*/
+		double postings_per_ns(void) const
+			{
+			return cost_per_posting_in_ns == 0 ? 0 : 1.0 / cost_per_posting_in_ns;
+			}
+	};
@@ -0,0 +1,221 @@
+/*
+	JASS_ANYTIME_DELTA.H
+	--------------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Search small delta indexes alongside the main index and merge their top-k lists.
+	@author Andrew Trotman
+	@copyright 2021 Andrew Trotman
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <string_view>
+
+#include "query.h"
+#include "deserialised_jass_v1.h"
+
+/*
+	CLASS JASS_ANYTIME_DELTA
+	------------------------
+*/
+/*!
+	@brief Documents added since the main index was built are indexed (by JASS_index) into delta indexes, each in its own directory.
+	@details Each delta has its own query object (and so its own accumulators and top-k heap).  Once the main index and each delta
+	have been searched the top-k lists are merged.  The documents of the first delta are numbered from the number of documents in the main
+	index, those of the second delta from there, and so on, so the document ids (and the order in which ties are broken) are those
+	that JASS_merge gives the documents when it folds the deltas into the main index.
+	@tparam QUERY The query class (top-k and accumulator strategy) used by each delta.
+*/
+template <typename QUERY>
+class JASS_anytime_delta
+	{
+	private:
+		/*
+			CLASS JASS_ANYTIME_DELTA::RESULT
+			--------------------------------
+		*/
+		/*!
+			@brief A <rsv, document_id, primary_key> triple used for merging the results of the indexes.
+		*/
+		class result
+			{
+			public:
+				JASS::query::ACCUMULATOR_TYPE rsv;			///< The rsv (Retrieval Status Value) relevance score
+				size_t document_id;								///< The document identifier (counting over the main index then the deltas)
+				std::string_view primary_key;					///< The primary key of the document
+
+			public:
+				/*
+					JASS_ANYTIME_DELTA::RESULT::OPERATOR>()
+					---------------------------------------
+				*/
+				/*!
+					@brief Order results from highest to lowest rsv, breaking ties on the higher document id (as the heap does).
+					@param with [in] The result to compare to.
+					@return true if this result ranks before with.
+				*/
+				bool operator>(const result &with) const
+					{
+					return rsv > with.rsv || (rsv == with.rsv && document_id > with.document_id);
+					}
+			};
+
+	private:
+		std::vector<const JASS::deserialised_jass_v1 *> index;				///< The delta indexes
+		std::vector<std::unique_ptr<QUERY>> delta_query;						///< The query object for each delta
+		std::vector<size_t> first_document_id;									///< The document id of the first document of each delta
+		std::vector<result> merged;													///< The merged top-k results (before conversion to results)
+		std::vector<JASS::query::docid_rsv_pair> results;						///< The merged top-k
+
+	public:
+		/*
+			JASS_ANYTIME_DELTA::INIT()
+			--------------------------
+		*/
+		/*!
+			@brief Allocate a query object for each delta.
+			@param deltas [in] The delta indexes (in the order in which they were built).
+			@param main_documents [in] The number of documents in the main index.
+			@param new_query [in] A function that, given an index, returns a new initialised query object for that index.
+		*/
+		template <typename NEW_QUERY>
+		void init(const std::vector<std::unique_ptr<JASS::deserialised_jass_v1>> &deltas, size_t main_documents, NEW_QUERY new_query)
+			{
+			size_t documents = main_documents;
+			for (const auto &delta : deltas)
+				{
+				index.push_back(delta.get());
+				delta_query.push_back(new_query(*delta));
+				first_document_id.push_back(documents);
+				documents += delta->document_count();
+				}
+			}
+
+		/*
+			JASS_ANYTIME_DELTA::SIZE()
+			--------------------------
+		*/
+		/*!
+			@brief Return the number of deltas.
+			@return The number of deltas (0 if there are none).
+		*/
+		size_t size(void) const
+			{
+			return delta_query.size();
+			}
+
+		/*
+			JASS_ANYTIME_DELTA::DELTA_INDEX()
+			---------------------------------
+		*/
+		/*!
+			@brief Return one of the delta indexes.
+			@param which [in] The delta.
+			@return The index.
+		*/
+		const JASS::deserialised_jass_v1 &delta_index(size_t which) const
+			{
+			return *index[which];
+			}
+
+		/*
+			JASS_ANYTIME_DELTA::QUERY_OBJECT()
+			----------------------------------
+		*/
+		/*!
+			@brief Return the query object used to search one of the deltas.
+			@param which [in] The delta.
+			@return The query object.
+		*/
+		QUERY &query_object(size_t which)
+			{
+			return *delta_query[which];
+			}
+
+		/*
+			JASS_ANYTIME_DELTA::MERGE()
+			---------------------------
+		*/
+		/*!
+			@brief Merge the top-k of the main index with the top-k of each delta (which must all have been searched).
+			@param main_results [in] The results from the main index (a query object or the intra-query parallel partitions).
+			@param top_k [in] The number of results to keep.
+		*/
+		template <typename RESULTS>
+		void merge(RESULTS &main_results, size_t top_k)
+			{
+			merged.clear();
+			for (const auto document : main_results)
+				merged.push_back(result{document.rsv, document.document_id, document.primary_key});
+
+			for (size_t which = 0; which < delta_query.size(); which++)
+				for (const auto document : *delta_query[which])
+					merged.push_back(result{document.rsv, first_document_id[which] + document.document_id, document.primary_key});
+
+			size_t keep = (std::min)(top_k, merged.size());
+			std::partial_sort(merged.begin(), merged.begin() + keep, merged.end(), [](const result &lhs, const result &rhs){return lhs > rhs;});
+
+			results.clear();
+			for (size_t which = 0; which < keep; which++)
+				results.emplace_back(merged[which].document_id, merged[which].primary_key, merged[which].rsv);
+			}
+
+		/*
+			JASS_ANYTIME_DELTA::BEGIN()
+			---------------------------
+		*/
+		/*!
+			@brief Return an iterator pointing to the start of the merged top-k (highest rsv first).
+			@return Iterator pointing to the start of the top-k.
+		*/
+		auto begin(void)
+			{
+			return results.begin();
+			}
+
+		/*
+			JASS_ANYTIME_DELTA::END()
+			-------------------------
+		*/
+		/*!
+			@brief Return an iterator pointing to the end of the merged top-k.
+			@return Iterator pointing to the end of the top-k.
+		*/
+		auto end(void)
+			{
+			return results.end();
+			}
+
+		/*
+			JASS_ANYTIME_DELTA::RBEGIN()
+			----------------------------
+		*/
+		/*!
+			@brief Return a reverse iterator pointing to the end of the merged top-k (lowest rsv first).
+			@return Reverse iterator pointing to the end of the top-k.
+		*/
+		auto rbegin(void)
+			{
+			return results.rbegin();
+			}
+
+		/*
+			JASS_ANYTIME_DELTA::REND()
+			--------------------------
+		*/
+		/*!
+			@brief Return a reverse iterator pointing to one before the start of the merged top-k.
+			@return Reverse iterator pointing to one before the start of the top-k.
+		*/
+		auto rend(void)
+			{
+			return results.rend();
+			}
+	};
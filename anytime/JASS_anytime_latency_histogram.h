@@ -0,0 +1,169 @@
+/*
+	JASS_ANYTIME_LATENCY_HISTOGRAM.H
+	--------------------------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief A fixed-size log-linear histogram of latencies for computing percentiles.
+	@author Andrew Trotman
+	@copyright 2021 Andrew Trotman
+*/
+#pragma once
+
+#include <math.h>
+
+#include <vector>
+
+#include "maths.h"
+
+/*
+	CLASS JASS_ANYTIME_LATENCY_HISTOGRAM
+	------------------------------------
+*/
+/*!
+	@brief A histogram of latencies (in nanoseconds) in the style of an HDR histogram.
+	@details Values below 128 each get their own bucket.  Above that each power of 2 is split into 64 equal buckets, so a value
+	is recorded to within 1/64 (about 1.6%) of its true value whatever its magnitude.  The histogram covers every size_t in
+	a fixed 3776 buckets, so adding a value is a floor_log2(), a shift and an increment.  A percentile is reported as the
+	largest value that falls into the same bucket as the value at that rank (that is, it is never under-reported).
+*/
+class JASS_anytime_latency_histogram
+	{
+	private:
+		static constexpr size_t sub_bucket_bits = 7;													///< Values below 2^sub_bucket_bits are recorded exactly
+		static constexpr size_t sub_buckets = (size_t)1 << sub_bucket_bits;					///< The number of exact buckets
+		static constexpr size_t half_sub_buckets = sub_buckets / 2;								///< The number of buckets per power of 2 above that
+		static constexpr size_t buckets = sub_buckets + (64 - sub_bucket_bits) * half_sub_buckets;		///< The total number of buckets
+
+	private:
+		std::vector<size_t> count;			///< The number of values in each bucket
+		size_t values;							///< The number of values added
+		size_t largest;						///< The largest value added
+
+	private:
+		/*
+			JASS_ANYTIME_LATENCY_HISTOGRAM::BUCKET()
+			----------------------------------------
+		*/
+		/*!
+			@brief Return the bucket a value falls into.
+			@param value [in] The value.
+			@return The index of the bucket.
+		*/
+		static size_t bucket(size_t value)
+			{
+			if (value < sub_buckets)
+				return value;
+
+			size_t magnitude = JASS::maths::floor_log2(value);
+			size_t shift = magnitude - (sub_bucket_bits - 1);
+			return sub_buckets + (magnitude - sub_bucket_bits) * half_sub_buckets + ((value >> shift) - half_sub_buckets);
+			}
+
+		/*
+			JASS_ANYTIME_LATENCY_HISTOGRAM::HIGHEST_EQUIVALENT_VALUE()
+			----------------------------------------------------------
+		*/
+		/*!
+			@brief Return the largest value that falls into a bucket.
+			@param which [in] The index of the bucket.
+			@return The largest value in the bucket.
+		*/
+		static size_t highest_equivalent_value(size_t which)
+			{
+			if (which < sub_buckets)
+				return which;
+
+			size_t magnitude = (which - sub_buckets) / half_sub_buckets + sub_bucket_bits;
+			size_t shift = magnitude - (sub_bucket_bits - 1);
+			size_t top = (which - sub_buckets) % half_sub_buckets + half_sub_buckets;
+			return ((top + 1) << shift) - 1;
+			}
+
+	public:
+		/*
+			JASS_ANYTIME_LATENCY_HISTOGRAM::JASS_ANYTIME_LATENCY_HISTOGRAM()
+			----------------------------------------------------------------
+		*/
+		/*!
+			@brief Constructor
+		*/
+		JASS_anytime_latency_histogram() :
+			count(buckets),
+			values(0),
+			largest(0)
+			{
+			/* Nothing */
+			}
+
+		/*
+			JASS_ANYTIME_LATENCY_HISTOGRAM::ADD()
+			-------------------------------------
+		*/
+		/*!
+			@brief Add a value to the histogram.
+			@param value [in] The value (normally a latency in nanoseconds).
+		*/
+		void add(size_t value)
+			{
+			count[bucket(value)]++;
+			values++;
+			largest = JASS::maths::maximum(largest, value);
+			}
+
+		/*
+			JASS_ANYTIME_LATENCY_HISTOGRAM::SIZE()
+			--------------------------------------
+		*/
+		/*!
+			@brief Return the number of values in the histogram.
+			@return The number of values added.
+		*/
+		size_t size(void) const
+			{
+			return values;
+			}
+
+		/*
+			JASS_ANYTIME_LATENCY_HISTOGRAM::MAXIMUM()
+			-----------------------------------------
+		*/
+		/*!
+			@brief Return the largest value in the histogram (exactly).
+			@return The largest value added (or 0 if there are none).
+		*/
+		size_t maximum(void) const
+			{
+			return largest;
+			}
+
+		/*
+			JASS_ANYTIME_LATENCY_HISTOGRAM::PERCENTILE()
+			--------------------------------------------
+		*/
+		/*!
+			@brief Return the value at the given percentile.
+			@param percent [in] The percentile (for example, 99.9).
+			@return The value below which percent of the values fall (or 0 if there are none).
+		*/
+		size_t percentile(double percent) const
+			{
+			if (values == 0)
+				return 0;
+
+			size_t rank = static_cast<size_t>(ceil(percent / 100.0 * static_cast<double>(values)));
+			rank = JASS::maths::maximum(rank, static_cast<size_t>(1));
+
+			size_t seen = 0;
+			for (size_t which = 0; which < buckets; which++)
+				{
+				seen += count[which];
+				if (seen >= rank)
+					return JASS::maths::minimum(highest_equivalent_value(which), largest);
+				}
+
+			return largest;
+			}
+	};
@@ -0,0 +1,534 @@
+/*
+	JASS_ANYTIME_PARTITIONS.H
+	-------------------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Intra-query parallelism for the anytime engine by partitioning the document-id space.
+	@author Andrew Trotman
+	@copyright 2021 Andrew Trotman
+*/
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <condition_variable>
+
+#include "simd.h"
+#include "timer.h"
+#include "query.h"
+#include "threads.h"
+#include "JASS_anytime_cost_model.h"
+#include "JASS_anytime_segment_header.h"
+
+/*
+	CLASS JASS_ANYTIME_PARTITIONS
+	-----------------------------
+*/
+/*!
+	@brief Resolve a single query on several threads, each responsible for a contiguous range of document ids.
+	@details Each partition has its own query object (and so its own top-k heap) with accumulators for only its range of document
+	ids.  The segments are processed in batches.  The compressed postings cannot be split by document id so each segment of a batch
+	is decoded (and D1-decoded) once, by whichever thread gets to it first, into a buffer shared by the partitions.  Each partition
+	then finds its range of document ids in each segment with a binary search, skipping the segments (and the parts of segments)
+	outside its range, and adds those postings to its accumulators.  Once all the batches are done the per-partition top-k lists
+	are merged.  The document-id ranges are disjoint and every partition processes the same segments so the merged list is identical
+	to the list produced by a single thread.  The threads are started by init() and wait between queries (the calling thread does
+	the first partition).  With rank-safe early termination the top-k of all the partitions is checked after each batch.
+	@tparam QUERY The query class (top-k and accumulator strategy) used by each partition.
+*/
+template <typename QUERY>
+class JASS_anytime_partitions
+	{
+	private:
+		static constexpr size_t segment_padding = 64 * sizeof(__m512i) / sizeof(JASS::query::DOCID_TYPE);		///< Decompressors can write this far past the end of a segment
+		static constexpr size_t segment_alignment = sizeof(__m512i) / sizeof(JASS::query::DOCID_TYPE);		///< Each segment is decoded to an address aligned on this many integers
+
+		/*
+			CLASS JASS_ANYTIME_PARTITIONS::RESULT
+			-------------------------------------
+		*/
+		/*!
+			@brief A <rsv, document_id> pair used for merging the results of the partitions.
+		*/
+		class result
+			{
+			public:
+				JASS::query::ACCUMULATOR_TYPE rsv;			///< The rsv (Retrieval Status Value) relevance score
+				size_t document_id;								///< The document identifier
+
+			public:
+				/*
+					JASS_ANYTIME_PARTITIONS::RESULT::OPERATOR>()
+					--------------------------------------------
+				*/
+				/*!
+					@brief Order results from highest to lowest rsv, breaking ties on the higher document id (as the heap does).
+					@param with [in] The result to compare to.
+					@return true if this result ranks before with.
+				*/
+				bool operator>(const result &with) const
+					{
+					return rsv > with.rsv || (rsv == with.rsv && document_id > with.document_id);
+					}
+			};
+
+		/*
+			CLASS JASS_ANYTIME_PARTITIONS::QUERY_PARAMETERS
+			-----------------------------------------------
+		*/
+		/*!
+			@brief The query being processed, as given to process().
+		*/
+		class query_parameters
+			{
+			public:
+				const JASS_anytime_segment_header *segment_order;				///< The segments to process, in order
+				const JASS_anytime_segment_header *end_of_segments;			///< One past the last segment to process
+				const uint8_t *postings;												///< The postings list memory
+				JASS::query::ACCUMULATOR_TYPE smallest_possible_rsv;			///< The smallest score any document can have
+				JASS::query::ACCUMULATOR_TYPE largest_possible_rsv;			///< The largest score any document can have
+				decltype(JASS::timer::start()) query_time;						///< The stop watch started when the query was started
+				size_t budget_in_ns;														///< The wall-clock time limit for the query (0 for no limit)
+				const JASS_anytime_cost_model *cost_model;						///< The model used to predict how long a segment will take
+				bool rank_safe;															///< Stop once the top-k cannot change (see query::top_k_is_final())
+				size_t remaining_rsv;													///< The most that the rsv of any document can still increase by
+			};
+
+	private:
+		const JASS::primary_key_list *primary_keys;								///< The primary keys of the documents in the collection
+		std::vector<std::unique_ptr<QUERY>> partition;						///< The query object for each partition (with accumulators for its range of document ids)
+		std::vector<JASS::query::DOCID_TYPE> boundary;								///< Partition p is responsible for document ids [boundary[p], boundary[p + 1])
+		std::vector<result> merged;														///< The merged top-k results (before conversion to results)
+		std::vector<JASS::query::docid_rsv_pair> results;							///< The merged top-k
+		std::vector<JASS::query::ACCUMULATOR_TYPE> top_k_rsvs;					///< Scratch space for checking that the top-k is final
+		bool answered;																			///< Did process() resolve the current query (or was it resolved on a single thread)
+
+		std::vector<__m512i> decompress_buffer;										///< The segments of the current batch are decoded into here
+		std::vector<size_t> batch_offset;												///< The offset (in integers) in decompress_buffer of each segment of the batch
+		const JASS_anytime_segment_header *batch_start;							///< The first segment of the current batch
+		const JASS_anytime_segment_header *batch_end;								///< One past the last segment of the current batch
+		std::atomic<size_t> next_to_decode;											///< The next segment of the batch to be decoded (counting from batch_start)
+		bool finished;																			///< There are no more batches in the current query
+		size_t postings_processed;														///< The number of postings processed in the current query
+		query_parameters current;															///< The query being processed
+
+		std::vector<JASS::thread> workers;												///< The threads doing partitions 1 onwards
+		std::mutex mutex;																		///< Guards the barrier
+		std::condition_variable changed;												///< Signalled when every thread has reached the barrier
+		size_t waiting;																		///< The number of threads waiting at the barrier
+		size_t generation;																	///< The number of times every thread has reached the barrier
+		bool stopping;																			///< The worker threads should return (set by the destructor)
+
+	private:
+		/*
+			JASS_ANYTIME_PARTITIONS::WAIT()
+			-------------------------------
+		*/
+		/*!
+			@brief Wait until all the threads (one per partition) have called wait().
+		*/
+		void wait(void)
+			{
+			std::unique_lock<std::mutex> lock(mutex);
+			size_t arrived_in = generation;
+			if (++waiting == partition.size())
+				{
+				waiting = 0;
+				generation++;
+				changed.notify_all();
+				}
+			else
+				changed.wait(lock, [this, arrived_in](){return generation != arrived_in;});
+			}
+
+		/*
+			JASS_ANYTIME_PARTITIONS::TOP_K_IS_FINAL()
+			-----------------------------------------
+		*/
+		/*!
+			@brief Can processing more postings change which documents are the highest top_k - 1 over all the partitions, or their order?
+			@details Each partition's top-k must be full, and then every document outside the top-k of its partition has an rsv no higher
+			than the top_k-th highest over all the partitions, which therefore stands for them all (as in query::top_k_is_final()).
+			@param remaining [in] The most that the rsv of any document can still increase by.
+			@param top_k [in] The number of results being kept.
+			@return true if no document can overtake any of the highest top_k - 1 documents and their order cannot change.
+		*/
+		bool top_k_is_final(size_t remaining, size_t top_k)
+			{
+			if (remaining == 0)
+				return true;
+
+			if constexpr (QUERY::can_stop_early)
+				{
+				top_k_rsvs.resize(top_k * partition.size());
+				for (size_t which = 0; which < partition.size(); which++)
+					if (!partition[which]->copy_top_k(&top_k_rsvs[which * top_k]))
+						return false;
+
+				std::partial_sort(top_k_rsvs.begin(), top_k_rsvs.begin() + top_k, top_k_rsvs.end(), std::greater<JASS::query::ACCUMULATOR_TYPE>());
+				for (size_t which = 1; which < top_k; which++)
+					if (static_cast<size_t>(top_k_rsvs[which - 1]) <= static_cast<size_t>(top_k_rsvs[which]) + remaining)
+						return false;
+
+				return true;
+				}
+			else
+				return false;
+			}
+
+		/*
+			JASS_ANYTIME_PARTITIONS::NEXT_BATCH()
+			-------------------------------------
+		*/
+		/*!
+			@brief Choose the segments of the next batch (called by the first partition while the others wait), or set finished if there are none.
+			@details A batch holds as many segments as fit in the decode buffer, but stops early if the time budget would be used up (the cost
+			model predicts the time for one thread to process the segments, so this is pessimistic).  With rank-safe early termination, the
+			query is finished once the top-k of the batch before cannot change.
+		*/
+		void next_batch(void)
+			{
+			if (current.rank_safe && batch_start != batch_end)
+				{
+				for (const auto *header = batch_start; header < batch_end; header++)
+					current.remaining_rsv -= header->impact - header->next_impact;
+				if (top_k_is_final(current.remaining_rsv, partition[0]->top_k))
+					{
+					finished = true;
+					return;
+					}
+				}
+
+			batch_start = batch_end;
+			batch_offset.clear();
+			size_t capacity = decompress_buffer.size() * sizeof(__m512i) / sizeof(JASS::query::DOCID_TYPE);
+			size_t used = 0;
+			size_t predicted = 0;
+			size_t elapsed = current.budget_in_ns == 0 ? 0 : static_cast<size_t>(JASS::timer::stop(current.query_time).nanoseconds());
+			while (batch_end < current.end_of_segments)
+				{
+				size_t length = (batch_end->segment_frequency + segment_alignment - 1) / segment_alignment * segment_alignment + segment_padding;
+				if (used + length > capacity)
+					break;
+
+				if (current.budget_in_ns != 0)
+					{
+					predicted += current.cost_model->predict(batch_end->segment_frequency);
+					if (elapsed + predicted > current.budget_in_ns)
+						{
+						current.end_of_segments = batch_end;
+						break;
+						}
+					}
+
+				batch_offset.push_back(used);
+				used += length;
+				postings_processed += batch_end->segment_frequency;
+				batch_end++;
+				}
+
+			next_to_decode = 0;
+			finished = batch_start == batch_end;
+			}
+
+		/*
+			JASS_ANYTIME_PARTITIONS::PROCESS_PARTITION()
+			--------------------------------------------
+		*/
+		/*!
+			@brief Process the segments of the current query for the document ids of one partition (each partition is processed on its own thread).
+			@param which [in] The partition to process.
+		*/
+		void process_partition(size_t which)
+			{
+			QUERY &jass_query = *partition[which];
+			JASS::query::DOCID_TYPE *buffer = reinterpret_cast<JASS::query::DOCID_TYPE *>(decompress_buffer.data());
+			JASS::query::DOCID_TYPE low = boundary[which];
+			JASS::query::DOCID_TYPE high = boundary[which + 1];
+
+			jass_query.rewind(current.smallest_possible_rsv, current.segment_order->impact, current.largest_possible_rsv);
+
+			while (true)
+				{
+				if (which == 0)
+					next_batch();
+				wait();
+				if (finished)
+					break;
+
+				/*
+					Decode and D1-decode each segment of the batch once (on whichever thread gets to it first)
+				*/
+				size_t segments = batch_end - batch_start;
+				for (size_t segment = next_to_decode++; segment < segments; segment = next_to_decode++)
+					{
+					const JASS_anytime_segment_header *header = batch_start + segment;
+					JASS::query::DOCID_TYPE *into = buffer + batch_offset[segment];
+					jass_query.decode(into, header->segment_frequency, current.postings + header->offset, header->end - header->offset);
+					JASS::simd::cumulative_sum(into, header->segment_frequency);
+					}
+				wait();
+
+				/*
+					Add only those postings that are in this partition (to accumulators that start at the start of the partition)
+				*/
+				for (size_t segment = 0; segment < segments; segment++)
+					{
+					const JASS::query::DOCID_TYPE *start = buffer + batch_offset[segment];
+					const JASS::query::DOCID_TYPE *end_of_segment = start + batch_start[segment].segment_frequency;
+					if (end_of_segment == start || *start >= high || *(end_of_segment - 1) < low)
+						continue;
+
+					const JASS::query::DOCID_TYPE *from = std::lower_bound(start, end_of_segment, low);
+					const JASS::query::DOCID_TYPE *end = std::lower_bound(from, end_of_segment, high);
+					JASS::query::ACCUMULATOR_TYPE impact = batch_start[segment].impact;
+					while (from < end)
+						jass_query.add_rsv(*from++ - low, impact);
+					}
+				wait();
+				}
+
+			jass_query.sort();
+			wait();
+			}
+
+		/*
+			JASS_ANYTIME_PARTITIONS::WORKER()
+			---------------------------------
+		*/
+		/*!
+			@brief The thread that processes one partition of each query, until the object is destroyed.
+			@param which [in] The partition to process.
+		*/
+		void worker(size_t which)
+			{
+			while (true)
+				{
+				wait();
+				if (stopping)
+					return;
+				process_partition(which);
+				}
+			}
+
+	public:
+		/*
+			JASS_ANYTIME_PARTITIONS::JASS_ANYTIME_PARTITIONS()
+			--------------------------------------------------
+		*/
+		/*!
+			@brief Constructor
+		*/
+		JASS_anytime_partitions() :
+			primary_keys(nullptr),
+			answered(false),
+			batch_start(nullptr),
+			batch_end(nullptr),
+			next_to_decode(0),
+			finished(false),
+			postings_processed(0),
+			current(),
+			waiting(0),
+			generation(0),
+			stopping(false)
+			{
+			/* Nothing */
+			}
+
+		/*
+			JASS_ANYTIME_PARTITIONS::~JASS_ANYTIME_PARTITIONS()
+			---------------------------------------------------
+		*/
+		/*!
+			@brief Destructor
+		*/
+		~JASS_anytime_partitions()
+			{
+			if (workers.size() != 0)
+				{
+				stopping = true;
+				wait();
+				for (auto &worker : workers)
+					worker.join();
+				}
+			}
+
+		/*
+			JASS_ANYTIME_PARTITIONS::INIT()
+			-------------------------------
+		*/
+		/*!
+			@brief Allocate the partitions and start their threads.
+			@param partitions [in] The number of partitions (and threads) to use for each query (0 or 1 turns this off).
+			@param new_query [in] A function that, given a number of documents, returns a new initialised query object with accumulators for that many documents.
+			@param primary_keys [in] The primary keys of the documents in the collection.
+			@param documents [in] The number of documents in the collection.
+		*/
+		template <typename NEW_QUERY>
+		void init(size_t partitions, NEW_QUERY new_query, const JASS::primary_key_list &primary_keys, size_t documents)
+			{
+			partitions = (std::min)(partitions, documents);		// every partition has at least one document
+			if (partitions <= 1)
+				return;
+
+			this->primary_keys = &primary_keys;
+			for (size_t which = 0; which <= partitions; which++)
+				boundary.push_back(static_cast<JASS::query::DOCID_TYPE>(documents * which / partitions));
+			for (size_t which = 0; which < partitions; which++)
+				partition.push_back(new_query(boundary[which + 1] - boundary[which]));
+
+			/*
+				Any one segment fits in half the buffer (with room for the decompressors to overflow)
+			*/
+			decompress_buffer.resize(2 * (segment_padding + (documents * sizeof(JASS::query::DOCID_TYPE) + sizeof(__m512i) - 1) / sizeof(__m512i)));
+
+			for (size_t which = 1; which < partitions; which++)
+				workers.push_back(JASS::thread(&JASS_anytime_partitions::worker, this, which));
+			}
+
+		/*
+			JASS_ANYTIME_PARTITIONS::SIZE()
+			-------------------------------
+		*/
+		/*!
+			@brief Return the number of partitions.
+			@return The number of partitions (0 if intra-query parallelism is off).
+		*/
+		size_t size(void) const
+			{
+			return partition.size();
+			}
+
+		/*
+			JASS_ANYTIME_PARTITIONS::REWIND()
+			---------------------------------
+		*/
+		/*!
+			@brief Ready for the next query.
+		*/
+		void rewind(void)
+			{
+			answered = false;
+			}
+
+		/*
+			JASS_ANYTIME_PARTITIONS::ANSWERED_QUERY()
+			-----------------------------------------
+		*/
+		/*!
+			@brief Was the most recent query resolved by process()?  If so the results are in this object rather than in the query object.
+			@return true if process() was called since the last rewind().
+		*/
+		bool answered_query(void) const
+			{
+			return answered;
+			}
+
+		/*
+			JASS_ANYTIME_PARTITIONS::PROCESS()
+			----------------------------------
+		*/
+		/*!
+			@brief Process the segments of a query in parallel and merge the results into a top-k list.
+			@param segment_order [in] The segments to process, in order.
+			@param end_of_segments [in] One past the last segment to process.
+			@param postings [in] The postings list memory.
+			@param smallest_possible_rsv [in] The smallest score any document can have.
+			@param largest_possible_rsv [in] The largest score any document can have.
+			@param query_time [in] The stop watch started when the query was started.
+			@param budget_in_ns [in] The wall-clock time limit for the query (0 for no limit).
+			@param cost_model [in] The model used to predict how long a segment will take.
+			@param top_k [in] The number of results to keep.
+			@param rank_safe [in] Stop once the top-k cannot change (the segments must have their next_impact set).
+			@param remaining_rsv [in] With rank_safe, the most that the rsv of any document can increase by before the first segment is processed.
+			@return The number of postings processed (by each partition).
+		*/
+		size_t process(const JASS_anytime_segment_header *segment_order, const JASS_anytime_segment_header *end_of_segments, const uint8_t *postings, JASS::query::ACCUMULATOR_TYPE smallest_possible_rsv, JASS::query::ACCUMULATOR_TYPE largest_possible_rsv, decltype(JASS::timer::start()) query_time, size_t budget_in_ns, const JASS_anytime_cost_model &cost_model, size_t top_k, bool rank_safe = false, size_t remaining_rsv = 0)
+			{
+			current = query_parameters{segment_order, end_of_segments, postings, smallest_possible_rsv, largest_possible_rsv, query_time, budget_in_ns, &cost_model, rank_safe, remaining_rsv};
+			batch_start = batch_end = segment_order;
+			postings_processed = 0;
+
+			/*
+				Wake the worker threads, then the calling thread does the first partition
+			*/
+			wait();
+			process_partition(0);
+
+			/*
+				Merge the per-partition top-k lists (each counts its document ids from the start of its partition)
+			*/
+			merged.clear();
+			for (size_t which = 0; which < partition.size(); which++)
+				for (const auto document : *partition[which])
+					merged.push_back(result{document.rsv, document.document_id + boundary[which]});
+
+			size_t keep = (std::min)(top_k, merged.size());
+			std::partial_sort(merged.begin(), merged.begin() + keep, merged.end(), [](const result &lhs, const result &rhs){return lhs > rhs;});
+
+			results.clear();
+			for (size_t which = 0; which < keep; which++)
+				results.emplace_back(merged[which].document_id, (*primary_keys)[merged[which].document_id], merged[which].rsv);
+
+			answered = true;
+			return postings_processed;
+			}
+
+		/*
+			JASS_ANYTIME_PARTITIONS::BEGIN()
+			--------------------------------
+		*/
+		/*!
+			@brief Return an iterator pointing to the start of the merged top-k (highest rsv first).
+			@return Iterator pointing to the start of the top-k.
+		*/
+		auto begin(void)
+			{
+			return results.begin();
+			}
+
+		/*
+			JASS_ANYTIME_PARTITIONS::END()
+			------------------------------
+		*/
+		/*!
+			@brief Return an iterator pointing to the end of the merged top-k.
+			@return Iterator pointing to the end of the top-k.
+		*/
+		auto end(void)
+			{
+			return results.end();
+			}
+
+		/*
+			JASS_ANYTIME_PARTITIONS::RBEGIN()
+			---------------------------------
+		*/
+		/*!
+			@brief Return a reverse iterator pointing to the end of the merged top-k (lowest rsv first).
+			@return Reverse iterator pointing to the end of the top-k.
+		*/
+		auto rbegin(void)
+			{
+			return results.rbegin();
+			}
+
+		/*
+			JASS_ANYTIME_PARTITIONS::REND()
+			-------------------------------
+		*/
+		/*!
+			@brief Return a reverse iterator pointing to one before the start of the merged top-k.
+			@return Reverse iterator pointing to one before the start of the top-k.
+		*/
+		auto rend(void)
+			{
+			return results.rend();
+			}
+	};
@@ -0,0 +1,99 @@
+/*
+	JASS_ANYTIME_PHASE_TIMES.H
+	--------------------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief The time spent in each phase of resolving a query.
+	@author Andrew Trotman
+	@copyright 2021 Andrew Trotman
+*/
+#pragma once
+
+#include <stddef.h>
+
+#include "timer.h"
+
+/*
+	CLASS JASS_ANYTIME_PHASE_TIMES
+	------------------------------
+*/
+/*!
+	@brief The time (in nanoseconds) a single query spent in each phase of search.
+	@details The phases run one after the other so the times are taken as "laps" of a single stop watch: lap() charges the
+	time since the previous lap to the given phase.  That is one clock read per phase boundary, which is cheap enough to
+	leave on.  When a query is processed in parallel (see JASS_anytime_partitions) the decoding, processing and top-k sort
+	of all the partitions (and the merge) are charged to PROCESS.
+*/
+class JASS_anytime_phase_times
+	{
+	public:
+		/*!
+			@enum phase
+			@brief The phases of search, in the order they happen.
+		*/
+		enum phase
+			{
+			PARSE,				///< Parse the query (and look it up in the result cache)
+			VOCABULARY,			///< Look up each term in the vocabulary
+			COLLECT,				///< Gather the impact segment headers of each term
+			ORDER,				///< std::sort() the segments from highest to lowest impact
+			PROCESS,				///< Initialise the accumulators then decode_and_process() the segments
+			TOP_K,				///< Sort the top-k
+			PHASES				///< The number of phases
+			};
+
+		static constexpr const char *name[PHASES] = {"parse", "vocabulary", "collect", "order", "process", "top-k"};		///< The name of each phase
+
+	private:
+		decltype(JASS::timer::start()) last_lap;			///< When the previous lap ended
+
+	public:
+		size_t time_in_ns[PHASES];								///< The time spent in each phase
+
+	public:
+		/*
+			JASS_ANYTIME_PHASE_TIMES::JASS_ANYTIME_PHASE_TIMES()
+			----------------------------------------------------
+		*/
+		/*!
+			@brief Constructor
+		*/
+		JASS_anytime_phase_times() :
+			time_in_ns()
+			{
+			/* Nothing */
+			}
+
+		/*
+			JASS_ANYTIME_PHASE_TIMES::START()
+			---------------------------------
+		*/
+		/*!
+			@brief Clear the phase times and start the stop watch.
+			@param when [in] The time the first phase starts.
+		*/
+		void start(decltype(JASS::timer::start()) when)
+			{
+			for (size_t which = 0; which < PHASES; which++)
+				time_in_ns[which] = 0;
+			last_lap = when;
+			}
+
+		/*
+			JASS_ANYTIME_PHASE_TIMES::LAP()
+			-------------------------------
+		*/
+		/*!
+			@brief Charge the time since the previous lap to the given phase.
+			@param which [in] The phase that just finished.
+		*/
+		void lap(phase which)
+			{
+			auto now = JASS::timer::start();
+			time_in_ns[which] += (now - last_lap).count();
+			last_lap = now;
+			}
+	};
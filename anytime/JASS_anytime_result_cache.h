@@ -0,0 +1,290 @@
+/*
+	JASS_ANYTIME_RESULT_CACHE.H
+	---------------------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief A bounded, thread-safe cache of results lists for repeated queries.
+	@author Andrew Trotman
+	@copyright 2021 Andrew Trotman
+*/
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <sstream>
+#include <string_view>
+#include <unordered_map>
+
+#include "query_term_list.h"
+
+/*
+	CLASS JASS_ANYTIME_RESULT_CACHE
+	-------------------------------
+*/
+/*!
+	@brief A cache of serialised (TREC format) results lists keyed on the parsed query and the search parameters.
+	@details The key is the list of unique query terms (with their query frequencies), the top-k, and the postings and
+	time budgets, so two queries that parse the same way and are searched the same way share an entry.  A hit returns
+	the results list without touching the postings, with the query-id in each line replaced by that of the new query.
+	A query is only admitted after it has missed admit_after times (1 admits every query) so that one-off queries do not
+	evict popular ones.  When full the cache evicts either the least recently used entry (LRU) or the oldest entry (FIFO).
+	All methods are safe to call from several threads at once.
+*/
+class JASS_anytime_result_cache
+	{
+	public:
+		/*!
+			@enum eviction_policy
+			@brief Which entry to throw away when the cache is full.
+		*/
+		enum eviction_policy
+			{
+			LRU,				///< Evict the entry that was least recently used (hits move an entry to the front)
+			FIFO				///< Evict the entry that was added first (hits do not change the order)
+			};
+
+	private:
+		/*
+			CLASS JASS_ANYTIME_RESULT_CACHE::ENTRY
+			--------------------------------------
+		*/
+		/*!
+			@brief A cached results list and the key it is stored under.
+		*/
+		class entry
+			{
+			public:
+				std::string key;						///< The key (see key())
+				std::string results_list;			///< The serialised results list
+			};
+
+	private:
+		std::mutex mutex;																		///< Guards everything but the counters
+		size_t maximum_entries;																///< The size of the cache (0 turns the cache off)
+		size_t admit_after;																	///< A query is admitted once it has missed this many times
+		eviction_policy eviction;															///< Which entry to evict when full
+		std::list<entry> entries;															///< The entries, most recently added (or used, if LRU) first
+		std::unordered_map<std::string_view, std::list<entry>::iterator> lookup;	///< Key to entry (the key memory belongs to the entry)
+		std::unordered_map<std::string, size_t> candidates;							///< Number of misses of queries not yet admitted
+		std::atomic<size_t> hits;															///< The number of lookups that found their query
+		std::atomic<size_t> misses;														///< The number of lookups that did not
+
+	private:
+		/*
+			JASS_ANYTIME_RESULT_CACHE::RELABEL()
+			------------------------------------
+		*/
+		/*!
+			@brief Replace the query-id (the first column) of each line of a TREC results list.
+			@param results_list [in/out] The results list.
+			@param query_id [in] The new query-id.
+		*/
+		static void relabel(std::string &results_list, const std::string &query_id)
+			{
+			std::string relabelled;
+			relabelled.reserve(results_list.size());
+
+			size_t start = 0;
+			while (start < results_list.size())
+				{
+				size_t end_of_line = results_list.find('\n', start);
+				end_of_line = end_of_line == std::string::npos ? results_list.size() : end_of_line + 1;
+				size_t end_of_id = results_list.find(' ', start);
+				if (end_of_id == std::string::npos || end_of_id > end_of_line)
+					end_of_id = start;
+
+				relabelled += query_id;
+				relabelled.append(results_list, end_of_id, end_of_line - end_of_id);
+				start = end_of_line;
+				}
+
+			results_list.swap(relabelled);
+			}
+
+	public:
+		/*
+			JASS_ANYTIME_RESULT_CACHE::JASS_ANYTIME_RESULT_CACHE()
+			------------------------------------------------------
+		*/
+		/*!
+			@brief Constructor.  The cache is off until init() is called.
+		*/
+		JASS_anytime_result_cache() :
+			maximum_entries(0),
+			admit_after(1),
+			eviction(LRU),
+			hits(0),
+			misses(0)
+			{
+			/* Nothing */
+			}
+
+		/*
+			JASS_ANYTIME_RESULT_CACHE::INIT()
+			---------------------------------
+		*/
+		/*!
+			@brief Set the size and policies of the cache.  Must be called before the cache is shared between threads.
+			@param maximum_entries [in] The number of results lists to keep (0 turns the cache off).
+			@param admit_after [in] Admit a query once it has missed this many times (0 and 1 admit every query).
+			@param eviction [in] Which entry to evict when the cache is full.
+		*/
+		void init(size_t maximum_entries, size_t admit_after, eviction_policy eviction)
+			{
+			this->maximum_entries = maximum_entries;
+			this->admit_after = admit_after;
+			this->eviction = eviction;
+			lookup.reserve(maximum_entries);
+			}
+
+		/*
+			JASS_ANYTIME_RESULT_CACHE::KEY()
+			--------------------------------
+		*/
+		/*!
+			@brief Compute the key for a query.
+			@param terms [in] The parsed query (unique terms in sorted order, as the query parser leaves them).
+			@param top_k [in] The number of results to return.
+			@param postings_to_process [in] The maximum number of postings to process.
+			@param budget_in_ns [in] The wall-clock time limit for the query (0 for no limit).
+			@return The key, or an empty string if the cache is off.
+		*/
+		std::string key(const JASS::query_term_list &terms, size_t top_k, size_t postings_to_process, size_t budget_in_ns) const
+			{
+			if (maximum_entries == 0)
+				return std::string();
+
+			/*
+				Each term is length-prefixed so that terms containing punctuation cannot run together
+			*/
+			std::ostringstream key;
+			key << top_k << ' ' << postings_to_process << ' ' << budget_in_ns;
+			for (const auto &term : terms)
+				key << ' ' << term.token().size() << ':' << term.token() << '*' << term.frequency();
+
+			return key.str();
+			}
+
+		/*
+			JASS_ANYTIME_RESULT_CACHE::FIND()
+			---------------------------------
+		*/
+		/*!
+			@brief Look for a query in the cache and if it's there return its results list.
+			@param results_list [out] The results list with the query-id set to query_id (unchanged on a miss).
+			@param key [in] The key of the query (see key()).
+			@param query_id [in] The query-id of the query.
+			@return true on a hit, false on a miss (or if the cache is off).
+		*/
+		bool find(std::string &results_list, const std::string &key, const std::string &query_id)
+			{
+			if (maximum_entries == 0)
+				return false;
+
+			std::string found;
+			{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			auto where = lookup.find(key);
+			if (where == lookup.end())
+				{
+				misses++;
+				return false;
+				}
+
+			if (eviction == LRU)
+				entries.splice(entries.begin(), entries, where->second);
+			found = where->second->results_list;
+			}
+
+			hits++;
+			relabel(found, query_id);
+			results_list.swap(found);
+			return true;
+			}
+
+		/*
+			JASS_ANYTIME_RESULT_CACHE::INSERT()
+			-----------------------------------
+		*/
+		/*!
+			@brief Offer the results list of a query that missed to the cache, which admits it according to the admission policy.
+			@param key [in] The key of the query (see key()).
+			@param results_list [in] The serialised results list.
+		*/
+		void insert(const std::string &key, const std::string &results_list)
+			{
+			if (maximum_entries == 0)
+				return;
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			/*
+				Another thread might have added it since we missed
+			*/
+			if (lookup.find(key) != lookup.end())
+				return;
+
+			/*
+				Admission: count the misses of queries that are not yet in the cache.  The table of candidates is bounded by
+				periodically forgetting all of them.
+			*/
+			if (admit_after > 1)
+				{
+				auto candidate = candidates.find(key);
+				if (candidate == candidates.end())
+					{
+					if (candidates.size() >= maximum_entries)
+						candidates.clear();
+					candidates[key] = 1;
+					return;
+					}
+				if (++candidate->second < admit_after)
+					return;
+				candidates.erase(candidate);
+				}
+
+			/*
+				Eviction: the victim is always at the back of the list
+			*/
+			if (entries.size() >= maximum_entries)
+				{
+				lookup.erase(entries.back().key);
+				entries.pop_back();
+				}
+
+			entries.push_front(entry{key, results_list});
+			lookup[entries.front().key] = entries.begin();
+			}
+
+		/*
+			JASS_ANYTIME_RESULT_CACHE::HIT_COUNT()
+			--------------------------------------
+		*/
+		/*!
+			@brief Return the number of lookups that found their query.
+			@return The number of cache hits.
+		*/
+		size_t hit_count(void) const
+			{
+			return hits;
+			}
+
+		/*
+			JASS_ANYTIME_RESULT_CACHE::MISS_COUNT()
+			---------------------------------------
+		*/
+		/*!
+			@brief Return the number of lookups that did not find their query.
+			@return The number of cache misses.
+		*/
+		size_t miss_count(void) const
+			{
+			return misses;
+			}
+	};
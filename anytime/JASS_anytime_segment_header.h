@@ -20,6 +20,7 @@ class JASS_anytime_segment_header
 	{
 	public:
 		JASS::query::ACCUMULATOR_TYPE impact;			///< The impact score
+		JASS::query::ACCUMULATOR_TYPE next_impact;	///< The impact score of the next lower segment of the same term, 0 if none (only set with --rank-safe)
 		uint64_t offset;										///< Offset (within the postings file) of the start of the compressed postings list
 		uint64_t end;											///< Offset (within the postings file) of the end of the compressed postings list
 		JASS::query::DOCID_TYPE segment_frequency;	///< The number of document ids in the segment (not end - offset because the postings are compressed)
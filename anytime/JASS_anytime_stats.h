@@ -12,6 +12,12 @@
 */
 #pragma once
 
+#include <iomanip>
+#include <iostream>
+
+#include "JASS_anytime_phase_times.h"
+#include "JASS_anytime_latency_histogram.h"
+
 /*
 	CLASS JASS_ANYTIME_STATS
 	------------------------
@@ -28,6 +34,10 @@ class JASS_anytime_stats
 		size_t wall_time_in_ns;						///< Total wall time to do all the search (in nanoseconds)
 		size_t sum_of_CPU_time_in_ns;				///< Sum of the indivivual thread total timers (multi-threaded can be larger than wall_time_in_ns)
 		size_t total_run_time_in_ns;				///< includes I/O and everything (start main() to end of main()).
+		size_t cache_hits;							///< The number of queries answered from the result cache
+		size_t cache_misses;							///< The number of queries looked for in the result cache but not found
+		JASS_anytime_latency_histogram latency;	///< The distribution of the per-query search times
+		JASS_anytime_latency_histogram phase_latency[JASS_anytime_phase_times::PHASES];		///< The distribution of the per-query time in each phase
 
 	public:
 		/*
@@ -43,7 +53,9 @@ class JASS_anytime_stats
 			number_of_queries(0),
 			wall_time_in_ns(0),
 			sum_of_CPU_time_in_ns(0),
-			total_run_time_in_ns(0)
+			total_run_time_in_ns(0),
+			cache_hits(0),
+			cache_misses(0)
 			{
 			/* Nothing */
 			}
@@ -69,6 +81,21 @@ std::ostream &operator<<(std::ostream &output, JASS_anytime_stats &data)
 	output << "Total CPU wall time searching (sum of threads)   : " << data.sum_of_CPU_time_in_ns << " ns\n";
 	output << "Total time excluding I/O (per query)             : " << data.sum_of_CPU_time_in_ns / ((data.number_of_queries == 0) ? 1 : data.number_of_queries) << " ns\n";
 	output << "Total wall clock run time (inc I/O and search)   : " << data.total_run_time_in_ns << " ns\n";
+	output << "Result cache hits                                : " << data.cache_hits << '\n';
+	output << "Result cache misses                              : " << data.cache_misses << '\n';
+
+	/*
+		Latency percentiles of the whole query then of each phase
+	*/
+	output << "Latency percentiles (p50 p90 p99 p99.9 max)\n";
+	for (size_t phase = 0; phase <= JASS_anytime_phase_times::PHASES; phase++)
+		{
+		const auto &histogram = phase == 0 ? data.latency : data.phase_latency[phase - 1];
+		std::string name = phase == 0 ? "query" : JASS_anytime_phase_times::name[phase - 1];
+
+		output << "  " << std::left << std::setw(47) << name << std::right << ": ";
+		output << histogram.percentile(50) << ' ' << histogram.percentile(90) << ' ' << histogram.percentile(99) << ' ' << histogram.percentile(99.9) << ' ' << histogram.maximum() << " ns\n";
+		}
 	output << "-------------------\n";
 	return output;
 	}
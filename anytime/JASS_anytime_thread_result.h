@@ -14,6 +14,8 @@
 
 #include <map>
 
+#include "JASS_anytime_phase_times.h"
+
 /*
 	CLASS JASS_ANYTIME_THREAD_RESULT
 	--------------------------------
@@ -36,6 +38,7 @@ class JASS_anytime_thread_result
 				std::string results_list;			///< The results list
 				size_t postings_processed;			///< The number of postings processed for this query
 				size_t search_time_in_ns;			///< The time it took to resolve the query
+				JASS_anytime_phase_times phases;	///< The time spent in each phase of resolving the query
 
 			/*
 				JASS_ANYTIME_THREAD_RESULT::QUERY_DETAILS::QUERY_DETAILS()
@@ -46,7 +49,8 @@ class JASS_anytime_thread_result
 				query(),
 				results_list(),
 				postings_processed(0),
-				search_time_in_ns(0)
+				search_time_in_ns(0),
+				phases()
 				{
 				/* Nothing */
 				}
@@ -61,13 +65,15 @@ class JASS_anytime_thread_result
 				@param results_list [in] The results list (normally in TREC format)
 				@param postings_processed [in] The numvber of postings processed (that is, <docid, impact> pairs)
 				@param search_time_in_ns [in] The time it took to resolve the query
+				@param phases [in] The time spent in each phase of resolving the query
 			*/
-			query_details(const std::string &query_id, const std::string &query, const std::string &results_list, size_t postings_processed, size_t search_time_in_ns) :
+			query_details(const std::string &query_id, const std::string &query, const std::string &results_list, size_t postings_processed, size_t search_time_in_ns, const JASS_anytime_phase_times &phases) :
 				query_id(query_id),
 				query(query),
 				results_list(results_list),
 				postings_processed(postings_processed),
-				search_time_in_ns(search_time_in_ns)
+				search_time_in_ns(search_time_in_ns),
+				phases(phases)
 				{
 				/* Nothing */
 				}
@@ -96,10 +102,11 @@ class JASS_anytime_thread_result
 			@param results_list [in] The results list (normally in TREC format)
 			@param postings_processed [in] The numvber of postings processed (that is, <docid, impact> pairs)
 			@param search_time_in_ns [in] The time it took to resolve the query
+			@param phases [in] The time spent in each phase of resolving the query
 		*/
-		void push_back(const std::string &query_id, const std::string &query, const std::string &results_list, size_t postings_processed, size_t search_time_in_ns)
+		void push_back(const std::string &query_id, const std::string &query, const std::string &results_list, size_t postings_processed, size_t search_time_in_ns, const JASS_anytime_phase_times &phases)
 			{
-			results[query_id] = query_details(query_id, query, results_list, postings_processed, search_time_in_ns);
+			results[query_id] = query_details(query_id, query, results_list, postings_processed, search_time_in_ns, phases);
 			}
 
 		/*
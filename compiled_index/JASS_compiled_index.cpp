@@ -19,6 +19,7 @@
 #include "accumulator_2d.h"
 #include "JASS_vocabulary.h"
 #include "run_export_trec.h"
+#include "primary_key_list.h"
 
 /*
 	If the line below is enabled then the global operator new and operator delete methods are overwridden
@@ -50,6 +51,11 @@ int main(int argc, char *argv[])
 		*/
 		std::sort(&dictionary[0], &dictionary[dictionary_length]);
 
+		/*
+			The query objects look up primary keys through a primary_key_list (built once, here, over the compiled-in keys)
+		*/
+		JASS::primary_key_list primary_keys(primary_key);
+
 		/*
 			Use a JASS channel to read the input query
 		*/
@@ -72,8 +78,8 @@ int main(int argc, char *argv[])
 			
 			JASS::string query(memory);					// allocate a string to read into
 
-			auto jass_query_memory = std::make_shared<JASS::query_heap>();	// allocate a JASS query object
-			jass_query_memory->init(primary_key, 1024, 10);
+			auto jass_query_memory = std::make_shared<JASS::query_heap<>>();	// allocate a JASS query object
+			jass_query_memory->init(primary_keys, 1024, 10);
 			auto &jass_query = *jass_query_memory.get();		// pretend its an object
 
 			/*
@@ -4,54 +4,54 @@
 #include"query_heap.h"
 
 using namespace JASS;
-void T_6(query_heap &q)
+void T_6(query_heap<> &q)
 {
 q.add_rsv(6,1);
 }
-void T_1(query_heap &q)
+void T_1(query_heap<> &q)
 {
 q.add_rsv(1,1);
 }
-void T_4(query_heap &q)
+void T_4(query_heap<> &q)
 {
 q.add_rsv(4,1);
 }
-void T_5(query_heap &q)
+void T_5(query_heap<> &q)
 {
 q.add_rsv(5,1);
 }
-void T_3(query_heap &q)
+void T_3(query_heap<> &q)
 {
 q.add_rsv(3,1);
 }
-void T_8(query_heap &q)
+void T_8(query_heap<> &q)
 {
 q.add_rsv(8,1);
 }
-void T_7(query_heap &q)
+void T_7(query_heap<> &q)
 {
 q.add_rsv(7,1);
 }
-void T_2(query_heap &q)
+void T_2(query_heap<> &q)
 {
 q.add_rsv(2,1);
 }
-void T_9(query_heap &q)
+void T_9(query_heap<> &q)
 {
 q.add_rsv(9,1);
 }
-void T_10(query_heap &q)
+void T_10(query_heap<> &q)
 {
 q.add_rsv(10,1);
 }
-void T_four(query_heap &q)
+void T_four(query_heap<> &q)
 {
 q.add_rsv(7,1);
 q.add_rsv(8,1);
 q.add_rsv(9,1);
 q.add_rsv(10,1);
 }
-void T_eight(query_heap &q)
+void T_eight(query_heap<> &q)
 {
 q.add_rsv(3,1);
 q.add_rsv(4,1);
@@ -62,7 +62,7 @@ q.add_rsv(8,1);
 q.add_rsv(9,1);
 q.add_rsv(10,1);
 }
-void T_five(query_heap &q)
+void T_five(query_heap<> &q)
 {
 q.add_rsv(6,1);
 q.add_rsv(7,1);
@@ -70,7 +70,7 @@ q.add_rsv(8,1);
 q.add_rsv(9,1);
 q.add_rsv(10,1);
 }
-void T_seven(query_heap &q)
+void T_seven(query_heap<> &q)
 {
 q.add_rsv(4,1);
 q.add_rsv(5,1);
@@ -80,12 +80,12 @@ q.add_rsv(8,1);
 q.add_rsv(9,1);
 q.add_rsv(10,1);
 }
-void T_two(query_heap &q)
+void T_two(query_heap<> &q)
 {
 q.add_rsv(9,1);
 q.add_rsv(10,1);
 }
-void T_six(query_heap &q)
+void T_six(query_heap<> &q)
 {
 q.add_rsv(5,1);
 q.add_rsv(6,1);
@@ -94,17 +94,17 @@ q.add_rsv(8,1);
 q.add_rsv(9,1);
 q.add_rsv(10,1);
 }
-void T_three(query_heap &q)
+void T_three(query_heap<> &q)
 {
 q.add_rsv(8,1);
 q.add_rsv(9,1);
 q.add_rsv(10,1);
 }
-void T_one(query_heap &q)
+void T_one(query_heap<> &q)
 {
 q.add_rsv(10,1);
 }
-void T_nine(query_heap &q)
+void T_nine(query_heap<> &q)
 {
 q.add_rsv(2,1);
 q.add_rsv(3,1);
@@ -116,7 +116,7 @@ q.add_rsv(8,1);
 q.add_rsv(9,1);
 q.add_rsv(10,1);
 }
-void T_ten(query_heap &q)
+void T_ten(query_heap<> &q)
 {
 q.add_rsv(1,1);
 q.add_rsv(2,1);
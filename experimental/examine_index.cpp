@@ -105,8 +105,7 @@ void process(JASS::deserialised_jass_v1 &index, JASS::compress_integer &decompre
 		*/
 		for (size_t impact = 0; impact < metadata.impacts; impact++)
 			{
-			const uint64_t *current_impact = (reinterpret_cast<const uint64_t *>(metadata.offset) + impact);
-			const JASS::deserialised_jass_v1::segment_header &header = *reinterpret_cast<const JASS::deserialised_jass_v1::segment_header *>(index.postings() + *current_impact);
+			const JASS::deserialised_jass_v1::segment_header header = index.segment(metadata, impact);
 
 			/*
 				Decompress the postings
@@ -21,6 +21,7 @@
 #include <bitset>
 #include <vector>
 #include <random>
+#include <type_traits>
 #include <numeric>
 #include <algorithm>
 
@@ -44,16 +45,16 @@ namespace JASS
 		X.-F. Jia, A. Trotman, R. O'Keefe (2010), Efficient Accumulator Initialisation, Proceedings of the 15th Australasian Document Computing Symposium (ADCS 2010).
 		This implementation differs from that implenentation is so far as the size of the page is alwaya a whole power of 2 and thus the dirty flag can
 		be found with a bit shift rather than a mod.  It also uses dirty flags rather than clean flags as it requires one fewer instruction to check
+		The arrays are allocated by init() so their size is set by the collection at run time.
 		@tparam ELEMENT The type of accumulator being used (default is uint16_t)
-		@tparam NUMBER_OF_ACCUMULATORS The maxium number of documents allowed in any index
 */
-	template <typename ELEMENT, size_t NUMBER_OF_ACCUMULATORS, typename = typename std::enable_if<std::is_arithmetic<ELEMENT>::value, ELEMENT>::type>
+	template <typename ELEMENT, typename = typename std::enable_if<std::is_arithmetic<ELEMENT>::value, ELEMENT>::type>
 	class accumulator_2d
 		{
 		/*
 			This somewhat bizar line is so that unittest() can see the private members of another instance of the class.
 		*/
-		template<typename A, size_t B, typename C> friend class accumulator_2d;
+		template<typename A, typename B> friend class accumulator_2d;
 
 		private:
 #ifdef USE_QUERY_IDS
@@ -64,21 +65,14 @@ namespace JASS
 
 		private:
 			/*
-				This class is templated so as to put the array and the dirty flags in-object rather than pointers.  So, its necessary
-				to work out the maxumum sizes of the two arrays at compile time and the check at construction that no overflow
-				is happening. This code works out the maximums and allocates the arrays.
+				The SIMD gather() and scatter() methods read and write whole 32-bit words, so the arrays are over-allocated so that
+				touching the last element does not run off the end.
 			*/
-//			static constexpr size_t maximum_shift = maths::floor_log2(maths::sqrt_compiletime(NUMBER_OF_ACCUMULATORS));					///< The amount to shift to get the right dirty flag
-//			static constexpr size_t maximum_width = 1 << maximum_shift;																					///< Each dirty flag represents this number of accumulators in a "row"
-		public:
-//			static constexpr size_t maximum_number_of_dirty_flags = (NUMBER_OF_ACCUMULATORS + maximum_width - 1) / maximum_width;	///< The number of "rows" (i.e. dirty flags).
-			static constexpr size_t maximum_number_of_dirty_flags = NUMBER_OF_ACCUMULATORS;
-		private:
-//			static constexpr size_t maximum_number_of_accumulators_allocated = maximum_width * maximum_number_of_dirty_flags;			///< The numner of accumulators that were actually allocated (recall that this is a 2D array)
-			static constexpr size_t maximum_number_of_accumulators_allocated = NUMBER_OF_ACCUMULATORS + NUMBER_OF_ACCUMULATORS / 2;			///< The numner of accumulators that were actually allocated (recall that this is a 2D array)
+			static constexpr size_t overflow_elements = sizeof(__m512i);
+
 		public:
-			alignas(__m512i) flag_type dirty_flag[maximum_number_of_dirty_flags];																							///< The dirty flags are kept as bytes for faster lookup
-			alignas(__m512i) ELEMENT accumulator[maximum_number_of_accumulators_allocated];																				///< The accumulators are kept in an array
+			std::vector<flag_type> dirty_flag;			///< The dirty flags are kept as bytes for faster lookup (allocated by init())
+			std::vector<ELEMENT> accumulator;			///< The accumulators are kept in an array (allocated by init())
 
 #ifdef USE_QUERY_IDS
 			flag_type query_id;
@@ -228,10 +222,10 @@ namespace JASS
 				number_of_accumulators_allocated = width * number_of_dirty_flags;
 
 				/*
-					Check we've not gone past the end of the arrays
+					Allocate the arrays
 				*/
-				if (number_of_dirty_flags > maximum_number_of_dirty_flags || number_of_accumulators_allocated > maximum_number_of_accumulators_allocated)
-					throw std::bad_array_new_length();
+				dirty_flag.resize(number_of_dirty_flags + overflow_elements);
+				accumulator.resize(number_of_accumulators_allocated + overflow_elements);
 
 				/*
 					Clear the dirty flags ready for first use.
@@ -553,7 +547,7 @@ namespace JASS
 				/*
 					Allocate an array of 64 accumulators and make sure the width and height are correct
 				*/
-				accumulator_2d<size_t, 64> array;
+				accumulator_2d<size_t> array;
 				array.init(64);
 				JASS_assert(array.width == 8);
 				JASS_assert(array.shift == 3);
@@ -564,7 +558,7 @@ namespace JASS
 				/*
 					Make sure it all works right when there is a single accumulator in the last row
 				*/
-				accumulator_2d<size_t, 65> array_hangover;
+				accumulator_2d<size_t> array_hangover;
 				array_hangover.init(65);
 				JASS_assert(array_hangover.width == 8);
 				JASS_assert(array_hangover.shift == 3);
@@ -575,7 +569,7 @@ namespace JASS
 				/*
 					Make sure it all works right when there is a single accumulator missing from the last row
 				*/
-				accumulator_2d<size_t, 63> array_hangunder;
+				accumulator_2d<size_t> array_hangunder;
 				array_hangunder.init(63);
 				JASS_assert(array_hangunder.width == 4);
 				JASS_assert(array_hangunder.shift == 2);
@@ -586,7 +580,7 @@ namespace JASS
 				/*
 					Make sure it all works right when there is a single accumulator
 				*/
-				accumulator_2d<size_t, 1> array_one;
+				accumulator_2d<size_t> array_one;
 				array_one.init(1);
 				JASS_assert(array_one.width == 1);
 				JASS_assert(array_one.shift == 0);
@@ -597,4 +591,25 @@ namespace JASS
 				puts("accumulator_2d::PASSED");
 				}
 		};
+
+	/*
+		CLASS IS_ACCUMULATOR_2D
+		-----------------------
+	*/
+	/*!
+		@brief Compile-time test of whether an accumulator strategy is accumulator_2d (the top-k classes use its dirty flags directly).
+		@tparam ACCUMULATORS The accumulator class to test.
+	*/
+	template <typename ACCUMULATORS>
+	class is_accumulator_2d : public std::false_type
+		{
+		};
+
+	/*!
+		@brief Compile-time test of whether an accumulator strategy is accumulator_2d (specialisation for accumulator_2d).
+	*/
+	template <typename ELEMENT, typename TYPE>
+	class is_accumulator_2d<accumulator_2d<ELEMENT, TYPE>> : public std::true_type
+		{
+		};
 	}
@@ -33,28 +33,28 @@ namespace JASS
 		@brief Store the accumulator in a an array and use a query-counter array to know when to clear.
 		@details Keep the accumulagor scores in an array, and use a second array as a set of dirty flags.  That second array
 		simply stores the ID of the query that last used the accumulator. By incrementing the query_id on each rewind its possible to
-		avoid initilising the acumulator array most of the time, at the cost of NUMBER_OF_ACCUMULATORS units of storage.
+		avoid initilising the acumulator array most of the time, at the cost of one byte of storage per accumulator.  The arrays are
+		allocated by init() so their size is set by the collection at run time.
 		Thanks go to Antonio Mallia for inveting this method.
 		@tparam ELEMENT The type of accumulator being used (default is uint16_t)
-		@tparam NUMBER_OF_ACCUMULATORS The maxium number of documents allowed in any index
 		@tparam COUNTER_BITSIZE The number of bits used for the query counter
 	*/
-	template <typename ELEMENT, size_t NUMBER_OF_ACCUMULATORS, size_t COUNTER_BITSIZE, typename = typename std::enable_if<std::is_arithmetic<ELEMENT>::value, ELEMENT>::type>
+	template <typename ELEMENT, size_t COUNTER_BITSIZE, typename = typename std::enable_if<std::is_arithmetic<ELEMENT>::value, ELEMENT>::type>
 	class accumulator_counter
 		{
 		static_assert(COUNTER_BITSIZE == 8 || COUNTER_BITSIZE == 4);
 		/*
 			This somewhat bizar line is so that unittest() can see the private members of different type instance of the class.
 		*/
-		template<typename A, size_t B, size_t C, typename D> friend class accumulator_counter;
+		template<typename A, size_t B, typename C> friend class accumulator_counter;
 
 		private:
 			size_t number_of_accumulators;																///< The number of accumulators that the user asked for
 			uint8_t clean_id;																					///< If clean_flag[x] == clean_id then accumulator[x] is valid
 			static constexpr uint8_t max_clean_id = (COUNTER_BITSIZE == 8 ? 0xFF : 0x0F);	///< The largest allowable clean id
 			static constexpr uint8_t min_clean_id = 0;												///< The smallest allowable clean id
-			uint8_t clean_flag[NUMBER_OF_ACCUMULATORS];												///< The clean flags are kept as bytes for faster lookup
-			ELEMENT accumulator[NUMBER_OF_ACCUMULATORS];												///< The accumulators are kept in an array
+			std::vector<uint8_t> clean_flag;																///< The clean flags are kept as bytes for faster lookup (allocated by init())
+			std::vector<ELEMENT> accumulator;															///< The accumulators are kept in an array (allocated by init())
 
 		public:
 			/*
@@ -86,10 +86,10 @@ namespace JASS
 				clean_id = min_clean_id;
 
 				/*
-					Clear the clean flags and accumulators ready for use.
+					Allocate and clear the clean flags and accumulators ready for use.
 				*/
-				std::fill(clean_flag, clean_flag + number_of_accumulators, min_clean_id);
-				std::fill(accumulator, accumulator + number_of_accumulators, ELEMENT());
+				clean_flag.assign(number_of_accumulators, min_clean_id);
+				accumulator.assign(number_of_accumulators, ELEMENT());
 				}
 
 			/*
@@ -161,7 +161,7 @@ namespace JASS
 			*/
 			forceinline size_t get_index(ELEMENT *pointer)
 				{
-				return pointer - accumulator;
+				return pointer - &accumulator[0];
 				}
 
 			/*
@@ -192,9 +192,9 @@ namespace JASS
 					{
 					clean_id = min_clean_id;
 					if constexpr (COUNTER_BITSIZE == 8)
-						std::fill(clean_flag, clean_flag + number_of_accumulators, min_clean_id);
+						std::fill(clean_flag.begin(), clean_flag.begin() + number_of_accumulators, min_clean_id);
 					else
-						std::fill(clean_flag, clean_flag + (number_of_accumulators + 1) / 2, min_clean_id);
+						std::fill(clean_flag.begin(), clean_flag.begin() + (number_of_accumulators + 1) / 2, min_clean_id);
 					}
 				clean_id++;
 				}
@@ -211,7 +211,7 @@ namespace JASS
 				/*
 					Allocate an array of 64 accumulators and make sure the width and height are correct
 				*/
-				accumulator_counter<size_t, 64, 8> array;
+				accumulator_counter<size_t, 8> array;
 				array.init(64);
 
 				/*
@@ -34,10 +34,9 @@ namespace JASS
 		@brief Store the accumulator in an array and use a query-counter in that array to know when to clear.
 		@details Thanks go to Antonio Mallia for inveting this method.
 		@tparam ELEMENT The type of accumulator being used (default is uint16_t)
-		@tparam NUMBER_OF_ACCUMULATORS The maxium number of documents allowed in any index
 		@tparam COUNTER_BITSIZE The number of bits used for the query counter
 	*/
-	template <typename ELEMENT, size_t NUMBER_OF_ACCUMULATORS, size_t COUNTER_BITSIZE, size_t ACCUMULATORS_PER_CHUNK = (COUNTER_BITSIZE == 8 ? 21 : 25), typename = typename std::enable_if<std::is_arithmetic<ELEMENT>::value, ELEMENT>::type>
+	template <typename ELEMENT, size_t COUNTER_BITSIZE, size_t ACCUMULATORS_PER_CHUNK = (COUNTER_BITSIZE == 8 ? 21 : 25), typename = typename std::enable_if<std::is_arithmetic<ELEMENT>::value, ELEMENT>::type>
 	class accumulator_counter_interleaved
 		{
 		static_assert(COUNTER_BITSIZE == 8 || COUNTER_BITSIZE == 4);
@@ -45,7 +44,7 @@ namespace JASS
 		/*
 			This somewhat bizar line is so that unittest() can see the private members of different type instance of the class.
 		*/
-		template<typename A, size_t B, size_t C, size_t D, typename E> friend class accumulator_counter_interleaved;
+		template<typename A, size_t B, size_t C, typename D> friend class accumulator_counter_interleaved;
 
 		private:
 			/*
@@ -167,7 +166,7 @@ namespace JASS
 			query_counter_type clean_id;														///< If clean_flag[x] == clean_id then accumulator[x] is valid
 			static constexpr query_counter_type min_clean_id = 0;						///< The smallest clean_id, used as an initialiser for the clean flags
 			static constexpr query_counter_type max_clean_id = COUNTER_BITSIZE == 8 ? 0xFF : 0x0F;	///< The largest clean_id, if we exceed this we must reinitialise the clean flags
-			chunk accumulator_chunk[(NUMBER_OF_ACCUMULATORS + accumulators_per_chunk - 1) / accumulators_per_chunk];		///< The accumulators are kept in an array of chunks
+			std::vector<chunk> accumulator_chunk;											///< The accumulators are kept in an array of chunks (allocated by init())
 
 		public:
 			/*
@@ -199,6 +198,7 @@ namespace JASS
 				{
 				this->number_of_accumulators = number_of_accumulators;
 				number_of_chunks = (number_of_accumulators + accumulators_per_chunk - 1) / accumulators_per_chunk;
+				accumulator_chunk.resize(number_of_chunks);
 
 				/*
 					Clear the clean flags ready for use.
@@ -292,7 +292,7 @@ namespace JASS
 			*/
 			forceinline size_t get_index(ELEMENT *pointer)
 				{
-				auto distance = reinterpret_cast<uint8_t *>(pointer) - reinterpret_cast<uint8_t *>(accumulator_chunk);
+				auto distance = reinterpret_cast<uint8_t *>(pointer) - reinterpret_cast<uint8_t *>(&accumulator_chunk[0]);
 				auto blocks = distance / sizeof(accumulator_chunk[0]);
 				auto extra_bytes = distance % sizeof(accumulator_chunk[0]);
 
@@ -348,7 +348,7 @@ namespace JASS
 				/*
 					Allocate an array of 64 accumulators and make sure the width and height are correct
 				*/
-				accumulator_counter_interleaved<size_t, 64, 8> array;
+				accumulator_counter_interleaved<size_t, 8> array;
 				array.init(64);
 
 				/*
@@ -0,0 +1,375 @@
+/*
+	CHANNEL_SOCKET.CPP
+	------------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+
+#ifndef _MSC_VER
+	#include <netdb.h>
+	#include <unistd.h>
+	#include <sys/un.h>
+	#include <sys/types.h>
+	#include <arpa/inet.h>
+	#include <sys/socket.h>
+	#include <netinet/in.h>
+	#include <netinet/tcp.h>
+#endif
+
+#include <algorithm>
+
+#include "file.h"
+#include "asserts.h"
+#include "threads.h"
+#include "channel_socket.h"
+
+#ifndef MSG_NOSIGNAL
+	#define MSG_NOSIGNAL 0
+#endif
+
+namespace JASS
+	{
+	/*
+		IS_PORT_NUMBER()
+		----------------
+	*/
+	/*!
+		@brief Is the socket address a TCP port number (all digits) or is it a Unix domain socket path.
+		@param address [in] The address to check.
+		@return true if address is a port number, else false.
+	*/
+	static bool is_port_number(const std::string &address)
+		{
+		return address.size() != 0 && std::all_of(address.begin(), address.end(), [](char ch){return ::isdigit(ch);});
+		}
+
+	/*
+		CHANNEL_SOCKET::CHANNEL_SOCKET()
+		--------------------------------
+	*/
+	channel_socket::channel_socket(int socket) :
+		socket(socket),
+		buffer_used(0),
+		buffer_position(0)
+		{
+		/* Nothing */
+		}
+
+	/*
+		CHANNEL_SOCKET::~CHANNEL_SOCKET()
+		---------------------------------
+	*/
+	channel_socket::~channel_socket()
+		{
+		close(socket);
+		}
+
+	/*
+		CHANNEL_SOCKET::BLOCK_WRITE()
+		-----------------------------
+	*/
+	size_t channel_socket::block_write(const void *buffer, size_t length)
+		{
+#ifdef _MSC_VER
+		return 0;
+#else
+		const char *from = reinterpret_cast<const char *>(buffer);
+		size_t written = 0;
+
+		/*
+			send() may write fewer bytes than asked for, so keep going until it's all gone (or the other end goes away).
+		*/
+		while (written < length)
+			{
+			auto sent = ::send(socket, from + written, length - written, MSG_NOSIGNAL);
+			if (sent <= 0)
+				break;
+			written += sent;
+			}
+
+		return written;
+#endif
+		}
+
+	/*
+		CHANNEL_SOCKET::BLOCK_READ()
+		----------------------------
+	*/
+	size_t channel_socket::block_read(void *into, size_t length)
+		{
+#ifdef _MSC_VER
+		return 0;
+#else
+		char *to = reinterpret_cast<char *>(into);
+		size_t bytes_read = 0;
+
+		while (bytes_read < length)
+			{
+			/*
+				If the buffer is empty then refill it from the socket.
+			*/
+			if (buffer_position >= buffer_used)
+				{
+				auto got = ::recv(socket, buffer, buffer_size, 0);
+				if (got <= 0)
+					break;					// EOF or error
+				buffer_used = got;
+				buffer_position = 0;
+				}
+
+			/*
+				Copy from the buffer into the caller's memory
+			*/
+			size_t bytes_to_copy = (std::min)(length - bytes_read, buffer_used - buffer_position);
+			memcpy(to + bytes_read, buffer + buffer_position, bytes_to_copy);
+			buffer_position += bytes_to_copy;
+			bytes_read += bytes_to_copy;
+			}
+
+		return bytes_read;
+#endif
+		}
+
+	/*
+		CHANNEL_SOCKET::LISTEN()
+		------------------------
+	*/
+	int channel_socket::listen(const std::string &address)
+		{
+#ifdef _MSC_VER
+		return -1;
+#else
+		int listener;
+
+		if (is_port_number(address))
+			{
+			/*
+				TCP socket on the loopback interface
+			*/
+			if ((listener = ::socket(AF_INET, SOCK_STREAM, 0)) < 0)
+				return -1;
+
+			int on = 1;
+			::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+			sockaddr_in where = {};
+			where.sin_family = AF_INET;
+			where.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			where.sin_port = htons(static_cast<uint16_t>(::atoi(address.c_str())));
+			if (::bind(listener, reinterpret_cast<sockaddr *>(&where), sizeof(where)) != 0)
+				{
+				close(listener);
+				return -1;
+				}
+			}
+		else
+			{
+			/*
+				Unix domain socket
+			*/
+			sockaddr_un where = {};
+			if (address.size() >= sizeof(where.sun_path))
+				return -1;
+
+			if ((listener = ::socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+				return -1;
+
+			where.sun_family = AF_UNIX;
+			strcpy(where.sun_path, address.c_str());
+			(void)::unlink(address.c_str());
+			if (::bind(listener, reinterpret_cast<sockaddr *>(&where), sizeof(where)) != 0)
+				{
+				close(listener);
+				return -1;
+				}
+			}
+
+		if (::listen(listener, SOMAXCONN) != 0)
+			{
+			close(listener);
+			return -1;
+			}
+
+		return listener;
+#endif
+		}
+
+	/*
+		CHANNEL_SOCKET::ACCEPT()
+		------------------------
+	*/
+	int channel_socket::accept(int listener)
+		{
+#ifdef _MSC_VER
+		return -1;
+#else
+		int client;
+
+		do
+			client = ::accept(listener, nullptr, nullptr);
+		while (client < 0 && errno == EINTR);
+
+		/*
+			Results are written as a single block so Nagle's algorithm only adds latency (this fails harmlessly on Unix domain sockets).
+		*/
+		if (client >= 0)
+			{
+			int on = 1;
+			::setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+			}
+
+		return client;
+#endif
+		}
+
+	/*
+		CHANNEL_SOCKET::CONNECT()
+		-------------------------
+	*/
+	int channel_socket::connect(const std::string &address)
+		{
+#ifdef _MSC_VER
+		return -1;
+#else
+		int client;
+
+		if (is_port_number(address))
+			{
+			if ((client = ::socket(AF_INET, SOCK_STREAM, 0)) < 0)
+				return -1;
+
+			sockaddr_in where = {};
+			where.sin_family = AF_INET;
+			where.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			where.sin_port = htons(static_cast<uint16_t>(::atoi(address.c_str())));
+			if (::connect(client, reinterpret_cast<sockaddr *>(&where), sizeof(where)) != 0)
+				{
+				close(client);
+				return -1;
+				}
+			}
+		else
+			{
+			sockaddr_un where = {};
+			if (address.size() >= sizeof(where.sun_path))
+				return -1;
+
+			if ((client = ::socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+				return -1;
+
+			where.sun_family = AF_UNIX;
+			strcpy(where.sun_path, address.c_str());
+			if (::connect(client, reinterpret_cast<sockaddr *>(&where), sizeof(where)) != 0)
+				{
+				close(client);
+				return -1;
+				}
+			}
+
+		return client;
+#endif
+		}
+
+	/*
+		CHANNEL_SOCKET::SHUTDOWN()
+		--------------------------
+	*/
+	void channel_socket::shutdown(int socket)
+		{
+#ifndef _MSC_VER
+		if (socket >= 0)
+			::shutdown(socket, SHUT_RDWR);
+#endif
+		}
+
+	/*
+		CHANNEL_SOCKET::CLOSE()
+		-----------------------
+	*/
+	void channel_socket::close(int socket)
+		{
+#ifndef _MSC_VER
+		if (socket >= 0)
+			::close(socket);
+#endif
+		}
+
+	/*
+		CHANNEL_SOCKET::UNITTEST()
+		--------------------------
+	*/
+	void channel_socket::unittest(void)
+		{
+#ifndef _MSC_VER
+		/*
+			Listen on a Unix domain socket with a name we know isn't in use
+		*/
+		auto address = file::mkstemp("jass");
+		int listener = listen(address);
+		JASS_assert(listener >= 0);
+
+		/*
+			The server echos each line it receives back to the client
+		*/
+		JASS::thread server([listener]()
+			{
+			channel_socket connection(accept(listener));
+			std::string line;
+
+			for (connection.gets(line); line.size() != 0; connection.gets(line))
+				connection << line;
+			});
+
+		/*
+			The client sends a couple of lines (the second larger than the read buffer) and checks they come back
+		*/
+		do
+			{
+			channel_socket client(connect(address));
+			std::string answer;
+
+			client.puts("one two three");
+			client.gets(answer);
+			JASS_assert(answer == "one two three\n");
+
+			std::string long_line(buffer_size * 2 + 7, 'x');
+			client.puts(long_line);
+			client.gets(answer);
+			JASS_assert(answer == long_line + "\n");
+			}
+		while (0);
+
+		/*
+			The client has gone so the server will see EOF and stop
+		*/
+		server.join();
+		close(listener);
+
+		/*
+			Shutting down the listener wakes a thread waiting in accept() (or stops it from waiting if it hasn't started yet)
+		*/
+		listener = listen(address);
+		JASS_assert(listener >= 0);
+		int accepted = 0;
+		JASS::thread waiter([listener, &accepted]()
+			{
+			accepted = accept(listener);
+			});
+		shutdown(listener);
+		waiter.join();
+		JASS_assert(accepted < 0);
+		close(listener);
+
+		/*
+			Connecting to something that isn't there must fail
+		*/
+		(void)::unlink(address.c_str());
+		JASS_assert(connect(address) == -1);
+#endif
+
+		::puts("channel_socket::PASSED");
+		}
+	}
@@ -1,38 +1,152 @@
 /*
 	CHANNEL_SOCKET.H
 	----------------
+	Copyright (c) 2017 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
 */
-#ifndef CHANNEL_SOCKET_H_
-#define CHANNEL_SOCKET_H_
+/*!
+	@file
+	@brief Input and output channel for a connected stream socket (TCP or Unix domain).
+	@author Andrew Trotman
+	@copyright 2017 Andrew Trotman
+*/
+#pragma once
+
+#include <string>
 
 #include "channel.h"
-#include "sockets.h"
 
-/*
-	class ANT_CHANNEL_SOCKET
-	------------------------
-*/
-class ANT_channel_socket : public ANT_channel
-{
-private:
-	long connected;
-	ANT_socket *socket;
-	char *address;
-	unsigned short port;
-
-private:
-	void connect(void);
-	void reset_socket(void);
-
-protected:
-	virtual long long block_write(char *source, long long length);
-	virtual char *block_read(char *into, long long length);
-	virtual char *getsz(char terminator = '\0');
-
-public:
-	ANT_channel_socket(unsigned short port, char *address = NULL);
-	virtual ~ANT_channel_socket();
-} ;
-
-#endif /* CHANNEL_SOCKET_H_ */
+namespace JASS
+	{
+	/*
+		CLASS CHANNEL_SOCKET
+		--------------------
+	*/
+	/*!
+		@brief Input and output channel for a connected stream socket.
+		@details The address of a socket is given as a string.  If the string is entirely digits then it is taken to be a TCP port number
+		on the loopback interface (127.0.0.1), otherwise it is taken to be the path of a Unix domain socket.  Sockets are only
+		supported on POSIX systems, on other systems listen() and connect() always fail.
+	*/
+	class channel_socket : public channel
+		{
+		private:
+			static constexpr size_t buffer_size = 64 * 1024;		///< The size of the read buffer
+
+		private:
+			int socket;														///< The socket's file descriptor (or -1 if closed)
+			char buffer[buffer_size];									///< Bytes read from the socket but not yet passed to the caller
+			size_t buffer_used;											///< The number of bytes in buffer
+			size_t buffer_position;										///< The number of bytes in buffer that have already been passed to the caller
+
+		protected:
+			/*
+				CHANNEL_SOCKET::BLOCK_WRITE()
+				-----------------------------
+			*/
+			/*!
+				@brief All output happens via the block_write method.
+				@param buffer [in] write length number of bytes from buffer
+				@param length [in] The number of bytes go write.
+				@return The number of bytes written (usually equal to length, less if the other end has closed the connection).
+			*/
+			virtual size_t block_write(const void *buffer, size_t length);
+
+			/*
+				CHANNEL_SOCKET::BLOCK_READ()
+				----------------------------
+			*/
+			/*!
+				@brief All input happens via the block_read method.
+				@param into [out] length number of bytes are written into into
+				@param length [in] The number of bytes to read.
+				@return The number of bytes read (less than length only if the other end has closed the connection).
+			*/
+			virtual size_t block_read(void *into, size_t length);
+
+		public:
+			/*
+				CHANNEL_SOCKET::CHANNEL_SOCKET()
+				--------------------------------
+			*/
+			/*!
+				@brief Constructor.
+				@param socket [in] A connected socket (from accept() or connect()), which this object now owns and will close.
+			*/
+			explicit channel_socket(int socket);
+
+			/*
+				CHANNEL_SOCKET::~CHANNEL_SOCKET()
+				---------------------------------
+			*/
+			/*!
+				@brief Destructor, closes the socket.
+			*/
+			virtual ~channel_socket();
+
+			/*
+				CHANNEL_SOCKET::LISTEN()
+				------------------------
+			*/
+			/*!
+				@brief Create a socket that is listening for connections at the given address.
+				@details A Unix domain socket file that already exists at address is removed first.
+				@param address [in] A port number on the loopback interface or the path of a Unix domain socket.
+				@return The listening socket, or -1 on failure.
+			*/
+			static int listen(const std::string &address);
+
+			/*
+				CHANNEL_SOCKET::ACCEPT()
+				------------------------
+			*/
+			/*!
+				@brief Block until a client connects to a listening socket.
+				@details This method is thread safe, several threads can wait on the same listening socket and each connection is given to exactly one.
+				@param listener [in] A socket returned by listen().
+				@return The connected socket, or -1 on failure.
+			*/
+			static int accept(int listener);
+
+			/*
+				CHANNEL_SOCKET::CONNECT()
+				-------------------------
+			*/
+			/*!
+				@brief Connect to a socket that is listening at the given address.
+				@param address [in] A port number on the loopback interface or the path of a Unix domain socket.
+				@return The connected socket, or -1 on failure.
+			*/
+			static int connect(const std::string &address);
+
+			/*
+				CHANNEL_SOCKET::SHUTDOWN()
+				--------------------------
+			*/
+			/*!
+				@brief Stop all reading and writing on a socket, waking any thread blocked in accept() or reading from it (which then fails or sees end of file).
+				@details This method is async-signal-safe and so can be called from a signal handler.  The socket must still be closed.
+				@param socket [in] The socket (from listen(), accept(), or connect()).
+			*/
+			static void shutdown(int socket);
+
+			/*
+				CHANNEL_SOCKET::CLOSE()
+				-----------------------
+			*/
+			/*!
+				@brief Close a socket returned by listen(), accept(), or connect() that is not owned by a channel_socket.
+				@param socket [in] The socket to close.
+			*/
+			static void close(int socket);
 
+			/*
+				CHANNEL_SOCKET::UNITTEST()
+				--------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+	}
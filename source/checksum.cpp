@@ -12,6 +12,7 @@
 #include <iomanip>
 #include <iostream>
 #include <iterator>
+#include <algorithm>
 
 #include "asserts.h"
 #include "checksum.h"
@@ -97,6 +98,62 @@ namespace JASS
 		return fletcher_16(file);
 		}
 
+	/*
+		CHECKSUM::FLETCHER_64()
+		-----------------------
+	*/
+	uint64_t checksum::fletcher_64(const void *address, size_t length)
+		{
+		const uint64_t modulus = 0xFFFFFFFF;
+		const uint8_t *start = (const uint8_t *)address;
+		const uint8_t *end = start + (length & ~static_cast<size_t>(3));
+		uint64_t sum_1 = 0;
+		uint64_t sum_2 = 0;
+
+		/*
+			Sum blocks of words before taking the modulus (1024 words cannot overflow the 64-bit sums).
+		*/
+		while (start < end)
+			{
+			const uint8_t *end_of_block = start + (std::min)(static_cast<size_t>(end - start), static_cast<size_t>(1024 * sizeof(uint32_t)));
+			for (; start < end_of_block; start += sizeof(uint32_t))
+				{
+				sum_1 += static_cast<uint32_t>(start[0] | (start[1] << 8) | (start[2] << 16) | (static_cast<uint32_t>(start[3]) << 24));
+				sum_2 += sum_1;
+				}
+			sum_1 %= modulus;
+			sum_2 %= modulus;
+			}
+
+		/*
+			The last (partial) word is padded with zeros
+		*/
+		if ((length & 3) != 0)
+			{
+			uint32_t word = 0;
+			for (size_t byte = 0; byte < (length & 3); byte++)
+				word |= static_cast<uint32_t>(start[byte]) << (8 * byte);
+			sum_1 = (sum_1 + word) % modulus;
+			sum_2 = (sum_2 + sum_1) % modulus;
+			}
+
+		return (sum_2 << 32) | sum_1;
+		}
+
+	/*
+		CHECKSUM::FLETCHER_64_COMBINE()
+		-------------------------------
+	*/
+	uint64_t checksum::fletcher_64_combine(uint64_t first, uint64_t second, size_t second_length)
+		{
+		const uint64_t modulus = 0xFFFFFFFF;
+		uint64_t words = ((second_length + 3) / sizeof(uint32_t)) % modulus;
+		uint64_t sum_1 = ((first & 0xFFFFFFFF) + (second & 0xFFFFFFFF)) % modulus;
+		uint64_t sum_2 = ((first >> 32) + (second >> 32) + (words * (first & 0xFFFFFFFF)) % modulus) % modulus;
+
+		return (sum_2 << 32) | sum_1;
+		}
+
 	/*
 		CHECKSUM::UNITTEST()
 		--------------------
@@ -142,6 +199,36 @@ namespace JASS
 		std::istringstream stream(unittest_data::ten_documents);
 		checksum = checksum::fletcher_16(stream);
 		JASS_assert(checksum == 0xF7DE);
+
+		/*
+			Fletcher 64 (checked against the examples on Wikipedia)
+		*/
+		JASS_assert(checksum::fletcher_64("", 0) == 0);
+		JASS_assert(checksum::fletcher_64("abcde", 5) == 0xC8C6C527646362C6);
+		JASS_assert(checksum::fletcher_64("abcdef", 6) == 0xC8C72B276463C8C6);
+		JASS_assert(checksum::fletcher_64("abcdefgh", 8) == 0x312E2B28CCCAC8C6);
+
+		/*
+			A long buffer (summed in more than one block) must change when any byte does
+		*/
+		std::string long_string;
+		while (long_string.size() < 10000)
+			long_string += unittest_data::ten_documents;
+		auto long_checksum = checksum::fletcher_64(long_string.c_str(), long_string.size());
+		long_string[long_string.size() / 2]++;
+		JASS_assert(checksum::fletcher_64(long_string.c_str(), long_string.size()) != long_checksum);
+
+		/*
+			The checksum of the long buffer from the checksums of pieces of it (the last of odd length)
+		*/
+		long_checksum = checksum::fletcher_64(long_string.c_str(), long_string.size());
+		for (size_t split = 0; split <= 8192; split += 4096 + 4)
+			{
+			auto first = checksum::fletcher_64(long_string.c_str(), split);
+			auto second = checksum::fletcher_64(long_string.c_str() + split, long_string.size() - split);
+			JASS_assert(checksum::fletcher_64_combine(first, second, long_string.size() - split) == long_checksum);
+			}
+		JASS_assert(checksum::fletcher_64_combine(checksum::fletcher_64("abcd", 4), checksum::fletcher_64("e", 1), 1) == 0xC8C6C527646362C6);
 		
 		/*
 			Passed!
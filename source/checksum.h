@@ -94,6 +94,35 @@ namespace JASS
 			*/
 			static uint16_t fletcher_16_file(const std::string &filename);
 
+			/*
+				CHECKSUM::FLETCHER_64()
+				-----------------------
+			*/
+			/*!
+				@brief Compute the Fletcher 64-bit checksum of a block of memory.
+				@details The data is summed as little-endian 32-bit words (the last padded with zeros), so this is much faster than Fletcher 16
+				on large buffers, and is strong enough to check index files.
+				@param data [in] The data to checksum.
+				@param length [in] The length of the data (in bytes).
+				@return The Fletcher 64-bit checksum of the data.
+			*/
+			static uint64_t fletcher_64(const void *data, size_t length);
+
+			/*
+				CHECKSUM::FLETCHER_64_COMBINE()
+				-------------------------------
+			*/
+			/*!
+				@brief Compute the Fletcher 64-bit checksum of two blocks of memory, one after the other, from the checksum of each.
+				@details If A is followed by B then sum_1 is sum_1(A) + sum_1(B) and sum_2 is sum_2(A) + sum_2(B) + words(B) * sum_1(A) (all
+				modulo 2^32-1), so a long buffer can be checksummed in pieces (on several threads).  The length of A must be a multiple of 4.
+				@param first [in] The Fletcher 64 checksum of A.
+				@param second [in] The Fletcher 64 checksum of B.
+				@param second_length [in] The length of B (in bytes).
+				@return The Fletcher 64-bit checksum of A followed by B.
+			*/
+			static uint64_t fletcher_64_combine(uint64_t first, uint64_t second, size_t second_length);
+
 			/*
 				CHECKSUM::UNITTEST()
 				--------------------
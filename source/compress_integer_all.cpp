@@ -4,6 +4,8 @@
 	Copyright (c) 2017 Andrew Trotman
 	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
 */
+#include <assert.h>
+
 #include <vector>
 
 #include "compress_integer_all.h"
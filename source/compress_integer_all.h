@@ -14,6 +14,7 @@
 
 #include <array>
 #include <tuple>
+#include <memory>
 #include <string>
 
 #include "commandline.h"
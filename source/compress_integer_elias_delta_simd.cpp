@@ -313,12 +313,11 @@ namespace JASS
  		return decoded;
  		}
 
-#ifdef __AVX512F__
 	/*
-		COMPRESS_INTEGER_ELIAS_DELTA_SIMD::DECODE()
-		-------------------------------------------
+		COMPRESS_INTEGER_ELIAS_DELTA_SIMD::DECODE_AVX512()
+		--------------------------------------------------
 	*/
-	void compress_integer_elias_delta_simd::decode(integer *decoded, size_t integers_to_decode, const void *source_as_void, size_t source_length)
+	JASS_TARGET_AVX512 void compress_integer_elias_delta_simd::decode_avx512(integer *decoded, size_t integers_to_decode, const void *source_as_void, size_t source_length)
 		{
 		uint32_t used = 0;
 		__m512i *into = reinterpret_cast<__m512i *>(decoded);
@@ -376,12 +375,12 @@ namespace JASS
 				}
 		}
 	}
-#elif defined(__AVX2__)
+
 	/*
-		COMPRESS_INTEGER_ELIAS_DELTA_SIMD::DECODE()
-		-------------------------------------------
+		COMPRESS_INTEGER_ELIAS_DELTA_SIMD::DECODE_AVX2()
+		------------------------------------------------
 	*/
-	void compress_integer_elias_delta_simd::decode(integer *decoded, size_t integers_to_decode, const void *source_as_void, size_t source_length)
+	void compress_integer_elias_delta_simd::decode_avx2(integer *decoded, size_t integers_to_decode, const void *source_as_void, size_t source_length)
 		{
 		uint32_t used = 0;
 		__m256i *into = reinterpret_cast<__m256i *>(decoded);
@@ -446,9 +445,19 @@ namespace JASS
 				}
 		}
 	}
-#else
-	#error "Must have either AVX2 or AVX512"
-#endif
+
+	/*
+		COMPRESS_INTEGER_ELIAS_DELTA_SIMD::DECODE()
+		-------------------------------------------
+	*/
+	void compress_integer_elias_delta_simd::decode(integer *decoded, size_t integers_to_decode, const void *source_as_void, size_t source_length)
+		{
+		if (instruction_set::current() == instruction_set::AVX512)
+			decode_avx512(decoded, integers_to_decode, source_as_void, source_length);
+		else
+			decode_avx2(decoded, integers_to_decode, source_as_void, source_length);
+		}
+
 	/*
 		COMPRESS_INTEGER_ELIAS_DELTA_SIMD::UNITTEST()
 		---------------------------------------------
@@ -505,6 +514,17 @@ namespace JASS
 
 		unittest_one(*compressor, second_broken_sequence);
 
+		/*
+			Check the AVX2 decoder too (if the AVX512 decoder was used above)
+		*/
+		if (instruction_set::current() == instruction_set::AVX512)
+			{
+			instruction_set::set(instruction_set::AVX2);
+			unittest_one(*compressor, broken_sequence);
+			unittest_one(*compressor, second_broken_sequence);
+			instruction_set::set(instruction_set::AVX512);
+			}
+
 		puts("compress_integer_elias_delta_simd::PASSED");
 		}
 	}
@@ -18,6 +18,7 @@
 
 
 #include "forceinline.h"
+#include "instruction_set.h"
 #include "compress_integer.h"
 
 namespace JASS
@@ -65,6 +66,32 @@ namespace JASS
 			forceinline void push_selector(uint32_t *&destination, uint8_t raw, uint32_t &selector_bits_used, uint64_t &accumulated_selector);
  			uint8_t forceinline decode_selector(const uint32_t *&selector_set, uint32_t &selector_bits_used, uint64_t &accumulated_selector);
 
+			/*
+				COMPRESS_INTEGER_ELIAS_DELTA_SIMD::DECODE_AVX512()
+				--------------------------------------------------
+			*/
+			/*!
+				@brief Decode a sequence of integers encoded with this codex using AVX512 instructions (only call if the CPU has them).
+				@param decoded [out] The sequence of decoded integers.
+				@param integers_to_decode [in] The minimum number of integers to decode (it may decode more).
+				@param source [in] The encoded integers.
+				@param source_length [in] The length (in bytes) of the source buffer.
+			*/
+			JASS_TARGET_AVX512 void decode_avx512(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length);
+
+			/*
+				COMPRESS_INTEGER_ELIAS_DELTA_SIMD::DECODE_AVX2()
+				------------------------------------------------
+			*/
+			/*!
+				@brief Decode a sequence of integers encoded with this codex using AVX2 instructions.
+				@param decoded [out] The sequence of decoded integers.
+				@param integers_to_decode [in] The minimum number of integers to decode (it may decode more).
+				@param source [in] The encoded integers.
+				@param source_length [in] The length (in bytes) of the source buffer.
+			*/
+			void decode_avx2(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length);
+
 		public:
 			/*
 				COMPRESS_INTEGER_ELIAS_DELTA_SIMD::ENCODE()
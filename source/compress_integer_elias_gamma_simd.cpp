@@ -241,13 +241,11 @@ namespace JASS
 		{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},			///< AND mask for 32-bit integers
 		};
 
-#ifdef __AVX512F__
 		/*
-			COMPRESS_INTEGER_ELIAS_GAMMA_SIMD::DECODE()
-			-------------------------------------------
-			AVX-512F version
+			COMPRESS_INTEGER_ELIAS_GAMMA_SIMD::DECODE_AVX512()
+			--------------------------------------------------
 		*/
-		void compress_integer_elias_gamma_simd::decode(integer *decoded, size_t integers_to_decode, const void *source_as_void, size_t source_length)
+		JASS_TARGET_AVX512 void compress_integer_elias_gamma_simd::decode_avx512(integer *decoded, size_t integers_to_decode, const void *source_as_void, size_t source_length)
 			{
 			__m512i mask;
 			const uint8_t *source = (const uint8_t *)source_as_void;
@@ -308,13 +306,12 @@ namespace JASS
 					}
 				}
 			}
-#elif defined(__AVX2__)
+
 	/*
-		COMPRESS_INTEGER_ELIAS_GAMMA_SIMD::DECODE()
-		-------------------------------------------
-		AVX2 version
+		COMPRESS_INTEGER_ELIAS_GAMMA_SIMD::DECODE_AVX2()
+		------------------------------------------------
 	*/
-	void compress_integer_elias_gamma_simd::decode(integer *decoded, size_t integers_to_decode, const void *source_as_void, size_t source_length)
+	void compress_integer_elias_gamma_simd::decode_avx2(integer *decoded, size_t integers_to_decode, const void *source_as_void, size_t source_length)
 		{
 		__m256i mask;
 		const uint8_t *source = (const uint8_t *)source_as_void;
@@ -384,9 +381,17 @@ namespace JASS
 			}
 		}
 
-#else
-	#error "Must have either AVX2 or AVX512"
-#endif
+	/*
+		COMPRESS_INTEGER_ELIAS_GAMMA_SIMD::DECODE()
+		-------------------------------------------
+	*/
+	void compress_integer_elias_gamma_simd::decode(integer *decoded, size_t integers_to_decode, const void *source_as_void, size_t source_length)
+		{
+		if (instruction_set::current() == instruction_set::AVX512)
+			decode_avx512(decoded, integers_to_decode, source_as_void, source_length);
+		else
+			decode_avx2(decoded, integers_to_decode, source_as_void, source_length);
+		}
 
 	/*
 		COMPRESS_INTEGER_ELIAS_GAMMA_SIMD::UNITTEST()
@@ -397,8 +402,6 @@ namespace JASS
 		compress_integer_elias_gamma_simd *compressor;
 
 		compressor = new compress_integer_elias_gamma_simd();
-		std::vector<std::string>pk;
-		compressor->init(pk);
 		compress_integer::unittest(*compressor);
 
 		std::vector<uint32_t> broken_sequence =
@@ -447,6 +450,17 @@ namespace JASS
 			};
 		unittest_one(*compressor, second_broken_sequence);
 
+		/*
+			Check the AVX2 decoder too (if the AVX512 decoder was used above)
+		*/
+		if (instruction_set::current() == instruction_set::AVX512)
+			{
+			instruction_set::set(instruction_set::AVX2);
+			unittest_one(*compressor, broken_sequence);
+			unittest_one(*compressor, second_broken_sequence);
+			instruction_set::set(instruction_set::AVX512);
+			}
+
 		puts("compress_integer_elias_gamma_simd::PASSED");
 		}
 	}
@@ -17,6 +17,7 @@
 #include <immintrin.h>
 
 #include "forceinline.h"
+#include "instruction_set.h"
 #include "compress_integer_variable_byte.h"
 
 namespace JASS
@@ -62,6 +63,32 @@ namespace JASS
 				return _tzcnt_u64(value) + 1;
 				}
 
+			/*
+				COMPRESS_INTEGER_ELIAS_GAMMA_SIMD_VB::DECODE_AVX512()
+				-----------------------------------------------------
+			*/
+			/*!
+				@brief Decode a sequence of integers encoded with this codex using AVX512 instructions (only call if the CPU has them).
+				@param decoded [out] The sequence of decoded integers.
+				@param integers_to_decode [in] The minimum number of integers to decode (it may decode more).
+				@param source [in] The encoded integers.
+				@param source_length [in] The length (in bytes) of the source buffer.
+			*/
+			JASS_TARGET_AVX512 void decode_avx512(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length);
+
+			/*
+				COMPRESS_INTEGER_ELIAS_GAMMA_SIMD_VB::DECODE_AVX2()
+				---------------------------------------------------
+			*/
+			/*!
+				@brief Decode a sequence of integers encoded with this codex using AVX2 instructions.
+				@param decoded [out] The sequence of decoded integers.
+				@param integers_to_decode [in] The minimum number of integers to decode (it may decode more).
+				@param source [in] The encoded integers.
+				@param source_length [in] The length (in bytes) of the source buffer.
+			*/
+			void decode_avx2(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length);
+
 		public:
 			/*
 				COMPRESS_INTEGER_ELIAS_GAMMA_SIMD_VB::ENCODE()
@@ -90,20 +117,6 @@ namespace JASS
 			*/
 			virtual void decode(integer *decoded, size_t integers_to_decode, const void *source, size_t source_length);
 
-			/*
-				COMPRESS_INTEGER_ELIAS_GAMMA_SIMD_VB::DECODE_WITH_WRITER()
-				----------------------------------------------------------
-			*/
-			/*!
-				@brief Decode a sequence of integers encoded with this codex, calling add_rsv for each SIMD register
-				@param integers_to_decode [in] The minimum number of integers to decode (it may decode more).
-				@param source [in] The encoded integers.
-				@param source_length [in] The length (in bytes) of the source buffer.
-			*/
-#ifdef SIMD_JASS
-			virtual void decode_with_writer(size_t integers_to_decode, const void *source_as_void, size_t source_length);
-#endif
-
 			/*
 				COMPRESS_INTEGER_ELIAS_GAMMA_SIMD_VB::UNITTEST()
 				------------------------------------------------
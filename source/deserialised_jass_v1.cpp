@@ -7,10 +7,12 @@
 #include "file.h"
 #include "slice.h"
 #include "serialise_jass_v1.h"
+#include "serialise_jass_v2.h"
 #include "compress_integer_all.h"
 #include "deserialised_jass_v1.h"
 
 #include <algorithm>
+#include <filesystem>
 
 namespace JASS
 	{
@@ -20,15 +22,6 @@ namespace JASS
 	*/
 	size_t deserialised_jass_v1::read_primary_keys(const std::string &filename)
 		{
-		/*
-			This can take some time so make some noise when we start
-		*/
-		if (verbose)
-			{
-			printf("Loading doclist... ");
-			fflush(stdout);
-			}
-
 		/*
 			Read the disk file
 		*/
@@ -36,24 +29,30 @@ namespace JASS
 		if (bytes == 0)
 			return 0;					// failed to read the file.
 
-		/*
-			Numnber of documents is stored at the end of the file (as a uint64_t)
-		*/
 		const uint8_t *memory = nullptr;
 		primary_key_memory.read_entire_file(memory);
-		documents = *reinterpret_cast<const uint64_t *>(&memory[bytes] - sizeof(uint64_t));
-		primary_key_list.reserve(documents);
+		return read_primary_keys(memory, bytes);
+		}
 
+	/*
+		DESERIALISED_JASS_V1::READ_PRIMARY_KEYS()
+		-----------------------------------------
+	*/
+	size_t deserialised_jass_v1::read_primary_keys(const uint8_t *memory, size_t bytes)
+		{
 		/*
-			The file is in 2 parts, the first is the primary key the second is the poiters to the primary keys
+			This can take some time so make some noise when we start
 		*/
-		uint64_t *offset_base = (uint64_t *) (&memory[0] + bytes - (documents * sizeof(uint64_t) + sizeof(uint64_t)));
+		if (verbose)
+			{
+			printf("Loading doclist... ");
+			fflush(stdout);
+			}
 
 		/*
-			Now work through each primary key adding it to the list of primary keys
+			The primary keys are used in place (rather than copied) so this is just a matter of finding the list of pointers to them
 		*/
-		for (size_t id = 0; id < documents; id++)
-			primary_key_list.push_back(reinterpret_cast<const char *>(memory + offset_base[id]));
+		documents = document_primary_keys.read(memory, bytes);
 
 		/*
 			This can take some time so make some noise when we're finished
@@ -76,14 +75,6 @@ namespace JASS
 	*/
 	size_t deserialised_jass_v1::read_vocabulary(const std::string &vocab_filename, const std::string &terms_filename)
 		{
-		/*
-			This can take some time so make some noise when we start
-		*/
-		if (verbose)
-			{
-			printf("Loading vocab... ");
-			fflush(stdout);
-			}
 		/*
 			Read the file of tripples that are the pointers to the terms (and the postings too)
 		*/
@@ -99,22 +90,50 @@ namespace JASS
 		auto bytes = file::read_entire_file(terms_filename, vocabulary_terms_memory);
 		if (bytes == 0)
 			return 0;
-		terms = length / (sizeof(uint64_t) + sizeof(uint64_t) + sizeof(uint64_t));
 		const uint8_t *vocab_terms;
 		vocabulary_terms_memory.read_entire_file(vocab_terms);
 
+		return read_vocabulary(vocab, length, vocab_terms, bytes);
+		}
+
+	/*
+		DESERIALISED_JASS_V1::READ_VOCABULARY()
+		---------------------------------------
+	*/
+	size_t deserialised_jass_v1::read_vocabulary(const uint8_t *vocab, size_t length, const uint8_t *vocab_terms, size_t terms_length)
+		{
 		/*
-			Build the vocabulary
+			This can take some time so make some noise when we start
 		*/
-		vocabulary_list.reserve(terms);
-		const uint8_t *postings_base = postings();
-		for (size_t term = 0; term < terms; term++)
+		if (verbose)
 			{
-			const uint64_t *base = reinterpret_cast<const uint64_t *>(vocab + (3 * sizeof(uint64_t)) * term);
-
-			vocabulary_list.push_back(metadata(slice(reinterpret_cast<const char*>(vocab_terms + base[0])), postings_base + base[1], base[2]));
+			printf("Loading vocab... ");
+			fflush(stdout);
 			}
 
+		vocabulary_record_size = index_version == 2 ? serialise_jass_v2::vocabulary_record_size : 3 * sizeof(uint64_t);
+		vocabulary_records = vocab;
+		vocabulary_strings = vocab_terms;
+		vocabulary_strings_length = terms_length;
+		terms = length / vocabulary_record_size;
+
+		/*
+			The records are checked against the lengths of the other files before they are used, and each term must be '\0' terminated, which
+			it is if the last byte of CIvocab_terms.bin is.
+		*/
+		if (terms_length == 0 || vocab_terms[terms_length - 1] != '\0')
+			terms = 0;
+
+		/*
+			If there is a hash table that matches the vocabulary then terms are looked up in that and the records are decoded when they are
+			needed, otherwise build the (sorted) vocabulary now so that it can be searched
+		*/
+		vocabulary_list.clear();
+		vocabulary_listed = false;
+		vocabulary_hashed = index_version == 2 && terms != 0 && vocabulary_table.size() == terms;
+		if (!vocabulary_hashed && !build_vocabulary_list())
+			terms = 0;
+
 		/*
 			This can take some time so make some noise when we're finished
 		*/
@@ -130,6 +149,81 @@ namespace JASS
 		return terms;
 		}
 
+	/*
+		DESERIALISED_JASS_V1::BUILD_VOCABULARY_LIST()
+		---------------------------------------------
+	*/
+	bool deserialised_jass_v1::build_vocabulary_list(void)
+		{
+		vocabulary_list.clear();
+		vocabulary_list.reserve(terms);
+		for (size_t term = 0; term < terms; term++)
+			if (vocabulary_record_is_valid(term))
+				vocabulary_list.push_back(vocabulary_term(term));
+		vocabulary_listed = true;
+
+		return vocabulary_list.size() == terms;
+		}
+
+	/*
+		DESERIALISED_JASS_V1::VOCABULARY_RECORD_IS_VALID()
+		--------------------------------------------------
+	*/
+	bool deserialised_jass_v1::vocabulary_record_is_valid(size_t which) const
+		{
+		const uint64_t *base = vocabulary_record(which);
+
+		if (base[0] >= vocabulary_strings_length)
+			return false;
+
+		/*
+			A JASS v2 term has impacts of each of the 4 segment header arrays in CIsegments.bin, a JASS v1 term has impacts pointers in CIpostings.bin
+		*/
+		size_t bytes_per_segment = index_version == 2 ? sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint16_t) : sizeof(uint64_t);
+		size_t length = index_version == 2 ? segments_length : postings_length;
+
+		return base[2] <= length / bytes_per_segment && base[1] <= length - base[2] * bytes_per_segment;
+		}
+
+	/*
+		DESERIALISED_JASS_V1::SEGMENTS_ARE_VALID()
+		------------------------------------------
+	*/
+	bool deserialised_jass_v1::segments_are_valid(const metadata &term) const
+		{
+		for (uint64_t which = 0; which < term.impacts; which++)
+			{
+			/*
+				A JASS v1 segment header is in the postings, so check it is before reading it
+			*/
+			if (index_version == 1)
+				{
+				uint64_t header_offset = reinterpret_cast<const uint64_t *>(term.offset)[which];
+				if (postings_length < sizeof(segment_header) || header_offset > postings_length - sizeof(segment_header))
+					return false;
+				}
+
+			auto header = segment(term, which);
+			if (header.offset > header.end || header.end > postings_length || header.segment_frequency > documents)
+				return false;
+			}
+
+		return true;
+		}
+
+	/*
+		DESERIALISED_JASS_V1::READ_VOCABULARY_HASH()
+		--------------------------------------------
+	*/
+	size_t deserialised_jass_v1::read_vocabulary_hash(const std::string &filename)
+		{
+		const uint8_t *memory = nullptr;
+		auto length = file::read_entire_file(filename, vocabulary_hash_memory);
+		vocabulary_hash_memory.read_entire_file(memory);
+
+		return vocabulary_table.read(memory, length);
+		}
+
 	/*
 		DESERIALISED_JASS_V1::READ_POSTINGS()
 		-------------------------------------
@@ -149,6 +243,9 @@ namespace JASS
 			Read the postings
 		*/
 		auto postings_memory_length = file::read_entire_file(filename, postings_memory);
+		const uint8_t *memory = nullptr;
+		postings_memory.read_entire_file(memory);
+		read_postings(memory, postings_memory_length);
 
 		/*
 			This can take some time so make some noise when we're finished
@@ -162,36 +259,182 @@ namespace JASS
 		return postings_memory_length;
 		}
 
+	/*
+		DESERIALISED_JASS_V1::READ_POSTINGS()
+		-------------------------------------
+	*/
+	size_t deserialised_jass_v1::read_postings(const uint8_t *memory, size_t length)
+		{
+		postings_address = memory;
+		postings_length = length;
+
+		/*
+			A JASS v2 index starts with a header, a JASS v1 index starts with the codex
+		*/
+		if (length >= serialise_jass_v2::header_size && std::equal(serialise_jass_v2::signature, serialise_jass_v2::signature + sizeof(serialise_jass_v2::signature), memory))
+			index_version = 2;
+		else
+			index_version = 1;
+
+		return length;
+		}
+
+	/*
+		DESERIALISED_JASS_V1::READ_SEGMENTS()
+		-------------------------------------
+	*/
+	size_t deserialised_jass_v1::read_segments(const std::string &filename)
+		{
+		/*
+			This can take some time so make some noise when we start
+		*/
+		if (verbose)
+			{
+			printf("Loading segments... ");
+			fflush(stdout);
+			}
+
+		/*
+			Read the segment headers
+		*/
+		auto segments_memory_length = file::read_entire_file(filename, segments_memory);
+		segments_memory.read_entire_file(segments_address);
+		segments_length = segments_memory_length;
+
+		/*
+			This can take some time so make some noise when we're finished
+		*/
+		if (verbose)
+			puts("done");
+
+		/*
+			Return the size of the segment headers (in bytes)
+		*/
+		return segments_memory_length;
+		}
+
 	/*
 		DESERIALISED_JASS_V1::READ_INDEX()
 		----------------------------------
 	*/
-	size_t deserialised_jass_v1::read_index(const std::string &primary_key_filename, const std::string &vocab_filename, const std::string &terms_filename, const std::string &postings_filename)
+	size_t deserialised_jass_v1::read_index(const std::string &primary_key_filename, const std::string &vocab_filename, const std::string &terms_filename, const std::string &postings_filename, const std::string &segments_filename, const std::string &vocab_hash_filename)
 		{
 		if (read_primary_keys(primary_key_filename) != 0)
 			if (read_postings(postings_filename) != 0)
-				if (read_vocabulary(vocab_filename, terms_filename) != 0)
-					return 1;
+				if (index_version == 1 || read_segments(segments_filename) != 0)
+					{
+					/*
+						The hash table is optional, without it the vocabulary is searched
+					*/
+					if (index_version == 2)
+						read_vocabulary_hash(vocab_hash_filename);
+
+					if (read_vocabulary(vocab_filename, terms_filename) != 0)
+						return 1;
+					}
 
 		return 0;
 		}
 
+	/*
+		DESERIALISED_JASS_V1::READ_INDEX_CONTAINER()
+		--------------------------------------------
+	*/
+	size_t deserialised_jass_v1::read_index_container(const std::string &filename, size_t validation_threads)
+		{
+		if (!container.open(filename))
+			return 0;
+
+		/*
+			Check the sections (in parallel) before looking at them
+		*/
+		if (validation_threads != 0)
+			{
+			if (verbose)
+				{
+				printf("Validating %s... ", filename.c_str());
+				fflush(stdout);
+				}
+			if (!container.validate(validation_threads))
+				{
+				if (verbose)
+					puts("failed");
+				return 0;
+				}
+			if (verbose)
+				puts("done");
+			}
+
+		auto primary_keys = container.find("CIdoclist.bin");
+		auto vocab = container.find("CIvocab.bin");
+		auto vocab_terms = container.find("CIvocab_terms.bin");
+		auto postings_section = container.find("CIpostings.bin");
+		auto segments_section = container.find("CIsegments.bin");
+		auto vocab_hash = container.find("CIvocab_hash.bin");
+		if (primary_keys == nullptr || vocab == nullptr || vocab_terms == nullptr || postings_section == nullptr)
+			return 0;
+
+		if (read_primary_keys(primary_keys->address, primary_keys->length) == 0)
+			return 0;
+		if (read_postings(postings_section->address, postings_section->length) == 0)
+			return 0;
+		if (index_version != container.version() || codex_id() != container.codex())
+			return 0;
+		if (index_version == 2)
+			{
+			if (segments_section == nullptr)
+				return 0;
+			segments_address = segments_section->address;
+			segments_length = segments_section->length;
+			if (vocab_hash != nullptr)
+				vocabulary_table.read(vocab_hash->address, vocab_hash->length);
+			}
+		if (read_vocabulary(vocab->address, vocab->length, vocab_terms->address, vocab_terms->length) == 0)
+			return 0;
+
+		return 1;
+		}
+
+	/*
+		DESERIALISED_JASS_V1::READ_INDEX_DIRECTORY()
+		--------------------------------------------
+	*/
+	size_t deserialised_jass_v1::read_index_directory(const std::string &directory, size_t validation_threads)
+		{
+		std::string container_filename = directory + "/" + container_name;
+		if (std::filesystem::exists(container_filename))
+			return read_index_container(container_filename, validation_threads);
+
+		return read_index(directory + "/CIdoclist.bin", directory + "/CIvocab.bin", directory + "/CIvocab_terms.bin", directory + "/CIpostings.bin", directory + "/CIsegments.bin", directory + "/CIvocab_hash.bin");
+		}
+
+	/*
+		DESERIALISED_JASS_V1::CODEX_ID()
+		--------------------------------
+	*/
+	uint8_t deserialised_jass_v1::codex_id(void) const
+		{
+		const uint8_t *memory = postings();
+
+		if (memory == nullptr)
+			return 0;
+		else
+			return index_version == 2 ? memory[sizeof(serialise_jass_v2::signature)] : memory[0];
+		}
+
 	/*
 		DESERIALISED_JASS_V1::CODEX()
 		-----------------------------
 	*/
 	std::unique_ptr<compress_integer> deserialised_jass_v1::codex(std::string &name, int32_t &d_ness) const
 		{
-		const uint8_t *memory;
-
-		postings_memory.read_entire_file(memory);
-		if (memory == nullptr)
+		if (postings() == nullptr)
 			{
 			name = "None";
 			d_ness = 0;
 			return compress_integer_all::get_by_name("None");
 			}
 		else
-			return serialise_jass_v1::get_compressor(static_cast<serialise_jass_v1::jass_v1_codex>(memory[0]), name, d_ness);
+			return serialise_jass_v1::get_compressor(static_cast<serialise_jass_v1::jass_v1_codex>(codex_id()), name, d_ness);
 		}
 	}
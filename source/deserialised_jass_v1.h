@@ -19,7 +19,10 @@
 
 #include "slice.h"
 #include "query_term.h"
+#include "index_container.h"
 #include "compress_integer.h"
+#include "vocabulary_hash.h"
+#include "primary_key_list.h"
 
 namespace JASS
 	{
@@ -29,6 +32,8 @@ namespace JASS
 	*/
 	/*!
 		@brief Load and deserialise a JASS v1 index
+		@details JASS v2 indexes (see serialise_jass_v2) are also read.  Use segment() to read the segment headers of either, or segments()
+		for the (faster) struct of arrays of a JASS v2 index.
 	*/
 	class deserialised_jass_v1
 		{
@@ -54,6 +59,24 @@ namespace JASS
 				};
 			#pragma pack(pop)
 
+			/*
+				CLASS DESERIALISED_JASS_V1::SEGMENT_LIST
+				----------------------------------------
+			*/
+			/*!
+				@brief The segment headers of a term in a JASS v2 index, stored as a struct of arrays (each metadata::impacts long).
+				@details See serialise_jass_v2 for the layout.  Each array is naturally aligned so the headers of a term can be walked without following
+				a pointer to each.
+			*/
+			class segment_list
+				{
+				public:
+					const uint64_t *offset;						///< Offset (within the postings file) of the start of each compressed segment
+					const uint32_t *segment_frequency;		///< The number of document ids in each segment
+					const uint32_t *length;						///< The length (in bytes) of each compressed segment
+					const uint16_t *impact;						///< The impact score of each segment
+				};
+
 			/*
 				CLASS DESERIALISED_JASS_V1::METADATA
 				------------------------------------
@@ -67,6 +90,9 @@ namespace JASS
 					slice term;								///< Pointer to a '\0' terminated string that is this term's name
 					uint8_t *offset;						///< Offset to the postings for this term
 					uint64_t impacts;						///< The numner of impact segments this term has
+					uint64_t document_frequency;		///< The number of postings this term has (0 if not known, as in a JASS v1 index)
+					uint16_t highest_impact;			///< The largest impact score of this term (0 if not known, as in a JASS v1 index)
+					uint16_t lowest_impact;				///< The smallest impact score of this term (0 if not known, as in a JASS v1 index)
 
 				public:
 					/*
@@ -79,7 +105,10 @@ namespace JASS
 					metadata() :
 						term(),
 						offset(nullptr),
-						impacts(0)
+						impacts(0),
+						document_frequency(0),
+						highest_impact(0),
+						lowest_impact(0)
 						{
 						/* Nothing */
 						}
@@ -93,11 +122,17 @@ namespace JASS
 						@param term [in]  The term this object represents
 						@param offset [in] The a ppointer to the postings lists for this term
 						@param impacts [in] The number of impacts for this term
+						@param document_frequency [in] The number of postings for this term (0 if not known)
+						@param highest_impact [in] The largest impact score of this term (0 if not known)
+						@param lowest_impact [in] The smallest impact score of this term (0 if not known)
 					*/
-					metadata(const slice &term, const void *offset, uint64_t impacts) :
+					metadata(const slice &term, const void *offset, uint64_t impacts, uint64_t document_frequency = 0, uint16_t highest_impact = 0, uint16_t lowest_impact = 0) :
 						term(term),
 						offset(const_cast<uint8_t *>(reinterpret_cast<const uint8_t *>(offset))),
-						impacts(impacts)
+						impacts(impacts),
+						document_frequency(document_frequency),
+						highest_impact(highest_impact),
+						lowest_impact(lowest_impact)
 						{
 						/* Nothing */
 						}
@@ -122,14 +157,33 @@ namespace JASS
 
 			uint64_t documents;										///< The number of documents in the collection
 			file::file_read_only primary_key_memory;			///< Memory used to store the primary key strings
-			std::vector<std::string> primary_key_list;		///< The array of primary keys
+			primary_key_list document_primary_keys;			///< The primary keys (pointing into primary_key_memory or the container)
 
 			uint64_t terms;											///< The number of terms in the collection
 			file::file_read_only vocabulary_memory;			///< Memory used to store the vocabulary pointers
 			file::file_read_only vocabulary_terms_memory;	///< Memory used to store the vocabulary strings
-			std::vector<metadata> vocabulary_list;				///< The (sorted in alphabetical order) array of vocbulary terms
+			std::vector<metadata> vocabulary_list;				///< The (sorted in alphabetical order) array of vocbulary terms (only built on demand if vocabulary_hashed)
+			bool vocabulary_listed;									///< Has vocabulary_list been built?
+			const uint8_t *vocabulary_records;					///< The start of the vocabulary pointers (CIvocab.bin)
+			size_t vocabulary_record_size;						///< The size (in bytes) of each record in CIvocab.bin
+			const uint8_t *vocabulary_strings;					///< The start of the vocabulary strings (CIvocab_terms.bin)
+			size_t vocabulary_strings_length;					///< The length (in bytes) of CIvocab_terms.bin
+			file::file_read_only vocabulary_hash_memory;		///< Memory used to store the vocabulary hash table (JASS v2 only)
+			vocabulary_hash vocabulary_table;					///< The hash table mapping terms to their records in CIvocab.bin (JASS v2 only)
+			bool vocabulary_hashed;									///< Are terms looked up with vocabulary_table (rather than searching vocabulary_list)?
 
 			file::file_read_only postings_memory;				///< Memory used to store the postings
+			file::file_read_only segments_memory;				///< Memory used to store the segment headers (JASS v2 only)
+			const uint8_t *postings_address;						///< The start of the postings
+			size_t postings_length;									///< The length (in bytes) of the postings
+			const uint8_t *segments_address;						///< The start of the segment headers (JASS v2 only)
+			size_t segments_length;									///< The length (in bytes) of the segment headers (JASS v2 only)
+			uint8_t index_version;									///< The version of the index (1 or 2)
+
+			index_container container;								///< The container (when the index is read from one)
+
+		public:
+			static constexpr const char *container_name = "JASS.index";		///< The name of the file that holds an index packed into a container
 
 		protected:
 			/*
@@ -143,6 +197,18 @@ namespace JASS
 			*/
 			size_t read_primary_keys(const std::string &primary_key_filename = "CIdoclist.bin");
 
+			/*
+				DESERIALISED_JASS_V1::READ_PRIMARY_KEYS()
+				-----------------------------------------
+			*/
+			/*!
+				@brief Decode the JASS v1 index primary key file (already in memory)
+				@param memory [in] The contents of CIdoclist.bin
+				@param bytes [in] The length of CIdoclist.bin
+				@return The number of documents in the collection (or 0 on error)
+			*/
+			size_t read_primary_keys(const uint8_t *memory, size_t bytes);
+
 			/*
 				DESERIALISED_JASS_V1::READ_VOCABULARY()
 				---------------------------------------
@@ -155,6 +221,20 @@ namespace JASS
 			*/
 			size_t read_vocabulary(const std::string &vocab_filename = "CIvocab.bin", const std::string &terms_filename = "CIvocab_terms.bin");
 
+			/*
+				DESERIALISED_JASS_V1::READ_VOCABULARY()
+				---------------------------------------
+			*/
+			/*!
+				@brief Decode the JASS v1 index vocabulary files (already in memory, and after the postings and segment headers)
+				@param vocab [in] The contents of CIvocab.bin
+				@param length [in] The length of CIvocab.bin
+				@param vocab_terms [in] The contents of CIvocab_terms.bin
+				@param terms_length [in] The length of CIvocab_terms.bin
+				@return The number of terms in the collection (or 0 on error, including a record that points outside the other files)
+			*/
+			size_t read_vocabulary(const uint8_t *vocab, size_t length, const uint8_t *vocab_terms, size_t terms_length);
+
 			/*
 				DESERIALISED_JASS_V1::READ_POSTINGS()
 				-------------------------------------
@@ -166,6 +246,62 @@ namespace JASS
 			*/
 			size_t read_postings(const std::string &postings_filename = "CIpostings.bin");
 
+			/*
+				DESERIALISED_JASS_V1::READ_POSTINGS()
+				-------------------------------------
+			*/
+			/*!
+				@brief Use the JASS v1 index postings (already in memory), and determine the version of the index from them
+				@param memory [in] The contents of CIpostings.bin
+				@param length [in] The length of CIpostings.bin
+				@return length
+			*/
+			size_t read_postings(const uint8_t *memory, size_t length);
+
+			/*
+				DESERIALISED_JASS_V1::READ_SEGMENTS()
+				-------------------------------------
+			*/
+			/*!
+				@brief Read the JASS v2 index segment headers file
+				@param segments_filename [in] the name of the file containing the segment headers ("CIsegments.bin")
+				@return size of the segment headers file or 0 on failure
+			*/
+			size_t read_segments(const std::string &segments_filename = "CIsegments.bin");
+
+			/*
+				DESERIALISED_JASS_V1::READ_VOCABULARY_HASH()
+				--------------------------------------------
+			*/
+			/*!
+				@brief Read the JASS v2 index vocabulary hash table file (which must be read before the vocabulary)
+				@param vocab_hash_filename [in] the name of the file containing the hash table ("CIvocab_hash.bin")
+				@return The number of terms in the hash table or 0 on failure
+			*/
+			size_t read_vocabulary_hash(const std::string &vocab_hash_filename = "CIvocab_hash.bin");
+
+			/*
+				DESERIALISED_JASS_V1::BUILD_VOCABULARY_LIST()
+				---------------------------------------------
+			*/
+			/*!
+				@brief Decode every record of CIvocab.bin into vocabulary_list (skipping any that are not valid, see vocabulary_record_is_valid())
+				@return true if every record is valid, else false
+			*/
+			bool build_vocabulary_list(void);
+
+			/*
+				DESERIALISED_JASS_V1::VOCABULARY_RECORD_IS_VALID()
+				--------------------------------------------------
+			*/
+			/*!
+				@brief Check that a record of CIvocab.bin points into CIvocab_terms.bin and that its segment headers (or, in JASS v1, the pointers to them)
+				lie within CIsegments.bin (or CIpostings.bin)
+				@param which [in] The record number (less than the number of terms)
+				@return true if the record can be decoded, else false
+			*/
+			bool vocabulary_record_is_valid(size_t which) const;
+
 		public:
 			/*
 				DESERIALISED_JASS_V1::DESERIALISED_JASS_V1()
@@ -178,7 +314,18 @@ namespace JASS
 			explicit deserialised_jass_v1(bool verbose = false) :
 				verbose(verbose),
 				documents(0),
-				terms(0)
+				terms(0),
+				vocabulary_listed(false),
+				vocabulary_records(nullptr),
+				vocabulary_record_size(0),
+				vocabulary_strings(nullptr),
+				vocabulary_strings_length(0),
+				vocabulary_hashed(false),
+				postings_address(nullptr),
+				postings_length(0),
+				segments_address(nullptr),
+				segments_length(0),
+				index_version(1)
 				{
 				/* Nothing */
 				}
@@ -188,14 +335,64 @@ namespace JASS
 				----------------------------------
 			*/
 			/*!
-				@brief Read a JASS v1 index into memory
+				@brief Read a JASS v1 (or JASS v2) index into memory
+				@details The version of the index is taken from the start of the postings file, and the segment headers file is only read if it is a JASS v2 index.
 				@param primary_key_filename [in] the name of the file containing the primary key list ("CIdoclist.bin")
 				@param vocab_filename [in] the name of the file containing the vocabulary pointers ("CIvocab.bin")
 				@param terms_filename [in] the name of the file containing the vocabulary strings ("CIvocab_terms.bin")
 				@param postings_filename [in] the name of the file containing the postings ("CIpostings.bin")
+				@param segments_filename [in] the name of the file containing the segment headers of a JASS v2 index ("CIsegments.bin")
+				@param vocab_hash_filename [in] the name of the file containing the vocabulary hash table of a JASS v2 index ("CIvocab_hash.bin", optional)
 				@return 0 on failure, non-zero on success
 			*/
-			size_t read_index(const std::string &primary_key_filename = "CIdoclist.bin", const std::string &vocab_filename = "CIvocab.bin", const std::string &terms_filename = "CIvocab_terms.bin", const std::string &postings_filename = "CIpostings.bin");
+			size_t read_index(const std::string &primary_key_filename = "CIdoclist.bin", const std::string &vocab_filename = "CIvocab.bin", const std::string &terms_filename = "CIvocab_terms.bin", const std::string &postings_filename = "CIpostings.bin", const std::string &segments_filename = "CIsegments.bin", const std::string &vocab_hash_filename = "CIvocab_hash.bin");
+
+			/*
+				DESERIALISED_JASS_V1::READ_INDEX_CONTAINER()
+				--------------------------------------------
+			*/
+			/*!
+				@brief Read an index that has been packed into a single file (see index_container) with one mapping
+				@param filename [in] the name of the container
+				@param validation_threads [in] Check the checksums of the sections with this many threads (0 to not check them)
+				@return 0 on failure (including a checksum failure), non-zero on success
+			*/
+			size_t read_index_container(const std::string &filename = container_name, size_t validation_threads = 1);
+
+			/*
+				DESERIALISED_JASS_V1::READ_INDEX_DIRECTORY()
+				--------------------------------------------
+			*/
+			/*!
+				@brief Read the index in a directory, from the container (JASS.index) if there is one, else from the separate files
+				@param directory [in] the directory holding the index
+				@param validation_threads [in] Check the checksums of a container with this many threads (0 to not check them)
+				@return 0 on failure, non-zero on success
+			*/
+			size_t read_index_directory(const std::string &directory, size_t validation_threads = 1);
+
+			/*
+				DESERIALISED_JASS_V1::VERSION()
+				-------------------------------
+			*/
+			/*!
+				@brief Return the version of the index
+				@return 1 for a JASS v1 index, 2 for a JASS v2 index
+			*/
+			uint8_t version(void) const
+				{
+				return index_version;
+				}
+
+			/*
+				DESERIALISED_JASS_V1::CODEX_ID()
+				--------------------------------
+			*/
+			/*!
+				@brief Return the identifier of the codex used to compress the postings (a serialise_jass_v1::jass_v1_codex)
+				@return The codex identifier (or 0 if no index has been read)
+			*/
+			uint8_t codex_id(void) const;
 
 			/*
 				DESERIALISED_JASS_V1::CODEX()
@@ -214,12 +411,12 @@ namespace JASS
 				------------------------------------
 			*/
 			/*!
-				@brief Return the list of primary keys as a std::vector<std::string>
-				@return A reference to a vector of primary keys
+				@brief Return the list of primary keys (which point into the index, so they are valid for as long as it is)
+				@return A reference to the list of primary keys
 			*/
-			const std::vector<std::string> &primary_keys(void) const
+			const primary_key_list &primary_keys(void) const
 				{
-				return primary_key_list;
+				return document_primary_keys;
 				}
 
 			/*
@@ -232,11 +429,67 @@ namespace JASS
 			*/
 			const uint8_t *postings(void) const
 				{
-				const uint8_t *buffer = nullptr;
-				postings_memory.read_entire_file(buffer);
-				return buffer;
+				return postings_address;
 				}
 
+			/*
+				DESERIALISED_JASS_V1::SEGMENTS()
+				--------------------------------
+			*/
+			/*!
+				@brief Return the segment headers of a term in a JASS v2 index (this must not be called on a JASS v1 index)
+				@param term [in] The metadata of the term
+				@return The segment headers, each array term.impacts long
+			*/
+			segment_list segments(const metadata &term) const
+				{
+				segment_list list;
+
+				list.offset = reinterpret_cast<const uint64_t *>(term.offset);
+				list.segment_frequency = reinterpret_cast<const uint32_t *>(list.offset + term.impacts);
+				list.length = list.segment_frequency + term.impacts;
+				list.impact = reinterpret_cast<const uint16_t *>(list.length + term.impacts);
+
+				return list;
+				}
+
+			/*
+				DESERIALISED_JASS_V1::SEGMENT()
+				-------------------------------
+			*/
+			/*!
+				@brief Return one segment header of a term, in the JASS v1 layout, regardless of the version of the index
+				@param term [in] The metadata of the term
+				@param which [in] The segment (counting from 0, less than term.impacts)
+				@return A copy of the segment header
+			*/
+			segment_header segment(const metadata &term, uint64_t which) const
+				{
+				if (index_version == 1)
+					return *reinterpret_cast<const segment_header *>(postings() + reinterpret_cast<const uint64_t *>(term.offset)[which]);
+
+				auto list = segments(term);
+				segment_header header;
+				header.impact = list.impact[which];
+				header.offset = list.offset[which];
+				header.end = list.offset[which] + list.length[which];
+				header.segment_frequency = list.segment_frequency[which];
+
+				return header;
+				}
+
+			/*
+				DESERIALISED_JASS_V1::SEGMENTS_ARE_VALID()
+				------------------------------------------
+			*/
+			/*!
+				@brief Check that each segment of a term lies within the postings and holds no more postings than there are documents
+				@details The terms returned by postings_details() have already been checked, terms reached through begin() have not.
+				@param term [in] The metadata of the term
+				@return true if each segment can be decoded, else false
+			*/
+			bool segments_are_valid(const metadata &term) const;
+
 			/*
 				DESERIALISED_JASS_V1::DOCUMENT_COUNT()
 				--------------------------------------
@@ -250,6 +503,56 @@ namespace JASS
 				return documents;
 				}
 
+			/*
+				DESERIALISED_JASS_V1::TERM_COUNT()
+				----------------------------------
+			*/
+			/*!
+				@brief Return the number of terms in the vocabulary
+				@return the number of terms in the vocabulary
+			*/
+			size_t term_count(void) const
+				{
+				return terms;
+				}
+
+			/*
+				DESERIALISED_JASS_V1::VOCABULARY_RECORD()
+				-----------------------------------------
+			*/
+			/*!
+				@brief Return the start of a record in CIvocab.bin (the term, offset, impacts, and for JASS v2 the postings and impact range)
+				@param which [in] The record number (counting from 0, in alphabetical order of the terms)
+				@return A pointer to the record
+			*/
+			const uint64_t *vocabulary_record(size_t which) const
+				{
+				return reinterpret_cast<const uint64_t *>(vocabulary_records + vocabulary_record_size * which);
+				}
+
+			/*
+				DESERIALISED_JASS_V1::VOCABULARY_TERM()
+				---------------------------------------
+			*/
+			/*!
+				@brief Decode a record of CIvocab.bin (without needing vocabulary_list)
+				@param which [in] The record number (counting from 0, in alphabetical order of the terms)
+				@return The metadata of the term
+			*/
+			metadata vocabulary_term(size_t which) const
+				{
+				const uint64_t *base = vocabulary_record(which);
+				slice term(reinterpret_cast<const char *>(vocabulary_strings + base[0]));
+
+				if (index_version == 2)			// JASS v2 points to the segment headers rather than the postings
+					{
+					const uint16_t *impact = reinterpret_cast<const uint16_t *>(base + 4);
+					return metadata(term, segments_address + base[1], base[2], base[3], impact[0], impact[1]);
+					}
+				else
+					return metadata(term, postings_address + base[1], base[2]);
+				}
+
 			/*
 				DESERIALISED_JASS_V1::POSTINGS_DETAILS()
 				----------------------------------------
@@ -262,6 +565,28 @@ namespace JASS
 			*/
 			bool postings_details(metadata &metadata, const query_term &term) const
 				{
+				/*
+					A JASS v2 index has a hash table, so look the term up in that and then decode its record
+				*/
+				if (vocabulary_hashed)
+					{
+					const slice &token = term.token();
+					auto same = [this, &token](size_t record)
+						{
+						uint64_t offset = vocabulary_record(record)[0];
+						if (offset >= vocabulary_strings_length)
+							return false;
+						const char *candidate = reinterpret_cast<const char *>(vocabulary_strings + offset);
+						return ::strncmp(candidate, reinterpret_cast<const char *>(token.address()), token.size()) == 0 && candidate[token.size()] == '\0';
+						};
+
+					size_t record;
+					if (!vocabulary_table.find(token, same, record) || !vocabulary_record_is_valid(record))
+						return false;
+					metadata = vocabulary_term(record);
+					return segments_are_valid(metadata);
+					}
+
 				auto found = std::lower_bound(vocabulary_list.begin(), vocabulary_list.end(), term.token());
 
 				/*
@@ -276,7 +601,7 @@ namespace JASS
 				if (term.token() == found->term)
 					{
 					metadata = *found;
-					return true;
+					return segments_are_valid(metadata);
 					}
 
 				/*
@@ -295,6 +620,8 @@ namespace JASS
 			*/
 			auto begin(void)
 				{
+				if (!vocabulary_listed)
+					build_vocabulary_list();
 				return vocabulary_list.begin();
 				}
 
@@ -308,6 +635,8 @@ namespace JASS
 			*/
 			auto end(void)
 				{
+				if (!vocabulary_listed)
+					build_vocabulary_list();
 				return vocabulary_list.end();
 				}
 		};
@@ -33,10 +33,10 @@ namespace JASS
 		FILE::FILE_READ_ONLY::OPEN()
 		----------------------------
 	*/
-	size_t file::file_read_only::open(const std::string &filename)
+	size_t file::file_read_only::open(const std::string &filename, access_pattern access)
 		{
 		#ifdef _MSC_VER
-			hFile = CreateFile(filename.c_str(), GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_READONLY, NULL);
+			hFile = CreateFile(filename.c_str(), GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_READONLY | (access == sequential ? FILE_FLAG_SEQUENTIAL_SCAN : 0), NULL);
 			if (hFile == INVALID_HANDLE_VALUE)
 				return 0;
 
@@ -88,7 +88,7 @@ namespace JASS
 			#ifdef __APPLE__
 				file_contents = (uint8_t *)mmap(nullptr, statistics.st_size, PROT_READ, MAP_PRIVATE, reader, 0);
 			#else
-				file_contents = (uint8_t *)mmap(nullptr, statistics.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, reader, 0);
+				file_contents = (uint8_t *)mmap(nullptr, statistics.st_size, PROT_READ, MAP_PRIVATE | (access == sequential ? 0 : MAP_POPULATE), reader, 0);
 			#endif
 
 			/*
@@ -96,8 +96,23 @@ namespace JASS
 			*/
 			close(reader);
 
-			if (file_contents == nullptr)
+			if (file_contents == nullptr || file_contents == MAP_FAILED)
+				{
+				file_contents = nullptr;
 				return 0;
+				}
+
+			/*
+				If the file is going to be read from start to end then tell the kernel to read ahead aggressively (and drop pages once read),
+				and to use huge pages (where the kernel supports them for files) to reduce TLB misses.
+			*/
+			if (access == sequential)
+				{
+				madvise(const_cast<void *>(file_contents), statistics.st_size, MADV_SEQUENTIAL);
+				#ifdef MADV_HUGEPAGE
+					madvise(const_cast<void *>(file_contents), statistics.st_size, MADV_HUGEPAGE);
+				#endif
+				}
 
 			/*
 				Remember the file size
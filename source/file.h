@@ -55,6 +55,17 @@ namespace JASS
 			class file_read_only
 				{
 				friend class file;
+				public:
+					/*!
+						@enum access_pattern
+						@brief How the file is going to be read (so that the mapping can be set up accordingly).
+					*/
+					enum access_pattern
+						{
+						random,			///< Load the whole file into memory when it is opened (the default).
+						sequential		///< Load the file as it is read, from the start to the end (the kernel reads ahead, and uses huge pages if it can).
+						};
+
 				private:
 #ifdef _MSC_VER
 					HANDLE hFile;							///< The file being mapped
@@ -85,9 +96,10 @@ namespace JASS
 					/*!
 						@brief Open and read the file into memory
 						@param filename [in] The name of the file to read
+						@param access [in] How the file is going to be read (default = random)
 						@return The size of the file
 					*/
-					size_t open(const std::string &filename);
+					size_t open(const std::string &filename, access_pattern access = random);
 
 					/*
 						FILE::FILE_READ_ONLY::~FILE_READ_ONLY()
@@ -0,0 +1,563 @@
+/*
+	HASH_TABLE_OPEN.H
+	-----------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Open addressing hash table keyed on slices (without delete).
+	@author Andrew Trotman
+	@copyright 2021 Andrew Trotman
+*/
+#pragma once
+
+#include <string.h>
+#include <stdint.h>
+
+#include <vector>
+#include <sstream>
+#include <algorithm>
+
+#include "slice.h"
+#include "asserts.h"
+#include "hash_table.h"
+#include "hash_pearson.h"
+#include "allocator_pool.h"
+
+namespace JASS
+	{
+	/*
+		CLASS HASH_TABLE_OPEN
+		---------------------
+	*/
+	/*!
+		@brief Non-thread-safe open addressing hash table keyed on slices (without delete), for use as the indexer's dictionary.
+		@details hash_table hashes a key a byte at a time (Pearson hashing) then descends a binary tree, comparing slices at each
+		node.  This table hashes 8 bytes at a time and uses linear probing in an array of 32-byte slots.  Each slot holds 32 bits
+		of the hash (the fingerprint), the length of the key, the first 8 bytes of the key, and pointers to the key and the element.
+		So a probe rarely leaves the slot, and keys of up to 8 bytes (most terms) are compared without following a pointer.  The
+		table doubles in size when it is half full (the old slots are left in the pool).  The keys and the elements are allocated
+		from the pool and never move, so references to elements remain valid as the table grows.
+
+		Iterating over the table visits the keys in the same order as a hash_table<slice, ELEMENT, BITS>, that is by ascending
+		Pearson hash value and, within a hash value, in descending slice order.  So an indexer using this table produces the same
+		index as one using hash_table.  The order is computed (by sorting) on the first iteration after an insertion.
+		@tparam ELEMENT The element data returned given the key (must include ELEMENT(allocator) constructur).
+		@tparam BITS Iterate in the order of a hash_table with 2^BITS entries (must be 8, 16, or 24).
+	*/
+	template <typename ELEMENT, size_t BITS = 24>
+	class hash_table_open
+		{
+		/*!
+			@brief Output a human readable serialisation to an ostream
+			@relates hash_table_open
+		*/
+		template<typename A, size_t B> friend std::ostream &operator<<(std::ostream &stream, const hash_table_open<A, B> &map);
+
+		private:
+			/*
+				CLASS HASH_TABLE_OPEN::SLOT
+				---------------------------
+			*/
+			/*!
+				@brief A slot in the table.
+			*/
+			class slot
+				{
+				public:
+					uint32_t fingerprint;		///< The low 32 bits of the hash of the key (the slot is chosen from these bits)
+					uint32_t length;				///< The length of the key (in bytes)
+					uint64_t prefix;				///< The first 8 bytes of the key (0-padded)
+					const uint8_t *key;			///< The key (allocated from the pool)
+					ELEMENT *element;				///< The element (allocated from the pool), or nullptr if the slot is empty
+				};
+
+			/*
+				CLASS HASH_TABLE_OPEN::ENTRY
+				----------------------------
+			*/
+			/*!
+				@brief A key and its element, in iteration order.
+			*/
+			class entry
+				{
+				public:
+					slice key;						///< The key
+					const ELEMENT *element;		///< The element
+					size_t bucket;					///< The Pearson hash value of the key (the first sort key)
+				};
+
+		public:
+			/*
+				CLASS HASH_TABLE_OPEN::ITERATOR
+				-------------------------------
+			*/
+			/*!
+				@brief Iterate over the hash table.
+			*/
+			class iterator
+				{
+				private:
+					const entry *current;			///< The current entry.
+
+				public:
+					/*
+						HASH_TABLE_OPEN::ITERATOR::ITERATOR
+						-----------------------------------
+					*/
+					/*!
+						@brief Constructor.
+						@param current [in] The entry to start at.
+					*/
+					iterator(const entry *current) :
+						current(current)
+						{
+						/* Nothing */
+						}
+
+					/*
+						HASH_TABLE_OPEN::ITERATOR::OPERATOR*()
+						--------------------------------------
+					*/
+					/*!
+						@brief Return a reference to the object at the current location.
+						@return The current object.
+					*/
+					const std::pair<const slice &, const ELEMENT &> operator*() const
+						{
+						return std::pair<const slice &, const ELEMENT &>(current->key, *current->element);
+						}
+
+					/*
+						HASH_TABLE_OPEN::ITERATOR::OPERATOR!=()
+						---------------------------------------
+					*/
+					/*!
+						@brief Compare two iterator objects for non-equality.
+						@param other [in] The iterator object to compare to.
+						@return true if they differ, else false.
+					*/
+					bool operator!=(const iterator &other) const
+						{
+						return current != other.current;
+						}
+
+					/*
+						HASH_TABLE_OPEN::ITERATOR::OPERATOR++()
+						---------------------------------------
+					*/
+					/*!
+						@brief Increment this iterator.
+					*/
+					iterator &operator++()
+						{
+						current++;
+						return *this;
+						}
+				};
+
+		private:
+			static constexpr size_t initial_size = 1 << 16;			///< The initial number of slots (must be a power of 2)
+
+		private:
+			allocator &memory_pool;						///< The pool allocator
+			slot *table;									///< The slots
+			size_t capacity;								///< The number of slots (a power of 2)
+			size_t used;									///< The number of slots in use
+			mutable std::vector<entry> order;		///< The keys in iteration order (valid if ordered)
+			mutable bool ordered;						///< Is order up to date?
+
+		private:
+			/*
+				HASH_TABLE_OPEN::LOAD()
+				-----------------------
+			*/
+			/*!
+				@brief Load an unaligned 8-byte word.
+				@param from [in] The address of the word.
+				@return The word.
+			*/
+			static inline uint64_t load(const uint8_t *from)
+				{
+				uint64_t word;
+				::memcpy(&word, from, sizeof(word));
+				return word;
+				}
+
+			/*
+				HASH_TABLE_OPEN::LOAD_SHORT()
+				-----------------------------
+			*/
+			/*!
+				@brief Load a string of fewer than 8 bytes into the low bytes of a word (without reading past the end of the string).
+				@param from [in] The string.
+				@param length [in] The length of the string (less than 8).
+				@return The word (0-padded).
+			*/
+			static inline uint64_t load_short(const uint8_t *from, size_t length)
+				{
+				if (length >= 4)
+					{
+					uint32_t low;
+					uint32_t high;
+					::memcpy(&low, from, sizeof(low));
+					::memcpy(&high, from + length - sizeof(high), sizeof(high));
+					return low | (static_cast<uint64_t>(high) << (8 * (length - sizeof(high))));
+					}
+				if (length == 0)
+					return 0;
+				return from[0] | (static_cast<uint64_t>(from[length / 2]) << (8 * (length / 2))) | (static_cast<uint64_t>(from[length - 1]) << (8 * (length - 1)));
+				}
+
+			/*
+				HASH_TABLE_OPEN::HASH()
+				-----------------------
+			*/
+			/*!
+				@brief Hash a key 8 bytes at a time, and extract its first 8 bytes.
+				@param key [in] The key.
+				@param prefix [out] The first 8 bytes of the key (0-padded).
+				@return The hash value.
+			*/
+			static inline uint64_t hash(const slice &key, uint64_t &prefix)
+				{
+				const uint8_t *from = reinterpret_cast<const uint8_t *>(key.address());
+				size_t length = key.size();
+				uint64_t result = 0x9E3779B97F4A7C15 ^ length;
+
+				if (length < sizeof(uint64_t))
+					{
+					prefix = load_short(from, length);
+					result = (result ^ prefix) * 0xBF58476D1CE4E5B9;
+					}
+				else
+					{
+					prefix = load(from);
+					const uint8_t *end = from + length;
+					for (; from + sizeof(uint64_t) <= end; from += sizeof(uint64_t))
+						{
+						result = (result ^ load(from)) * 0xBF58476D1CE4E5B9;
+						result ^= result >> 29;
+						}
+					if (from != end)
+						result = (result ^ (load(end - sizeof(uint64_t)) >> (8 * (sizeof(uint64_t) - (end - from))))) * 0xBF58476D1CE4E5B9;		// the last (partial) word, loaded so as to end at the end of the key
+					}
+
+				/*
+					Mix the bits so that the low 32 bits depend on all of the key
+				*/
+				result ^= result >> 33;
+				result *= 0xFF51AFD7ED558CCD;
+				result ^= result >> 33;
+
+				return result;
+				}
+
+			/*
+				HASH_TABLE_OPEN::SAME_SUFFIX()
+				------------------------------
+			*/
+			/*!
+				@brief Compare the bytes after the first 8 of two keys of the same length (more than 8 bytes).
+				@param first [in] The first key.
+				@param second [in] The second key.
+				@param length [in] The length of the keys.
+				@return true if they are the same, else false.
+			*/
+			static inline bool same_suffix(const uint8_t *first, const uint8_t *second, size_t length)
+				{
+				for (size_t at = sizeof(uint64_t); at + sizeof(uint64_t) < length; at += sizeof(uint64_t))
+					if (load(first + at) != load(second + at))
+						return false;
+				return load(first + length - sizeof(uint64_t)) == load(second + length - sizeof(uint64_t));		// the last word (which may overlap the one before)
+				}
+
+			/*
+				HASH_TABLE_OPEN::ALLOCATE()
+				---------------------------
+			*/
+			/*!
+				@brief Allocate (from the pool) and clear an array of slots.
+				@param slots [in] The number of slots.
+				@return The slots.
+			*/
+			slot *allocate(size_t slots)
+				{
+				slot *answer = static_cast<slot *>(memory_pool.malloc(sizeof(slot) * slots, sizeof(void *)));
+				std::fill(answer, answer + slots, slot{0, 0, 0, nullptr, nullptr});
+				return answer;
+				}
+
+			/*
+				HASH_TABLE_OPEN::GROW()
+				-----------------------
+			*/
+			/*!
+				@brief Double the number of slots, moving each key to its place in the new table.
+			*/
+			void grow(void)
+				{
+				slot *old_table = table;
+				size_t old_capacity = capacity;
+
+				capacity *= 2;
+				table = allocate(capacity);
+				size_t mask = capacity - 1;
+				for (const slot *from = old_table; from < old_table + old_capacity; from++)
+					if (from->element != nullptr)
+						{
+						size_t at = from->fingerprint & mask;
+						while (table[at].element != nullptr)
+							at = (at + 1) & mask;
+						table[at] = *from;
+						}
+				}
+
+			/*
+				HASH_TABLE_OPEN::SORT()
+				-----------------------
+			*/
+			/*!
+				@brief Put the keys in iteration order (the order of a hash_table<slice, ELEMENT, BITS>).
+			*/
+			void sort(void) const
+				{
+				order.clear();
+				order.reserve(used);
+				for (const slot *current = table; current < table + capacity; current++)
+					if (current->element != nullptr)
+						{
+						slice key(const_cast<uint8_t *>(current->key), current->length);
+						order.push_back(entry{key, current->element, hash_pearson::hash<BITS>(key)});
+						}
+
+				std::sort(order.begin(), order.end(), [](const entry &first, const entry &second)
+					{
+					if (first.bucket != second.bucket)
+						return first.bucket < second.bucket;
+					return first.key > second.key;
+					});
+
+				ordered = true;
+				}
+
+		public:
+			/*
+				HASH_TABLE_OPEN::HASH_TABLE_OPEN()
+				----------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param pool [in] All memmory associated with this object is allocated using the pool.
+			*/
+			hash_table_open(allocator &pool) :
+				memory_pool(pool),
+				table(nullptr),
+				capacity(initial_size),
+				used(0),
+				ordered(true)
+				{
+				table = allocate(capacity);
+				}
+
+			/*
+				HASH_TABLE_OPEN::SIZE()
+				-----------------------
+			*/
+			/*!
+				@brief Return the number of keys in the table.
+				@return The number of keys.
+			*/
+			size_t size(void) const
+				{
+				return used;
+				}
+
+			/*
+				HASH_TABLE_OPEN::BEGIN()
+				------------------------
+			*/
+			/*!
+				@brief Return an iterator pointing to the first element in the hash table.
+				@return Iterator pointing to the first element in the hash table.
+			*/
+			iterator begin() const
+				{
+				if (!ordered)
+					sort();
+				return iterator(order.data());
+				}
+
+			/*
+				HASH_TABLE_OPEN::END()
+				----------------------
+			*/
+			/*!
+				@brief Return an iterator pointing past the end of the hash table.
+				@return Iterator pointing past the end of the hash table.
+			*/
+			iterator end() const
+				{
+				if (!ordered)
+					sort();
+				return iterator(order.data() + order.size());
+				}
+
+			/*
+				HASH_TABLE_OPEN::TEXT_RENDER()
+				------------------------------
+			*/
+			/*!
+				@brief Write the contents of this object to the output steam (one key->element per line).
+				@param stream [in] The stream to write to.
+			*/
+			void text_render(std::ostream &stream) const
+				{
+				for (const auto &[key, element] : *this)
+					stream << key << "->" << element << '\n';
+				}
+
+			/*
+				HASH_TABLE_OPEN::OPERATOR[]()
+				-----------------------------
+			*/
+			/*!
+				@brief Return a reference to the element associated with the key.  If there is no element the create an empty one.
+				@param key [in] The key to look up.
+				@return The element associated with the key.
+			*/
+			ELEMENT &operator[](const slice &key)
+				{
+				uint64_t prefix;
+				uint32_t fingerprint = static_cast<uint32_t>(hash(key, prefix));
+				uint32_t length = static_cast<uint32_t>(key.size());
+
+				size_t mask = capacity - 1;
+				size_t at = fingerprint & mask;
+				while (true)
+					{
+					slot &current = table[at];
+					if (current.element == nullptr)
+						break;
+					if (current.fingerprint == fingerprint && current.length == length && current.prefix == prefix)
+						if (length <= sizeof(prefix) || same_suffix(current.key, reinterpret_cast<const uint8_t *>(key.address()), length))
+							return *current.element;
+					at = (at + 1) & mask;
+					}
+
+				/*
+					Not found so add it, first growing the table if it is half full
+				*/
+				if (used + 1 > capacity / 2)
+					{
+					grow();
+					mask = capacity - 1;
+					at = fingerprint & mask;
+					while (table[at].element != nullptr)
+						at = (at + 1) & mask;
+					}
+
+				slice copy(memory_pool, key);
+				ELEMENT *element = new (memory_pool.malloc(sizeof(ELEMENT), sizeof(void *))) ELEMENT(memory_pool);
+				table[at] = slot{fingerprint, length, prefix, reinterpret_cast<const uint8_t *>(copy.address()), element};
+				used++;
+				ordered = false;
+
+				return *element;
+				}
+
+			/*
+				HASH_TABLE_OPEN::UNITTEST()
+				---------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void)
+				{
+				/*
+					Check inserting and serialising
+				*/
+				allocator_pool pool;
+				hash_table_open<slice> map(pool);
+
+				map[slice("5")] = slice("five");
+				map[slice("3")] = slice("three");
+				map[slice("7")] = slice("seven");
+				map[slice("4")] = slice("four");
+				map[slice("2")] = slice("two");
+				map[slice("1")] = slice("one");
+				map[slice("9")] = slice("nine");
+				map[slice("6")] = slice("six");
+				map[slice("8")] = slice("eight");
+				map[slice("0")];
+				JASS_assert(map.size() == 10);
+				JASS_assert(map[slice("7")] == slice("seven"));
+
+				const char *answer = "0->\n6->six\n1->one\n4->four\n5->five\n3->three\n8->eight\n7->seven\n2->two\n9->nine\n";
+
+				std::ostringstream serialised;
+				serialised << map;
+				JASS_assert(strcmp(serialised.str().c_str(), answer) == 0);
+
+				/*
+					Check the iterator
+				*/
+				std::ostringstream output;
+				for (const auto element : map)
+					output << element.first;
+				JASS_assert(output.str() == "0614538729");
+
+				/*
+					Grow the table several times (with short and long keys, some sharing a Pearson hash value) and check the
+					elements are all found and the keys iterate in the same order as a hash_table.
+				*/
+				hash_table_open<slice, 8> big(pool);
+				hash_table<slice, slice, 8> chained(pool);
+				for (size_t which = 0; which < 200'000; which++)
+					{
+					std::string key = std::to_string(which * 7919);
+					if (which % 3 == 0)
+						key += "-a-rather-long-key";
+					slice value(pool, key.c_str());
+					big[slice(const_cast<char *>(key.c_str()), key.size())] = value;
+					chained[slice(const_cast<char *>(key.c_str()), key.size())] = value;
+					}
+				JASS_assert(big.size() == 200'000);
+				JASS_assert(big[slice("7919")] == slice("7919"));
+				JASS_assert(big[slice("0-a-rather-long-key")] == slice("0-a-rather-long-key"));
+				JASS_assert(big.size() == 200'000);
+
+				auto expected = chained.begin();
+				for (const auto &[key, value] : big)
+					{
+					JASS_assert(key == (*expected).first);
+					JASS_assert(value == (*expected).second);
+					++expected;
+					}
+				JASS_assert(!(expected != chained.end()));
+
+				puts("hash_table_open::PASSED");
+				}
+		};
+
+	/*
+		OPERATOR<<()
+		------------
+	*/
+	/*!
+		@brief Dump the contents of a hash table down an output stream.
+		@param stream [in] The stream to write to.
+		@param map [in] The hash table to write.
+		@tparam ELEMENT The element data returned given the key.
+		@tparam BITS The iteration order is that of a hash_table of 2^BITS entries.
+		@return The stream once the table has been written.
+	*/
+	template <typename ELEMENT, size_t BITS>
+	inline std::ostream &operator<<(std::ostream &stream, const hash_table_open<ELEMENT, BITS> &map)
+		{
+		map.text_render(stream);
+		return stream;
+		}
+	}
@@ -0,0 +1,318 @@
+/*
+	INDEX_CONTAINER.CPP
+	-------------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <string.h>
+
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <filesystem>
+
+#include "asserts.h"
+#include "threads.h"
+#include "checksum.h"
+#include "allocator.h"
+#include "index_container.h"
+
+namespace JASS
+	{
+	/*
+		INDEX_CONTAINER::WRITE()
+		------------------------
+	*/
+	bool index_container::write(const std::string &filename, const std::vector<std::string> &files, uint8_t index_version, uint8_t codex)
+		{
+		/*
+			Map each file and work out where it goes in the container
+		*/
+		std::vector<std::unique_ptr<file::file_read_only>> contents;
+		std::vector<std::string> table_of_contents;
+		uint64_t offset = header_size + files.size() * toc_entry_size;
+		for (const auto &name : files)
+			{
+			contents.push_back(std::make_unique<file::file_read_only>());
+			const uint8_t *address = nullptr;
+			uint64_t length = file::read_entire_file(name, *contents.back());
+			if (length == 0 && !std::filesystem::exists(name))
+				return false;
+			contents.back()->read_entire_file(address);
+
+			std::string section_name = std::filesystem::path(name).filename().string();
+			if (section_name.size() >= name_length)
+				return false;
+
+			offset += allocator::realign(offset, section_alignment);
+			uint64_t section_checksum = checksum::fletcher_64(address, length);
+
+			std::string entry(toc_entry_size, '\0');
+			memcpy(&entry[0], section_name.c_str(), section_name.size());
+			memcpy(&entry[name_length], &offset, sizeof(offset));
+			memcpy(&entry[name_length + sizeof(uint64_t)], &length, sizeof(length));
+			memcpy(&entry[name_length + 2 * sizeof(uint64_t)], &section_checksum, sizeof(section_checksum));
+			table_of_contents.push_back(entry);
+
+			offset += length;
+			}
+
+		/*
+			Write the header and the table of contents
+		*/
+		do
+			{
+			file container(filename, "w+b");
+
+			std::string toc;
+			for (const auto &entry : table_of_contents)
+				toc += entry;
+
+			uint8_t header[header_size] = {};
+			uint32_t version = container_version;
+			uint32_t sections = static_cast<uint32_t>(files.size());
+			uint64_t toc_checksum = checksum::fletcher_64(toc.c_str(), toc.size());
+			memcpy(header, signature, sizeof(signature));
+			memcpy(header + 8, &version, sizeof(version));
+			memcpy(header + 12, &sections, sizeof(sections));
+			header[16] = index_version;
+			header[17] = codex;
+			memcpy(header + 24, &toc_checksum, sizeof(toc_checksum));
+			container.write(header, sizeof(header));
+			container.write(toc.c_str(), toc.size());
+
+			/*
+				Write each section (padded so that it starts on a page boundary)
+			*/
+			static const uint8_t zero[section_alignment] = {};
+			for (const auto &section : contents)
+				{
+				const uint8_t *address = nullptr;
+				size_t length = section->read_entire_file(address);
+				container.write(zero, allocator::realign(container.tell(), section_alignment));
+				if (length != 0)
+					container.write(address, length);
+				}
+			}
+		while (0);
+
+		/*
+			Make sure it was all written
+		*/
+		std::error_code error;
+		return std::filesystem::file_size(filename, error) == offset;
+		}
+
+	/*
+		INDEX_CONTAINER::OPEN()
+		-----------------------
+	*/
+	bool index_container::open(const std::string &filename)
+		{
+		const uint8_t *address = nullptr;
+		table.clear();
+		uint64_t length = file::read_entire_file(filename, memory);
+		memory.read_entire_file(address);
+		if (length < header_size || memcmp(address, signature, sizeof(signature)) != 0)
+			return false;
+
+		uint32_t version;
+		uint32_t sections;
+		uint64_t toc_checksum;
+		memcpy(&version, address + 8, sizeof(version));
+		memcpy(&sections, address + 12, sizeof(sections));
+		memcpy(&toc_checksum, address + 24, sizeof(toc_checksum));
+		if (version != container_version || header_size + static_cast<uint64_t>(sections) * toc_entry_size > length)
+			return false;
+
+		/*
+			Check then decode the table of contents
+		*/
+		const uint8_t *toc = address + header_size;
+		if (checksum::fletcher_64(toc, sections * toc_entry_size) != toc_checksum)
+			return false;
+
+		for (uint32_t which = 0; which < sections; which++)
+			{
+			const uint8_t *entry = toc + which * toc_entry_size;
+			section current;
+			uint64_t offset;
+			current.name = std::string(reinterpret_cast<const char *>(entry), strnlen(reinterpret_cast<const char *>(entry), name_length));
+			memcpy(&offset, entry + name_length, sizeof(offset));
+			memcpy(&current.length, entry + name_length + sizeof(uint64_t), sizeof(current.length));
+			memcpy(&current.checksum, entry + name_length + 2 * sizeof(uint64_t), sizeof(current.checksum));
+			if (offset > length || current.length > length - offset)
+				return false;
+			current.address = address + offset;
+			table.push_back(current);
+			}
+
+		index_version = address[16];
+		index_codex = address[17];
+
+		return true;
+		}
+
+	/*
+		INDEX_CONTAINER::FIND()
+		-----------------------
+	*/
+	const index_container::section *index_container::find(const std::string &name) const
+		{
+		for (const auto &current : table)
+			if (current.name == name)
+				return &current;
+
+		return nullptr;
+		}
+
+	/*
+		INDEX_CONTAINER::VALIDATE()
+		---------------------------
+	*/
+	bool index_container::validate(const section &which)
+		{
+		return checksum::fletcher_64(which.address, which.length) == which.checksum;
+		}
+
+	/*
+		INDEX_CONTAINER::CHECKSUM_CHUNKS()
+		----------------------------------
+	*/
+	void index_container::checksum_chunks(std::vector<chunk> &chunks, std::atomic<size_t> &next)
+		{
+		for (size_t which = next++; which < chunks.size(); which = next++)
+			chunks[which].checksum = checksum::fletcher_64(chunks[which].address, chunks[which].length);
+		}
+
+	/*
+		INDEX_CONTAINER::VALIDATE()
+		---------------------------
+	*/
+	bool index_container::validate(size_t threads) const
+		{
+		/*
+			Split the sections into pieces (CIpostings.bin is most of the container so splitting only between sections isn't enough)
+		*/
+		std::vector<chunk> chunks;
+		std::vector<size_t> first_chunk;
+		for (const auto &current : table)
+			{
+			first_chunk.push_back(chunks.size());
+			uint64_t offset = 0;
+			do
+				{
+				uint64_t length = (std::min)(current.length - offset, static_cast<uint64_t>(validation_chunk));
+				chunks.push_back(chunk{current.address + offset, length, 0});
+				offset += length;
+				}
+			while (offset < current.length);
+			}
+		first_chunk.push_back(chunks.size());
+
+		/*
+			Checksum the pieces in parallel
+		*/
+		std::atomic<size_t> next(0);
+		threads = (std::max)(static_cast<size_t>(1), (std::min)(threads, chunks.size()));
+		std::vector<thread> workers;
+		for (size_t which = 1; which < threads; which++)
+			workers.push_back(thread(&index_container::checksum_chunks, std::ref(chunks), std::ref(next)));
+		checksum_chunks(chunks, next);
+		for (auto &worker : workers)
+			worker.join();
+
+		/*
+			Combine the checksums of the pieces of each section (each piece but the last is a multiple of 4 bytes long)
+		*/
+		for (size_t which = 0; which < table.size(); which++)
+			{
+			uint64_t section_checksum = chunks[first_chunk[which]].checksum;
+			for (size_t piece = first_chunk[which] + 1; piece < first_chunk[which + 1]; piece++)
+				section_checksum = checksum::fletcher_64_combine(section_checksum, chunks[piece].checksum, chunks[piece].length);
+			if (section_checksum != table[which].checksum)
+				return false;
+			}
+
+		return true;
+		}
+
+	/*
+		INDEX_CONTAINER::UNITTEST()
+		---------------------------
+	*/
+	void index_container::unittest(void)
+		{
+		std::string first_name = file::mkstemp("jass");
+		std::string second_name = file::mkstemp("jass");
+		std::string container_name = file::mkstemp("jass");
+		std::string first_contents = "The quick brown fox";
+		std::string second_contents(validation_chunk + 10001, 'x');		// more than one piece for validate()
+		file::write_entire_file(first_name, first_contents);
+		file::write_entire_file(second_name, second_contents);
+
+		/*
+			Write then read a container
+		*/
+		JASS_assert(write(container_name, {first_name, second_name}, 2, 'G'));
+		do
+			{
+			index_container container;
+			JASS_assert(container.open(container_name));
+			JASS_assert(container.version() == 2);
+			JASS_assert(container.codex() == 'G');
+
+			auto *first = container.find(std::filesystem::path(first_name).filename().string());
+			auto *second = container.find(std::filesystem::path(second_name).filename().string());
+			JASS_assert(first != nullptr && second != nullptr);
+			JASS_assert(container.find("CIpostings.bin") == nullptr);
+			JASS_assert(std::string(reinterpret_cast<const char *>(first->address), first->length) == first_contents);
+			JASS_assert(std::string(reinterpret_cast<const char *>(second->address), second->length) == second_contents);
+			JASS_assert(reinterpret_cast<uintptr_t>(second->address) % section_alignment == 0);
+			JASS_assert(container.validate(1));
+			JASS_assert(container.validate(2));
+			}
+		while (0);
+
+		/*
+			A damaged section fails validation (but the container still opens), and a damaged table of contents fails to open
+		*/
+		std::string contents;
+		file::read_entire_file(container_name, contents);
+		contents[contents.size() - 1] = 'y';
+		file::write_entire_file(container_name, contents);
+		do
+			{
+			index_container container;
+			JASS_assert(container.open(container_name));
+			JASS_assert(validate(*container.find(std::filesystem::path(first_name).filename().string())));
+			JASS_assert(!container.validate(2));
+			}
+		while (0);
+
+		contents[header_size]++;
+		file::write_entire_file(container_name, contents);
+		do
+			{
+			index_container container;
+			JASS_assert(!container.open(container_name));
+			}
+		while (0);
+
+		/*
+			Not a container
+		*/
+		do
+			{
+			index_container container;
+			JASS_assert(!container.open(first_name));
+			}
+		while (0);
+
+		::remove(first_name.c_str());
+		::remove(second_name.c_str());
+		::remove(container_name.c_str());
+
+		puts("index_container::PASSED");
+		}
+	}
@@ -0,0 +1,211 @@
+/*
+	INDEX_CONTAINER.H
+	-----------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief A single file holding all the files of an index, with a table of contents and checksums.
+	@author Andrew Trotman
+	@copyright 2021 Andrew Trotman
+*/
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "file.h"
+
+namespace JASS
+	{
+	/*
+		CLASS INDEX_CONTAINER
+		---------------------
+	*/
+	/*!
+		@brief A single file holding all the files of an index, with a table of contents and checksums.
+		@details A JASS index is several files (CIdoclist.bin, CIvocab.bin, CIvocab_terms.bin, CIpostings.bin, and for JASS v2 CIsegments.bin).
+		The container holds each of these as a section of one file, so an index can be shipped as one file and loaded with one mapping.
+		The container starts with a 32-byte header: the signature "JASSpack", the uint32_t container version, the uint32_t number of sections,
+		the uint8_t index version (1 for JASS v1, 2 for JASS v2), the uint8_t codex (a serialise_jass_v1::jass_v1_codex), 6 bytes of padding,
+		and the uint64_t Fletcher 64 checksum of the table of contents.  The table of contents follows, one 56-byte entry per section: the
+		'\0' padded name (32 bytes), then the uint64_t offset (from the start of the container), uint64_t length, and uint64_t Fletcher 64
+		checksum of the section.  Each section starts on a page boundary so the alignment of the data within it is the same as in a file of
+		its own.  The header and table of contents are checked when the container is opened, the sections are checked by validate() (which
+		can use several threads, splitting each section into pieces whose Fletcher sums are combined) so a caller can choose not to pay for
+		checking on startup.
+	*/
+	class index_container
+		{
+		public:
+			static constexpr uint8_t signature[] = {'J', 'A', 'S', 'S', 'p', 'a', 'c', 'k'};	///< The first 8 bytes of a container
+			static constexpr uint32_t container_version = 1;												///< The version of the container format
+			static constexpr size_t header_size = 32;															///< The size (in bytes) of the header
+			static constexpr size_t name_length = 32;															///< The size (in bytes) of a section name in the table of contents
+			static constexpr size_t toc_entry_size = name_length + 3 * sizeof(uint64_t);				///< The size (in bytes) of an entry in the table of contents
+			static constexpr size_t section_alignment = 4096;													///< Each section starts on a boundary of this many bytes
+			static constexpr size_t validation_chunk = 16 * 1024 * 1024;										///< validate() checksums the sections in pieces of this many bytes
+
+			/*
+				CLASS INDEX_CONTAINER::SECTION
+				------------------------------
+			*/
+			/*!
+				@brief An entry in the table of contents.
+			*/
+			class section
+				{
+				public:
+					std::string name;					///< The name of the section (the name of the file it came from)
+					const uint8_t *address;			///< The start of the section (in memory)
+					uint64_t length;					///< The length (in bytes) of the section
+					uint64_t checksum;				///< The Fletcher 64 checksum of the section
+				};
+
+		private:
+			file::file_read_only memory;			///< The container
+			std::vector<section> table;			///< The table of contents
+			uint8_t index_version;					///< The version of the index in the container
+			uint8_t index_codex;						///< The codex of the index in the container
+
+		private:
+			/*
+				CLASS INDEX_CONTAINER::CHUNK
+				----------------------------
+			*/
+			/*!
+				@brief A piece of a section to be checksummed by validate().
+			*/
+			class chunk
+				{
+				public:
+					const uint8_t *address;			///< The start of the piece
+					uint64_t length;					///< The length (in bytes) of the piece
+					uint64_t checksum;				///< The Fletcher 64 checksum of the piece (once computed)
+				};
+
+		private:
+			/*
+				INDEX_CONTAINER::CHECKSUM_CHUNKS()
+				----------------------------------
+			*/
+			/*!
+				@brief Compute the checksum of each chunk not yet taken by another thread.
+				@param chunks [in/out] The chunks to checksum.
+				@param next [in/out] The next chunk that no thread has taken.
+			*/
+			static void checksum_chunks(std::vector<chunk> &chunks, std::atomic<size_t> &next);
+
+		public:
+			/*
+				INDEX_CONTAINER::INDEX_CONTAINER()
+				----------------------------------
+			*/
+			/*!
+				@brief Constructor
+			*/
+			index_container() :
+				index_version(0),
+				index_codex(0)
+				{
+				/* Nothing */
+				}
+
+			/*
+				INDEX_CONTAINER::WRITE()
+				------------------------
+			*/
+			/*!
+				@brief Write a container holding the given files (each as a section named after the file).
+				@param filename [in] The name of the container to write.
+				@param files [in] The paths of the files to put in the container.
+				@param index_version [in] The version of the index (1 for JASS v1, 2 for JASS v2).
+				@param codex [in] The codex used to compress the postings (a serialise_jass_v1::jass_v1_codex).
+				@return true on success, false on failure (a file cannot be read or the container cannot be written).
+			*/
+			static bool write(const std::string &filename, const std::vector<std::string> &files, uint8_t index_version, uint8_t codex);
+
+			/*
+				INDEX_CONTAINER::OPEN()
+				-----------------------
+			*/
+			/*!
+				@brief Map a container into memory and check its header and table of contents (but not the sections, see validate()).
+				@param filename [in] The name of the container.
+				@return true on success, false if the file cannot be read or is not a valid container.
+			*/
+			bool open(const std::string &filename);
+
+			/*
+				INDEX_CONTAINER::FIND()
+				-----------------------
+			*/
+			/*!
+				@brief Return the table of contents entry for a section.
+				@param name [in] The name of the section.
+				@return The section, or nullptr if there is no section with that name.
+			*/
+			const section *find(const std::string &name) const;
+
+			/*
+				INDEX_CONTAINER::VALIDATE()
+				---------------------------
+			*/
+			/*!
+				@brief Check the checksum of one section.
+				@param which [in] The section (from find()).
+				@return true if the checksum matches, else false.
+			*/
+			static bool validate(const section &which);
+
+			/*
+				INDEX_CONTAINER::VALIDATE()
+				---------------------------
+			*/
+			/*!
+				@brief Check the checksum of every section, using several threads (each checksums pieces of the sections).
+				@param threads [in] The number of threads to use.
+				@return true if every checksum matches, else false.
+			*/
+			bool validate(size_t threads = 1) const;
+
+			/*
+				INDEX_CONTAINER::VERSION()
+				--------------------------
+			*/
+			/*!
+				@brief Return the version of the index in the container.
+				@return 1 for a JASS v1 index, 2 for a JASS v2 index.
+			*/
+			uint8_t version(void) const
+				{
+				return index_version;
+				}
+
+			/*
+				INDEX_CONTAINER::CODEX()
+				------------------------
+			*/
+			/*!
+				@brief Return the codex of the index in the container.
+				@return The codex (a serialise_jass_v1::jass_v1_codex).
+			*/
+			uint8_t codex(void) const
+				{
+				return index_codex;
+				}
+
+			/*
+				INDEX_CONTAINER::UNITTEST()
+				---------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+	}
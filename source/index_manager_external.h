@@ -0,0 +1,677 @@
+/*
+	INDEX_MANAGER_EXTERNAL.H
+	------------------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Indexer object that spills its in-memory index to disk as sorted runs whenever it grows too large, and merges the runs as it is iterated over.
+	@author Andrew Trotman
+	@copyright 2021 Andrew Trotman
+*/
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <sstream>
+#include <filesystem>
+
+#include "file.h"
+#include "parser.h"
+#include "hash_pearson.h"
+#include "index_manager.h"
+#include "unittest_data.h"
+#include "index_postings.h"
+#include "allocator_pool.h"
+#include "index_manager_sequential.h"
+#include "compress_integer_variable_byte.h"
+
+namespace JASS
+	{
+	/*
+		CLASS INDEX_MANAGER_EXTERNAL
+		----------------------------
+	*/
+	/*!
+		@brief An index that is built in memory until it reaches a memory budget, then written to disk as a run, and so on.
+		@details The documents are indexed into an index_manager_sequential.  When, at the end of a document, that index has taken
+		more than the budget from its allocator (not counting what an empty index takes, such as its dictionary), its postings lists are
+		written to a run file and a new (empty) index_manager_sequential takes its place.  Once all the documents have been indexed, finish()
+		writes the last run and then, if there are more runs than can be merged at once, merges consecutive runs into longer runs until there
+		are not.  Iterating then merges the runs one term at a time.  The runs cover consecutive ranges of documents so the postings list of a term is the concatenation
+		of its postings lists in each run (in run order).  Each run is written in the order an index_manager_sequential iterates
+		over its terms (ascending hash value, and within a hash value descending slice order) so a k-way merge in that order
+		visits the terms in the same order as an index_manager_sequential over the whole collection, and the serialisers produce
+		the same index.  Only the postings lists are spilled, the document lengths and primary keys (and, once iterated over, the vocabulary)
+		are kept in memory.
+
+		A run is a sequence of records, one per term, each being a three 64-bit integer header (the length of the term, the
+		document frequency, and the length of the postings) followed by the term and then the postings.  The postings are
+		variable-byte encoded (document id gap, term frequency) pairs.
+	*/
+	class index_manager_external : public index_manager
+		{
+		private:
+			/*
+				CLASS INDEX_MANAGER_EXTERNAL::RUN
+				---------------------------------
+			*/
+			/*!
+				@brief A cursor on a run that is being merged.
+			*/
+			class run
+				{
+				public:
+					file source;										///< The run file
+					std::vector<uint8_t> record;					///< The current term and its encoded postings
+					slice term;											///< The current term (in record)
+					size_t hash;										///< The hash value of the current term
+					compress_integer::integer document_frequency;	///< The document frequency of the current term
+					const uint8_t *postings;						///< The encoded postings of the current term (in record)
+					size_t postings_length;							///< The length (in bytes) of postings
+					bool eof;											///< There are no more terms in the run
+
+				public:
+					/*
+						INDEX_MANAGER_EXTERNAL::RUN::RUN()
+						----------------------------------
+					*/
+					/*!
+						@brief Constructor
+						@param filename [in] The name of the run file.
+					*/
+					run(const std::string &filename) :
+						source(filename, "rb"),
+						hash(0),
+						document_frequency(0),
+						postings(nullptr),
+						postings_length(0),
+						eof(false)
+						{
+						next();
+						}
+
+					/*
+						INDEX_MANAGER_EXTERNAL::RUN::NEXT()
+						-----------------------------------
+					*/
+					/*!
+						@brief Move on to the next term in the run (setting eof if there isn't one).
+					*/
+					void next(void)
+						{
+						uint64_t header[3];
+						if (source.read(header, sizeof(header)) != sizeof(header))
+							{
+							eof = true;
+							return;
+							}
+
+						record.resize(header[0] + header[2]);
+						if (record.size() != 0)
+							source.read(record.data(), record.size());
+
+						term = slice(record.data(), header[0]);
+						hash = hash_pearson::hash<24>(term);
+						document_frequency = static_cast<compress_integer::integer>(header[1]);
+						postings = record.data() + header[0];
+						postings_length = header[2];
+						}
+
+					/*
+						INDEX_MANAGER_EXTERNAL::RUN::PRECEDES()
+						---------------------------------------
+					*/
+					/*!
+						@brief Does the current term of this run come before the current term of another run in the iteration order?
+						@param other [in] The other run.
+						@return true if this run's term comes first, else false.
+					*/
+					bool precedes(const run &other) const
+						{
+						if (hash != other.hash)
+							return hash < other.hash;
+						return term > other.term;
+						}
+				};
+
+		private:
+			size_t memory_budget;																	///< Spill the in-memory index once it has taken this many bytes from its allocator (more than an empty one)
+			size_t merge_fan_in;																		///< The most runs that are merged at once
+			size_t empty_memory_used;																///< The number of bytes an empty in-memory index has taken from its allocator
+			std::string run_prefix;																	///< The run files are named from this prefix
+			std::vector<std::string> runs;														///< The names of the run files, in document order
+			std::unique_ptr<index_manager_sequential> current;								///< The in-memory index of the documents since the last spill
+			compress_integer::integer current_first;											///< The collection's document id of the document before the first in current
+			allocator_pool memory;																	///< The primary keys and the vocabulary are allocated from here
+			std::vector<slice> primary_key;														///< The collection's primary keys in document id order
+			std::vector<slice> vocabulary;														///< The terms in iteration order (built on the first iteration)
+
+			/*
+				Each of these buffers is re-used in spilling and in the serialisation process
+			*/
+			std::vector<compress_integer::integer> document_ids;							///< The re-used buffer storing the document ids
+			std::vector<index_postings_impact::impact_type> term_frequencies;			///< The re-used buffer storing the term frequencies
+			std::vector<compress_integer::integer> decoded;									///< The re-used buffer storing the decoded (gap, term frequency) pairs
+			std::vector<uint8_t> encoded;															///< The re-used buffer storing the encoded (gap, term frequency) pairs
+			std::vector<uint8_t> temporary;														///< Temporary buffer for linearising a postings list
+
+		private:
+			/*
+				INDEX_MANAGER_EXTERNAL::SPILL()
+				-------------------------------
+			*/
+			/*!
+				@brief Write the in-memory index to a new run file and start a new in-memory index.
+			*/
+			void spill(void)
+				{
+				compress_integer::integer documents = current->get_highest_document_id();
+				if (documents == 0)
+					return;
+
+				document_ids.resize(maths::maximum(document_ids.size(), static_cast<size_t>(documents)));
+				term_frequencies.resize(document_ids.size());
+				temporary.resize(maths::maximum(temporary.size(), documents * (sizeof(compress_integer::integer) / 7 + 1)));
+				encoded.resize(maths::maximum(encoded.size(), 2 * documents * (sizeof(compress_integer::integer) * 8 / 7 + 1)));		// (gap, frequency) pairs, at most this many bytes each
+
+				runs.push_back(file::mkstemp(run_prefix));
+				file out(runs.back(), "wb");
+
+				for (const auto &[term, postings] : current->get_postings())
+					{
+					auto document_frequency = postings.linearize(temporary.data(), temporary.size(), document_ids.data(), term_frequencies.data(), documents);
+					write_record(out, term, document_frequency, current_first);
+					}
+
+				/*
+					Release the memory before allocating the next in-memory index
+				*/
+				current.reset();
+				current = std::make_unique<index_manager_sequential>();
+				current_first = get_highest_document_id();
+				}
+
+			/*
+				INDEX_MANAGER_EXTERNAL::WRITE_RECORD()
+				--------------------------------------
+			*/
+			/*!
+				@brief Write the record of a term (the postings list of which is in document_ids and term_frequencies) to a run.
+				@param out [in] The run file.
+				@param term [in] The term.
+				@param document_frequency [in] The number of postings.
+				@param first_document_id [in] Added to each document id to make it the collection's document id.
+			*/
+			void write_record(file &out, const slice &term, compress_integer::integer document_frequency, compress_integer::integer first_document_id)
+				{
+				uint8_t *into = encoded.data();
+				compress_integer::integer previous = 0;
+				for (compress_integer::integer which = 0; which < document_frequency; which++)
+					{
+					compress_integer::integer document_id = document_ids[which] + first_document_id;
+					compress_integer_variable_byte::compress_into(into, document_id - previous);
+					compress_integer_variable_byte::compress_into(into, term_frequencies[which]);
+					previous = document_id;
+					}
+
+				uint64_t header[3] = {term.size(), document_frequency, static_cast<uint64_t>(into - encoded.data())};
+				out.write(header, sizeof(header));
+				out.write(term.address(), term.size());
+				out.write(encoded.data(), header[2]);
+				}
+
+			/*
+				INDEX_MANAGER_EXTERNAL::MERGE_RUNS()
+				------------------------------------
+			*/
+			/*!
+				@brief Merge a range of consecutive runs calling the callback with each term and its document frequency, the merged postings list
+				being in document_ids and term_frequencies.
+				@param first_run [in] The first run to merge.
+				@param last_run [in] One past the last run to merge.
+				@param callback [in] Called with each term (which is only valid during the call) and its document frequency.
+			*/
+			template <typename CALLBACK>
+			void merge_runs(size_t first_run, size_t last_run, CALLBACK &&callback)
+				{
+				document_ids.resize(maths::maximum(document_ids.size(), static_cast<size_t>(get_highest_document_id())));
+				term_frequencies.resize(document_ids.size());
+				decoded.resize(maths::maximum(decoded.size(), 2 * document_ids.size()));
+
+				std::vector<std::unique_ptr<run>> cursors;
+				for (size_t which = first_run; which < last_run; which++)
+					{
+					cursors.push_back(std::make_unique<run>(runs[which]));
+					if (cursors.back()->eof)
+						cursors.pop_back();
+					}
+
+				std::vector<uint8_t> term;
+				while (cursors.size() != 0)
+					{
+					size_t first = 0;
+					for (size_t which = 1; which < cursors.size(); which++)
+						if (cursors[which]->precedes(*cursors[first]))
+							first = which;
+
+					/*
+						Copy the term as the run it comes from will move on
+					*/
+					const uint8_t *start = reinterpret_cast<const uint8_t *>(cursors[first]->term.address());
+					term.assign(start, start + cursors[first]->term.size());
+					slice key(term.data(), term.size());
+
+					compress_integer::integer document_frequency = 0;
+					for (size_t which = 0; which < cursors.size();)
+						{
+						run &from = *cursors[which];
+						if (!(from.term == key))
+							{
+							which++;
+							continue;
+							}
+
+						/*
+							The first gap in a run is the document id
+						*/
+						compress_integer::integer previous = 0;
+
+						compress_integer_variable_byte::static_decode(decoded.data(), 2 * from.document_frequency, from.postings, from.postings_length);
+						for (compress_integer::integer posting = 0; posting < from.document_frequency; posting++)
+							{
+							previous += decoded[posting * 2];
+							document_ids[document_frequency] = previous;
+							term_frequencies[document_frequency] = static_cast<index_postings_impact::impact_type>(decoded[posting * 2 + 1]);
+							document_frequency++;
+							}
+
+						from.next();
+						if (from.eof)
+							cursors.erase(cursors.begin() + which);
+						else
+							which++;
+						}
+
+					callback(key, document_frequency);
+					}
+				}
+
+			/*
+				INDEX_MANAGER_EXTERNAL::MERGE()
+				-------------------------------
+			*/
+			/*!
+				@brief Merge the runs calling the callback with each term's postings list, then with each primary key.
+				@param callback [in] Called with each term, the postings list object, the document frequency, the document ids, and the term frequencies; and then with each document id and primary key.
+			*/
+			template <typename CALLBACK>
+			void merge(CALLBACK &&callback)
+				{
+				/*
+					The merged postings lists are passed in the arrays, so the postings list object is an empty one
+				*/
+				allocator_pool postings_memory(1024);
+				index_postings empty(postings_memory);
+
+				size_t terms = 0;
+				merge_runs(0, runs.size(), [this, &callback, &empty, &terms](const slice &term, compress_integer::integer document_frequency)
+					{
+					/*
+						Keep a copy of the term as the callback might keep it (the serialisers do)
+					*/
+					if (terms == vocabulary.size())
+						vocabulary.push_back(slice(memory, term));
+					callback(vocabulary[terms++], empty, document_frequency, document_ids.data(), term_frequencies.data());
+					});
+
+				/*
+					Note that the search engine counts documents from 1, not from 0.
+				*/
+				size_t instance = 0;
+				callback(instance, slice("-"));
+				for (const auto &key : primary_key)
+					callback(++instance, key);
+				}
+
+		public:
+			/*
+				INDEX_MANAGER_EXTERNAL::INDEX_MANAGER_EXTERNAL()
+				------------------------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param memory_budget [in] Write the in-memory index to a run once it has taken more than this many bytes from its allocator on top of what an empty one takes (the growth of the dictionary, which doubles in size as it fills, is counted).
+				@param run_prefix [in] The run files are named with this prefix (and a unique suffix), they are deleted when this object is.
+				@param merge_fan_in [in] The most runs to merge at once (at least 2), more are first merged into longer runs by finish().
+			*/
+			index_manager_external(size_t memory_budget, const std::string &run_prefix = "jass_run_", size_t merge_fan_in = 64) :
+				index_manager(),
+				memory_budget(memory_budget),
+				merge_fan_in(maths::maximum(merge_fan_in, static_cast<size_t>(2))),
+				run_prefix(run_prefix),
+				current(std::make_unique<index_manager_sequential>()),
+				current_first(0)
+				{
+				empty_memory_used = current->get_memory_used();
+				}
+
+			/*
+				INDEX_MANAGER_EXTERNAL::~INDEX_MANAGER_EXTERNAL()
+				-------------------------------------------------
+			*/
+			/*!
+				@brief Destructor
+			*/
+			virtual ~index_manager_external()
+				{
+				for (const auto &filename : runs)
+					::remove(filename.c_str());
+				}
+
+			/*
+				INDEX_MANAGER_EXTERNAL::BEGIN_DOCUMENT()
+				----------------------------------------
+			*/
+			/*!
+				@brief Tell this object that you're about to start indexing a new object.
+				@param document_primary_key [in] The document's primary key (or external document identifier).
+			*/
+			virtual void begin_document(const slice &document_primary_key)
+				{
+				index_manager::begin_document(document_primary_key);
+				primary_key.push_back(slice(memory, document_primary_key));
+				current->begin_document(document_primary_key);
+				}
+
+			/*
+				INDEX_MANAGER_EXTERNAL::TERM()
+				------------------------------
+			*/
+			/*!
+				@brief Hand a new term from the token stream to this object.
+				@param term [in] The term from the token stream.
+			*/
+			virtual void term(const parser::token &term)
+				{
+				current->term(term);
+				}
+
+			/*
+				INDEX_MANAGER_EXTERNAL::END_DOCUMENT()
+				--------------------------------------
+			*/
+			/*!
+				@brief Tell this object that you've finished with the current document, and write a run if the memory budget has been used.
+				@param document_length [in] The length of the document (in terms).
+			*/
+			virtual void end_document(compress_integer::integer document_length)
+				{
+				index_manager::end_document(document_length);
+				current->end_document(document_length);
+				if (current->get_memory_used() - empty_memory_used > memory_budget)
+					spill();
+				}
+
+			/*
+				INDEX_MANAGER_EXTERNAL::FINISH()
+				--------------------------------
+			*/
+			/*!
+				@brief Write the last run, then merge consecutive runs until there are few enough to merge at once.  Call once all the documents
+				have been indexed, and before iterating.
+			*/
+			void finish(void)
+				{
+				spill();
+				current.reset();
+
+				encoded.resize(maths::maximum(encoded.size(), 2 * static_cast<size_t>(get_highest_document_id()) * (sizeof(compress_integer::integer) * 8 / 7 + 1)));
+				while (runs.size() > merge_fan_in)
+					{
+					std::vector<std::string> longer_runs;
+					for (size_t first = 0; first < runs.size(); first += merge_fan_in)
+						{
+						size_t last = maths::minimum(first + merge_fan_in, runs.size());
+						if (last - first == 1)
+							{
+							longer_runs.push_back(runs[first]);
+							continue;
+							}
+
+						longer_runs.push_back(file::mkstemp(run_prefix));
+						do
+							{
+							file out(longer_runs.back(), "wb");
+							merge_runs(first, last, [this, &out](const slice &term, compress_integer::integer document_frequency)
+								{
+								write_record(out, term, document_frequency, 0);
+								});
+							}
+						while (0);
+
+						for (size_t which = first; which < last; which++)
+							::remove(runs[which].c_str());
+						}
+					runs = longer_runs;
+					}
+				}
+
+			/*
+				INDEX_MANAGER_EXTERNAL::GET_RUNS()
+				----------------------------------
+			*/
+			/*!
+				@brief Return the number of runs written to disk.
+				@return The number of runs.
+			*/
+			size_t get_runs(void) const
+				{
+				return runs.size();
+				}
+
+			/*
+				INDEX_MANAGER_EXTERNAL::TEXT_RENDER()
+				-------------------------------------
+			*/
+			/*!
+				@brief Dump a human-readable version of the merged index down the stream (one term->postings list per line).
+				@param stream [in] The stream to write to.
+			*/
+			virtual void text_render(std::ostream &stream) const
+				{
+				class render
+					{
+					private:
+						std::ostream &stream;
+
+					public:
+						render(std::ostream &stream) :
+							stream(stream)
+							{
+							/* Nothing */
+							}
+
+						void operator()(const slice &term, const index_postings &postings, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
+							{
+							stream << term << "->";
+							for (compress_integer::integer which = 0; which < document_frequency; which++)
+								stream << '<' << document_ids[which] << ',' << static_cast<size_t>(term_frequencies[which]) << '>';
+							stream << '\n';
+							}
+
+						void operator()(size_t document_id, const slice &primary_key)
+							{
+							/* Nothing */
+							}
+					};
+
+				const_cast<index_manager_external *>(this)->merge(render(stream));
+				}
+
+			/*
+				INDEX_MANAGER_EXTERNAL::ITERATE()
+				---------------------------------
+			*/
+			/*!
+				@brief Iterate over the merged index calling callback.operator() with each postings list.
+				@details The postings list object passed to the callback is empty, the merged postings list is in the arrays.
+				@param callback [in] The callback to call.
+			*/
+			virtual void iterate(index_manager::delegate &callback)
+				{
+				merge(callback);
+				}
+
+			/*
+				INDEX_MANAGER_EXTERNAL::ITERATE()
+				---------------------------------
+			*/
+			/*!
+				@brief Iterate over the merged index calling callback.operator() with each postings list.
+				@param quantizer [in] The quantizer that will quantize then call the serialiser callback.
+				@param callback [in] The callback that the quantizer should call.
+			*/
+			virtual void iterate(index_manager::quantizing_delegate &quantizer, index_manager::delegate &callback)
+				{
+				class forward
+					{
+					private:
+						index_manager::quantizing_delegate &quantizer;
+						index_manager::delegate &callback;
+
+					public:
+						forward(index_manager::quantizing_delegate &quantizer, index_manager::delegate &callback) :
+							quantizer(quantizer),
+							callback(callback)
+							{
+							/* Nothing */
+							}
+
+						void operator()(const slice &term, const index_postings &postings, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
+							{
+							quantizer(callback, term, postings, document_frequency, document_ids, term_frequencies);
+							}
+
+						void operator()(size_t document_id, const slice &primary_key)
+							{
+							quantizer(callback, document_id, primary_key);
+							}
+					};
+
+				merge(forward(quantizer, callback));
+				}
+
+			/*
+				INDEX_MANAGER_EXTERNAL::UNITTEST()
+				----------------------------------
+			*/
+			/*!
+				@brief Unit test this class.
+			*/
+			static void unittest(void)
+				{
+				/*
+					The answer is the index built in memory
+				*/
+				index_manager_sequential sequential;
+				index_manager_sequential::unittest_build_index(sequential, unittest_data::ten_documents);
+
+				std::ostringstream postings_answer;
+				std::ostringstream primary_key_answer;
+				index_manager_sequential::delegate sequential_callback(10, postings_answer, primary_key_answer);
+				sequential.iterate(sequential_callback);
+
+				/*
+					Build the same index with a given memory budget and merge fan-in, and check it is the same as the one built in memory
+					(including the order of the terms)
+				*/
+				auto build = [](size_t memory_budget, size_t merge_fan_in)
+					{
+					auto index = std::make_unique<index_manager_external>(memory_budget, "jass_unittest_run_", merge_fan_in);
+					class parser parser;
+					document document;
+					std::shared_ptr<instream> file(new instream_memory(unittest_data::ten_documents.c_str(), unittest_data::ten_documents.size()));
+					instream_document_trec source(file);
+
+					while (true)
+						{
+						document.rewind();
+						source.read(document);
+						if (document.isempty())
+							break;
+
+						compress_integer::integer document_length = 0;
+						parser.set_document(document);
+						index->begin_document(document.primary_key);
+						for (const auto *token = &parser.get_next_token(); token->type != parser::token::eof; token = &parser.get_next_token())
+							if (token->type == parser::token::alpha || token->type == parser::token::numeric)
+								{
+								document_length++;
+								index->term(*token);
+								}
+						index->end_document(document_length + 1);		// unittest_build_index() counts the eof token
+						}
+					index->finish();
+
+					return index;
+					};
+
+				auto check = [&](index_manager_external &index)
+					{
+					JASS_assert(index.get_highest_document_id() == 10);
+					JASS_assert(index.get_document_length_vector() == sequential.get_document_length_vector());
+
+					std::ostringstream computed_result;
+					computed_result << index;
+					JASS_assert(computed_result.str() == postings_answer.str());
+
+					std::ostringstream postings_result;
+					std::ostringstream primary_key_result;
+					index_manager_sequential::delegate callback(10, postings_result, primary_key_result);
+					index.iterate(callback);
+					JASS_assert(primary_key_result.str() == primary_key_answer.str());
+					};
+
+				/*
+					A memory budget so small that every document is written to its own run
+				*/
+				auto index_object = build(0, 64);
+				JASS_assert(index_object->get_runs() == 10);
+				check(*index_object);
+
+				/*
+					The fixed size of an empty index (such as its dictionary) is not counted, so with a budget of a quarter of the
+					ten documents several documents share each run
+				*/
+				size_t growth = sequential.get_memory_used() - index_manager_sequential().get_memory_used();
+				auto shared_runs = build(growth / 4, 64);
+				JASS_assert(shared_runs->get_runs() > 1 && shared_runs->get_runs() < 10);
+				check(*shared_runs);
+
+				/*
+					No more than the merge fan-in runs are left to merge (10 runs become 4 and then 2 with a fan-in of 3)
+				*/
+				auto merged_runs = build(0, 3);
+				JASS_assert(merged_runs->get_runs() == 2);
+				check(*merged_runs);
+				std::string merged_run = merged_runs->runs[0];
+				merged_runs.reset();
+				JASS_assert(!std::filesystem::exists(merged_run));
+
+				/*
+					The runs are deleted along with the index
+				*/
+				std::string first_run = index_object->runs[0];
+				index_object.reset();
+				JASS_assert(!std::filesystem::exists(first_run));
+
+				puts("index_manager_external::PASSED");
+				}
+		};
+	}
@@ -0,0 +1,492 @@
+/*
+	INDEX_MANAGER_PARALLEL.H
+	------------------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Indexer object that merges the indexes built by several threads, each indexing a disjoint set of documents.
+	@author Andrew Trotman
+	@copyright 2021 Andrew Trotman
+*/
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <sstream>
+#include <algorithm>
+
+#include "parser.h"
+#include "hash_table.h"
+#include "dynamic_array.h"
+#include "index_manager.h"
+#include "unittest_data.h"
+#include "index_postings.h"
+#include "instream_memory.h"
+#include "instream_document_trec.h"
+#include "index_manager_sequential.h"
+
+namespace JASS
+	{
+	/*
+		CLASS INDEX_MANAGER_PARALLEL
+		----------------------------
+	*/
+	/*!
+		@brief An index built in parts (one per thread) and merged as it is iterated over.
+		@details The documents are handed out to the parts in batches of consecutive documents, and each part is an
+		index_manager_sequential that is used by only one thread.  Before a part indexes a batch it must be told where the
+		batch starts in the collection (begin_batch()).  Once all the parts are done, finish() computes the collection's
+		document lengths and primary keys and the union of the vocabularies.  Iterating then merges the postings lists of
+		each term on the fly: each part's postings list is linearised, its document ids are mapped back to collection
+		document ids (which are monotonic within a part), and the parts' lists are merged one run at a time.  The
+		vocabulary is the same kind of hash table the parts use, so the terms are iterated over in the same order as an
+		index_manager_sequential over the whole collection, and the serialisers produce the same index.
+	*/
+	class index_manager_parallel : public index_manager
+		{
+		private:
+			/*
+				CLASS INDEX_MANAGER_PARALLEL::BATCH
+				-----------------------------------
+			*/
+			/*!
+				@brief A run of consecutive documents indexed by one part.
+			*/
+			class batch
+				{
+				public:
+					compress_integer::integer local_first;			///< The part's document id of the first document in the batch
+					compress_integer::integer global_first;		///< The collection's document id of the first document in the batch
+				};
+
+			/*
+				CLASS INDEX_MANAGER_PARALLEL::TERM_PART
+				---------------------------------------
+			*/
+			/*!
+				@brief The postings list of a term in one part.
+			*/
+			class term_part
+				{
+				public:
+					size_t part;											///< The part that holds the postings list
+					const index_postings *postings;					///< The postings list
+				};
+
+		private:
+			allocator_pool memory;																						///< The vocabulary is allocated from here
+			std::vector<std::unique_ptr<index_manager_sequential>> parts;									///< The index of each part
+			std::vector<std::vector<batch>> batches;																///< The batches each part indexed, in order
+			std::unique_ptr<hash_table<slice, dynamic_array<term_part>, 24>> vocabulary;				///< The union of the vocabularies of the parts (built by finish())
+			std::vector<slice> primary_key;																			///< The collection's primary keys in document id order (built by finish())
+
+			/*
+				Each of these buffers is re-used in the serialisation process
+			*/
+			std::vector<compress_integer::integer> document_ids;							///< The re-used buffer storing the merged document ids
+			std::vector<index_postings_impact::impact_type> term_frequencies;			///< The re-used buffer storing the merged term frequencies
+			std::vector<compress_integer::integer> part_document_ids;					///< The re-used buffer storing each part's document ids (one after the other)
+			std::vector<index_postings_impact::impact_type> part_term_frequencies;	///< The re-used buffer storing each part's term frequencies (one after the other)
+			std::vector<uint8_t> temporary;														///< Temporary buffer for linearising a postings list
+
+		private:
+			/*
+				INDEX_MANAGER_PARALLEL::GLOBALISE()
+				-----------------------------------
+			*/
+			/*!
+				@brief Turn a part's (sorted) document ids into the collection's document ids.
+				@param part [in] The part the document ids come from.
+				@param ids [in/out] The document ids.
+				@param length [in] The number of document ids.
+			*/
+			void globalise(size_t part, compress_integer::integer *ids, compress_integer::integer length) const
+				{
+				const auto &runs = batches[part];
+				auto current = runs.begin();
+				auto next = current + 1;
+
+				for (auto id = ids; id < ids + length; id++)
+					{
+					while (next != runs.end() && *id >= next->local_first)
+						current = next++;
+					*id = *id - current->local_first + current->global_first;
+					}
+				}
+
+			/*
+				INDEX_MANAGER_PARALLEL::LINEARIZE()
+				-----------------------------------
+			*/
+			/*!
+				@brief Merge the postings lists of a term from each part into document_ids and term_frequencies.
+				@param postings [in] The postings list of the term in each part that has it.
+				@return The document frequency of the term.
+			*/
+			compress_integer::integer linearize(const dynamic_array<term_part> &postings)
+				{
+				/*
+					The common case is that the term is in only one part, so linearise straight into the answer
+				*/
+				auto first = postings.begin();
+				auto second = first;
+				++second;
+				if (!(second != postings.end()))
+					{
+					auto document_frequency = (*first).postings->linearize(temporary.data(), temporary.size(), document_ids.data(), term_frequencies.data(), document_ids.size());
+					globalise((*first).part, document_ids.data(), document_frequency);
+					return document_frequency;
+					}
+
+				/*
+					Otherwise linearise each part one after the other, and then merge them
+				*/
+				class cursor
+					{
+					public:
+						compress_integer::integer *id;
+						compress_integer::integer *end;
+						index_postings_impact::impact_type *frequency;
+					};
+				std::vector<cursor> cursors;
+
+				size_t used = 0;
+				for (const auto &current : postings)
+					{
+					compress_integer::integer *ids = part_document_ids.data() + used;
+					index_postings_impact::impact_type *frequencies = part_term_frequencies.data() + used;
+					auto document_frequency = current.postings->linearize(temporary.data(), temporary.size(), ids, frequencies, part_document_ids.size() - used);
+					if (document_frequency == 0)
+						continue;
+					globalise(current.part, ids, document_frequency);
+					cursors.push_back(cursor{ids, ids + document_frequency, frequencies});
+					used += document_frequency;
+					}
+
+				/*
+					Each part's documents are in runs (batches) so copy the whole run from the part with the lowest document id
+				*/
+				compress_integer::integer *into_id = document_ids.data();
+				index_postings_impact::impact_type *into_frequency = term_frequencies.data();
+				while (cursors.size() != 0)
+					{
+					size_t lowest = 0;
+					compress_integer::integer up_to = (std::numeric_limits<compress_integer::integer>::max)();
+					for (size_t which = 1; which < cursors.size(); which++)
+						if (*cursors[which].id < *cursors[lowest].id)
+							{
+							up_to = *cursors[lowest].id;
+							lowest = which;
+							}
+						else
+							up_to = maths::minimum(up_to, *cursors[which].id);
+
+					cursor &from = cursors[lowest];
+					while (from.id < from.end && *from.id < up_to)
+						{
+						*into_id++ = *from.id++;
+						*into_frequency++ = *from.frequency++;
+						}
+
+					if (from.id == from.end)
+						cursors.erase(cursors.begin() + lowest);
+					}
+
+				return static_cast<compress_integer::integer>(into_id - document_ids.data());
+				}
+
+			/*
+				INDEX_MANAGER_PARALLEL::MAKE_SPACE()
+				------------------------------------
+			*/
+			/*!
+				@brief make sure all the internal buffers needed for iteration have been allocated
+			*/
+			void make_space(void)
+				{
+				size_t documents = get_highest_document_id();
+
+				document_ids.resize(documents);
+				term_frequencies.resize(documents);
+				part_document_ids.resize(documents);
+				part_term_frequencies.resize(documents);
+				temporary.resize(documents * (sizeof(compress_integer::integer) / 7 + 1));
+				}
+
+		public:
+			/*
+				INDEX_MANAGER_PARALLEL::INDEX_MANAGER_PARALLEL()
+				------------------------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param number_of_parts [in] The number of parts (normally the number of indexing threads).
+			*/
+			index_manager_parallel(size_t number_of_parts) :
+				index_manager(),
+				batches(number_of_parts)
+				{
+				for (size_t which = 0; which < number_of_parts; which++)
+					parts.push_back(std::make_unique<index_manager_sequential>());
+				}
+
+			/*
+				INDEX_MANAGER_PARALLEL::~INDEX_MANAGER_PARALLEL()
+				-------------------------------------------------
+			*/
+			/*!
+				@brief Destructor
+			*/
+			virtual ~index_manager_parallel()
+				{
+				/* Nothing */
+				}
+
+			/*
+				INDEX_MANAGER_PARALLEL::PART()
+				------------------------------
+			*/
+			/*!
+				@brief Return the index of a part, into which its thread indexes its documents (with begin_document(), term(), and end_document()).
+				@param which [in] The part.
+				@return The index of the part.
+			*/
+			index_manager_sequential &part(size_t which)
+				{
+				return *parts[which];
+				}
+
+			/*
+				INDEX_MANAGER_PARALLEL::BEGIN_BATCH()
+				-------------------------------------
+			*/
+			/*!
+				@brief Tell this object that a part is about to index a batch of consecutive documents from the collection.
+				@details Each part must be given its batches in increasing order of document id.  Only the thread using the
+				part may call this method for the part.
+				@param which [in] The part.
+				@param first_document_id [in] The collection's document id (counting from 1) of the first document in the batch.
+			*/
+			void begin_batch(size_t which, compress_integer::integer first_document_id)
+				{
+				batches[which].push_back(batch{parts[which]->get_highest_document_id() + 1, first_document_id});
+				}
+
+			/*
+				INDEX_MANAGER_PARALLEL::FINISH()
+				--------------------------------
+			*/
+			/*!
+				@brief Merge the document lengths, primary keys, and vocabularies of the parts. Call once all parts are done, and before iterating.
+			*/
+			void finish(void)
+				{
+				/*
+					The document lengths and primary keys
+				*/
+				size_t documents = 0;
+				for (const auto &current : parts)
+					documents += current->get_highest_document_id();
+
+				std::vector<compress_integer::integer> lengths(documents + 1);
+				primary_key.resize(documents);
+				for (size_t which = 0; which < parts.size(); which++)
+					{
+					const auto &local_lengths = parts[which]->get_document_length_vector();
+					compress_integer::integer local_id = 1;
+					auto key = parts[which]->get_primary_keys().begin();
+					const auto &runs = batches[which];
+
+					for (size_t run = 0; run < runs.size(); run++)
+						{
+						compress_integer::integer end = run + 1 < runs.size() ? runs[run + 1].local_first : parts[which]->get_highest_document_id() + 1;
+						for (; local_id < end; local_id++, ++key)
+							{
+							compress_integer::integer global_id = local_id - runs[run].local_first + runs[run].global_first;
+							lengths[global_id] = local_lengths[local_id];
+							primary_key[global_id - 1] = *key;
+							}
+						}
+					}
+				set_document_length_vector(lengths);
+
+				/*
+					The union of the vocabularies, each term pointing to the postings lists of the parts in part order
+				*/
+				vocabulary = std::make_unique<hash_table<slice, dynamic_array<term_part>, 24>>(memory);
+				for (size_t which = 0; which < parts.size(); which++)
+					for (const auto &[term, postings] : parts[which]->get_postings())
+						(*vocabulary)[term].push_back(term_part{which, &postings});
+				}
+
+			/*
+				INDEX_MANAGER_PARALLEL::TEXT_RENDER()
+				-------------------------------------
+			*/
+			/*!
+				@brief Dump a human-readable version of the merged index down the stream (one term->postings list per line).
+				@param stream [in] The stream to write to.
+			*/
+			virtual void text_render(std::ostream &stream) const
+				{
+				class render : public index_manager::delegate
+					{
+					private:
+						std::ostream &stream;
+
+					public:
+						render(size_t documents, std::ostream &stream) :
+							index_manager::delegate(documents),
+							stream(stream)
+							{
+							/* Nothing */
+							}
+
+						virtual void operator()(const slice &term, const index_postings &postings, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
+							{
+							stream << term << "->";
+							for (compress_integer::integer which = 0; which < document_frequency; which++)
+								stream << '<' << document_ids[which] << ',' << static_cast<size_t>(term_frequencies[which]) << '>';
+							stream << '\n';
+							}
+
+						virtual void operator()(size_t document_id, const slice &primary_key)
+							{
+							/* Nothing */
+							}
+					} callback(get_highest_document_id(), stream);
+
+				const_cast<index_manager_parallel *>(this)->iterate(callback);
+				}
+
+			/*
+				INDEX_MANAGER_PARALLEL::ITERATE()
+				---------------------------------
+			*/
+			/*!
+				@brief Iterate over the merged index calling callback.operator() with each postings list.
+				@details The postings list object passed to the callback is that of one of the parts, the merged postings list is in the arrays.
+				@param callback [in] The callback to call.
+			*/
+			virtual void iterate(index_manager::delegate &callback)
+				{
+				make_space();
+
+				for (const auto &[term, postings] : *vocabulary)
+					{
+					auto document_frequency = linearize(postings);
+					callback(term, *(*postings.begin()).postings, document_frequency, document_ids.data(), term_frequencies.data());
+					}
+
+				/*
+					Note that the search engine counts documents from 1, not from 0.
+				*/
+				size_t instance = 0;
+				callback(instance, slice("-"));
+				for (const auto &key : primary_key)
+					callback(++instance, key);
+				}
+
+			/*
+				INDEX_MANAGER_PARALLEL::ITERATE()
+				---------------------------------
+			*/
+			/*!
+				@brief Iterate over the merged index calling callback.operator() with each postings list.
+				@param quantizer [in] The quantizer that will quantize then call the serialiser callback.
+				@param callback [in] The callback that the quantizer should call.
+			*/
+			virtual void iterate(index_manager::quantizing_delegate &quantizer, index_manager::delegate &callback)
+				{
+				make_space();
+
+				for (const auto &[term, postings] : *vocabulary)
+					{
+					auto document_frequency = linearize(postings);
+					quantizer(callback, term, *(*postings.begin()).postings, document_frequency, document_ids.data(), term_frequencies.data());
+					}
+
+				size_t instance = 0;
+				quantizer(callback, instance, slice("-"));
+				for (const auto &key : primary_key)
+					quantizer(callback, ++instance, key);
+				}
+
+			/*
+				INDEX_MANAGER_PARALLEL::UNITTEST()
+				----------------------------------
+			*/
+			/*!
+				@brief Unit test this class.
+			*/
+			static void unittest(void)
+				{
+				/*
+					The answer is the index built sequentially
+				*/
+				index_manager_sequential sequential;
+				index_manager_sequential::unittest_build_index(sequential, unittest_data::ten_documents);
+
+				std::ostringstream postings_answer;
+				std::ostringstream primary_key_answer;
+				index_manager_sequential::delegate sequential_callback(10, postings_answer, primary_key_answer);
+				sequential.iterate(sequential_callback);
+
+				/*
+					Build the same index in 3 parts with batches of 2 documents handed out round robin (so part 0 gets documents 1, 2, 7, and 8)
+				*/
+				index_manager_parallel index(3);
+				class parser parser;
+				document document;
+				std::shared_ptr<instream> file(new instream_memory(unittest_data::ten_documents.c_str(), unittest_data::ten_documents.size()));
+				instream_document_trec source(file);
+
+				compress_integer::integer document_id = 0;
+				while (true)
+					{
+					document.rewind();
+					source.read(document);
+					if (document.isempty())
+						break;
+
+					size_t which = (document_id / 2) % 3;
+					if (document_id % 2 == 0)
+						index.begin_batch(which, document_id + 1);
+					document_id++;
+
+					index_manager_sequential &part = index.part(which);
+					compress_integer::integer document_length = 0;
+					parser.set_document(document);
+					part.begin_document(document.primary_key);
+					for (const auto *token = &parser.get_next_token(); token->type != parser::token::eof; token = &parser.get_next_token())
+						if (token->type == parser::token::alpha || token->type == parser::token::numeric)
+							{
+							document_length++;
+							part.term(*token);
+							}
+					part.end_document(document_length + 1);		// unittest_build_index() counts the eof token
+					}
+				index.finish();
+
+				/*
+					Check the merged index is the same as the sequential one (including the order of the terms)
+				*/
+				JASS_assert(index.get_highest_document_id() == 10);
+				JASS_assert(index.get_document_length_vector() == sequential.get_document_length_vector());
+
+				std::ostringstream computed_result;
+				computed_result << index;
+				JASS_assert(computed_result.str() == postings_answer.str());
+
+				std::ostringstream postings_result;
+				std::ostringstream primary_key_result;
+				index_manager_sequential::delegate callback(10, postings_result, primary_key_result);
+				index.iterate(callback);
+				JASS_assert(primary_key_result.str() == primary_key_answer.str());
+
+				puts("index_manager_parallel::PASSED");
+				}
+		};
+	}
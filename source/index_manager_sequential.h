@@ -17,7 +17,7 @@
 
 #include "parser.h"
 #include "posting.h"
-#include "hash_table.h"
+#include "hash_table_open.h"
 #include "index_manager.h"
 #include "unittest_data.h"
 #include "index_postings.h"
@@ -32,14 +32,17 @@ namespace JASS
 	*/
 	/*!
 		@brief Non-thread-Safe indexer object.
-		@details This class is a non-thread-safe indexer used for regular sequential indexing.  It self-contains its memory, uses a hash-table with
-		direct chaining (in a non-ballanced tree) and supports a positional index.
+		@details This class is a non-thread-safe indexer used for regular sequential indexing.  It self-contains its memory, uses an open addressing
+		hash table (which iterates in the same order as the hash-table with direct chaining in a non-ballanced tree) and supports a positional index.
 	*/
 	class index_manager_sequential : public index_manager
 		{
+		public:
+			typedef hash_table_open<index_postings, 24> dictionary;			///< The type of the term to postings list hash table.
+
 		private:
 			allocator_pool memory;														///< All memory in allocatged from this allocator.
-			hash_table<slice, index_postings, 24> index;							///< The index is a hash table of index_postings keyed on the term (a slice).
+			dictionary index;																///< The index is a hash table of index_postings keyed on the term (a slice).
 			dynamic_array<slice> primary_key;										///< The list of primary keys (i.e. external document identifiers) allocated in memory.
 			
 			/*
@@ -261,6 +264,45 @@ namespace JASS
 				index[term.lexeme].push_back(docid);
 				}
 
+			/*
+				INDEX_MANAGER_SEQUENTIAL::GET_POSTINGS()
+				----------------------------------------
+			*/
+			/*!
+				@brief Return the hash table of term to postings list (for merging several indexes, see index_manager_parallel).
+				@return The postings lists, keyed on the term.
+			*/
+			const dictionary &get_postings(void) const
+				{
+				return index;
+				}
+
+			/*
+				INDEX_MANAGER_SEQUENTIAL::GET_PRIMARY_KEYS()
+				--------------------------------------------
+			*/
+			/*!
+				@brief Return the primary keys (external document identifiers) in document id order (the first is that of document 1).
+				@return The list of primary keys.
+			*/
+			const dynamic_array<slice> &get_primary_keys(void) const
+				{
+				return primary_key;
+				}
+
+			/*
+				INDEX_MANAGER_SEQUENTIAL::GET_MEMORY_USED()
+				-------------------------------------------
+			*/
+			/*!
+				@brief Return the number of bytes of memory the index (including the hash table and the primary keys) has taken from its allocator.
+				@return The number of bytes in use.
+			*/
+			size_t get_memory_used(void) const
+				{
+				return memory.size();
+				}
+
 			/*
 				INDEX_MANAGER_SEQUENTIAL::TEXT_RENDER()
 				---------------------------------------
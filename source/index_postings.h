@@ -263,13 +263,14 @@ namespace JASS
 			*/
 			/*!
 				@brief Return the postings list impact ordered postings list with impact headers.
+				@details This method uses only its parameters (not the object), so it is static and can be called from several threads at once (each with its own postings_list).
 				@param documents_in_collection [in] The number of documents in the collection,
 				@param postings_list [out] The constructed impact ordered postings list.
 				@param document_frequency [in] the document frequency of this term (the length of id_list and tf_list).
 				@param document_ids [in] The list of document ids.
 				@param term_frequencies [in] The list of term frequencies.
 			*/
-			void impact_order(size_t documents_in_collection, index_postings_impact &postings_list, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies) const
+			static void impact_order(size_t documents_in_collection, index_postings_impact &postings_list, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
 				{
 #ifdef ADD_SENTINALS
 #define SENTINAL (documents_in_collection + 1)
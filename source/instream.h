@@ -13,8 +13,11 @@
 
 #pragma once
 
+#include <string.h>
+
 #include <vector>
 #include <memory>
+#include <algorithm>
 
 #include "document.h"
 #include "allocator_memory.h"
@@ -129,6 +132,16 @@ namespace JASS
 				
 				into.contents = slice(buffer, bytes);
 				read(into);
+
+				/*
+					Readers that read in place (see instream_memory::unread()) return a pointer to the data rather than copying it into the buffer
+				*/
+				if (into.contents.address() != buffer && into.contents.size() != 0)
+					{
+					into.contents.resize((std::min)(into.contents.size(), bytes));
+					::memmove(buffer, into.contents.address(), into.contents.size());
+					}
+
 				return into.contents.size();
 				}
 		} ;
@@ -6,9 +6,14 @@
 */
 #include <string.h>
 
+#include <algorithm>
+
+#include "file.h"
 #include "assert.h"
+#include "asserts.h"
 #include "instream_file.h"
 #include "instream_deflate.h"
+#include "compress_general_zlib.h"
 #include "instream_directory_iterator.h"
 
 namespace JASS
@@ -17,12 +22,108 @@ namespace JASS
 		INSTREAM_DIRECTORY_ITERATOR::INSTREAM_DIRECTORY_ITERATOR()
 		----------------------------------------------------------
 	*/
-	instream_directory_iterator::instream_directory_iterator(const std::string &directory_name) :
-		source(directory_name),
-		reader(nullptr)
+	instream_directory_iterator::instream_directory_iterator(const std::string &directory_name, size_t threads) :
+		next_file(0),
+		reader(nullptr),
+		threads(threads),
+		current_offset(0),
+		next_to_decompress(0),
+		stop(false)
 		{
-		current = begin(source);
-		last = end(source);
+		/*
+			The order of a directory_iterator is unspecified, so sort the filenames so that the stream (and the document ids) are reproducable
+		*/
+		for (const auto &entry : std::filesystem::directory_iterator(directory_name))
+			filenames.push_back(entry.path().string());
+		std::sort(filenames.begin(), filenames.end());
+
+		if (threads > 1)
+			{
+			files.resize(filenames.size());
+			for (size_t which = 0; which < threads; which++)
+				workers.push_back(thread(&instream_directory_iterator::decompress, this));
+			}
+		}
+
+	/*
+		INSTREAM_DIRECTORY_ITERATOR::~INSTREAM_DIRECTORY_ITERATOR()
+		-----------------------------------------------------------
+	*/
+	instream_directory_iterator::~instream_directory_iterator()
+		{
+		do
+			{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+			}
+		while (0);
+		changed.notify_all();
+
+		for (auto &worker : workers)
+			worker.join();
+		}
+
+	/*
+		INSTREAM_DIRECTORY_ITERATOR::OPEN()
+		-----------------------------------
+	*/
+	std::shared_ptr<instream> instream_directory_iterator::open(const std::string &filename)
+		{
+//puts(filename.c_str());
+		std::shared_ptr<instream> reader(new instream_file(filename));
+		if (filename.rfind(".gz") != std::string::npos)
+			reader = std::shared_ptr<JASS::instream>(new instream_deflate(reader));
+
+		return reader;
+		}
+
+	/*
+		INSTREAM_DIRECTORY_ITERATOR::DECOMPRESS()
+		-----------------------------------------
+	*/
+	void instream_directory_iterator::decompress(void)
+		{
+		const size_t chunk_size = 1024 * 1024;
+
+		while (true)
+			{
+			/*
+				Choose the next file to read, but stay no more than one file per thread ahead of the reader
+			*/
+			size_t which;
+			do
+				{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [this](){ return stop || next_to_decompress >= files.size() || next_to_decompress < next_file + threads; });
+				if (stop || next_to_decompress >= files.size())
+					return;
+				which = next_to_decompress++;
+				}
+			while (0);
+
+			/*
+				Read (and decompress) the whole file into memory
+			*/
+			std::vector<uint8_t> contents;
+			auto source = open(filenames[which]);
+			size_t got;
+			do
+				{
+				contents.resize(contents.size() + chunk_size);
+				got = source->fetch(&contents[contents.size() - chunk_size], chunk_size);
+				contents.resize(contents.size() - chunk_size + got);
+				}
+			while (got != 0);
+
+			do
+				{
+				std::lock_guard<std::mutex> lock(mutex);
+				files[which].contents = std::move(contents);
+				files[which].ready = true;
+				}
+			while (0);
+			changed.notify_all();
+			}
 		}
 
 	/*
@@ -30,19 +131,31 @@ namespace JASS
 		-----------------------------------
 	*/
 	void instream_directory_iterator::read(document &document)
+		{
+		if (threads <= 1)
+			read_sequential(document);
+		else
+			read_concurrent(document);
+		}
+
+	/*
+		INSTREAM_DIRECTORY_ITERATOR::READ_SEQUENTIAL()
+		----------------------------------------------
+	*/
+	void instream_directory_iterator::read_sequential(document &document)
 		{
 		/*
 			Is this the first time this method is called?
 		*/
 		if (reader == nullptr)
-			if (current != last)
+			{
+			if (next_file >= filenames.size())
 				{
-//puts(current->path().string().c_str());
-				reader = std::shared_ptr<instream>(new instream_file(current->path().string()));
-				if (current->path().string().rfind(".gz") != std::string::npos)
-					reader = std::shared_ptr<JASS::instream>(new instream_deflate(reader));
-				current++;
+				document.contents.resize(0);
+				return;				// there are no files
 				}
+			reader = open(filenames[next_file++]);
+			}
 
 		/*
 			Now we can get data from the reader and return it, after making sure we're not at EOF.
@@ -63,14 +176,8 @@ namespace JASS
 			/*
 				We're at EOF so move on to the next disk file
 			*/
-			if (current != last)
-				{
-//puts(current->path().string().c_str());
-				reader = std::shared_ptr<instream>(new instream_file(current->path().string()));
-				if (current->path().string().rfind(".gz") != std::string::npos)
-					reader = std::shared_ptr<JASS::instream>(new instream_deflate(reader));
-				current++;
-				}
+			if (next_file < filenames.size())
+				reader = open(filenames[next_file++]);
 			else
 				{
 				document.contents.resize(document.contents.size() - amount_to_read);
@@ -80,6 +187,58 @@ namespace JASS
 		while (amount_to_read != 0);
 		}
 
+	/*
+		INSTREAM_DIRECTORY_ITERATOR::READ_CONCURRENT()
+		----------------------------------------------
+	*/
+	void instream_directory_iterator::read_concurrent(document &document)
+		{
+		size_t amount_to_read = document.contents.size();
+		size_t got = 0;
+
+		while (got < amount_to_read && next_file < files.size())
+			{
+			/*
+				Wait for a worker to finish reading the file
+			*/
+			do
+				{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [this](){ return files[next_file].ready; });
+				}
+			while (0);
+
+			/*
+				Copy what we can from it
+			*/
+			auto &contents = files[next_file].contents;
+			size_t bytes = (std::min)(amount_to_read - got, contents.size() - current_offset);
+			if (bytes != 0)
+				memcpy(&document.contents[got], &contents[current_offset], bytes);
+			got += bytes;
+			current_offset += bytes;
+
+			/*
+				If we've finished with this file then release its memory and let the workers move on
+			*/
+			if (current_offset == contents.size())
+				{
+				std::vector<uint8_t>().swap(contents);
+				current_offset = 0;
+				do
+					{
+					std::lock_guard<std::mutex> lock(mutex);
+					next_file++;
+					}
+				while (0);
+				changed.notify_all();
+				}
+			}
+
+		if (got < amount_to_read)
+			document.contents.resize(got);
+		}
+
 	/*
 		INSTREAM_DIRECTORY_ITERATOR::UNITTEST()
 		---------------------------------------
@@ -90,11 +249,49 @@ namespace JASS
 
 		document blob;
 		source.read(blob);
+
+		/*
+			Create a directory of files, one of them compressed, in a different order to their names
+		*/
+		auto directory = file::mkstemp("jass");
+		(void)remove(directory.c_str());
+		std::filesystem::create_directory(directory);
+
+		std::string compressed_text;
+		for (size_t line = 0; line < 1000; line++)
+			compressed_text += "<DOC><DOCNO>" + std::to_string(line) + "</DOCNO></DOC>\n";
+		std::string compressed(compressed_text.size() + 1024, '\0');
+		compress_general_zlib zlib;
+		compressed.resize(zlib.encode(&compressed[0], compressed.size(), compressed_text.c_str(), compressed_text.size()));
+
+		file::write_entire_file(directory + "/d.txt", "");
+		file::write_entire_file(directory + "/b.txt", "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb");
+		file::write_entire_file(directory + "/c.gz", compressed);
+		file::write_entire_file(directory + "/a.txt", "aaaaaaaaaaaaaaaaaaaaaaaaaa");
+		std::string expected = "aaaaaaaaaaaaaaaaaaaaaaaaaa" "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb" + compressed_text;
+
+		/*
+			Read it (in blocks of 100 bytes) with one thread and with several, which must produce the same stream
+		*/
+		for (size_t threads = 1; threads <= 3; threads++)
+			{
+			instream_directory_iterator reader(directory, threads);
+			std::string got;
+			char buffer[100];
+			size_t bytes;
+
+			while ((bytes = reader.fetch(buffer, sizeof(buffer))) != 0)
+				got.append(buffer, bytes);
+
+			JASS_assert(got == expected);
+			JASS_assert(reader.fetch(buffer, sizeof(buffer)) == 0);
+			}
+
+		std::filesystem::remove_all(directory);
+
 		/*
 			Yay, we passed!
 		*/
 		puts("instream_directory_iterator::PASSED");
 		}
 	}
-
-
@@ -12,8 +12,12 @@
 */
 #pragma once
 
+#include <mutex>
+#include <vector>
 #include <filesystem>
+#include <condition_variable>
 
+#include "threads.h"
 #include "instream.h"
 
 namespace JASS
@@ -24,17 +28,85 @@ namespace JASS
 	*/
 	/*!
 		@brief Subclass of instream for reading data from multiple files in a directory (as if they were all concatinated).
+		@details The files are read in order of filename, so the same directory always produces the same stream (and so the same
+		document ids).  Files ending in .gz are decompressed.  With more than one thread the files are read and decompressed
+		concurrently, each (whole) into memory, with at most one file per thread ahead of the file being read from.  The stream
+		is the same regardless of the number of threads.
 	*/
 	class instream_directory_iterator : public instream
 		{
 		protected:
-			std::filesystem::directory_iterator source;		///< Use the C++17 directory iterator
-			std::filesystem::directory_iterator current;		///< Where we are in the current iteration
-			std::filesystem::directory_iterator last;			///< The point where the iterator finishes iterating
+			/*
+				CLASS INSTREAM_DIRECTORY_ITERATOR::DECOMPRESSED_FILE
+				----------------------------------------------------
+			*/
+			/*!
+				@brief The contents of a file read by a worker thread.
+			*/
+			class decompressed_file
+				{
+				public:
+					std::vector<uint8_t> contents;		///< The (decompressed) contents of the file
+					bool ready = false;						///< Has the file been read?
+				};
+
+		protected:
+			std::vector<std::string> filenames;				///< The files in the directory (sorted)
+			size_t next_file;										///< The next file to read from (the index into filenames)
 
 			std::shared_ptr<instream> reader;					///< A chain of instram objects responsible for sourcing the data
 			size_t bytes_read;										///< The number of bytes that have been read from the file.
 
+			size_t threads;										///< The number of threads reading the files (1 means this thread)
+			std::vector<decompressed_file> files;				///< With more than one thread, the files the workers have read (or are reading)
+			size_t current_offset;								///< With more than one thread, the position in the file being read from (files[next_file])
+			size_t next_to_decompress;							///< With more than one thread, the next file a worker should read
+			bool stop;												///< Set by the destructor to tell the workers to finish
+			std::mutex mutex;										///< Guards files[].ready, next_file, next_to_decompress, and stop
+			std::condition_variable changed;					///< Signalled when a file has been read or finished with (or stop is set)
+			std::vector<thread> workers;						///< The threads that read the files
+
+		protected:
+			/*
+				INSTREAM_DIRECTORY_ITERATOR::OPEN()
+				-----------------------------------
+			*/
+			/*!
+				@brief Return an instream that reads the given file, decompressing it if its name ends with .gz.
+				@param filename [in] The name of the file.
+				@return The instream.
+			*/
+			static std::shared_ptr<instream> open(const std::string &filename);
+
+			/*
+				INSTREAM_DIRECTORY_ITERATOR::DECOMPRESS()
+				-----------------------------------------
+			*/
+			/*!
+				@brief A worker thread, read files (in order) into files[] until they have all been read or the destructor is called.
+			*/
+			void decompress(void);
+
+			/*
+				INSTREAM_DIRECTORY_ITERATOR::READ_SEQUENTIAL()
+				----------------------------------------------
+			*/
+			/*!
+				@brief Read buffer.contents.size() bytes of data into buffer.contents, resizing on eof, reading the files on this thread.
+				@param buffer [out] buffer.contents.size() bytes of data are read from source into buffer which is resized to the number of bytes read on eof.
+			*/
+			void read_sequential(document &buffer);
+
+			/*
+				INSTREAM_DIRECTORY_ITERATOR::READ_CONCURRENT()
+				----------------------------------------------
+			*/
+			/*!
+				@brief Read buffer.contents.size() bytes of data into buffer.contents, resizing on eof, from the files read by the workers.
+				@param buffer [out] buffer.contents.size() bytes of data are read from source into buffer which is resized to the number of bytes read on eof.
+			*/
+			void read_concurrent(document &buffer);
+
 		public:
 			/*
 				INSTREAM_DIRECTORY_ITERATOR::INSTREAM_DIRECTORY_ITERATOR()
@@ -43,20 +115,18 @@ namespace JASS
 			/*!
 				@brief Constructor
 				@param directory_name [in] The name of the directory to search within
+				@param threads [in] The number of threads to read (and decompress) the files with.
 			*/
-			instream_directory_iterator(const std::string &directory_name);
+			instream_directory_iterator(const std::string &directory_name, size_t threads = 1);
 
 			/*
 				INSTREAM_DIRECTORY_ITERATOR::~INSTREAM_DIRECTORY_ITERATOR()
 				-----------------------------------------------------------
 			*/
 			/*!
-				@brief Destructor.
+				@brief Destructor.  Stop the workers (once they finish the file they are reading).
 			*/
-			virtual ~instream_directory_iterator()
-				{
-				/* Nothing */
-				}
+			virtual ~instream_directory_iterator();
 
 			/*
 				INSTREAM_DIRECTORY_ITERATOR::READ()
@@ -24,7 +24,8 @@ namespace JASS
 	*/
 	instream_document_trec::instream_document_trec(std::shared_ptr<instream> &source, size_t buffer_size, const std::string &document_tag, const std::string &document_primary_key_tag) :
 		instream(source),
-		buffer_size(buffer_size)
+		buffer_size(buffer_size),
+		in_place(dynamic_cast<instream_memory *>(source.get()))
 		{
 		/*
 			Allocate the internal buffer and keep a pointer to its end.
@@ -82,6 +83,12 @@ namespace JASS
 	*/
 	void instream_document_trec::read(document &object)
 		{
+		if (in_place != nullptr)
+			{
+			read_in_place(object);
+			return;
+			}
+
 		uint8_t *unread_data = buffer + buffer_used;
 
 		/*
@@ -138,6 +145,42 @@ namespace JASS
 		document_end += document_end_tag.size();
 		buffer_used = document_end - buffer;		// skip to end of end tag
 
+		extract(object, document_start, document_end, false);
+		}
+
+	/*
+		INSTREAM_DOCUMENT_TREC::READ_IN_PLACE()
+		---------------------------------------
+	*/
+	void instream_document_trec::read_in_place(document &object)
+		{
+		size_t length;
+		uint8_t *unread_data = const_cast<uint8_t *>(in_place->unread(length));
+		uint8_t *end = unread_data + length;
+
+		/*
+			Find the start tag and then the end tag.  If either is missing then we're at EOF (or the last document is broken)
+		*/
+		uint8_t *document_start = std::search(unread_data, end, document_start_tag.c_str(), document_start_tag.c_str() + document_start_tag.size());
+		uint8_t *document_end = std::search(document_start, end, document_end_tag.c_str(), document_end_tag.c_str() + document_end_tag.size());
+		if (document_end == end)
+			{
+			in_place->skip(length);
+			object.primary_key = object.contents = slice();
+			return;
+			}
+		document_end += document_end_tag.size();
+		in_place->skip(document_end - unread_data);
+
+		extract(object, document_start, document_end, true);
+		}
+
+	/*
+		INSTREAM_DOCUMENT_TREC::EXTRACT()
+		---------------------------------
+	*/
+	void instream_document_trec::extract(document &object, uint8_t *document_start, uint8_t *document_end, bool in_place)
+		{
 		/*
 			Extract the document's primary key.
 		*/
@@ -158,15 +201,21 @@ namespace JASS
 			}
 
 		/*
-			Copy the id into the document object and get the document
+			Copy the id into the document object and get the document (or point to them if they are in memory that will not change)
 		*/
-		object.contents = slice(object.contents_allocator, document_start, document_end);
+		if (in_place)
+			object.contents = slice(document_start, document_end);
+		else
+			object.contents = slice(object.contents_allocator, document_start, document_end);
+
 		if (document_id_end == document_end)
 			object.primary_key = slice(object.primary_key_allocator, "Unknown");
+		else if (in_place)
+			object.primary_key = slice(document_id_start, document_id_end);
 		else
 			object.primary_key = slice(object.primary_key_allocator, document_id_start, document_id_end);
 		}
-		
+
 	/*
 		INSTREAM_DOCUMENT_TREC::UNITTEST()
 		----------------------------------
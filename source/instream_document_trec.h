@@ -19,6 +19,7 @@
 
 #include "slice.h"
 #include "instream.h"
+#include "instream_memory.h"
 
 namespace JASS
 	{
@@ -31,6 +32,9 @@ namespace JASS
 		@details Connect an object of this class to an input stream and it will return TREC new-article formatted documents
 		one per read.  This is done by looking for \<DOC> and \</DOC> tags in the source stream.  Document primary keys are
 		assumed to be between \<DOCNO> and \</DOCNO> tags.
+
+		If the source is an instream_memory (or an instream_file_mmap) then the documents are found in the source's memory
+		and the document and primary key returned by read() point into that memory (rather than being copied).
 	*/
 	class instream_document_trec : public instream
 		{
@@ -47,6 +51,8 @@ namespace JASS
 			std::string primary_key_start_tag;			///< The primary key's start tag ("<DOCNO>" by default)
 			std::string primary_key_end_tag;				///< The primary key's end tag ("</DOCNO>" by default)
 
+			instream_memory *in_place;						///< If the source is in memory then it, and documents are read in place, else nullptr
+
 		protected:
 			/*
 				INSTREAM_DOCUMENT_TREC::INSTREAM_DOCUMENT_TREC()
@@ -86,6 +92,29 @@ namespace JASS
 				buffer_end = (uint8_t *)buffer + source->fetch(buffer, bytes);
 				}
 
+			/*
+				INSTREAM_DOCUMENT_TREC::READ_IN_PLACE()
+				---------------------------------------
+			*/
+			/*!
+				@brief Read the next document from an in-memory source, without copying it.
+				@param buffer [out] The next document in the source instream.
+			*/
+			void read_in_place(document &buffer);
+
+			/*
+				INSTREAM_DOCUMENT_TREC::EXTRACT()
+				---------------------------------
+			*/
+			/*!
+				@brief Find the primary key of a document and set up the document object.
+				@param object [out] The document object.
+				@param document_start [in] The start of the document (its start tag).
+				@param document_end [in] The end of the document (the end of its end tag).
+				@param in_place [in] If true then point to the document and primary key, else copy them into object.
+			*/
+			void extract(document &object, uint8_t *document_start, uint8_t *document_end, bool in_place);
+
 		public:
 			/*
 				INSTREAM_DOCUMENT_TREC::INSTREAM_DOCUMENT_TREC()
@@ -3,107 +3,251 @@
 	--------------------------
 */
 #include <string.h>
+#include <stdlib.h>
 
 #include <memory>
+#include <algorithm>
 
 #include "ascii.h"
 #include "instream_memory.h"
+#include "instream_read_ahead.h"
 #include "instream_document_warc.h"
 
 namespace JASS
 	{
 	/*
-		INSTREAM_DOCUMENT_WARC::FIND_STRING()
-		-------------------------------------
+		INSTREAM_DOCUMENT_WARC::GET_LINE()
+		----------------------------------
 	*/
-	const char *instream_document_warc::find_string(const std::string &string)
+	const char *instream_document_warc::get_line(const char *&end_of_line)
 		{
-		size_t string_length = string.size();
+		const uint8_t *start;
+		const uint8_t *newline;
 
-		/*
-			Do a series of gets()'s until we find the given string
-		*/
-		buffer[string_length] = '\0';		// prevent early accidental termination (due to a ':' left over from a previous iteration).
-		const char *end = buffer.c_str() + buffer.size() - 1;
-		do
-			do
+		if (in_place != nullptr)
+			{
+			/*
+				The source is in memory so the line is found in place
+			*/
+			size_t length;
+			start = in_place->unread(length);
+			if ((newline = reinterpret_cast<const uint8_t *>(memchr(start, '\n', length))) == nullptr)
 				{
-				/*
-					Read a '\n' terminated string from the source.
-				*/
-				buffer[0] = '\0';
-				char *into = const_cast<char *>(buffer.c_str() - 1);
-				do
-					{
-					into++;
-					if (source->fetch(into, 1) != 1)
-						return nullptr;		// at EOF
-					}
-				while (*into != '\n' && into < end);
-				*into = '\0';
+				in_place->skip(length);
+				return nullptr;		// at EOF
+				}
+			in_place->skip(newline + 1 - start);
+			}
+		else
+			{
+			/*
+				If the line isn't in the buffer then shift the unused part of the buffer to the start and fill the remainder
+			*/
+			while ((newline = reinterpret_cast<const uint8_t *>(memchr(buffer.data() + buffer_used, '\n', buffer_end - buffer_used))) == nullptr)
+				{
+				memmove(buffer.data(), buffer.data() + buffer_used, buffer_end - buffer_used);
+				buffer_end -= buffer_used;
+				buffer_used = 0;
 
 				/*
-					In the case of buffer overflow we read to end of line and start over.  This shouldn't happen very often,
-					but it does happen because there are some very long WARC-Target-URI in the TREC ClueWeb09 collection
-					in documents such as clueweb09-en0000-05-10880 which as a 1486 character WARC-Target-URI!  It also won't
-					affect the string comparison because we're only comparing to the start of the string.
+					There are some very long WARC-Target-URI lines (for example in clueweb09-en0000-05-10880) so if the line fills the buffer we grow it
 				*/
-				if (into == end)
+				if (buffer_end == buffer.size())
+					buffer.resize(buffer.size() * 2);
+
+				size_t got = source->fetch(buffer.data() + buffer_end, buffer.size() - buffer_end);
+				if (got == 0)
 					{
-					do
-						if (source->fetch(into, 1) != 1)
-							return nullptr;		// at EOF
-					while (*into != '\n');
-					continue;		// don't do the string compare because we're out of sync
+					buffer_used = buffer_end = 0;
+					return nullptr;		// at EOF
 					}
+				buffer_end += got;
 				}
-			while (buffer[string_length] != ':');			// check for the ':' in the right place
-		while (buffer.compare(0, string_length, string) != 0);	// now check for the TREC-ID
+			start = buffer.data() + buffer_used;
+			buffer_used = newline + 1 - buffer.data();
+			}
+
+		/*
+			WARC lines end "\r\n" (but some files end them with just "\n")
+		*/
+		end_of_line = reinterpret_cast<const char *>(newline);
+		if (newline > start && *(newline - 1) == '\r')
+			end_of_line--;
+
+		return reinterpret_cast<const char *>(start);
+		}
+
+	/*
+		INSTREAM_DOCUMENT_WARC::READ_PAYLOAD()
+		--------------------------------------
+	*/
+	void instream_document_warc::read_payload(document &object, size_t length)
+		{
+		if (in_place != nullptr)
+			{
+			size_t remaining;
+			uint8_t *payload = const_cast<uint8_t *>(in_place->unread(remaining));
+			length = (std::min)(length, remaining);
+			in_place->skip(length);
+			object.contents = slice(payload, payload + length);
+			return;
+			}
+
+		/*
+			Take what we can from the buffer and read the remainder straight into the document
+		*/
+		uint8_t *payload = reinterpret_cast<uint8_t *>(object.contents_allocator.malloc(length + 1));
+		size_t from_buffer = (std::min)(length, buffer_end - buffer_used);
+		memcpy(payload, buffer.data() + buffer_used, from_buffer);
+		buffer_used += from_buffer;
+		size_t got = from_buffer;
+		if (got < length)
+			got += source->fetch(payload + got, length - got);
+
+		payload[got] = '\0';
+		object.contents = slice(payload, payload + got);
+		}
+
+	/*
+		INSTREAM_DOCUMENT_WARC::SKIP_PAYLOAD()
+		--------------------------------------
+	*/
+	void instream_document_warc::skip_payload(size_t length)
+		{
+		if (in_place != nullptr)
+			{
+			size_t remaining;
+			in_place->unread(remaining);
+			in_place->skip((std::min)(length, remaining));
+			return;
+			}
+
+		/*
+			Skip what is in the buffer, then read the remainder through the buffer (the source is a stream so it must be read)
+		*/
+		size_t from_buffer = (std::min)(length, buffer_end - buffer_used);
+		buffer_used += from_buffer;
+		length -= from_buffer;
+		while (length > 0)
+			{
+			buffer_end = source->fetch(buffer.data(), buffer.size());
+			if (buffer_end == 0)
+				break;		// at EOF
+			buffer_used = (std::min)(length, buffer_end);
+			length -= buffer_used;
+			}
+		}
 
-		return buffer.c_str() + string_length + 1;
+	/*
+		INSTREAM_DOCUMENT_WARC::FIELD()
+		-------------------------------
+	*/
+	const char *instream_document_warc::field(const char *line, const char *end_of_line, const std::string &name, const char *&value_end)
+		{
+		size_t name_length = name.size();
+
+		if (static_cast<size_t>(end_of_line - line) <= name_length || line[name_length] != ':')
+			return nullptr;
+
+		for (size_t which = 0; which < name_length; which++)
+			if (ascii::tolower(line[which]) != ascii::tolower(name[which]))
+				return nullptr;
+
+		const char *value = line + name_length + 1;
+		while (value < end_of_line && ascii::isspace(*value))
+			value++;
+		value_end = end_of_line;
+		while (value_end > value && ascii::isspace(*(value_end - 1)))
+			value_end--;
+
+		return value;
+		}
+
+	/*
+		INSTREAM_DOCUMENT_WARC::SET_PRIMARY_KEY()
+		-----------------------------------------
+	*/
+	void instream_document_warc::set_primary_key(document &object, const char *key, const char *key_end)
+		{
+		if (in_place != nullptr)
+			object.primary_key = slice(const_cast<char *>(key), const_cast<char *>(key_end));
+		else
+			object.primary_key = slice(object.primary_key_allocator, key, key_end);		// the line is about to be overwritten so copy it
 		}
 
 	/*
 		INSTREAM_DOCUMENT_WARC::READ()
 		------------------------------
 	*/
+	static const std::string warc_type = "WARC-Type";						// initialise at program startup
 	static const std::string warc_trec_id = "WARC-TREC-ID";				// initialise at program startup
+	static const std::string warc_record_id = "WARC-Record-ID";			// initialise at program startup
 	static const std::string content_length = "Content-Length"; 		// initialise at program startup
-	
+
 	void instream_document_warc::read(document &object)
 		{
-		const char *filename;
-
-		/*
-			Get and store the filename
-		*/
-		if ((filename = find_string(warc_trec_id)) == NULL)
-			object.primary_key = object.contents = slice();
-		else
+		while (true)
 			{
+			const char *line;
+			const char *end_of_line;
+
 			/*
-				Get the document primary key
+				Find the start of the next record (skipping the blank lines between records)
 			*/
-			while (ascii::isspace(*filename))
-				filename++;
-
-			object.primary_key = slice(object.primary_key_allocator, filename, filename + strlen(filename));
+			do
+				if ((line = get_line(end_of_line)) == nullptr)
+					{
+					object.primary_key = object.contents = slice();
+					return;		// at EOF
+					}
+			while (end_of_line - line < 5 || memcmp(line, "WARC/", 5) != 0);
 
 			/*
-				Get and store the document length
+				Process the header, which ends with a blank line
 			*/
-			const char *file_length;
-			if ((file_length = find_string(content_length)) == NULL)
-				object.primary_key = object.contents = slice();
-			else
+			bool response = false;
+			bool have_trec_id = false;
+			size_t length = 0;
+			object.primary_key = slice();
+			while ((line = get_line(end_of_line)) != nullptr && line != end_of_line)
 				{
-				size_t length = atoll(file_length);
-				char *document = reinterpret_cast<char *>(object.contents_allocator.malloc(length + 1));
+				const char *value;
+				const char *value_end;
 
-				source->fetch(document, length);
-				document[length] = '\0';
-				object.contents = slice(document, document + length);
+				if ((value = field(line, end_of_line, warc_type, value_end)) != nullptr)
+					response = value_end - value == 8 && memcmp(value, "response", 8) == 0;
+				else if ((value = field(line, end_of_line, warc_trec_id, value_end)) != nullptr)
+					{
+					set_primary_key(object, value, value_end);
+					have_trec_id = true;
+					}
+				else if ((value = field(line, end_of_line, warc_record_id, value_end)) != nullptr)
+					{
+					if (!have_trec_id)
+						set_primary_key(object, value, value_end);
+					}
+				else if ((value = field(line, end_of_line, content_length, value_end)) != nullptr)
+					length = strtoull(value, nullptr, 10);
+				}
+
+			if (line == nullptr)
+				{
+				object.primary_key = object.contents = slice();
+				return;		// at EOF (in the middle of a header)
+				}
+
+			/*
+				Return the payload of a response record, and skip over the payload of anything else
+			*/
+			if (response && length != 0)
+				{
+				read_payload(object, length);
+				if (object.primary_key.size() == 0)
+					object.primary_key = slice(object.primary_key_allocator, "Unknown");
+				return;
 				}
+
+			skip_payload(length);
 			}
 		}
 
@@ -149,6 +293,18 @@ namespace JASS
 			"HTTP/1.1\n"
 			"\n"
 			"\n"
+			"WARC/1.0\r\n"
+			"WARC-Type: request\r\n"
+			"WARC-TREC-ID: not-a-document\r\n"
+			"Content-Length: 54\r\n"
+			"\r\n"
+			"WARC/1.0\r\n"
+			"WARC-Type: response\r\n"
+			"Content-Length: 2\r\n"
+			"\r\n"
+			"no"
+			"\r\n"
+			"\r\n"
 			"WARC/1.0\n"
 			"WARC-Type: response\n"
 			"WARC-Date: 2012-02-10T21:49:12Z\n"
@@ -166,33 +322,39 @@ namespace JASS
 		/*
 			The correct documents
 		*/
-		const char *first_answer = "\nHTTP/1.1";
+		const char *first_answer = "HTTP/1.1\n";
 		const char *first_key = "clueweb12-0000tw-00-00013";
-		const char *second_answer = "\nHTTP/1.1 200 OK";
+		const char *second_answer = "HTTP/1.1 200 OK\n";
 		const char *second_key = "clueweb12-0000tw-00-00027";
 
 		/*
-			set up a reader from memory
+			Set up a reader from memory (which reads in place), and readers that read from memory through another instream (which copy),
+			one of which has a buffer smaller than a line (and a document) so the buffer is refilled and grown.
 		*/
-		std::shared_ptr<instream> source(new instream_memory(example_file.c_str(), example_file.size()));
-		instream_document_warc getter(source);
+		for (size_t buffer_size : {size_t(0), WARC_BUFFER_SIZE, size_t(16)})
+			{
+			std::shared_ptr<instream> source(new instream_memory(example_file.c_str(), example_file.size()));
+			if (buffer_size != 0)
+				source.reset(new instream_read_ahead(source, 7, 2));
+			instream_document_warc getter(source, buffer_size);
 
-		/*
-			Extract 2 documents to make sure we get the right answers
-		*/
-		document doc;
-		getter.read(doc);
-		JASS_assert(strncmp(reinterpret_cast<char *>(doc.primary_key.address()), first_key, strlen(first_key)) == 0);
-		JASS_assert(strncmp(reinterpret_cast<char *>(doc.contents.address()), first_answer, strlen(first_answer)) == 0);
-		getter.read(doc);
-		JASS_assert(strncmp(reinterpret_cast<char *>(doc.primary_key.address()), second_key, strlen(second_key)) == 0);
-		JASS_assert(strncmp(reinterpret_cast<char *>(doc.contents.address()), second_answer, strlen(second_answer)) == 0);
+			/*
+				Extract 2 documents to make sure we get the right answers (and skip the request record between them)
+			*/
+			document doc;
+			getter.read(doc);
+			JASS_assert(std::string(reinterpret_cast<char *>(doc.primary_key.address()), doc.primary_key.size()) == first_key);
+			JASS_assert(std::string(reinterpret_cast<char *>(doc.contents.address()), doc.contents.size()) == first_answer);
+			getter.read(doc);
+			JASS_assert(std::string(reinterpret_cast<char *>(doc.primary_key.address()), doc.primary_key.size()) == second_key);
+			JASS_assert(std::string(reinterpret_cast<char *>(doc.contents.address()), doc.contents.size()) == second_answer);
 
-		/*
-			Make sure we can mark EOF correctly
-		*/
-		getter.read(doc);
-		JASS_assert(doc.isempty());
+			/*
+				Make sure we can mark EOF correctly
+			*/
+			getter.read(doc);
+			JASS_assert(doc.isempty());
+			}
 
 		/*
 			Success
@@ -13,7 +13,11 @@
 
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include "instream.h"
+#include "instream_memory.h"
 
 namespace JASS
 	{
@@ -23,26 +27,81 @@ namespace JASS
 	*/
 	/*!
 		@brief Extract documents from a WARC archive
+		@details Each WARC record is a header (a WARC/ version line then "name: value" lines up to a blank line) followed by
+		Content-Length bytes of payload.  The payload of each response record is returned as a document, with the WARC-TREC-ID
+		as its primary key (or the WARC-Record-ID if there is no WARC-TREC-ID).  The payloads of all other records (warcinfo,
+		request, metadata, and so on) are skipped over without being copied into the document.  The source is read through a
+		fixed size buffer, so memory use is bounded by the buffer and the largest document.
 	*/
 	class instream_document_warc : public instream
 		{
+		public:
+			static constexpr size_t WARC_BUFFER_SIZE = 1024 * 1024;		///< The default size of the internal buffer the source is read through (it grows if a header line is longer)
+
 		private:
-			static constexpr size_t WARC_BUFFER_SIZE = 8 * 1024;		///< The internal buffer used to read lines one at a time
-			
-		private:
-			std::string buffer;													///< An internal buffer used to store lines
-			
+			std::vector<uint8_t> buffer;										///< An internal buffer the source is read through
+			size_t buffer_used;													///< The number of bytes at the start of buffer that have been used
+			size_t buffer_end;													///< The number of bytes in buffer
+			instream_memory *in_place;											///< If the source is in memory then it, and documents are read in place, else nullptr
+
 		private:
 			/*
-				INSTREAM_DOCUMENT_WARC::FIND_STRING()
-				-------------------------------------
+				INSTREAM_DOCUMENT_WARC::GET_LINE()
+				----------------------------------
+			*/
+			/*!
+				@brief Get the next line from the source.
+				@param end_of_line [out] The end of the line (without the '\n', or the '\r' before it).
+				@return The start of the line (valid until the next call to a method of this object), or nullptr at EOF.
+			*/
+			const char *get_line(const char *&end_of_line);
+
+			/*
+				INSTREAM_DOCUMENT_WARC::READ_PAYLOAD()
+				--------------------------------------
+			*/
+			/*!
+				@brief Read (or, if the source is in memory, point to) the next bytes of the source.
+				@param object [out] The document to read into.
+				@param length [in] The number of bytes to read.
+			*/
+			void read_payload(document &object, size_t length);
+
+			/*
+				INSTREAM_DOCUMENT_WARC::SKIP_PAYLOAD()
+				--------------------------------------
+			*/
+			/*!
+				@brief Skip over the next bytes of the source.
+				@param length [in] The number of bytes to skip.
+			*/
+			void skip_payload(size_t length);
+
+			/*
+				INSTREAM_DOCUMENT_WARC::FIELD()
+				-------------------------------
+			*/
+			/*!
+				@brief If a header line is the given field then return its value.
+				@param line [in] The header line.
+				@param end_of_line [in] The end of the header line.
+				@param name [in] The name of the field (compared case-insensitively, as WARC field names are).
+				@param value_end [out] The end of the value (trailing whitespace removed).
+				@return The start of the value (leading whitespace removed), or nullptr if the line is not the field.
+			*/
+			static const char *field(const char *line, const char *end_of_line, const std::string &name, const char *&value_end);
+
+			/*
+				INSTREAM_DOCUMENT_WARC::SET_PRIMARY_KEY()
+				-----------------------------------------
 			*/
 			/*!
-				@brief read lines from the WARC file until one starting with string is found.
-				@param string [in] the string to look for (at the start of a line)
-				@return a pointer to the remainder of the string
+				@brief Set the primary key of the document (the WARC-TREC-ID or the WARC-Record-ID).
+				@param object [out] The document.
+				@param key [in] The start of the primary key.
+				@param key_end [in] The end of the primary key.
 			*/
-			const char *find_string(const std::string &string);
+			void set_primary_key(document &object, const char *key, const char *key_end);
 
 		public:
 			/*
@@ -51,11 +110,19 @@ namespace JASS
 			*/
 			/*!
 				@brief Constructor
+				@details If the source is an instream_memory (or an instream_file_mmap) then the documents are found in the source's
+				memory and the document and primary key returned by read() point into that memory (rather than being copied).
+				@param source [in] The instream to read the WARC file from.
+				@param buffer_size [in] The initial size of the internal buffer (if not reading in place).
 			*/
-			instream_document_warc(std::shared_ptr<instream> &source) :
-				instream(source)
+			instream_document_warc(std::shared_ptr<instream> &source, size_t buffer_size = WARC_BUFFER_SIZE) :
+				instream(source),
+				buffer_used(0),
+				buffer_end(0),
+				in_place(dynamic_cast<instream_memory *>(source.get()))
 				{
-				buffer.resize(WARC_BUFFER_SIZE);
+				if (in_place == nullptr)
+					buffer.resize(buffer_size == 0 ? 1 : buffer_size);
 				}
 
 			/*
@@ -0,0 +1,121 @@
+/*
+	INSTREAM_FILE_MMAP.H
+	--------------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Subclass of instream_memory for reading from a memory mapped disk file.
+	@author Andrew Trotman
+	@copyright 2021 Andrew Trotman
+*/
+#pragma once
+
+#include <string.h>
+
+#include "file.h"
+#include "asserts.h"
+#include "instream_memory.h"
+
+namespace JASS
+	{
+	/*
+		CLASS INSTREAM_FILE_MMAP
+		------------------------
+	*/
+	/*!
+		@brief Subclass of instream_memory for reading from a memory mapped disk file.
+		@details The file is mapped for sequential access (see file::file_read_only::access_pattern) so the kernel reads ahead
+		of the reader and the file need not fit in memory.  Document readers that know about instream_memory (for example
+		instream_document_trec and instream_document_warc) return documents that point directly into the mapped file rather
+		than copying them, and those documents remain valid for the lifetime of this object.  Other readers can use this as
+		they would an instream_file.
+	*/
+	class instream_file_mmap : public instream_memory
+		{
+		protected:
+			file::file_read_only mapping;				///< The memory mapped file
+
+		public:
+			/*
+				INSTREAM_FILE_MMAP::INSTREAM_FILE_MMAP()
+				----------------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param filename [in] The name of the file to use as the input stream
+			*/
+			instream_file_mmap(const std::string &filename) :
+				instream_memory(nullptr, 0)
+				{
+				file_length = mapping.open(filename, file::file_read_only::sequential);
+				mapping.read_entire_file(file);
+				}
+
+			/*
+				INSTREAM_FILE_MMAP::~INSTREAM_FILE_MMAP()
+				-----------------------------------------
+			*/
+			/*!
+				@brief Destructor.
+			*/
+			virtual ~instream_file_mmap()
+				{
+				/* Nothing */
+				}
+
+			/*
+				INSTREAM_FILE_MMAP::UNITTEST()
+				------------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void)
+				{
+				const char *example_file = "123456789012345678901234567890";			// sample to be written and read back
+
+				auto filename = file::mkstemp("jass");
+				file::write_entire_file(filename, example_file);
+
+				/*
+					NOTE: The scope is created so that the object is deleted before removal of the temporary file.
+				*/
+				do
+					{
+					instream_file_mmap reader(filename);
+
+					/*
+						Read in place
+					*/
+					size_t length;
+					const uint8_t *unread = reader.unread(length);
+					JASS_assert(length == 30);
+					JASS_assert(memcmp(unread, example_file, length) == 0);
+					reader.skip(10);
+
+					/*
+						Read by copying
+					*/
+					char into[16];
+					JASS_assert(reader.fetch(into, sizeof(into)) == 16);
+					JASS_assert(memcmp(into, example_file + 10, 16) == 0);
+					JASS_assert(reader.fetch(into, sizeof(into)) == 4);
+					JASS_assert(memcmp(into, example_file + 26, 4) == 0);
+					JASS_assert(reader.fetch(into, sizeof(into)) == 0);
+
+					reader.unread(length);
+					JASS_assert(length == 0);
+					}
+				while (0);
+
+				(void)remove(filename.c_str());			// delete the file.  Cast to void to remove Coverity warning if remove() fails.
+
+				/*
+					Yay, we passed
+				*/
+				puts("instream_file_mmap::PASSED");
+				}
+		};
+	}
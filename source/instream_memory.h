@@ -59,6 +59,34 @@ namespace JASS
 				@param buffer [out] buffer.contents.size() bytes of data are read from source into buffer which is resized to the number of bytes read on eof.
 			*/
 			virtual void read(document &buffer);
+
+			/*
+				INSTREAM_MEMORY::UNREAD()
+				-------------------------
+			*/
+			/*!
+				@brief Return the data that has not yet been read, without copying it (for readers that can use it in place).
+				@param length [out] The number of bytes that have not yet been read.
+				@return A pointer to the unread data (valid for the lifetime of this object).
+			*/
+			const uint8_t *unread(size_t &length) const
+				{
+				length = bytes_read < file_length ? file_length - bytes_read : 0;
+				return file + (bytes_read < file_length ? bytes_read : file_length);
+				}
+
+			/*
+				INSTREAM_MEMORY::SKIP()
+				-----------------------
+			*/
+			/*!
+				@brief Mark some of the unread data as read (having been used in place, see unread()).
+				@param bytes [in] The number of bytes to skip.
+			*/
+			void skip(size_t bytes)
+				{
+				bytes_read += bytes;
+				}
 			
 			/*
 				INSTREAM_MEMORY::UNITTEST()
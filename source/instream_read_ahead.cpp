@@ -0,0 +1,209 @@
+/*
+	INSTREAM_READ_AHEAD.CPP
+	-----------------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <string.h>
+
+#include <random>
+
+#include "asserts.h"
+#include "instream_memory.h"
+#include "instream_read_ahead.h"
+
+namespace JASS
+	{
+	/*
+		INSTREAM_READ_AHEAD::INSTREAM_READ_AHEAD()
+		------------------------------------------
+	*/
+	instream_read_ahead::instream_read_ahead(std::shared_ptr<instream> &source, size_t buffer_size, size_t buffers) :
+		instream(source),
+		buffer(buffers < 2 ? 2 : buffers, std::vector<uint8_t>(buffer_size == 0 ? 1 : buffer_size)),
+		buffer_length(buffer.size(), 0),
+		buffers_full(0),
+		consumer_buffer(0),
+		consumer_offset(0),
+		reader_buffer(0),
+		stop(false)
+		{
+		reader.reset(new thread(&instream_read_ahead::read_source, this));
+		}
+
+	/*
+		INSTREAM_READ_AHEAD::~INSTREAM_READ_AHEAD()
+		-------------------------------------------
+	*/
+	instream_read_ahead::~instream_read_ahead()
+		{
+		do
+			{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+			}
+		while (0);
+		changed.notify_all();
+		reader->join();
+		}
+
+	/*
+		INSTREAM_READ_AHEAD::READ_SOURCE()
+		----------------------------------
+	*/
+	void instream_read_ahead::read_source(void)
+		{
+		while (true)
+			{
+			/*
+				Wait for an empty buffer
+			*/
+			do
+				{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [this](){ return stop || buffers_full < buffer.size(); });
+				if (stop)
+					return;
+				}
+			while (0);
+
+			/*
+				Fill it.  The consumer does not look at this buffer until buffers_full says it is full, so this is done without the lock
+			*/
+			size_t got = source->fetch(&buffer[reader_buffer][0], buffer[reader_buffer].size());
+			buffer_length[reader_buffer] = got;
+			reader_buffer = (reader_buffer + 1) % buffer.size();
+
+			do
+				{
+				std::lock_guard<std::mutex> lock(mutex);
+				buffers_full++;
+				}
+			while (0);
+			changed.notify_all();
+
+			/*
+				An empty buffer marks EOF, and there is nothing more to read
+			*/
+			if (got == 0)
+				return;
+			}
+		}
+
+	/*
+		INSTREAM_READ_AHEAD::READ()
+		---------------------------
+	*/
+	void instream_read_ahead::read(document &document)
+		{
+		size_t wanted = document.contents.size();
+		size_t got = 0;
+
+		while (got < wanted)
+			{
+			/*
+				Wait for the reader to fill the buffer we're reading from
+			*/
+			do
+				{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [this](){ return buffers_full > 0; });
+				}
+			while (0);
+
+			/*
+				If we're at EOF then we stay at EOF (the empty buffer is never released)
+			*/
+			size_t length = buffer_length[consumer_buffer];
+			if (length == 0)
+				break;
+
+			/*
+				Copy what we can from this buffer
+			*/
+			size_t bytes = (std::min)(wanted - got, length - consumer_offset);
+			memcpy(&document.contents[got], &buffer[consumer_buffer][consumer_offset], bytes);
+			got += bytes;
+			consumer_offset += bytes;
+
+			/*
+				If we've finished with this buffer then give it back to the reader
+			*/
+			if (consumer_offset == length)
+				{
+				consumer_offset = 0;
+				consumer_buffer = (consumer_buffer + 1) % buffer.size();
+				do
+					{
+					std::lock_guard<std::mutex> lock(mutex);
+					buffers_full--;
+					}
+				while (0);
+				changed.notify_all();
+				}
+			}
+
+		if (got < wanted)
+			document.contents.resize(got);
+		}
+
+	/*
+		INSTREAM_READ_AHEAD::UNITTEST()
+		-------------------------------
+	*/
+	void instream_read_ahead::unittest(void)
+		{
+		/*
+			Some data that is not a multiple of either the buffer size or the read size
+		*/
+		std::vector<uint8_t> example(100'003);
+		std::mt19937 random(1);
+		for (auto &byte : example)
+			byte = static_cast<uint8_t>(random());
+
+		/*
+			Read with reads smaller than, and larger than, the buffers
+		*/
+		for (size_t read_size : {777, 2500})
+			{
+			std::shared_ptr<instream> memory(new instream_memory(&example[0], example.size()));
+			instream_read_ahead reader(memory, 1000, 2);
+
+			std::vector<uint8_t> into(read_size);
+			size_t at = 0;
+			while (true)
+				{
+				size_t got = reader.fetch(&into[0], into.size());
+				if (got == 0)
+					break;
+				JASS_assert(got == read_size || at + got == example.size());
+				JASS_assert(memcmp(&into[0], &example[at], got) == 0);
+				at += got;
+				}
+			JASS_assert(at == example.size());
+
+			/*
+				Make sure we stay at EOF
+			*/
+			JASS_assert(reader.fetch(&into[0], into.size()) == 0);
+			}
+
+		/*
+			Destroy the object before reading the whole stream (the reader thread must stop)
+		*/
+		do
+			{
+			std::shared_ptr<instream> memory(new instream_memory(&example[0], example.size()));
+			instream_read_ahead reader(memory, 100, 3);
+			uint8_t into[10];
+			JASS_assert(reader.fetch(into, sizeof(into)) == sizeof(into));
+			JASS_assert(memcmp(into, &example[0], sizeof(into)) == 0);
+			}
+		while (0);
+
+		/*
+			Yay, we passed
+		*/
+		puts("instream_read_ahead::PASSED");
+		}
+	}
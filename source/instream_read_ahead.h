@@ -0,0 +1,106 @@
+/*
+	INSTREAM_READ_AHEAD.H
+	---------------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Subclass of instream that reads ahead from its source on a background thread.
+	@author Andrew Trotman
+	@copyright 2021 Andrew Trotman
+*/
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <condition_variable>
+
+#include "threads.h"
+#include "instream.h"
+
+namespace JASS
+	{
+	/*
+		CLASS INSTREAM_READ_AHEAD
+		-------------------------
+	*/
+	/*!
+		@brief Subclass of instream that reads ahead from its source on a background thread.
+		@details The source (for example an instream_file or an instream_deflate) is read into a ring of buffers by a thread that
+		is started by the constructor.  While the consumer (for example an instream_document_trec) is using one buffer the thread
+		is filling the others, so the consumer does not wait on disk reads or on decompression unless it is faster than they are.
+		This object can be placed between any two parts of an instream pipeline, for example read_file | read_ahead | de-zip |
+		read_ahead | parse_trec.  The source must not be read by any other object.
+	*/
+	class instream_read_ahead : public instream
+		{
+		public:
+			static constexpr size_t default_buffer_size = 16 * 1024 * 1024;		///< The default size of each buffer (in bytes)
+			static constexpr size_t default_buffers = 3;								///< The default number of buffers (triple buffering)
+
+		private:
+			std::vector<std::vector<uint8_t>> buffer;	///< The ring of buffers
+			std::vector<size_t> buffer_length;			///< The number of bytes in each buffer (0 means the source is at EOF)
+			size_t buffers_full;								///< The number of buffers the reader has filled that the consumer has not finished with
+			size_t consumer_buffer;							///< The buffer the consumer is reading from
+			size_t consumer_offset;							///< The consumer's position in consumer_buffer
+			size_t reader_buffer;							///< The next buffer the reader will fill
+			bool stop;											///< Set by the destructor to tell the reader to finish
+			std::mutex mutex;									///< Guards buffers_full and stop
+			std::condition_variable changed;				///< Signalled when a buffer is filled or emptied (or stop is set)
+			std::unique_ptr<thread> reader;				///< The thread that reads from source
+
+		private:
+			/*
+				INSTREAM_READ_AHEAD::READ_SOURCE()
+				----------------------------------
+			*/
+			/*!
+				@brief The reader thread, fill buffers from the source until it is at EOF or the destructor is called.
+			*/
+			void read_source(void);
+
+		public:
+			/*
+				INSTREAM_READ_AHEAD::INSTREAM_READ_AHEAD()
+				------------------------------------------
+			*/
+			/*!
+				@brief Constructor.  Start reading from source.
+				@param source [in] The instream to read ahead from.
+				@param buffer_size [in] The size of each buffer (in bytes).
+				@param buffers [in] The number of buffers (at least 2).
+			*/
+			instream_read_ahead(std::shared_ptr<instream> &source, size_t buffer_size = default_buffer_size, size_t buffers = default_buffers);
+
+			/*
+				INSTREAM_READ_AHEAD::~INSTREAM_READ_AHEAD()
+				-------------------------------------------
+			*/
+			/*!
+				@brief Destructor.  Stop the reader thread (once it finishes its current read from source).
+			*/
+			virtual ~instream_read_ahead();
+
+			/*
+				INSTREAM_READ_AHEAD::READ()
+				---------------------------
+			*/
+			/*!
+				@brief Read buffer.contents.size() bytes of data into buffer.contents, resizing on eof.
+				@param buffer [out] buffer.contents.size() bytes of data are read from source into buffer which is resized to the number of bytes read on eof.
+			*/
+			virtual void read(document &buffer);
+
+			/*
+				INSTREAM_READ_AHEAD::UNITTEST()
+				-------------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+	}
@@ -0,0 +1,181 @@
+/*
+	INSTRUCTION_SET.H
+	-----------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Choose, at run time, the widest SIMD instruction set to use for the kernels that have more than one implementation.
+	@author Andrew Trotman
+	@copyright 2021 Andrew Trotman
+*/
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "asserts.h"
+#include "hardware_support.h"
+
+/*
+	JASS_TARGET_AVX512 marks a function as being compiled for AVX-512 even when the rest of the program is not (see instruction_set).
+	Visual Studio allows any intrinsic in any function so it needs no marking.
+*/
+#ifdef _MSC_VER
+	#define JASS_TARGET_AVX512
+#else
+	#define JASS_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl,avx2,bmi,bmi2,popcnt,lzcnt")))
+#endif
+
+namespace JASS
+	{
+	/*
+		CLASS INSTRUCTION_SET
+		---------------------
+	*/
+	/*!
+		@brief The widest SIMD instruction set that the kernels with more than one implementation should use.
+		@details JASS is compiled for AVX2 (with -march=native, or for any AVX2 CPU when built with -DJASS_PORTABLE=1).  The hot
+		kernels that have an AVX-512 implementation (the cumulative sum in simd and the SIMD Elias codecs) compile that version with
+		JASS_TARGET_AVX512 whatever the build flags, and call it only if current() is AVX512.  That is decided once, the first time
+		it is asked, from the CPU (and the operating system's support for the AVX-512 registers).  Setting the environment variable
+		JASS_INSTRUCTION_SET to "avx2" stops the use of AVX-512 on a CPU that has it.
+	*/
+	class instruction_set
+		{
+		public:
+			/*!
+				@enum level
+				@brief The instruction sets, from narrowest to widest.
+			*/
+			enum level
+				{
+				AVX2 = 0,		///< 256-bit AVX2 (the minimum JASS runs on)
+				AVX512 = 1		///< 512-bit AVX-512 (F, BW, DQ and VL)
+				};
+
+		private:
+			/*
+				INSTRUCTION_SET::OPERATING_SYSTEM_SAVES_AVX512()
+				------------------------------------------------
+			*/
+			/*!
+				@brief Does the operating system save the AVX-512 registers on a context switch (and so allow their use)?
+				@return true if the opmask and all 512 bits of the 32 ZMM registers are enabled in XCR0.
+			*/
+			static bool operating_system_saves_avx512(void)
+				{
+#ifdef _MSC_VER
+				uint64_t xcr0 = _xgetbv(0);
+#else
+				uint32_t eax;
+				uint32_t edx;
+				__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+				uint64_t xcr0 = (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+				return (xcr0 & 0xE6) == 0xE6;			// SSE, AVX, opmask, ZMM0-15 high halves, ZMM16-31
+				}
+
+			/*
+				INSTRUCTION_SET::DETECT()
+				-------------------------
+			*/
+			/*!
+				@brief Work out the widest instruction set the CPU (and operating system) supports, unless told otherwise by JASS_INSTRUCTION_SET.
+				@return The instruction set to use.
+			*/
+			static level detect(void)
+				{
+				const char *requested = getenv("JASS_INSTRUCTION_SET");
+				if (requested != nullptr && ::strcmp(requested, "avx2") == 0)
+					return AVX2;
+
+				hardware_support cpu;
+				if (cpu.OSXSAVE && cpu.AVX512F && cpu.AVX512BW && cpu.AVX512DQ && cpu.AVX512VL && operating_system_saves_avx512())
+					return AVX512;
+
+				return AVX2;
+				}
+
+			/*
+				INSTRUCTION_SET::CHOICE()
+				-------------------------
+			*/
+			/*!
+				@brief Return a reference to the current choice of instruction set (detected on the first call).
+				@return The current choice.
+			*/
+			static level &choice(void)
+				{
+				static level chosen = detect();
+				return chosen;
+				}
+
+		public:
+			/*
+				INSTRUCTION_SET::CURRENT()
+				--------------------------
+			*/
+			/*!
+				@brief Return the instruction set that the kernels should use.
+				@return The widest instruction set to use.
+			*/
+			static level current(void)
+				{
+				return choice();
+				}
+
+			/*
+				INSTRUCTION_SET::SET()
+				----------------------
+			*/
+			/*!
+				@brief Change the instruction set that the kernels use (normally only for testing).  Asking for a wider instruction set than the CPU supports has no effect.
+				@param which [in] The instruction set to use.
+				@return The instruction set that will now be used.
+			*/
+			static level set(level which)
+				{
+				level widest = detect();
+				choice() = which <= widest ? which : widest;
+				return choice();
+				}
+
+			/*
+				INSTRUCTION_SET::NAME()
+				-----------------------
+			*/
+			/*!
+				@brief Return the name of an instruction set.
+				@param which [in] The instruction set.
+				@return Its name (as used in JASS_INSTRUCTION_SET).
+			*/
+			static const char *name(level which)
+				{
+				return which == AVX512 ? "avx512" : "avx2";
+				}
+
+			/*
+				INSTRUCTION_SET::UNITTEST()
+				---------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void)
+				{
+				level original = current();
+
+				JASS_assert(set(AVX2) == AVX2);
+				JASS_assert(current() == AVX2);
+				JASS_assert(::strcmp(name(AVX2), "avx2") == 0);
+
+				set(original);
+				JASS_assert(current() == original);
+
+				puts("instruction_set::PASSED");
+				}
+		};
+	}
@@ -0,0 +1,106 @@
+/*
+	PRIMARY_KEY_LIST.CPP
+	--------------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <string.h>
+
+#include "asserts.h"
+#include "primary_key_list.h"
+
+namespace JASS
+	{
+	/*
+		PRIMARY_KEY_LIST::PRIMARY_KEY_LIST()
+		------------------------------------
+	*/
+	primary_key_list::primary_key_list(const std::vector<std::string> &from) :
+		primary_key_list()
+		{
+		/*
+			Lay the keys out as they are in CIdoclist.bin, then point at them
+		*/
+		std::vector<uint64_t> key_offsets;
+		for (const auto &key : from)
+			{
+			key_offsets.push_back(storage.size());
+			storage.append(key.c_str(), key.size() + 1);
+			}
+
+		uint64_t count = from.size();
+		storage.append(reinterpret_cast<const char *>(key_offsets.data()), key_offsets.size() * sizeof(uint64_t));
+		storage.append(reinterpret_cast<const char *>(&count), sizeof(count));
+
+		read(reinterpret_cast<const uint8_t *>(storage.data()), storage.size());
+		}
+
+	/*
+		PRIMARY_KEY_LIST::READ()
+		------------------------
+	*/
+	size_t primary_key_list::read(const uint8_t *memory, size_t bytes)
+		{
+		keys = offsets = nullptr;
+		documents = 0;
+
+		/*
+			The number of documents is stored at the end of the file (as a uint64_t) and the offsets of the keys are just before it
+		*/
+		uint64_t count;
+		if (bytes < sizeof(count))
+			return 0;
+		memcpy(&count, memory + bytes - sizeof(count), sizeof(count));
+		if (count > (bytes - sizeof(count)) / sizeof(uint64_t))
+			return 0;
+
+		keys = memory;
+		offsets = memory + bytes - sizeof(count) - count * sizeof(uint64_t);
+		documents = count;
+
+		return documents;
+		}
+
+	/*
+		PRIMARY_KEY_LIST::UNITTEST()
+		----------------------------
+	*/
+	void primary_key_list::unittest(void)
+		{
+		/*
+			Keys of odd lengths so that the offsets are not aligned
+		*/
+		std::vector<std::string> keys = {"zero", "one", "", "three", "WSJ870324-0001"};
+		primary_key_list list(keys);
+		JASS_assert(list.size() == keys.size());
+		for (size_t which = 0; which < keys.size(); which++)
+			JASS_assert(list[which] == keys[which]);
+
+		size_t which = 0;
+		for (const auto key : list)
+			JASS_assert(key == keys[which++]);
+		JASS_assert(which == keys.size());
+
+		/*
+			Read a CIdoclist.bin without copying it
+		*/
+		std::string doclist(reinterpret_cast<const char *>(list.keys), list.offsets + list.size() * sizeof(uint64_t) + sizeof(uint64_t) - list.keys);
+		primary_key_list view;
+		JASS_assert(view.read(reinterpret_cast<const uint8_t *>(doclist.data()), doclist.size()) == keys.size());
+		JASS_assert(view[4] == "WSJ870324-0001");
+		JASS_assert(view[4].data() == doclist.data() + 16);
+
+		/*
+			Files that are too short
+		*/
+		JASS_assert(view.read(reinterpret_cast<const uint8_t *>(doclist.data()), 4) == 0);
+		JASS_assert(view.size() == 0);
+		JASS_assert(view.read(reinterpret_cast<const uint8_t *>(doclist.data()) + doclist.size() - 16, 16) == 0);
+
+		primary_key_list empty(std::vector<std::string>{});
+		JASS_assert(empty.size() == 0);
+		JASS_assert(!(empty.begin() != empty.end()));
+
+		puts("primary_key_list::PASSED");
+		}
+	}
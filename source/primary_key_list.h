@@ -0,0 +1,237 @@
+/*
+	PRIMARY_KEY_LIST.H
+	------------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief The list of document primary keys, read directly from CIdoclist.bin (without copying).
+	@author Andrew Trotman
+	@copyright 2021 Andrew Trotman
+*/
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+#include <string_view>
+
+namespace JASS
+	{
+	/*
+		CLASS PRIMARY_KEY_LIST
+		----------------------
+	*/
+	/*!
+		@brief The list of document primary keys, read directly from CIdoclist.bin (without copying).
+		@details CIdoclist.bin is the '\0' terminated primary keys, then the uint64_t offset (from the start of the file) of each, then
+		the uint64_t number of documents (see serialise_jass_v1).  Rather than copying each key into a std::string when the index is loaded
+		(one allocation per document), this class keeps a pointer to the file (which is in memory) and looks up the offset of a key when
+		it is asked for, returning it as a std::string_view.  The memory must outlive the list.  A list can also be built from a vector of
+		strings, in which case it holds its own copy of the keys (in the same format).
+	*/
+	class primary_key_list
+		{
+		public:
+			/*
+				CLASS PRIMARY_KEY_LIST::ITERATOR
+				--------------------------------
+			*/
+			/*!
+				@brief Iterate over the primary keys, in document order.
+			*/
+			class iterator
+				{
+				private:
+					const primary_key_list &parent;			///< The list being iterated over
+					size_t where;									///< The current document
+
+				public:
+					/*
+						PRIMARY_KEY_LIST::ITERATOR::ITERATOR()
+						--------------------------------------
+					*/
+					/*!
+						@brief Constructor
+						@param parent [in] The list being iterated over.
+						@param where [in] The document to start at.
+					*/
+					iterator(const primary_key_list &parent, size_t where) :
+						parent(parent),
+						where(where)
+						{
+						/* Nothing */
+						}
+
+					/*
+						PRIMARY_KEY_LIST::ITERATOR::OPERATOR!=()
+						----------------------------------------
+					*/
+					/*!
+						@brief Compare two iterators
+						@param with [in] The iterator to compare to.
+						@return true if they are different, else false.
+					*/
+					bool operator!=(const iterator &with) const
+						{
+						return where != with.where;
+						}
+
+					/*
+						PRIMARY_KEY_LIST::ITERATOR::OPERATOR++()
+						----------------------------------------
+					*/
+					/*!
+						@brief Move on to the next primary key
+						@return The iterator.
+					*/
+					iterator &operator++(void)
+						{
+						where++;
+						return *this;
+						}
+
+					/*
+						PRIMARY_KEY_LIST::ITERATOR::OPERATOR*()
+						---------------------------------------
+					*/
+					/*!
+						@brief Return the current primary key
+						@return The primary key.
+					*/
+					std::string_view operator*(void) const
+						{
+						return parent[where];
+						}
+				};
+
+		private:
+			std::string storage;				///< The keys when built from a vector of strings (in the format of CIdoclist.bin), else empty
+			const uint8_t *keys;				///< The start of CIdoclist.bin (the offsets are from here)
+			const uint8_t *offsets;			///< The (possibly unaligned) uint64_t offset of each primary key
+			size_t documents;					///< The number of primary keys in the list
+
+		public:
+			/*
+				PRIMARY_KEY_LIST::PRIMARY_KEY_LIST()
+				------------------------------------
+			*/
+			/*!
+				@brief Constructor (of an empty list)
+			*/
+			primary_key_list() :
+				keys(nullptr),
+				offsets(nullptr),
+				documents(0)
+				{
+				/* Nothing */
+				}
+
+			/*
+				PRIMARY_KEY_LIST::PRIMARY_KEY_LIST()
+				------------------------------------
+			*/
+			/*!
+				@brief Constructor (of a list holding a copy of the given keys)
+				@param from [in] The primary keys, in document order.
+			*/
+			explicit primary_key_list(const std::vector<std::string> &from);
+
+			/*
+				PRIMARY_KEY_LIST::PRIMARY_KEY_LIST()
+				------------------------------------
+			*/
+			/*!
+				@brief The list points into itself so it cannot be copied.
+			*/
+			primary_key_list(const primary_key_list &) = delete;
+
+			/*
+				PRIMARY_KEY_LIST::OPERATOR=()
+				-----------------------------
+			*/
+			/*!
+				@brief The list points into itself so it cannot be copied.
+			*/
+			primary_key_list &operator=(const primary_key_list &) = delete;
+
+			/*
+				PRIMARY_KEY_LIST::READ()
+				------------------------
+			*/
+			/*!
+				@brief Point the list at the contents of CIdoclist.bin (which is not copied and must outlive the list).
+				@param memory [in] The contents of CIdoclist.bin.
+				@param bytes [in] The length of CIdoclist.bin.
+				@return The number of documents in the list, or 0 if the file is too short to be a CIdoclist.bin.
+			*/
+			size_t read(const uint8_t *memory, size_t bytes);
+
+			/*
+				PRIMARY_KEY_LIST::SIZE()
+				------------------------
+			*/
+			/*!
+				@brief Return the number of primary keys in the list.
+				@return The number of documents.
+			*/
+			size_t size(void) const
+				{
+				return documents;
+				}
+
+			/*
+				PRIMARY_KEY_LIST::OPERATOR[]()
+				------------------------------
+			*/
+			/*!
+				@brief Return the primary key of a document.
+				@param document_id [in] The document (counting from 0 in the order the keys are stored in CIdoclist.bin).
+				@return The primary key (which points into CIdoclist.bin).
+			*/
+			std::string_view operator[](size_t document_id) const
+				{
+				uint64_t offset;
+				memcpy(&offset, offsets + document_id * sizeof(uint64_t), sizeof(offset));
+				return std::string_view(reinterpret_cast<const char *>(keys + offset));
+				}
+
+			/*
+				PRIMARY_KEY_LIST::BEGIN()
+				-------------------------
+			*/
+			/*!
+				@brief Return an iterator pointing to the first primary key.
+				@return Iterator pointing to the start of the list.
+			*/
+			iterator begin(void) const
+				{
+				return iterator(*this, 0);
+				}
+
+			/*
+				PRIMARY_KEY_LIST::END()
+				-----------------------
+			*/
+			/*!
+				@brief Return an iterator pointing past the last primary key.
+				@return Iterator pointing past the end of the list.
+			*/
+			iterator end(void) const
+				{
+				return iterator(*this, documents);
+				}
+
+			/*
+				PRIMARY_KEY_LIST::UNITTEST()
+				----------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+	}
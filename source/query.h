@@ -4,8 +4,6 @@
 	#define INCLUDE_FILE(x) QUOTEME(x)
 	#include INCLUDE_FILE(JASS_HAS_EXTERNAL_CONFIGURATION)
 #else
-	#define QUERY_HEAP
-	#define ACCUMULATOR_STRATEGY_2D
 	#define JASS_TOPK_SORT
 
 	/*
@@ -14,34 +12,10 @@
 #endif
 
 /*
-	Which top-k algorithm to use.  There is no default, one of these MUST be defined
-
-	QUERY_HEAP uses the heap to store the rsvs
-	QUERY_BUCKETS uses the bucket apprach to the top-k, the alternative is the query_heap
-	QUERY_MAXBLOCK uses the max-block approach to the top-k, the alternative is the query_heap
-	QUERY_MAXBLOCK_HEAP uses the max-block approach to the top-k (in a heap), the alternative is the query_heap
-*/
-//#define QUERY_HEAP
-//#define QUERY_BUCKETS
-//#define QUERY_MAXBLOCK
-//#define QUERY_MAXBLOCK_HEAP
-
-/*
-	Which accmulator allocator strategy to use
-
-	ACCUMULATOR_STRATEGY_2D uses the ATIRE 2D accumulator dirty pages strategy
-	ACCUMULATOR_COUNTER_8 uses an 8-bit counter per accumulator incremented with each query, in they do not match then zero just that one accumulator
-	ACCUMULATOR_COUNTER_4 uses an 4-bit counter per accumulator incremented with each query, in they do not match then zero just that one accumulator
-	ACCUMULATOR_COUNTER_INTERLEAVED_8 same as ACCUMULATOR_COUNTER_8, but interleaved the flags with the accumulators, and uses 21 accumulators per chunk (so flag + accumulators approximately equals cachline size)
-	ACCUMULATOR_COUNTER_INTERLEAVED_8_1 same as ACCUMULATOR_COUNTER_8, but interleaved the flags with the accumulators, one flag per accumulator
-	ACCUMULATOR_COUNTER_INTERLEAVED_4 same as ACCUMULATOR_COUNTER_4, but interleaved the flags with the accumulators, and uses 25 accumulators per chunk (so flag + accumulators approximately equals cachline size)
+	The top-k algorithm (query_heap_clean, query_heap, query_bucket, query_maxblock, query_maxblock_heap) and the accumulator
+	strategy (accumulator_2d, accumulator_counter, accumulator_counter_interleaved) are no longer chosen here.  The top-k classes
+	are templates over the accumulator strategy and JASS_anytime instantiates each combination so that it can be chosen at run time.
 */
-//#define ACCUMULATOR_STRATEGY_2D
-//#define ACCUMULATOR_COUNTER_8
-//#define ACCUMULATOR_COUNTER_4
-//#define ACCUMULATOR_COUNTER_INTERLEAVED_8
-//#define ACCUMULATOR_COUNTER_INTERLEAVED_8_1
-//#define ACCUMULATOR_COUNTER_INTERLEAVED_4
 
 /*
 	ACCUMULATOR_POINTER_BEAP uses a beap of pointers (rather than a heap of pointers) to store the top-k in the query_heap code.
@@ -80,7 +54,7 @@
 //#define SIMD_ADD_RSV_AFTER_CUMSUM 1
 
 /*
-	SIMD_JASS uses the decompressor that calls add_rsv() directly (single pass) rather than decompressng then processing (in 2 passes)
+	SIMD_JASS sets up the impact registers used by the SIMD add_rsv_d1() methods of query_heap and query_bucket
 */
 //#define SIMD_JASS 1
 
@@ -106,9 +80,15 @@
 
 #include <immintrin.h>
 
+#include <memory>
+#include <algorithm>
+#include <string_view>
+
 #include "top_k_qsort.h"
 #include "parser_query.h"
+#include "compress_integer.h"
 #include "query_term_list.h"
+#include "primary_key_list.h"
 #include "allocator_memory.h"
 
 namespace JASS
@@ -126,8 +106,6 @@ namespace JASS
 			typedef uint16_t ACCUMULATOR_TYPE;									///< the type of an accumulator (probably a uint16_t)
 //			typedef uint32_t ACCUMULATOR_TYPE;									///< the type of an accumulator (probably a uint16_t)
 			typedef uint32_t DOCID_TYPE;											///< the type of a document id (from a compressor)
-			static constexpr size_t MAX_DOCUMENTS = 55'000'000;			///< the maximum number of documents an index can hold
-			static constexpr size_t MAX_TOP_K = 1'000;						///< the maximum top-k value
 
 		public:
 			/*
@@ -141,7 +119,7 @@ namespace JASS
 				{
 				public:
 					size_t document_id;							///< The document identifier
-					const std::string &primary_key;			///< The external identifier of the document (the primary key)
+					std::string_view primary_key;				///< The external identifier of the document (the primary key)
 					ACCUMULATOR_TYPE rsv;						///< The rsv (Retrieval Status Value) relevance score
 
 				public:
@@ -155,7 +133,7 @@ namespace JASS
 						@param key [in] The external identifier of the document (the primary key).
 						@param rsv [in] The rsv (Retrieval Status Value) relevance score.
 					*/
-					docid_rsv_pair(size_t document_id, const std::string &key, ACCUMULATOR_TYPE rsv) :
+					docid_rsv_pair(size_t document_id, std::string_view key, ACCUMULATOR_TYPE rsv) :
 						document_id(document_id),
 						primary_key(key),
 						rsv(rsv)
@@ -176,10 +154,12 @@ namespace JASS
 
 			parser_query parser;															///< Parser responsible for converting text into a parsed query
 			query_term_list *parsed_query;											///< The parsed query
-			const std::vector<std::string> *primary_keys;						///< A vector of strings, each the primary key for the document with an id equal to the vector index
+			const primary_key_list *primary_keys;									///< The primary keys, each the primary key for the document with an id equal to its index in the list
+			std::unique_ptr<compress_integer> codex;								///< The decoder for the postings lists
 
 		public:
 			size_t top_k;																	///< The number of results to track.
+			static constexpr bool can_stop_early = false;						///< Does top_k_is_final() ever return true before there is nothing left to process
 
 		public:
 			/*
@@ -210,12 +190,12 @@ namespace JASS
 			*/
 			/*!
 				@brief Initialise the object. MUST be called before first use.
-				@param primary_keys [in] Vector of the document primary keys used to convert from internal document ids to external primary keys.
+				@param primary_keys [in] The document primary keys used to convert from internal document ids to external primary keys.
 				@param documents [in] The number of documents in the collection.
 				@param top_k [in]	The top-k documents to return from the query once executed.
 				@param width [in] The width of the 2-d accumulators (if they are being used).
 			*/
-			virtual void init(const std::vector<std::string> &primary_keys, DOCID_TYPE documents = 1024, size_t top_k = 10, size_t width = 7)
+			virtual void init(const primary_key_list &primary_keys, DOCID_TYPE documents = 1024, size_t top_k = 10, size_t width = 7)
 				{
 				this->primary_keys = &primary_keys;
 				this->top_k = top_k;
@@ -344,18 +324,72 @@ namespace JASS
 				}
 
 			/*
-				QUERY_HEAP::DECODE()
-				--------------------
+				QUERY::SET_CODEX()
+				------------------
 			*/
 			/*!
-				@brief Decode a sequence of integers encoded with this codex.
+				@brief Set the decoder used to decompress the postings lists (normally from deserialised_jass_v1::codex()).
+				@param decoder [in] The decoder, which this object takes ownership of.
+			*/
+			void set_codex(std::unique_ptr<compress_integer> decoder)
+				{
+				codex = std::move(decoder);
+				}
+
+			/*
+				QUERY::DECODE()
+				---------------
+			*/
+			/*!
+				@brief Decode a sequence of integers encoded with the codex.
 				@param decoded [out] The sequence of decoded integers.
 				@param integers_to_decode [in] The minimum number of integers to decode (it may decode more).
 				@param source [in] The encoded integers.
 				@param source_length [in] The length (in bytes) of the source buffer.
 			*/
-			virtual void decode(DOCID_TYPE *decoded, size_t integers_to_decode, const void *source, size_t source_length)
+			forceinline void decode(DOCID_TYPE *decoded, size_t integers_to_decode, const void *source, size_t source_length)
+				{
+				codex->decode(decoded, integers_to_decode, source, source_length);
+				}
+
+			/*
+				QUERY::TOP_K_IS_FINAL()
+				-----------------------
+			*/
+			/*!
+				@brief Can processing more postings change which documents are the highest top_k - 1, or their order?
+				@details This is the test for rank-safe early termination (see JASS_anytime --rank-safe).  The top_k-th document
+				stands in for all those outside the top_k - 1 because none of them has a higher rsv.  A query object that does not
+				keep its top-k up to date as the postings are processed cannot tell until there is nothing left to process, which
+				is what this default does (and why can_stop_early is false).
+				@param remaining [in] The most that the rsv of any document can still increase by.
+				@return true if no document can overtake any of the highest top_k - 1 documents and their order cannot change.
+			*/
+			bool top_k_is_final(size_t remaining)
 				{
+				return remaining == 0;
+				}
+
+		protected:
+			/*
+				QUERY::RSVS_ARE_SEPARATED()
+				---------------------------
+			*/
+			/*!
+				@brief Sort a list of rsvs and check that each is more than gap larger than the one before it.
+				@param rsv [in/out] The rsvs (sorted in place).
+				@param count [in] The number of rsvs.
+				@param gap [in] The difference that each adjacent pair of rsvs must exceed.
+				@return true if every adjacent pair differs by more than gap.
+			*/
+			static bool rsvs_are_separated(ACCUMULATOR_TYPE *rsv, size_t count, size_t gap)
+				{
+				std::sort(rsv, rsv + count);
+				for (size_t which = 1; which < count; which++)
+					if (static_cast<size_t>(rsv[which]) <= static_cast<size_t>(rsv[which - 1]) + gap)
+						return false;
+
+				return true;
 				}
 		};
 	}
@@ -12,6 +12,8 @@
 */
 #pragma once
 
+#include <vector>
+
 #include "heap.h"
 #include "query.h"
 #include "accumulator_2d.h"
@@ -28,9 +30,9 @@ namespace JASS
 	/*!
 		@brief Everything necessary to process a query (using a bucket sort) is encapsulated in an object of this type
 		@tparam ACCUMULATOR_TYPE The value-type for an accumulator (normally uint16_t or double).
-		@tparam MAX_DOCUMENTS The maximum number of documents that are ever going to exist in this collection
-		@tparam MAX_TOP_K The maximum top-k documents that are going to be asked for
+		@tparam ACCUMULATORS The accumulator strategy (accumulator_2d, accumulator_counter, or accumulator_counter_interleaved)
 	*/
+	template <typename ACCUMULATORS = accumulator_2d<query::ACCUMULATOR_TYPE>>
 	class query_bucket : public query
 		{
 		public:
@@ -54,7 +56,7 @@ namespace JASS
 					{
 					public:
 						DOCID_TYPE document_id;							///< The document identifier
-						const std::string &primary_key;			///< The external identifier of the document (the primary key)
+						std::string_view primary_key;				///< The external identifier of the document (the primary key)
 						ACCUMULATOR_TYPE rsv;						///< The rsv (Retrieval Status Value) relevance score
 
 					public:
@@ -68,7 +70,7 @@ namespace JASS
 							@param key [in] The external identifier of the document (the primary key).
 							@param rsv [in] The rsv (Retrieval Status Value) relevance score.
 						*/
-						docid_rsv_pair(DOCID_TYPE document_id, const std::string &key, ACCUMULATOR_TYPE rsv) :
+						docid_rsv_pair(DOCID_TYPE document_id, std::string_view key, ACCUMULATOR_TYPE rsv) :
 							document_id(document_id),
 							primary_key(key),
 							rsv(rsv)
@@ -142,7 +144,7 @@ namespace JASS
 						ACCUMULATOR_TYPE rsv = parent.sorted_accumulators[where] >> 32;
 						return docid_rsv_pair(id, (*parent.primary_keys)[id], rsv);
 #else
-						size_t id = parent.accumulator_pointers[where] - parent.shadow_accumulator;
+						size_t id = parent.accumulator_pointers[where] - parent.shadow_accumulator.data();
 						return docid_rsv_pair(id, (*parent.primary_keys)[id], parent.shadow_accumulator[id]);
 #endif
 						}
@@ -169,33 +171,21 @@ namespace JASS
 					*/
 					virtual iterator &operator++(void)
 						{
-						where--;
+						this->where--;
 						return *this;
 						}
 				};
 
 		private:
 #ifdef ACCUMULATOR_64s
-			uint64_t sorted_accumulators[MAX_TOP_K];		///< high word is the rsv, the low word is the DocID.
+			std::vector<uint64_t> sorted_accumulators;		///< high word is the rsv, the low word is the DocID (sized by init()).
 #else
-			ACCUMULATOR_TYPE *accumulator_pointers[MAX_TOP_K];					///< Array of pointers to the top k accumulators
-			ACCUMULATOR_TYPE shadow_accumulator[MAX_DOCUMENTS];				///< Used to deduplicate the top-k
+			std::vector<ACCUMULATOR_TYPE *> accumulator_pointers;				///< Array of pointers to the top k accumulators (sized by init())
+			std::vector<ACCUMULATOR_TYPE> shadow_accumulator;					///< Used to deduplicate the top-k, one per document (sized by init())
 #endif
 			uint64_t accumulators_used;												///< The number of accumulator_pointers used (can be smaller than top_k)
 
-#ifdef ACCUMULATOR_STRATEGY_2D
-			accumulator_2d<ACCUMULATOR_TYPE, MAX_DOCUMENTS> accumulators;	///< The accumulators, one per document in the collection
-#elif defined(ACCUMULATOR_COUNTER_8)
-			accumulator_counter<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 8> accumulators;	///< The accumulators, one per document in the collection
-#elif defined(ACCUMULATOR_COUNTER_4)
-			accumulator_counter<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 4> accumulators;	///< The accumulators, one per document in the collection
-#elif defined(ACCUMULATOR_COUNTER_INTERLEAVED_8)
-			accumulator_counter_interleaved<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 8> accumulators;	///< The accumulators, one per document in the collection
-#elif defined(ACCUMULATOR_COUNTER_INTERLEAVED_8_1)
-			accumulator_counter_interleaved<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 8, 1> accumulators;	///< The accumulators, one per document in the collection
-#elif defined(ACCUMULATOR_COUNTER_INTERLEAVED_4)
-			accumulator_counter_interleaved<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 4> accumulators;	///< The accumulators, one per document in the collection
-#endif
+			ACCUMULATORS accumulators;													///< The accumulators, one per document in the collection
 
 			bool sorted;																	///< has heap and accumulator_pointers been sorted (false after rewind() true after sort())
 
@@ -211,13 +201,19 @@ namespace JASS
 			uint8_t bucket_depth[number_of_buckets];										///< The number of documents in the given bucket
 
 		public:
+#ifdef ACCUMULATOR_64s
+			static constexpr bool run_is_ascending = true;			///< The top-k is iterated from lowest to highest rsv (see run_export())
+#else
+			static constexpr bool run_is_ascending = false;		///< The top-k is iterated from highest to lowest rsv (see run_export())
+#endif
+
 			/*
 				QUERY_BUCKET::QUERY_BUCKET()
 				----------------------------
 			*/
 			/*!
 				@brief Constructor
-				@param primary_keys [in] Vector of the document primary keys used to convert from internal document ids to external primary keys.
+				@param primary_keys [in] The document primary keys used to convert from internal document ids to external primary keys.
 				@param documents [in] The number of documents in the collection.
 				@param top_k [in]	The top-k documents to return from the query once executed.
 			*/
@@ -248,15 +244,21 @@ namespace JASS
 			*/
 			/*!
 				@brief Initialise the object. MUST be called before first use.
-				@param primary_keys [in] Vector of the document primary keys used to convert from internal document ids to external primary keys.
+				@param primary_keys [in] The document primary keys used to convert from internal document ids to external primary keys.
 				@param documents [in] The number of documents in the collection.
 				@param top_k [in]	The top-k documents to return from the query once executed.
 				@param width [in] The width of the 2-d accumulators (if they are being used).
 			*/
-			virtual void init(const std::vector<std::string> &primary_keys, DOCID_TYPE documents = 1024, size_t top_k = 10, size_t width = 7)
+			virtual void init(const primary_key_list &primary_keys, DOCID_TYPE documents = 1024, size_t top_k = 10, size_t width = 7)
 				{
 				query::init(primary_keys, documents, top_k);
 				accumulators.init(documents, width);
+#ifdef ACCUMULATOR_64s
+				sorted_accumulators.resize(top_k);
+#else
+				accumulator_pointers.resize(top_k);
+				shadow_accumulator.resize(documents);
+#endif
 				rewind(0, number_of_buckets);
 				}
 
@@ -377,16 +379,16 @@ namespace JASS
 					*/
 	#ifdef JASS_TOPK_SORT
 					// CHECKED
-					top_k_qsort::sort(sorted_accumulators, accumulators_used, top_k);
+					top_k_qsort::sort(sorted_accumulators.data(), accumulators_used, top_k);
 	#elif defined(CPP_TOPK_SORT)
 					// CHECKED
-					std::partial_sort(sorted_accumulators, sorted_accumulators + (top_k > accumulators_used ? accumulators_used : top_k), sorted_accumulators + accumulators_used);
+					std::partial_sort(sorted_accumulators.data(), sorted_accumulators.data() + (top_k > accumulators_used ? accumulators_used : top_k), sorted_accumulators.data() + accumulators_used);
 	#elif defined(CPP_SORT)
 					// CHECKED
-					std::sort(sorted_accumulators, sorted_accumulators + accumulators_used);
+					std::sort(sorted_accumulators.data(), sorted_accumulators.data() + accumulators_used);
 	#elif defined(AVX512_SORT)
 // NOT CHECKED
-					Sort512_uint64_t::Sort(sorted_accumulators, accumulators_used);
+					Sort512_uint64_t::Sort(sorted_accumulators.data(), accumulators_used);
 	#endif
 #else
 					/*
@@ -421,13 +423,13 @@ namespace JASS
 
 	#ifdef JASS_TOPK_SORT
 					// CHECKED
-					top_k_qsort::sort(accumulator_pointers, accumulators_used, top_k);
+					top_k_qsort::sort(accumulator_pointers.data(), accumulators_used, top_k);
 	#elif defined(CPP_TOPK_SORT)
 					// CHECKED
-					std::partial_sort(accumulator_pointers, accumulator_pointers + (top_k < accumulators_used ? top_k : accumulators_used), accumulator_pointers + accumulators_used, [](const ACCUMULATOR_TYPE *a, const ACCUMULATOR_TYPE *b) -> bool { return *a > *b ? true : *a < *b ? false : a > b; });
+					std::partial_sort(accumulator_pointers.data(), accumulator_pointers.data() + (top_k < accumulators_used ? top_k : accumulators_used), accumulator_pointers.data() + accumulators_used, [](const ACCUMULATOR_TYPE *a, const ACCUMULATOR_TYPE *b) -> bool { return *a > *b ? true : *a < *b ? false : a > b; });
 	#elif defined(CPP_SORT)
 					// CHECKED
-					std::sort(accumulator_pointers, accumulator_pointers + accumulators_used, [](const ACCUMULATOR_TYPE *a, const ACCUMULATOR_TYPE *b) -> bool { return *a > *b ? true : *a < *b ? false : a > b; });
+					std::sort(accumulator_pointers.data(), accumulator_pointers.data() + accumulators_used, [](const ACCUMULATOR_TYPE *a, const ACCUMULATOR_TYPE *b) -> bool { return *a > *b ? true : *a < *b ? false : a > b; });
 	#elif defined(AVX512_SORT)
 					// CHECKED
 					assert(false);
@@ -485,7 +487,11 @@ namespace JASS
 				set_bucket(document_id, *which);
 				}
 
-#ifdef ACCUMULATOR_STRATEGY_2D
+			/*
+				The SIMD methods scatter() directly into the accumulator array and so can only be used with accumulator_2d.
+				As this is a template they are only instantiated if they are called.
+			*/
+
 			/*
 				QUERY_BUCKET::ADD_RSV()
 				-----------------------
@@ -574,7 +580,6 @@ namespace JASS
 				set_bucket(_mm512_extracti32x4_epi32(document_ids, 3), _mm512_extracti32x4_epi32(values, 3));
 #endif
 				}
-#endif
 
 			/*
 				QUERY_BUCKET::ADD_RSV_D1()
@@ -594,8 +599,6 @@ namespace JASS
 				set_bucket(document_id, *which);
 				}
 
-#ifdef ACCUMULATOR_STRATEGY_2D
-
 			/*
 				QUERY_BUCKET::ADD_RSV_D1()
 				--------------------------
@@ -651,7 +654,6 @@ namespace JASS
 				*/
 				add_rsv(document_ids);
 				}
-#endif
 
 			/*
 				QUERY_BUCKET::DECODE_WITH_WRITER()
@@ -671,7 +673,7 @@ namespace JASS
 				/*
 					D1-decode inplace with SIMD instructions then process one at a time
 				*/
-				simd::cumulative_sum_256(buffer, integers);
+				simd::cumulative_sum(buffer, integers);
 
 				/*
 					Process the d1-decoded postings list.
@@ -754,7 +756,7 @@ namespace JASS
 			*/
 			static void unittest(void)
 				{
-				std::vector<std::string> keys = {"one", "two", "three", "four"};
+				primary_key_list keys({"one", "two", "three", "four"});
 				query_bucket *query_object = new query_bucket;
 				query_object->init(keys, 1024, 2);
 				std::ostringstream string;
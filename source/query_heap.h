@@ -12,6 +12,8 @@
 */
 #pragma once
 
+#include <vector>
+
 #include "beap.h"
 #include "heap.h"
 #include "simd.h"
@@ -30,7 +32,9 @@ namespace JASS
 	*/
 	/*!
 		@brief Everything necessary to process a query (using a heap) is encapsulated in an object of this type
+		@tparam ACCUMULATORS The accumulator strategy (accumulator_2d, accumulator_counter, or accumulator_counter_interleaved)
 	*/
+	template <typename ACCUMULATORS = accumulator_2d<query::ACCUMULATOR_TYPE>>
 	class query_heap : public query
 		{
 		private:
@@ -137,35 +141,23 @@ namespace JASS
 					*/
 					virtual iterator &operator++(void)
 						{
-						where--;
+						this->where--;
 						return *this;
 						}
 				};
 
 		private:
 		
-#ifdef ACCUMULATOR_STRATEGY_2D
-			accumulator_2d<ACCUMULATOR_TYPE, MAX_DOCUMENTS> accumulators;	///< The accumulators, one per document in the collection
-#elif defined(ACCUMULATOR_COUNTER_8)
-			accumulator_counter<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 8> accumulators;	///< The accumulators, one per document in the collection
-#elif defined(ACCUMULATOR_COUNTER_4)
-			accumulator_counter<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 4> accumulators;	///< The accumulators, one per document in the collection
-#elif defined(ACCUMULATOR_COUNTER_INTERLEAVED_8)
-			accumulator_counter_interleaved<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 8> accumulators;	///< The accumulators, one per document in the collection
-#elif defined(ACCUMULATOR_COUNTER_INTERLEAVED_8_1)
-			accumulator_counter_interleaved<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 8, 1> accumulators;	///< The accumulators, one per document in the collection
-#elif defined(ACCUMULATOR_COUNTER_INTERLEAVED_4)
-			accumulator_counter_interleaved<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 4> accumulators;	///< The accumulators, one per document in the collection
-#endif
+			ACCUMULATORS accumulators;													///< The accumulators, one per document in the collection
 
 			size_t needed_for_top_k;													///< The number of results we still need in order to fill the top-k
 
 #ifdef ACCUMULATOR_64s
-			uint64_t sorted_accumulators[MAX_TOP_K];							///< high 32-bits is the rsv, the low 32-bits is the DocID.
+			std::vector<uint64_t> sorted_accumulators;						///< high 32-bits is the rsv, the low 32-bits is the DocID (top-k of them, sized by init())
 			beap<uint64_t> top_results;											///< Heap containing the top-k results
 #else
 			ACCUMULATOR_TYPE zero;																		///< Constant zero used for pointer dereferenced comparisons
-			accumulator_pointer accumulator_pointers[MAX_TOP_K];									///< Array of pointers to the top k accumulators
+			std::vector<accumulator_pointer> accumulator_pointers;								///< Array of pointers to the top k accumulators (sized by init())
 	#ifdef ACCUMULATOR_POINTER_BEAP
 			beap<accumulator_pointer> top_results;		///< Heap containing the top-k results
 	#else
@@ -174,6 +166,7 @@ namespace JASS
 #endif
 
 			bool sorted;																	///< has heap and accumulator_pointers been sorted (false after rewind() true after sort())
+			std::vector<ACCUMULATOR_TYPE> top_k_rsvs;									///< Scratch space for top_k_is_final() (sized by init())
 #ifdef SIMD_JASS_GROUP_ADD_RSV
 	#ifdef __AVX512F__
 			__m512i lowest_in_heap;														///< vector of the smallest values in the heap
@@ -183,6 +176,9 @@ namespace JASS
 #endif
 
 		public:
+			static constexpr bool run_is_ascending = true;			///< The top-k is iterated from lowest to highest rsv (see run_export())
+			static constexpr bool can_stop_early = true;				///< The heap is always up to date so top_k_is_final() can stop early
+
 			/*
 				QUERY_HEAP::QUERY_HEAP()
 				------------------------
@@ -193,10 +189,12 @@ namespace JASS
 			query_heap() :
 				query(),
 #ifdef ACCUMULATOR_64s
-				top_results(sorted_accumulators, top_k)
+				sorted_accumulators(1),
+				top_results(sorted_accumulators.data(), top_k)
 #else
 				zero(0),
-				top_results(accumulator_pointers, top_k)
+				accumulator_pointers(1),
+				top_results(accumulator_pointers.data(), top_k)
 #endif
 				{
 				rewind();
@@ -219,20 +217,23 @@ namespace JASS
 			*/
 			/*!
 				@brief Initialise the object. MUST be called before first use.
-				@param primary_keys [in] Vector of the document primary keys used to convert from internal document ids to external primary keys.
+				@param primary_keys [in] The document primary keys used to convert from internal document ids to external primary keys.
 				@param documents [in] The number of documents in the collection.
 				@param top_k [in]	The top-k documents to return from the query once executed.
 				@param width [in] The width of the 2-d accumulators (if they are being used).
 			*/
-			virtual void init(const std::vector<std::string> &primary_keys, DOCID_TYPE documents = 1024, size_t top_k = 10, size_t width = 7)
+			virtual void init(const primary_key_list &primary_keys, DOCID_TYPE documents = 1024, size_t top_k = 10, size_t width = 7)
 				{
 				query::init(primary_keys, documents, top_k);
 				accumulators.init(documents, width);
 #ifdef ACCUMULATOR_64s
-				top_results.set_top_k((int64_t)top_k);
+				sorted_accumulators.resize(maths::maximum(top_k, (size_t)1));
+				top_results = decltype(top_results)(sorted_accumulators.data(), (int64_t)top_k);
 #else
-				top_results.set_top_k(top_k);
+				accumulator_pointers.resize(maths::maximum(top_k, (size_t)1));
+				top_results = decltype(top_results)(accumulator_pointers.data(), top_k);
 #endif
+				top_k_rsvs.resize(top_k);
 				}
 
 			/*
@@ -330,27 +331,27 @@ namespace JASS
 #ifdef ACCUMULATOR_64s
 	#ifdef JASS_TOPK_SORT
 					// CHECKED
-					top_k_qsort::sort(sorted_accumulators + needed_for_top_k, top_k - needed_for_top_k, top_k);
+					top_k_qsort::sort(sorted_accumulators.data() + needed_for_top_k, top_k - needed_for_top_k, top_k);
 	#elif defined(CPP_TOPK_SORT)
 					// CHECKED
-					std::partial_sort(sorted_accumulators + needed_for_top_k,  sorted_accumulators + top_k, sorted_accumulators + top_k);
+					std::partial_sort(sorted_accumulators.data() + needed_for_top_k,  sorted_accumulators.data() + top_k, sorted_accumulators.data() + top_k);
 	#elif defined(CPP_SORT)
 					// CHECKED
-					std::sort(sorted_accumulators + needed_for_top_k, sorted_accumulators + top_k);
+					std::sort(sorted_accumulators.data() + needed_for_top_k, sorted_accumulators.data() + top_k);
 	#elif defined(AVX512_SORT)
 					// CHECKED
-					Sort512_uint64_t::Sort(sorted_accumulators + needed_for_top_k, top_k - needed_for_top_k);
+					Sort512_uint64_t::Sort(sorted_accumulators.data() + needed_for_top_k, top_k - needed_for_top_k);
 	#endif
 #else
 	#ifdef JASS_TOPK_SORT
 					// CHECKED
-					top_k_qsort::sort(accumulator_pointers + needed_for_top_k, top_k - needed_for_top_k, top_k);
+					top_k_qsort::sort(accumulator_pointers.data() + needed_for_top_k, top_k - needed_for_top_k, top_k);
 	#elif defined(CPP_TOPK_SORT)
 					// CHECKED
-					std::partial_sort(accumulator_pointers + needed_for_top_k, accumulator_pointers + top_k, accumulator_pointers + top_k);
+					std::partial_sort(accumulator_pointers.data() + needed_for_top_k, accumulator_pointers.data() + top_k, accumulator_pointers.data() + top_k);
 	#elif defined(CPP_SORT)
 					// CHECKED
-					std::sort(accumulator_pointers + needed_for_top_k, accumulator_pointers + top_k);
+					std::sort(accumulator_pointers.data() + needed_for_top_k, accumulator_pointers.data() + top_k);
 	#elif defined(AVX512_SORT)
 					// CHECKED
 					assert(false);
@@ -360,6 +361,69 @@ namespace JASS
 					}
 				}
 
+			/*
+				QUERY_HEAP::TOP_K_IS_FINAL()
+				----------------------------
+			*/
+			/*!
+				@brief Can processing more postings change which documents are the highest top_k - 1, or their order (see query::top_k_is_final())?
+				@details Once the heap is full every document outside it has an rsv no higher than the bottom of the heap.  In both
+				the heap and the beap the second lowest is one of elements 1 and 2, so checking it first is usually enough to say no
+				without looking at the whole heap.
+				@param remaining [in] The most that the rsv of any document can still increase by.
+				@return true if no document can overtake any of the highest top_k - 1 documents and their order cannot change.
+			*/
+			bool top_k_is_final(size_t remaining)
+				{
+				if (remaining == 0)
+					return true;
+				if (needed_for_top_k != 0)
+					return false;			// a document we've not yet seen can still get into the top-k
+
+#ifdef ACCUMULATOR_64s
+				if (top_k > 2)
+					if ((maths::minimum(sorted_accumulators[1], sorted_accumulators[2]) >> 32) <= (sorted_accumulators[0] >> 32) + remaining)
+						return false;
+
+				for (size_t which = 0; which < top_k; which++)
+					top_k_rsvs[which] = static_cast<ACCUMULATOR_TYPE>(sorted_accumulators[which] >> 32);
+#else
+				if (top_k > 2)
+					if (static_cast<size_t>(*maths::minimum(accumulator_pointers[1], accumulator_pointers[2]).pointer()) <= static_cast<size_t>(*accumulator_pointers[0].pointer()) + remaining)
+						return false;
+
+				for (size_t which = 0; which < top_k; which++)
+					top_k_rsvs[which] = *accumulator_pointers[which].pointer();
+#endif
+
+				return rsvs_are_separated(top_k_rsvs.data(), top_k, remaining);
+				}
+
+			/*
+				QUERY_HEAP::COPY_TOP_K()
+				------------------------
+			*/
+			/*!
+				@brief Copy the rsvs of the top-k (in no particular order), used to check that the top-k is final across several query objects.
+				@param into [out] The rsvs (top_k of them).
+				@return false (and nothing is copied) if the heap is not yet full, else true.
+			*/
+			bool copy_top_k(ACCUMULATOR_TYPE *into) const
+				{
+				if (needed_for_top_k != 0)
+					return false;
+
+#ifdef ACCUMULATOR_64s
+				for (size_t which = 0; which < top_k; which++)
+					into[which] = static_cast<ACCUMULATOR_TYPE>(sorted_accumulators[which] >> 32);
+#else
+				for (size_t which = 0; which < top_k; which++)
+					into[which] = *accumulator_pointers[which].pointer();
+#endif
+
+				return true;
+				}
+
 			/*
 				QUERY_HEAP::ADD_RSV()
 				---------------------
@@ -404,7 +468,7 @@ namespace JASS
 								If we were to sort first then it'd be N log N to sort and then log N to find, so O(N log N + log N), or O((N + 1) log N), which is O(N log N)
 							*/
 							uint64_t prior_key = ((uint64_t)(*which - score) << (uint64_t)32) | document_id;
-							for (uint64_t *check = sorted_accumulators + needed_for_top_k; check < sorted_accumulators + top_k; check++)
+							for (uint64_t *check = sorted_accumulators.data() + needed_for_top_k; check < sorted_accumulators.data() + top_k; check++)
 								if (*check == prior_key)
 									{
 									*check = key;
@@ -724,7 +788,7 @@ namespace JASS
 				/*
 					D1-decode inplace with SIMD instructions then process one at a time
 				*/
-				simd::cumulative_sum_256(buffer, integers);
+				simd::cumulative_sum(buffer, integers);
 
 				/*
 					Process the d1-decoded postings list.
@@ -781,7 +845,7 @@ namespace JASS
 			*/
 			static void unittest(void)
 				{
-				std::vector<std::string> keys = {"one", "two", "three", "four"};
+				primary_key_list keys({"one", "two", "three", "four"});
 				query_heap *query_object = new query_heap;
 				query_object->init(keys, 1024, 2);
 				std::ostringstream string;
@@ -12,6 +12,8 @@
 */
 #pragma once
 
+#include <vector>
+
 #include "beap.h"
 #include "heap.h"
 #include "simd.h"
@@ -30,7 +32,9 @@ namespace JASS
 	*/
 	/*!
 		@brief Everything necessary to process a query (using a heap) is encapsulated in an object of this type
+		@tparam ACCUMULATORS The accumulator strategy (accumulator_2d, accumulator_counter, or accumulator_counter_interleaved)
 	*/
+	template <typename ACCUMULATORS = accumulator_2d<query::ACCUMULATOR_TYPE>>
 	class query_heap_clean : public query
 		{
 		private:
@@ -131,21 +135,25 @@ namespace JASS
 					*/
 					virtual iterator &operator++(void)
 						{
-						where--;
+						this->where--;
 						return *this;
 						}
 				};
 
 		private:
-			accumulator_2d<ACCUMULATOR_TYPE, MAX_DOCUMENTS> accumulators;	///< The accumulators, one per document in the collection
+			ACCUMULATORS accumulators;													///< The accumulators, one per document in the collection
 			size_t needed_for_top_k;													///< The number of results we still need in order to fill the top-k
 			ACCUMULATOR_TYPE zero;														///< Constant zero used for pointer dereferenced comparisons
-			accumulator_pointer accumulator_pointers[MAX_TOP_K];				///< Array of pointers to the top k accumulators
+			std::vector<accumulator_pointer> accumulator_pointers;			///< Array of pointers to the top k accumulators (sized by init())
 			heap<accumulator_pointer> top_results;									///< Heap containing the top-k results
 			bool sorted;																	///< has heap and accumulator_pointers been sorted (false after rewind() true after sort())
 			ACCUMULATOR_TYPE top_k_lower_bound;										///< lowest possible score to enter the top k
+			std::vector<ACCUMULATOR_TYPE> top_k_rsvs;									///< Scratch space for top_k_is_final() (sized by init())
 
 		public:
+			static constexpr bool run_is_ascending = true;			///< The top-k is iterated from lowest to highest rsv (see run_export())
+			static constexpr bool can_stop_early = true;				///< The heap is always up to date so top_k_is_final() can stop early
+
 			/*
 				QUERY_HEAP_CLEAN::QUERY_HEAP_CLEAN()
 				------------------------------------
@@ -156,7 +164,8 @@ namespace JASS
 			query_heap_clean() :
 				query(),
 				zero(0),
-				top_results(accumulator_pointers, top_k)
+				accumulator_pointers(1),
+				top_results(accumulator_pointers.data(), top_k)
 				{
 				rewind();
 				}
@@ -178,16 +187,18 @@ namespace JASS
 			*/
 			/*!
 				@brief Initialise the object. MUST be called before first use.
-				@param primary_keys [in] Vector of the document primary keys used to convert from internal document ids to external primary keys.
+				@param primary_keys [in] The document primary keys used to convert from internal document ids to external primary keys.
 				@param documents [in] The number of documents in the collection.
 				@param top_k [in]	The top-k documents to return from the query once executed.
 				@param width [in] The width of the 2-d accumulators (if they are being used).
 			*/
-			virtual void init(const std::vector<std::string> &primary_keys, DOCID_TYPE documents = 1024, size_t top_k = 10, size_t width = 7)
+			virtual void init(const primary_key_list &primary_keys, DOCID_TYPE documents = 1024, size_t top_k = 10, size_t width = 7)
 				{
 				query::init(primary_keys, documents, top_k);
 				accumulators.init(documents, width);
-				top_results.set_top_k(top_k);
+				accumulator_pointers.resize(maths::maximum(top_k, (size_t)1));
+				top_results = decltype(top_results)(accumulator_pointers.data(), top_k);
+				top_k_rsvs.resize(top_k);
 				}
 
 			/*
@@ -273,11 +284,60 @@ namespace JASS
 				{
 				if (!sorted)
 					{
-					std::partial_sort(accumulator_pointers + needed_for_top_k, accumulator_pointers + top_k, accumulator_pointers + top_k);
+					std::partial_sort(accumulator_pointers.data() + needed_for_top_k, accumulator_pointers.data() + top_k, accumulator_pointers.data() + top_k);
 					sorted = true;
 					}
 				}
 
+			/*
+				QUERY_HEAP_CLEAN::TOP_K_IS_FINAL()
+				----------------------------------
+			*/
+			/*!
+				@brief Can processing more postings change which documents are the highest top_k - 1, or their order (see query::top_k_is_final())?
+				@details Once the heap is full every document outside it has an rsv no higher than the bottom of the heap.  The
+				smaller of the children of the bottom of the heap is the second lowest so checking it first is usually enough to
+				say no without looking at the whole heap.
+				@param remaining [in] The most that the rsv of any document can still increase by.
+				@return true if no document can overtake any of the highest top_k - 1 documents and their order cannot change.
+			*/
+			bool top_k_is_final(size_t remaining)
+				{
+				if (remaining == 0)
+					return true;
+				if (needed_for_top_k != 0)
+					return false;			// a document we've not yet seen can still get into the top-k
+
+				if (top_k > 2)
+					if (static_cast<size_t>(*maths::minimum(accumulator_pointers[1], accumulator_pointers[2]).pointer()) <= static_cast<size_t>(*accumulator_pointers[0].pointer()) + remaining)
+						return false;
+
+				for (size_t which = 0; which < top_k; which++)
+					top_k_rsvs[which] = *accumulator_pointers[which].pointer();
+
+				return rsvs_are_separated(top_k_rsvs.data(), top_k, remaining);
+				}
+
+			/*
+				QUERY_HEAP_CLEAN::COPY_TOP_K()
+				------------------------------
+			*/
+			/*!
+				@brief Copy the rsvs of the top-k (in no particular order), used to check that the top-k is final across several query objects.
+				@param into [out] The rsvs (top_k of them).
+				@return false (and nothing is copied) if the heap is not yet full, else true.
+			*/
+			bool copy_top_k(ACCUMULATOR_TYPE *into) const
+				{
+				if (needed_for_top_k != 0)
+					return false;
+
+				for (size_t which = 0; which < top_k; which++)
+					into[which] = *accumulator_pointers[which].pointer();
+
+				return true;
+				}
+
 			/*
 				QUERY_HEAP_CLEAN::ADD_RSV()
 				---------------------------
@@ -367,7 +427,7 @@ namespace JASS
 				/*
 					D1-decode inplace with SIMD instructions then process one at a time
 				*/
-				simd::cumulative_sum_256(buffer, integers);
+				simd::cumulative_sum(buffer, integers);
 
 				/*
 					Process the d1-decoded postings list.
@@ -423,8 +483,8 @@ namespace JASS
 			*/
 			static void unittest(void)
 				{
-				std::vector<std::string> keys = {"one", "two", "three", "four"};
-				query_heap *query_object = new query_heap;
+				primary_key_list keys({"one", "two", "three", "four"});
+				query_heap_clean *query_object = new query_heap_clean;
 				query_object->init(keys, 1024, 2);
 				std::ostringstream string;
 
@@ -437,6 +497,13 @@ namespace JASS
 				query_object->add_rsv(1, 1);
 				query_object->add_rsv(1, 14);
 
+				/*
+					Check rank-safe early termination: document 3 (20) stays ahead of document 1 (15) unless a document can gain 5 or more
+				*/
+				JASS_assert(query_object->top_k_is_final(0));
+				JASS_assert(query_object->top_k_is_final(4));
+				JASS_assert(!query_object->top_k_is_final(5));
+
 				for (const auto rsv : *query_object)
 					string << "<" << rsv.document_id << "," << rsv.rsv << ">";
 				JASS_assert(string.str() == "<1,15><3,20>");
@@ -457,7 +524,7 @@ namespace JASS
 						JASS_assert(term.token() == "three");
 					}
 
-				puts("query_heap::PASSED");
+				puts("query_heap_clean::PASSED");
 				}
 		};
 	}
@@ -12,6 +12,8 @@
 */
 #pragma once
 
+#include <vector>
+
 #include "query.h"
 #include "heap.h"
 
@@ -24,9 +26,9 @@ namespace JASS
 	/*!
 		@brief Everything necessary to process a query (using a maxblock) is encapsulated in an object of this type.  Thanks go to Antonio Mallia for inveting this method.
 		@tparam ACCUMULATOR_TYPE The value-type for an accumulator (normally uint16_t or double).
-		@tparam MAX_DOCUMENTS The maximum number of documents that are ever going to exist in this collection
-		@tparam MAX_TOP_K The maximum top-k documents that are going to be asked for
+		@tparam ACCUMULATORS The accumulator strategy (accumulator_2d, accumulator_counter, or accumulator_counter_interleaved)
 	*/
+	template <typename ACCUMULATORS = accumulator_2d<query::ACCUMULATOR_TYPE>>
 	class query_maxblock : public query
 		{
 		public:
@@ -50,7 +52,7 @@ namespace JASS
 					{
 					public:
 						size_t document_id;							///< The document identifier
-						const std::string &primary_key;			///< The external identifier of the document (the primary key)
+						std::string_view primary_key;				///< The external identifier of the document (the primary key)
 						ACCUMULATOR_TYPE rsv;						///< The rsv (Retrieval Status Value) relevance score
 
 					public:
@@ -64,7 +66,7 @@ namespace JASS
 							@param key [in] The external identifier of the document (the primary key).
 							@param rsv [in] The rsv (Retrieval Status Value) relevance score.
 						*/
-						docid_rsv_pair(size_t document_id, const std::string &key, ACCUMULATOR_TYPE rsv) :
+						docid_rsv_pair(size_t document_id, std::string_view key, ACCUMULATOR_TYPE rsv) :
 							document_id(document_id),
 							primary_key(key),
 							rsv(rsv)
@@ -165,51 +167,46 @@ namespace JASS
 						*/
 						virtual iterator &operator++(void)
 							{
-							where--;
+							this->where--;
 							return *this;
 							}
 					};
 
 		protected:
 #ifdef ACCUMULATOR_64s
-			uint64_t sorted_accumulators[MAX_DOCUMENTS];									///< high word is the rsv, the low word is the DocID.
+			std::vector<uint64_t> sorted_accumulators;									///< high word is the rsv, the low word is the DocID (one per document, sized by init()).
 #else
-			ACCUMULATOR_TYPE *accumulator_pointers[MAX_DOCUMENTS];					///< Array of pointers to the top k accumulators
+			std::vector<ACCUMULATOR_TYPE *> accumulator_pointers;					///< Array of pointers to the non-zero accumulators (one per document, sized by init())
 #endif
 
-#ifdef ACCUMULATOR_STRATEGY_2D
-			accumulator_2d<ACCUMULATOR_TYPE, MAX_DOCUMENTS> accumulators;	///< The accumulators, one per document in the collection
-#elif defined(ACCUMULATOR_COUNTER_8)
-			accumulator_counter<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 8> accumulators;	///< The accumulators, one per document in the collection
-#elif defined(ACCUMULATOR_COUNTER_4)
-			accumulator_counter<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 4> accumulators;	///< The accumulators, one per document in the collection
-#elif defined(ACCUMULATOR_COUNTER_INTERLEAVED_8)
-			accumulator_counter_interleaved<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 8> accumulators;	///< The accumulators, one per document in the collection
-#elif defined(ACCUMULATOR_COUNTER_INTERLEAVED_8_1)
-			accumulator_counter_interleaved<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 8, 1> accumulators;	///< The accumulators, one per document in the collection
-#elif defined(ACCUMULATOR_COUNTER_INTERLEAVED_4)
-			accumulator_counter_interleaved<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 4> accumulators;	///< The accumulators, one per document in the collection
-#endif
+			ACCUMULATORS accumulators;													///< The accumulators, one per document in the collection
 
 			size_t block_width;																	///< The number of documents per block
 			size_t bucket_shift;																	///< The amount to shift to get the right bucket
 			size_t number_of_blocks;															///< The number of blocks
-			ACCUMULATOR_TYPE page_maximum[MAX_DOCUMENTS];								///< The current maximum value of the accumulator block
+			std::vector<ACCUMULATOR_TYPE> page_maximum;								///< The current maximum value of the accumulator block (one per block, sized by init())
 			bool sorted;																			///< has heap and accumulator_pointers been sorted (false after rewind() true after sort())
 			size_t non_zero_accumulators;														///< The number of non-zero accumulators (should be top-k or less)
 
 		public:
+#ifdef ACCUMULATOR_64s
+			static constexpr bool run_is_ascending = true;			///< The top-k is iterated from lowest to highest rsv (see run_export())
+#else
+			static constexpr bool run_is_ascending = false;		///< The top-k is iterated from highest to lowest rsv (see run_export())
+#endif
+
 			/*
 				QUERY_MAXBLOCK::QUERY_MAXBLOCK()
 				--------------------------------
 			*/
 			/*!
 				@brief Constructor
-				@param primary_keys [in] Vector of the document primary keys used to convert from internal document ids to external primary keys.
+				@param primary_keys [in] The document primary keys used to convert from internal document ids to external primary keys.
 				@param documents [in] The number of documents in the collection.
 				@param top_k [in]	The top-k documents to return from the query once executed.
 			*/
-			query_maxblock()
+			query_maxblock() :
+				number_of_blocks(0)
 				{
 				rewind();
 				}
@@ -231,29 +228,44 @@ namespace JASS
 			*/
 			/*!
 				@brief Initialise the object. MUST be called before first use.
-				@param primary_keys [in] Vector of the document primary keys used to convert from internal document ids to external primary keys.
+				@param primary_keys [in] The document primary keys used to convert from internal document ids to external primary keys.
 				@param documents [in] The number of documents in the collection.
 				@param top_k [in]	The top-k documents to return from the query once executed.
 				@param width [in] The width of the 2-d accumulators (if they are being used).
 			*/
-			virtual void init(const std::vector<std::string> &primary_keys, DOCID_TYPE documents = 1024, size_t top_k = 10, size_t preferred_width = 7)
+			virtual void init(const primary_key_list &primary_keys, DOCID_TYPE documents = 1024, size_t top_k = 10, size_t preferred_width = 7)
 				{
 				query::init(primary_keys, documents, top_k);
-				accumulators.init(documents, preferred_width);
 
-#ifdef ACCUMULATOR_STRATEGY_2D
-				number_of_blocks = accumulators.number_of_dirty_flags;
-				block_width = accumulators.width;
-				bucket_shift = accumulators.shift;
-#else
-				if (preferred_width >= 1)
-					bucket_shift = preferred_width;
+				if constexpr (is_accumulator_2d<ACCUMULATORS>::value)
+					{
+					accumulators.init(documents, preferred_width);
+					number_of_blocks = accumulators.number_of_dirty_flags;
+					block_width = accumulators.width;
+					bucket_shift = accumulators.shift;
+					}
 				else
-					bucket_shift = maths::floor_log2((size_t)sqrt(documents));
+					{
+					if (preferred_width >= 1)
+						bucket_shift = preferred_width;
+					else
+						bucket_shift = maths::floor_log2((size_t)sqrt(documents));
+
+					block_width = (size_t)1 << bucket_shift;
+					number_of_blocks = (documents + block_width - 1) / block_width;
 
-				block_width = (size_t)1 << bucket_shift;
-				number_of_blocks = (documents + block_width - 1) / block_width;
+					/*
+						sort() looks at every accumulator in a block so there must be whole blocks of them
+					*/
+					accumulators.init(number_of_blocks * block_width, preferred_width);
+					}
+
+#ifdef ACCUMULATOR_64s
+				sorted_accumulators.resize(documents);
+#else
+				accumulator_pointers.resize(documents);
 #endif
+				page_maximum.resize(number_of_blocks);
 				}
 
 			/*
@@ -322,11 +334,8 @@ namespace JASS
 				sorted = false;
 				accumulators.rewind();
 				non_zero_accumulators = 0;
-#ifdef ACCUMULATOR_STRATEGY_2D
-				/* Nothing */
-#else
-				std::fill(page_maximum, page_maximum + number_of_blocks, 0);
-#endif
+				if constexpr (!is_accumulator_2d<ACCUMULATORS>::value)
+					std::fill(page_maximum.data(), page_maximum.data() + number_of_blocks, 0);
 				query::rewind();
 				}
 
@@ -341,48 +350,51 @@ namespace JASS
 				{
 				if (!sorted)
 					{
-#ifdef ACCUMULATOR_STRATEGY_2D
-					/*
-						Walk through all the pages looking for the case where an accumulator in the page might appear in the results list
-					*/
-					non_zero_accumulators = 0;
-					for (size_t page = 0; page < number_of_blocks; page++)
-						if (accumulators.dirty_flag[page] == 0)
-							{
-							ACCUMULATOR_TYPE *start = &accumulators.accumulator[page * accumulators.width];
-							for (ACCUMULATOR_TYPE *which = start; which < start + accumulators.width; which++)
+					if constexpr (is_accumulator_2d<ACCUMULATORS>::value)
+						{
+						/*
+							Walk through all the pages looking for the case where an accumulator in the page might appear in the results list
+						*/
+						non_zero_accumulators = 0;
+						for (size_t page = 0; page < number_of_blocks; page++)
+							if (accumulators.dirty_flag[page] == 0)
 								{
-								if (*which != 0)
+								ACCUMULATOR_TYPE *start = &accumulators.accumulator[page * accumulators.width];
+								for (ACCUMULATOR_TYPE *which = start; which < start + accumulators.width; which++)
 									{
+									if (*which != 0)
+										{
 	#ifdef ACCUMULATOR_64s
-									sorted_accumulators[non_zero_accumulators++] = ((uint64_t)*which << (uint64_t)32) | (which - &accumulators.accumulator[0]);
+										sorted_accumulators[non_zero_accumulators++] = ((uint64_t)*which << (uint64_t)32) | (which - &accumulators.accumulator[0]);
 	#else
-									accumulator_pointers[non_zero_accumulators++] = which;
+										accumulator_pointers[non_zero_accumulators++] = which;
 	#endif
+										}
 									}
 								}
-							}
-#else
-					/*
-						Walk through all the pages looking for the case where an accumulator in the page might appear in the results list
-					*/
-					non_zero_accumulators = 0;
-					for (size_t page = 0; page < number_of_blocks; page++)
-						if (page_maximum[page] != 0)
-							{
-							for (size_t which = page * block_width; which < page * block_width + block_width; which++)
+						}
+					else
+						{
+						/*
+							Walk through all the pages looking for the case where an accumulator in the page might appear in the results list
+						*/
+						non_zero_accumulators = 0;
+						for (size_t page = 0; page < number_of_blocks; page++)
+							if (page_maximum[page] != 0)
 								{
-								if (accumulators.get_value(which) != 0)
+								for (size_t which = page * block_width; which < page * block_width + block_width; which++)
 									{
+									if (accumulators.get_value(which) != 0)
+										{
 	#ifdef ACCUMULATOR_64s
-									sorted_accumulators[non_zero_accumulators++] = ((uint64_t)accumulators.get_value(which) << (uint64_t)32) | which;
+										sorted_accumulators[non_zero_accumulators++] = ((uint64_t)accumulators.get_value(which) << (uint64_t)32) | which;
 	#else
-									accumulator_pointers[non_zero_accumulators++] = &accumulators[which];
+										accumulator_pointers[non_zero_accumulators++] = &accumulators[which];
 	#endif
+										}
 									}
 								}
-							}
-#endif
+						}
 
 					/*
 						We now sort the array over which the heap is built so that we have a sorted list of docids from highest to lowest rsv.
@@ -390,35 +402,35 @@ namespace JASS
 #ifdef ACCUMULATOR_64s
 	#ifdef JASS_TOPK_SORT
 					//CHECKED
-					top_k_qsort::sort(sorted_accumulators, non_zero_accumulators, top_k);
+					top_k_qsort::sort(sorted_accumulators.data(), non_zero_accumulators, top_k);
 					non_zero_accumulators = maths::minimum(non_zero_accumulators, top_k);
 	#elif defined(CPP_TOPK_SORT)
 					//CHECKED
 					size_t sort_point = maths::minimum(non_zero_accumulators, top_k);
-					std::partial_sort(sorted_accumulators, sorted_accumulators + sort_point, sorted_accumulators + non_zero_accumulators, std::greater<decltype(sorted_accumulators[0])>());
+					std::partial_sort(sorted_accumulators.data(), sorted_accumulators.data() + sort_point, sorted_accumulators.data() + non_zero_accumulators, std::greater<decltype(sorted_accumulators[0])>());
 					non_zero_accumulators = sort_point;
 	#elif defined(CPP_SORT)
 					//CHECKED
-					std::sort(sorted_accumulators, sorted_accumulators + non_zero_accumulators, std::greater<decltype(sorted_accumulators[0])>());
+					std::sort(sorted_accumulators.data(), sorted_accumulators.data() + non_zero_accumulators, std::greater<decltype(sorted_accumulators[0])>());
 					non_zero_accumulators = maths::minimum(non_zero_accumulators, top_k);
 	#elif defined(AVX512_SORT)
 // NOT CHECKED
-					Sort512_uint64_t::Sort(sorted_accumulators, non_zero_accumulators);
+					Sort512_uint64_t::Sort(sorted_accumulators.data(), non_zero_accumulators);
 					non_zero_accumulators = maths::minimum(non_zero_accumulators, top_k);
 	#endif
 #else
 	#ifdef JASS_TOPK_SORT
 					//CHECKED
-					top_k_qsort::sort(accumulator_pointers, non_zero_accumulators, top_k);
+					top_k_qsort::sort(accumulator_pointers.data(), non_zero_accumulators, top_k);
 					non_zero_accumulators = maths::minimum(non_zero_accumulators, top_k);
 	#elif defined(CPP_TOPK_SORT)
 					//CHECKED
 					size_t sort_point = maths::minimum(non_zero_accumulators, top_k);
-					std::partial_sort(accumulator_pointers, accumulator_pointers + sort_point, accumulator_pointers + non_zero_accumulators,  [](const ACCUMULATOR_TYPE *a, const ACCUMULATOR_TYPE *b) -> bool { return *a > *b ? true : *a < *b ? false : a > b; });
+					std::partial_sort(accumulator_pointers.data(), accumulator_pointers.data() + sort_point, accumulator_pointers.data() + non_zero_accumulators,  [](const ACCUMULATOR_TYPE *a, const ACCUMULATOR_TYPE *b) -> bool { return *a > *b ? true : *a < *b ? false : a > b; });
 					non_zero_accumulators = sort_point;
 	#elif defined(CPP_SORT)
 					//CHECKED
-					std::sort(accumulator_pointers, accumulator_pointers + non_zero_accumulators,  [](const ACCUMULATOR_TYPE *a, const ACCUMULATOR_TYPE *b) -> bool { return *a > *b ? true : *a < *b ? false : a > b; });
+					std::sort(accumulator_pointers.data(), accumulator_pointers.data() + non_zero_accumulators,  [](const ACCUMULATOR_TYPE *a, const ACCUMULATOR_TYPE *b) -> bool { return *a > *b ? true : *a < *b ? false : a > b; });
 					non_zero_accumulators = maths::minimum(non_zero_accumulators, top_k);
 	#elif defined(AVX512_SORT)
 					//CHECKED
@@ -440,13 +452,16 @@ namespace JASS
 			*/
 			forceinline void add_rsv(size_t document_id, ACCUMULATOR_TYPE score)
 				{
-#ifdef ACCUMULATOR_STRATEGY_2D
-				size_t page = accumulators.which_dirty_flag(document_id);		// get the page number
-				if (accumulators.dirty_flag[page] == 0)
-					page_maximum[page] = 0;
-#else
-				size_t page = document_id >> bucket_shift;							// get the page number
-#endif
+				size_t page;
+				if constexpr (is_accumulator_2d<ACCUMULATORS>::value)
+					{
+					page = accumulators.which_dirty_flag(document_id);		// get the page number
+					if (accumulators.dirty_flag[page] == 0)
+						page_maximum[page] = 0;
+					}
+				else
+					page = document_id >> bucket_shift;							// get the page number
+
 				ACCUMULATOR_TYPE *which = &accumulators[document_id];				// This will create the accumulator if it doesn't already exist.
 
 				*which += score;
@@ -481,7 +496,7 @@ namespace JASS
 				/*
 					D1-decode inplace with SIMD instructions then process one at a time
 				*/
-				simd::cumulative_sum_256(buffer, integers);
+				simd::cumulative_sum(buffer, integers);
 
 				/*
 					Process the d1-decoded postings list.
@@ -539,7 +554,7 @@ namespace JASS
 			*/
 			static void unittest_this(query_maxblock *query_object)
 				{
-				std::vector<std::string> keys = {"one", "two", "three", "four"};
+				primary_key_list keys({"one", "two", "three", "four"});
 				query_object->init(keys, 1024, 2);
 				query_object->rewind();
 				std::ostringstream string;
@@ -567,7 +582,7 @@ namespace JASS
 			*/
 			static void unittest(void)
 				{
-				std::vector<std::string> keys = {"one", "two", "three", "four"};
+				primary_key_list keys({"one", "two", "three", "four"});
 				auto object = new query_maxblock;
 				unittest_this(object);
 				delete object;
@@ -12,6 +12,8 @@
 */
 #pragma once
 
+#include <vector>
+
 #include "query.h"
 #include "heap.h"
 
@@ -24,9 +26,9 @@ namespace JASS
 	/*!
 		@brief Everything necessary to process a query (using a maxblock) is encapsulated in an object of this type.  Thanks go to Antonio Mallia for inveting this method.
 		@tparam ACCUMULATOR_TYPE The value-type for an accumulator (normally uint16_t or double).
-		@tparam MAX_DOCUMENTS The maximum number of documents that are ever going to exist in this collection
-		@tparam MAX_TOP_K The maximum top-k documents that are going to be asked for
+		@tparam ACCUMULATORS The accumulator strategy (accumulator_2d, accumulator_counter, or accumulator_counter_interleaved)
 	*/
+	template <typename ACCUMULATORS = accumulator_2d<query::ACCUMULATOR_TYPE>>
 	class query_maxblock_heap : public query
 		{
 		private:
@@ -53,7 +55,7 @@ namespace JASS
 					{
 					public:
 						size_t document_id;							///< The document identifier
-						const std::string &primary_key;			///< The external identifier of the document (the primary key)
+						std::string_view primary_key;				///< The external identifier of the document (the primary key)
 						ACCUMULATOR_TYPE rsv;						///< The rsv (Retrieval Status Value) relevance score
 
 					public:
@@ -67,7 +69,7 @@ namespace JASS
 							@param key [in] The external identifier of the document (the primary key).
 							@param rsv [in] The rsv (Retrieval Status Value) relevance score.
 						*/
-						docid_rsv_pair(size_t document_id, const std::string &key, ACCUMULATOR_TYPE rsv) :
+						docid_rsv_pair(size_t document_id, std::string_view key, ACCUMULATOR_TYPE rsv) :
 							document_id(document_id),
 							primary_key(key),
 							rsv(rsv)
@@ -168,59 +170,51 @@ namespace JASS
 						*/
 						virtual iterator &operator++(void)
 							{
-							where--;
+							this->where--;
 							return *this;
 							}
 					};
 
 		private:
-#ifdef ACCUMULATOR_STRATEGY_2D
-			accumulator_2d<ACCUMULATOR_TYPE, MAX_DOCUMENTS> accumulators;	///< The accumulators, one per document in the collection
-#elif defined(ACCUMULATOR_COUNTER_8)
-			accumulator_counter<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 8> accumulators;	///< The accumulators, one per document in the collection
-#elif defined(ACCUMULATOR_COUNTER_4)
-			accumulator_counter<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 4> accumulators;	///< The accumulators, one per document in the collection
-#elif defined(ACCUMULATOR_COUNTER_INTERLEAVED_8)
-			accumulator_counter_interleaved<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 8> accumulators;	///< The accumulators, one per document in the collection
-#elif defined(ACCUMULATOR_COUNTER_INTERLEAVED_8_1)
-			accumulator_counter_interleaved<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 8, 1> accumulators;	///< The accumulators, one per document in the collection
-#elif defined(ACCUMULATOR_COUNTER_INTERLEAVED_4)
-			accumulator_counter_interleaved<ACCUMULATOR_TYPE, MAX_DOCUMENTS, 4> accumulators;	///< The accumulators, one per document in the collection
-#endif
+			ACCUMULATORS accumulators;													///< The accumulators, one per document in the collection
 			size_t block_width;																	///< The number of documents per block
 			size_t bucket_shift;																	///< The amount to shift to get the right bucket
 			size_t number_of_blocks;													///< The number of blocks
 			size_t needed_for_top_k;													///< The number of results we still need in order to fill the top-k
 #ifdef ACCUMULATOR_64s
-			uint64_t sorted_accumulators[MAX_DOCUMENTS];									///< high word is the rsv, the low word is the DocID.
+			std::vector<uint64_t> sorted_accumulators;									///< high word is the rsv, the low word is the DocID (top-k of them, sized by init()).
 			heap<uint64_t> top_results;			///< Heap containing the top-k results
 #else
 			ACCUMULATOR_TYPE zero;															///< Constant zero used for pointer dereferenced comparisons
-			accumulator_pointer accumulator_pointers[MAX_TOP_K];					///< Array of pointers to the top k accumulators
+			std::vector<accumulator_pointer> accumulator_pointers;				///< Array of pointers to the top k accumulators (sized by init())
 			heap<accumulator_pointer> top_results;										///< Heap containing the top-k results
 #endif
-			ACCUMULATOR_TYPE page_maximum[accumulator_2d<ACCUMULATOR_TYPE, MAX_DOCUMENTS>::maximum_number_of_dirty_flags];		///< The current maximum value of the accumulator block
-			ACCUMULATOR_TYPE *page_maximum_pointers[accumulator_2d<ACCUMULATOR_TYPE, MAX_DOCUMENTS>::maximum_number_of_dirty_flags];		///< Poointers to the current maximum value of the accumulator block
+			std::vector<ACCUMULATOR_TYPE> page_maximum;								///< The current maximum value of the accumulator block (one per block, sized by init())
+			std::vector<ACCUMULATOR_TYPE *> page_maximum_pointers;				///< Poointers to the current maximum value of the accumulator block (one per block, sized by init())
 			bool sorted;																	///< has heap and accumulator_pointers been sorted (false after rewind() true after sort())
 
 		public:
+			static constexpr bool run_is_ascending = true;			///< The top-k is iterated from lowest to highest rsv (see run_export())
+
 			/*
 				QUERY_MAXBLOCK_HEAP::QUERY_MAXBLOCK_HEAP()
 				------------------------------------------
 			*/
 			/*!
 				@brief Constructor
-				@param primary_keys [in] Vector of the document primary keys used to convert from internal document ids to external primary keys.
+				@param primary_keys [in] The document primary keys used to convert from internal document ids to external primary keys.
 				@param documents [in] The number of documents in the collection.
 				@param top_k [in]	The top-k documents to return from the query once executed.
 			*/
 			query_maxblock_heap() :
 				number_of_blocks(0),
 #ifdef ACCUMULATOR_64s
-				top_results(sorted_accumulators, 0)
+				sorted_accumulators(1),
+				top_results(sorted_accumulators.data(), 0)
 #else
 				zero(0),
-				top_results(accumulator_pointers, 0)
+				accumulator_pointers(1),
+				top_results(accumulator_pointers.data(), 0)
 #endif
 				{
 				rewind();
@@ -243,30 +237,45 @@ namespace JASS
 			*/
 			/*!
 				@brief Initialise the object. MUST be called before first use.
-				@param primary_keys [in] Vector of the document primary keys used to convert from internal document ids to external primary keys.
+				@param primary_keys [in] The document primary keys used to convert from internal document ids to external primary keys.
 				@param documents [in] The number of documents in the collection.
 				@param top_k [in]	The top-k documents to return from the query once executed.
 				@param width [in] The width of the 2-d accumulators (if they are being used).
 			*/
-			virtual void init(const std::vector<std::string> &primary_keys, DOCID_TYPE documents = 1024, size_t top_k = 10, size_t preferred_width = 7)
+			virtual void init(const primary_key_list &primary_keys, DOCID_TYPE documents = 1024, size_t top_k = 10, size_t preferred_width = 7)
 				{
 				query::init(primary_keys, documents, top_k);
-				accumulators.init(documents, preferred_width);
-				top_results.set_top_k(top_k);
-#ifdef ACCUMULATOR_STRATEGY_2D
-				number_of_blocks = accumulators.number_of_dirty_flags;
-				block_width = accumulators.width;
-				bucket_shift = accumulators.shift;
+#ifdef ACCUMULATOR_64s
+				sorted_accumulators.resize(maths::maximum(top_k, (size_t)1));
+				top_results = decltype(top_results)(sorted_accumulators.data(), top_k);
 #else
-				if (preferred_width >= 1)
-					bucket_shift = preferred_width;
+				accumulator_pointers.resize(maths::maximum(top_k, (size_t)1));
+				top_results = decltype(top_results)(accumulator_pointers.data(), top_k);
+#endif
+				if constexpr (is_accumulator_2d<ACCUMULATORS>::value)
+					{
+					accumulators.init(documents, preferred_width);
+					number_of_blocks = accumulators.number_of_dirty_flags;
+					block_width = accumulators.width;
+					bucket_shift = accumulators.shift;
+					}
 				else
-					bucket_shift = maths::floor_log2((size_t)sqrt(documents));
+					{
+					if (preferred_width >= 1)
+						bucket_shift = preferred_width;
+					else
+						bucket_shift = maths::floor_log2((size_t)sqrt(documents));
 
-				block_width = (size_t)1 << bucket_shift;
-				number_of_blocks = (documents + block_width - 1) / block_width;
+					block_width = (size_t)1 << bucket_shift;
+					number_of_blocks = (documents + block_width - 1) / block_width;
 
-#endif
+					/*
+						sort() looks at every accumulator in a block so there must be whole blocks of them
+					*/
+					accumulators.init(number_of_blocks * block_width, preferred_width);
+					}
+				page_maximum.resize(number_of_blocks);
+				page_maximum_pointers.resize(number_of_blocks);
 				for (size_t which = 0; which < number_of_blocks; which++)
 					page_maximum_pointers[which] = &page_maximum[which];
 				}
@@ -342,7 +351,7 @@ namespace JASS
 #endif
 				accumulators.rewind();
 				needed_for_top_k = this->top_k;
-				std::fill(page_maximum, page_maximum + number_of_blocks, 0);
+				std::fill(page_maximum.data(), page_maximum.data() + number_of_blocks, 0);
 				query::rewind();
 				}
 
@@ -360,7 +369,7 @@ namespace JASS
 					/*
 						Sort the page maximum values from highest to lowest.
 					*/
-					std::sort(page_maximum_pointers, page_maximum_pointers + number_of_blocks,
+					std::sort(page_maximum_pointers.data(), page_maximum_pointers.data() + number_of_blocks,
 						[](const ACCUMULATOR_TYPE *a, const ACCUMULATOR_TYPE *b) -> bool
 						{
 						return *a > *b ? true : *a < *b ? false : a < b;
@@ -380,7 +389,7 @@ namespace JASS
 //std::cout << "page:" << *page_maximum_pointers[page] << " heap[0]:" << (sorted_accumulators[0] >> 32) << "\n";
 						if (*page_maximum_pointers[page] != 0 && *page_maximum_pointers[page] >= (sorted_accumulators[0] >> 32))
 							{
-							size_t start = (page_maximum_pointers[page] - page_maximum) * block_width;
+							size_t start = (page_maximum_pointers[page] - page_maximum.data()) * block_width;
 							for (size_t which = start; which < start + block_width; which++)
 								{
 								uint64_t key = ((uint64_t)accumulators[which] << (uint64_t)32) | which;
@@ -405,7 +414,7 @@ namespace JASS
 						{
 						if (*page_maximum_pointers[page] != 0 && *page_maximum_pointers[page] >= *accumulator_pointers[0])
 							{
-							size_t start = (page_maximum_pointers[page] - page_maximum) * block_width;
+							size_t start = (page_maximum_pointers[page] - page_maximum.data()) * block_width;
 							for (size_t which = start; which < start + block_width; which++)
 								{
 								if (accumulators.get_value(which) > 0)
@@ -435,27 +444,27 @@ namespace JASS
 #ifdef ACCUMULATOR_64s
 	#ifdef JASS_TOPK_SORT
 					// CHECKED
-					top_k_qsort::sort(sorted_accumulators + needed_for_top_k, top_k - needed_for_top_k, top_k);
+					top_k_qsort::sort(sorted_accumulators.data() + needed_for_top_k, top_k - needed_for_top_k, top_k);
 	#elif defined(CPP_TOPK_SORT)
 					// CHECKED
-					std::partial_sort(sorted_accumulators + needed_for_top_k, sorted_accumulators + top_k, sorted_accumulators + top_k);
+					std::partial_sort(sorted_accumulators.data() + needed_for_top_k, sorted_accumulators.data() + top_k, sorted_accumulators.data() + top_k);
 	#elif defined(CPP_SORT)
 					// CHECKED
-					std::sort(sorted_accumulators + needed_for_top_k, sorted_accumulators + top_k);
+					std::sort(sorted_accumulators.data() + needed_for_top_k, sorted_accumulators.data() + top_k);
 	#elif defined(AVX512_SORT)
 // NOT CHECKED
-					Sort512_uint64_t::Sort(sorted_accumulators + needed_for_top_k, top_k - needed_for_top_k);
+					Sort512_uint64_t::Sort(sorted_accumulators.data() + needed_for_top_k, top_k - needed_for_top_k);
 	#endif
 #else
 	#ifdef JASS_TOPK_SORT
 					// CHECKED
-					top_k_qsort::sort(accumulator_pointers + needed_for_top_k, top_k - needed_for_top_k, top_k);
+					top_k_qsort::sort(accumulator_pointers.data() + needed_for_top_k, top_k - needed_for_top_k, top_k);
 	#elif defined(CPP_TOPK_SORT)
 					// CHECKED
-					std::partial_sort(accumulator_pointers + needed_for_top_k, accumulator_pointers + top_k, accumulator_pointers + top_k);
+					std::partial_sort(accumulator_pointers.data() + needed_for_top_k, accumulator_pointers.data() + top_k, accumulator_pointers.data() + top_k);
 	#elif defined(CPP_SORT)
 					// CHECKED
-					std::sort(accumulator_pointers + needed_for_top_k, accumulator_pointers + top_k);
+					std::sort(accumulator_pointers.data() + needed_for_top_k, accumulator_pointers.data() + top_k);
 	#elif defined(AVX512_SORT)
 					// CHECKED
 					assert(false);
@@ -511,7 +520,7 @@ namespace JASS
 				/*
 					D1-decode inplace with SIMD instructions then process one at a time
 				*/
-				simd::cumulative_sum_256(buffer, integers);
+				simd::cumulative_sum(buffer, integers);
 
 				/*
 					Process the d1-decoded postings list.
@@ -568,7 +577,7 @@ namespace JASS
 			*/
 			static void unittest(void)
 				{
-				std::vector<std::string> keys = {"one", "two", "three", "four"};
+				primary_key_list keys({"one", "two", "three", "four"});
 				query_maxblock_heap *query_object = new query_maxblock_heap;
 				query_object->init(keys, 1024, 2);
 				std::ostringstream string;
@@ -118,6 +118,18 @@ namespace JASS
 					}
 				}
 
+			/*
+				QUERY_TERM_LIST::CLEAR()
+				------------------------
+			*/
+			/*!
+				@brief Remove all the terms from the list so that it can be re-used for another query.
+			*/
+			void clear(void)
+				{
+				terms_in_query = 0;
+				}
+
 			/*
 				QUERY_TERM_LIST::SORT_UNIQUE()
 				------------------------------
@@ -253,6 +265,23 @@ namespace JASS
 				into << terms;
 				JASS_assert(into.str() == "(a,2)(b,2)");
 				}
+
+				/*
+					Cleared list re-used
+				*/
+				{
+				query_term_list terms;
+
+				terms.push_back("a");
+				terms.push_back("b");
+				terms.clear();
+				terms.push_back("c");
+
+				terms.sort_unique();
+				std::ostringstream into;
+				into << terms;
+				JASS_assert(into.str() == "(c,1)");
+				}
 				
 				puts("query_term_list::PASSED");
 				}
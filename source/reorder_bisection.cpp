@@ -0,0 +1,288 @@
+/*
+	REORDER_BISECTION.CPP
+	---------------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <math.h>
+#include <string.h>
+
+#include <numeric>
+#include <algorithm>
+
+#include "maths.h"
+#include "asserts.h"
+#include "allocator_pool.h"
+#include "index_postings.h"
+#include "reorder_bisection.h"
+
+namespace JASS
+	{
+	/*
+		REORDER_BISECTION::OPERATOR()()
+		-------------------------------
+	*/
+	void reorder_bisection::operator()(const slice &term, const index_postings &postings, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
+		{
+		list_postings.insert(list_postings.end(), document_ids, document_ids + document_frequency);
+		list_start.push_back(list_postings.size());
+		}
+
+	/*
+		REORDER_BISECTION::BISECT()
+		---------------------------
+	*/
+	void reorder_bisection::bisect(compress_integer::integer *documents, size_t length, size_t iterations, size_t smallest_partition)
+		{
+		/*
+			Small parts are left in their original order
+		*/
+		if (length <= smallest_partition)
+			{
+			std::sort(documents, documents + length);
+			return;
+			}
+
+		size_t left = length / 2;
+		size_t right = length - left;
+		compress_integer::integer *middle = documents + left;
+		compress_integer::integer *end = documents + length;
+
+		for (auto *document = documents; document < end; document++)
+			for (size_t term = document_start[*document]; term < document_start[*document + 1]; term++)
+				if (document < middle)
+					degree_left[document_terms[term]]++;
+				else
+					degree_right[document_terms[term]]++;
+
+		for (size_t iteration = 0; iteration < iterations; iteration++)
+			{
+			/*
+				Compute the gain of moving each document to the other part
+			*/
+			round++;
+			for (auto *document = documents; document < end; document++)
+				{
+				double gain = 0;
+				for (size_t which = document_start[*document]; which < document_start[*document + 1]; which++)
+					{
+					compress_integer::integer term = document_terms[which];
+					if (gain_computed[term] != round)
+						{
+						size_t in_left = degree_left[term];
+						size_t in_right = degree_right[term];
+						double before = partition_cost(left, in_left, right, in_right);
+						gain_left[term] = in_left == 0 ? 0 : before - partition_cost(left, in_left - 1, right, in_right + 1);
+						gain_right[term] = in_right == 0 ? 0 : before - partition_cost(left, in_left + 1, right, in_right - 1);
+						gain_computed[term] = round;
+						}
+					gain += document < middle ? gain_left[term] : gain_right[term];
+					}
+				document_gain[*document] = gain;
+				}
+
+			/*
+				Swap the documents that gain the most from moving while the swap reduces the cost
+			*/
+			auto most_gain_first = [this](compress_integer::integer lhs, compress_integer::integer rhs)
+				{
+				return document_gain[lhs] > document_gain[rhs] || (document_gain[lhs] == document_gain[rhs] && lhs < rhs);
+				};
+			std::sort(documents, middle, most_gain_first);
+			std::sort(middle, end, most_gain_first);
+
+			size_t swaps = 0;
+			for (size_t which = 0; which < left && which < right; which++)
+				{
+				compress_integer::integer &from_left = documents[which];
+				compress_integer::integer &from_right = middle[which];
+				if (document_gain[from_left] + document_gain[from_right] <= 0)
+					break;
+
+				for (size_t term = document_start[from_left]; term < document_start[from_left + 1]; term++)
+					{
+					degree_left[document_terms[term]]--;
+					degree_right[document_terms[term]]++;
+					}
+				for (size_t term = document_start[from_right]; term < document_start[from_right + 1]; term++)
+					{
+					degree_right[document_terms[term]]--;
+					degree_left[document_terms[term]]++;
+					}
+				std::swap(from_left, from_right);
+				swaps++;
+				}
+
+			if (swaps == 0)
+				break;
+			}
+
+		/*
+			Clear the degrees for the next split, then split each part
+		*/
+		for (auto *document = documents; document < end; document++)
+			for (size_t term = document_start[*document]; term < document_start[*document + 1]; term++)
+				degree_left[document_terms[term]] = degree_right[document_terms[term]] = 0;
+
+		bisect(documents, left, iterations, smallest_partition);
+		bisect(middle, right, iterations, smallest_partition);
+		}
+
+	/*
+		REORDER_BISECTION::COMPUTE()
+		----------------------------
+	*/
+	const std::vector<compress_integer::integer> &reorder_bisection::compute(size_t iterations, size_t smallest_partition)
+		{
+		size_t terms = list_start.size() - 1;
+
+		/*
+			Build the forward index (each document's list of terms) from the postings lists with more than one posting
+		*/
+		document_start.assign(documents + 2, 0);
+		for (size_t term = 0; term < terms; term++)
+			if (list_start[term + 1] - list_start[term] > 1)
+				for (size_t which = list_start[term]; which < list_start[term + 1]; which++)
+					document_start[list_postings[which] + 1]++;
+		std::partial_sum(document_start.begin(), document_start.end(), document_start.begin());
+
+		document_terms.resize(document_start.back());
+		std::vector<size_t> used(document_start.begin(), document_start.end() - 1);
+		for (size_t term = 0; term < terms; term++)
+			if (list_start[term + 1] - list_start[term] > 1)
+				for (size_t which = list_start[term]; which < list_start[term + 1]; which++)
+					document_terms[used[list_postings[which]]++] = static_cast<compress_integer::integer>(term);
+
+		/*
+			Split (document ids count from 1)
+		*/
+		degree_left.assign(terms, 0);
+		degree_right.assign(terms, 0);
+		gain_left.assign(terms, 0);
+		gain_right.assign(terms, 0);
+		gain_computed.assign(terms, 0);
+		document_gain.assign(documents + 1, 0);
+		log2_of.resize(documents + 2);
+		log2_of[0] = 0;
+		for (size_t which = 1; which < log2_of.size(); which++)
+			log2_of[which] = log2(static_cast<double>(which));
+
+		std::vector<compress_integer::integer> order(documents);
+		std::iota(order.begin(), order.end(), 1);
+		if (documents != 0)
+			bisect(&order[0], order.size(), iterations, smallest_partition);
+
+		new_id.assign(documents + 1, 0);
+		for (size_t which = 0; which < order.size(); which++)
+			new_id[order[which]] = static_cast<compress_integer::integer>(which + 1);
+
+		/*
+			Free the working memory
+		*/
+		std::vector<size_t>().swap(document_start);
+		std::vector<compress_integer::integer>().swap(document_terms);
+		std::vector<compress_integer::integer>().swap(degree_left);
+		std::vector<compress_integer::integer>().swap(degree_right);
+		std::vector<double>().swap(gain_left);
+		std::vector<double>().swap(gain_right);
+		std::vector<size_t>().swap(gain_computed);
+		std::vector<double>().swap(document_gain);
+
+		return new_id;
+		}
+
+	/*
+		REORDER_BISECTION::BITS_PER_POSTING()
+		-------------------------------------
+	*/
+	double reorder_bisection::bits_per_posting(const std::vector<compress_integer::integer> *document_ids) const
+		{
+		if (list_postings.size() == 0)
+			return 0;
+
+		size_t bits = 0;
+		std::vector<compress_integer::integer> list;
+		for (size_t term = 0; term < list_start.size() - 1; term++)
+			{
+			list.assign(list_postings.begin() + list_start[term], list_postings.begin() + list_start[term + 1]);
+			if (document_ids != nullptr)
+				{
+				for (auto &id : list)
+					id = (*document_ids)[id];
+				std::sort(list.begin(), list.end());
+				}
+
+			compress_integer::integer previous = 0;
+			for (auto id : list)
+				{
+				bits += 2 * maths::floor_log2(id - previous) + 1;
+				previous = id;
+				}
+			}
+
+		return static_cast<double>(bits) / list_postings.size();
+		}
+
+	/*
+		REORDER_BISECTION::UNITTEST()
+		-----------------------------
+	*/
+	void reorder_bisection::unittest(void)
+		{
+		allocator_pool memory;
+		index_postings unused(memory);
+		std::vector<index_postings_impact::impact_type> frequencies(64, 1);
+
+		/*
+			Two interleaved clusters of documents (the odd and the even), each split again into two halves
+		*/
+		std::vector<std::vector<compress_integer::integer>> lists(5);
+		for (compress_integer::integer document = 1; document <= 64; document++)
+			{
+			lists[document % 2].push_back(document);
+			if (document % 2 == 0 && document <= 32)
+				lists[2].push_back(document);
+			if (document % 2 == 1 && document > 32)
+				lists[3].push_back(document);
+			}
+		lists[4].push_back(7);
+
+		reorder_bisection reorderer(64);
+		for (auto &list : lists)
+			reorderer(slice("term"), unused, static_cast<compress_integer::integer>(list.size()), &list[0], &frequencies[0]);
+
+		/*
+			Re-numbering must produce a permutation that costs less than the original order
+		*/
+		auto new_id = reorderer.compute(default_iterations, 4);
+		JASS_assert(new_id.size() == 65);
+		JASS_assert(new_id[0] == 0);
+		std::vector<compress_integer::integer> sorted(new_id.begin() + 1, new_id.end());
+		std::sort(sorted.begin(), sorted.end());
+		for (size_t which = 0; which < sorted.size(); which++)
+			JASS_assert(sorted[which] == which + 1);
+
+		JASS_assert(reorderer.bits_per_posting(&new_id) < reorderer.bits_per_posting());
+
+		/*
+			Documents in the same cluster are now together
+		*/
+		std::vector<compress_integer::integer> even_ids;
+		for (auto document : lists[0])
+			even_ids.push_back(new_id[document]);
+		std::sort(even_ids.begin(), even_ids.end());
+		JASS_assert(even_ids.back() - even_ids.front() + 1 == even_ids.size());
+
+		/*
+			If the parts are too small to split then nothing changes
+		*/
+		new_id = reorderer.compute(default_iterations, 64);
+		for (size_t which = 0; which < new_id.size(); which++)
+			JASS_assert(new_id[which] == which);
+
+		/*
+			Yay, we passed
+		*/
+		puts("reorder_bisection::PASSED");
+		}
+	}
@@ -0,0 +1,180 @@
+/*
+	REORDER_BISECTION.H
+	-------------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Re-number the documents in a collection so that similar documents have close document ids (recursive graph bisection).
+	@author Andrew Trotman
+	@copyright 2021 Andrew Trotman
+*/
+#pragma once
+
+#include <vector>
+
+#include "index_manager.h"
+
+namespace JASS
+	{
+	/*
+		CLASS REORDER_BISECTION
+		-----------------------
+	*/
+	/*!
+		@brief Re-number the documents in a collection so that similar documents have close document ids (recursive graph bisection).
+		@details The postings lists are gathered by iterating over the index with this object as the delegate, then compute() finds the new
+		document ids.  This is the algorithm of:
+		L. Dhulipala, I. Kabiljo, B. Karrer, G. Ottaviano, S. Pupyrev, A. Shalita (2016), Compressing Graphs and Indexes with Recursive Graph
+		Bisection, Proceedings of KDD 2016, pp. 1535-1544.
+		The documents are split into two halves and documents are swapped between the halves while doing so reduces the estimated cost
+		(in bits) of storing the d-gaps of the postings lists.  Each half is then split in the same way, and so on until the parts are small.
+		Terms that occur in only one document do not affect the split and are ignored.  The cost of storing the index is reported as the
+		number of bits per posting of Elias gamma encoded d-gaps (of the postings lists in document order) before and after re-numbering.
+		Use reorder_remap to apply the new document ids while serialising the index.
+	*/
+	class reorder_bisection : public index_manager::delegate
+		{
+		public:
+			static constexpr size_t default_iterations = 20;				///< The maximum number of rounds of swaps at each split
+			static constexpr size_t default_smallest_partition = 32;		///< Parts with this many documents or fewer are not split
+
+		private:
+			std::vector<size_t> list_start;										///< Where each postings list starts in list_postings
+			std::vector<compress_integer::integer> list_postings;			///< The concatenated postings lists (document ids only)
+			std::vector<size_t> document_start;									///< Where each document's list of terms starts in document_terms (the forward index)
+			std::vector<compress_integer::integer> document_terms;		///< The terms (the postings lists with more than one posting) in each document
+
+			std::vector<compress_integer::integer> degree_left;			///< The number of documents in the left part that contain each term
+			std::vector<compress_integer::integer> degree_right;			///< The number of documents in the right part that contain each term
+			std::vector<double> gain_left;										///< The gain (in bits) of moving a document containing each term from the left part to the right part
+			std::vector<double> gain_right;										///< The gain (in bits) of moving a document containing each term from the right part to the left part
+			std::vector<size_t> gain_computed;									///< The round in which the gains of each term were last computed
+			std::vector<double> document_gain;									///< The gain (in bits) of moving each document to the other part
+			std::vector<double> log2_of;											///< log2_of[x] == log2(x)
+			size_t round;																///< The number of rounds of swaps done so far (over all splits)
+
+			std::vector<compress_integer::integer> new_id;					///< The new document id of each document (indexed by the old document id)
+
+		private:
+			/*
+				REORDER_BISECTION::PARTITION_COST()
+				-----------------------------------
+			*/
+			/*!
+				@brief The estimated cost (in bits) of the d-gaps of a term given the number of documents in each part that contain the term
+				@param left_documents [in] The number of documents in the left part.
+				@param left_degree [in] The number of documents in the left part that contain the term.
+				@param right_documents [in] The number of documents in the right part.
+				@param right_degree [in] The number of documents in the right part that contain the term.
+				@return The estimated cost.
+			*/
+			double partition_cost(size_t left_documents, size_t left_degree, size_t right_documents, size_t right_degree) const
+				{
+				return left_degree * (log2_of[left_documents] - log2_of[left_degree + 1]) + right_degree * (log2_of[right_documents] - log2_of[right_degree + 1]);
+				}
+
+			/*
+				REORDER_BISECTION::BISECT()
+				---------------------------
+			*/
+			/*!
+				@brief Split the documents into two parts, then split those parts, and so on.
+				@param documents [in/out] The documents to split, which are re-ordered.
+				@param length [in] The number of documents.
+				@param iterations [in] The maximum number of rounds of swaps at each split.
+				@param smallest_partition [in] Parts with this many documents or fewer are not split.
+			*/
+			void bisect(compress_integer::integer *documents, size_t length, size_t iterations, size_t smallest_partition);
+
+		public:
+			/*
+				REORDER_BISECTION::REORDER_BISECTION()
+				--------------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param documents [in] The number of documents in the collection.
+			*/
+			explicit reorder_bisection(size_t documents) :
+				index_manager::delegate(documents),
+				list_start(1, 0),
+				round(0)
+				{
+				/* Nothing */
+				}
+
+			/*
+				REORDER_BISECTION::~REORDER_BISECTION()
+				---------------------------------------
+			*/
+			/*!
+				@brief Destructor
+			*/
+			virtual ~reorder_bisection()
+				{
+				/* Nothing */
+				}
+
+			/*
+				REORDER_BISECTION::OPERATOR()()
+				-------------------------------
+			*/
+			/*!
+				@brief Gather a postings list.
+				@param term [in] The term name.
+				@param postings [in] The postings list.
+				@param document_frequency [in] The document frequency of the term
+				@param document_ids [in] An array (of length document_frequency) of document ids.
+				@param term_frequencies [in] An array (of length document_frequency) of term frequencies (corresponding to document_ids).
+			*/
+			virtual void operator()(const slice &term, const index_postings &postings, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies);
+
+			/*
+				REORDER_BISECTION::OPERATOR()()
+				-------------------------------
+			*/
+			/*!
+				@brief The primary keys are not needed.
+				@param document_id [in] The internal document identfier.
+				@param primary_key [in] This document's primary key (external document identifier).
+			*/
+			virtual void operator()(size_t document_id, const slice &primary_key)
+				{
+				/* Nothing */
+				}
+
+			/*
+				REORDER_BISECTION::COMPUTE()
+				----------------------------
+			*/
+			/*!
+				@brief Compute the new document ids (after the postings lists have been gathered).
+				@param iterations [in] The maximum number of rounds of swaps at each split.
+				@param smallest_partition [in] Parts with this many documents or fewer are not split.
+				@return The new document id of each document, indexed by the old document id (document ids count from 1, and element 0 is 0).
+			*/
+			const std::vector<compress_integer::integer> &compute(size_t iterations = default_iterations, size_t smallest_partition = default_smallest_partition);
+
+			/*
+				REORDER_BISECTION::BITS_PER_POSTING()
+				-------------------------------------
+			*/
+			/*!
+				@brief Return the number of bits per posting needed to store the Elias gamma encoded d-gaps of the gathered postings lists.
+				@param document_ids [in] The new document id of each document (indexed by the old document id), or nullptr for the document ids as they are.
+				@return The bits per posting (0 if there are no postings).
+			*/
+			double bits_per_posting(const std::vector<compress_integer::integer> *document_ids = nullptr) const;
+
+			/*
+				REORDER_BISECTION::UNITTEST()
+				-----------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+	}
@@ -0,0 +1,201 @@
+/*
+	REORDER_REMAP.H
+	---------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Re-number the documents of an index as it is passed to a serialiser.
+	@author Andrew Trotman
+	@copyright 2021 Andrew Trotman
+*/
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <utility>
+#include <sstream>
+#include <algorithm>
+
+#include "asserts.h"
+#include "index_manager.h"
+#include "allocator_pool.h"
+#include "index_postings.h"
+
+namespace JASS
+	{
+	/*
+		CLASS REORDER_REMAP
+		-------------------
+	*/
+	/*!
+		@brief Re-number the documents of an index as it is passed to a serialiser.
+		@details This delegate sits between the index (or the quantizer) and a serialiser.  The document ids of each postings list are
+		replaced with their new ids and the list is put back into document id order before it is passed on.  The primary keys are held
+		until the last has been seen and are then passed on in the order of the new document ids, so the primary key of each document stays
+		with the document.  The serialiser is deleted when this object is deleted.
+	*/
+	class reorder_remap : public index_manager::delegate
+		{
+		private:
+			const std::vector<compress_integer::integer> &new_id;												///< The new document id of each document (indexed by the old document id)
+			std::unique_ptr<index_manager::delegate> writer;													///< The serialiser that is passed the re-numbered index
+			std::vector<std::pair<compress_integer::integer, index_postings_impact::impact_type>> list;	///< The re-numbered postings list being sorted
+			std::vector<compress_integer::integer> document_ids;												///< The re-numbered document ids passed to the writer
+			std::vector<index_postings_impact::impact_type> term_frequencies;								///< The term frequencies passed to the writer
+			std::vector<std::string> primary_key;																	///< The primary keys (indexed by the new document id)
+			size_t primary_keys_seen;																					///< The number of primary keys seen so far
+
+		public:
+			/*
+				REORDER_REMAP::REORDER_REMAP()
+				------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param new_id [in] The new document id of each document, indexed by the old document id (see reorder_bisection::compute()).  This must remain valid for the life of this object.
+				@param writer [in] The serialiser to pass the re-numbered index to.
+			*/
+			reorder_remap(const std::vector<compress_integer::integer> &new_id, std::unique_ptr<index_manager::delegate> writer) :
+				index_manager::delegate(writer->documents),
+				new_id(new_id),
+				writer(std::move(writer)),
+				primary_key(new_id.size()),
+				primary_keys_seen(0)
+				{
+				/* Nothing */
+				}
+
+			/*
+				REORDER_REMAP::~REORDER_REMAP()
+				-------------------------------
+			*/
+			/*!
+				@brief Destructor
+			*/
+			virtual ~reorder_remap()
+				{
+				/* Nothing */
+				}
+
+			/*
+				REORDER_REMAP::OPERATOR()()
+				---------------------------
+			*/
+			/*!
+				@brief Re-number a postings list and pass it to the writer.
+				@param term [in] The term name.
+				@param postings [in] The postings list (in the original document order).
+				@param document_frequency [in] The document frequency of the term
+				@param document_ids [in] An array (of length document_frequency) of document ids.
+				@param term_frequencies [in] An array (of length document_frequency) of term frequencies (corresponding to document_ids).
+			*/
+			virtual void operator()(const slice &term, const index_postings &postings, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
+				{
+				list.resize(document_frequency);
+				for (compress_integer::integer which = 0; which < document_frequency; which++)
+					list[which] = std::make_pair(new_id[document_ids[which]], term_frequencies[which]);
+				std::sort(list.begin(), list.end());
+
+				this->document_ids.resize(document_frequency);
+				this->term_frequencies.resize(document_frequency);
+				for (compress_integer::integer which = 0; which < document_frequency; which++)
+					{
+					this->document_ids[which] = list[which].first;
+					this->term_frequencies[which] = list[which].second;
+					}
+
+				(*writer)(term, postings, document_frequency, this->document_ids.data(), this->term_frequencies.data());
+				}
+
+			/*
+				REORDER_REMAP::OPERATOR()()
+				---------------------------
+			*/
+			/*!
+				@brief Hold a primary key, and once they have all been seen pass them to the writer in the new order.
+				@param document_id [in] The internal document identfier.
+				@param primary_key [in] This document's primary key (external document identifier).
+			*/
+			virtual void operator()(size_t document_id, const slice &primary_key)
+				{
+				this->primary_key[new_id[document_id]].assign(reinterpret_cast<char *>(primary_key.address()), primary_key.size());
+
+				if (++primary_keys_seen == new_id.size())
+					for (size_t which = 0; which < this->primary_key.size(); which++)
+						(*writer)(which, slice(const_cast<char *>(this->primary_key[which].c_str()), this->primary_key[which].size()));
+				}
+
+			/*
+				REORDER_REMAP::UNITTEST()
+				-------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void)
+				{
+				/*
+					A writer that records what it is given
+				*/
+				class recorder : public index_manager::delegate
+					{
+					private:
+						std::ostringstream &into;
+
+					public:
+						recorder(std::ostringstream &into) :
+							index_manager::delegate(3),
+							into(into)
+							{
+							/* Nothing */
+							}
+
+						virtual void operator()(const slice &term, const index_postings &postings, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
+							{
+							into << term << ':';
+							for (compress_integer::integer which = 0; which < document_frequency; which++)
+								into << '<' << document_ids[which] << ',' << term_frequencies[which] << '>';
+							into << '\n';
+							}
+
+						virtual void operator()(size_t document_id, const slice &primary_key)
+							{
+							into << document_id << "->" << primary_key << '\n';
+							}
+					};
+
+				/*
+					Swap the documents around (1 becomes 3, 2 becomes 1, and 3 becomes 2)
+				*/
+				std::ostringstream result;
+				std::vector<compress_integer::integer> new_id = {0, 3, 1, 2};
+				do
+					{
+					reorder_remap remap(new_id, std::unique_ptr<index_manager::delegate>(new recorder(result)));
+
+					allocator_pool memory;
+					index_postings unused(memory);
+					std::vector<compress_integer::integer> document_ids = {1, 2, 3};
+					std::vector<index_postings_impact::impact_type> term_frequencies = {10, 20, 30};
+
+					remap(slice("cat"), unused, 3, &document_ids[0], &term_frequencies[0]);
+					remap(slice("dog"), unused, 1, &document_ids[2], &term_frequencies[0]);
+					remap(0, slice("-"));
+					remap(1, slice("one"));
+					remap(2, slice("two"));
+					remap(3, slice("three"));
+					}
+				while (0);
+
+				JASS_assert(result.str() == "cat:<1,20><2,30><3,10>\ndog:<2,10>\n0->-\n1->two\n2->three\n3->one\n");
+
+				/*
+					Yay, we passed
+				*/
+				puts("reorder_remap::PASSED");
+				}
+		};
+	}
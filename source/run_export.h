@@ -82,8 +82,9 @@ namespace JASS
 			static void unittest(void)
 				{
 				std::vector<uint32_t>integer_sequence = {1, 1, 1, 1, 1, 1};
-				std::vector<std::string>primary_keys = {"zero", "one", "two", "three", "four", "five", "six"};
-				compress_integer_none *identity = new compress_integer_none;
+				primary_key_list primary_keys({"zero", "one", "two", "three", "four", "five", "six"});
+				query_heap_clean<> *identity = new query_heap_clean<>;
+				identity->set_codex(std::make_unique<compress_integer_none>());
 				identity->init(primary_keys, 10, 10);
 				std::ostringstream result;
 
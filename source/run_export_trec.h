@@ -13,6 +13,7 @@
 #pragma once
 
 #include "reverse.h"
+#include "query_heap_clean.h"
 #include "compress_integer_none.h"
 
 namespace JASS
@@ -91,8 +92,9 @@ namespace JASS
 			static void unittest(void)
 				{
 				std::vector<uint32_t>integer_sequence = {1, 1, 1, 1, 1, 1};
-				std::vector<std::string>primary_keys = {"zero", "one", "two", "three", "four", "five", "six"};
-				compress_integer_none *identity = new compress_integer_none;
+				primary_key_list primary_keys({"zero", "one", "two", "three", "four", "five", "six"});
+				query_heap_clean<> *identity = new query_heap_clean<>;
+				identity->set_codex(std::make_unique<compress_integer_none>());
 				identity->init(primary_keys, 10, 10);
 				std::ostringstream result;
 
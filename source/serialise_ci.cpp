@@ -82,7 +82,7 @@ namespace JASS
 		/*
 			Construct the method and write it out
 		*/
-		code << "void T_" << term << "(query_heap &q)\n";
+		code << "void T_" << term << "(query_heap<> &q)\n";
 		code << "{\n";
 
 		/*
@@ -110,7 +110,7 @@ namespace JASS
 		*/
 		postings_header_file.write("void T_");
 		postings_header_file.write(term.address(), term.size());
-		postings_header_file.write("(query_heap &);\n");
+		postings_header_file.write("(query_heap<> &);\n");
 
 		terms++;
 		}
@@ -153,11 +153,11 @@ namespace JASS
 
 		auto checksum = checksum::fletcher_16_file("JASS_postings.cpp");
 //		std::cout << "JASS_postings.c:" << checksum << '\n';
-		JASS_assert(checksum == 35708 || checksum == 5482);
+		JASS_assert(checksum == 8443 || checksum == 26894);
 
 		checksum = checksum::fletcher_16_file("JASS_postings.h");
 //		std::cout << "JASS_postings.h:" << checksum << '\n';
-		JASS_assert(checksum == 31263 || checksum == 44045);
+		JASS_assert(checksum == 22686 || checksum == 63664);
 
 		checksum = checksum::fletcher_16_file("JASS_vocabulary.cpp");
 //		std::cout << "JASS_vocabulary.cpp:" << checksum << '\n';
@@ -4,10 +4,12 @@
 	Copyright (c) 2016 Andrew Trotman
 	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
 */
+#include <limits>
 #include <algorithm>
 
 #include "reverse.h"
 #include "checksum.h"
+#include "threads.h"
 #include "allocator.h"
 #include "serialise_jass_v1.h"
 #include "compress_integer_all.h"
@@ -21,6 +23,11 @@ namespace JASS
 	*/
 	serialise_jass_v1::~serialise_jass_v1()
 		{
+		/*
+			Write any postings lists still in the queue
+		*/
+		flush();
+
 		/*
 			Sort then serialise the contents of the CIvocab.bin file.
 		*/
@@ -46,29 +53,69 @@ namespace JASS
 		}
 
 	/*
-		SERIALISE_JASS_V1::WRITE_POSTINGS()
-		-----------------------------------
+		SERIALISE_JASS_V1::COMPRESSOR::COMPRESS()
+		-----------------------------------------
 	*/
-	size_t serialise_jass_v1::write_postings(const index_postings &postings_list, size_t &number_of_impacts, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
+	void serialise_jass_v1::compressor::compress(size_t documents, uint8_t alignment, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies, compressed_postings &into)
 		{
 		/*
-			Keep a track of where the postings are stored on disk.
+			Impact order the postings list.
 		*/
-		size_t postings_location = postings.tell();
+		index_postings::impact_order(documents, impact_ordered, document_frequency, document_ids, term_frequencies);
 
 		/*
-			Impact order the postings list.
+			Compress each segment (highest impact first), padding each to the alignment.
 		*/
-		postings_list.impact_order(documents, impact_ordered, document_frequency, document_ids, term_frequencies);
+		uint8_t *compress_into = &compressed_buffer[0];
+		auto compress_into_size = compressed_buffer.size();
+		into.segments.clear();
+		for (auto &header : reverse(impact_ordered))
+			{
+			/*
+				This is where compression happens.
+				First D1 encode, then use the encoder to compress.
+			*/
+			compress_integer::d1_encode(header.begin(), header.begin(), header.size());
+			*header.begin() -= 1;			// JASS v1 counts documents from 0.
+			auto took = encoder->encode(compress_into, compress_into_size, header.begin(), header.size());
+			if (took == 0)
+				{
+				/*
+					Compression failed - exit
+				*/
+				std::cout <<  "Failed to compress postings list while serialising" << std::ends;
+				exit(1);
+				}
 
+			/*
+				Round up to the next word-aligned boundary
+			*/
+			auto padding = allocator::realign(took, alignment);
+			std::fill(compress_into + took, compress_into + took + padding, 0);
+
+			into.segments.push_back(compressed_postings::segment{static_cast<uint16_t>(header.impact_score), took, static_cast<uint32_t>(header.size())});
+			compress_into += took + padding;
+			compress_into_size -= took + padding;
+			}
+
+		into.data.assign(&compressed_buffer[0], compress_into);
+		}
+
+	/*
+		SERIALISE_JASS_V1::WRITE_POSTINGS()
+		-----------------------------------
+	*/
+	size_t serialise_jass_v1::write_postings(const compressed_postings &postings_list)
+		{
 		/*
-			Compute the number of impact headers we're going to see.
+			Keep a track of where the postings are stored on disk.
 		*/
-		number_of_impacts = impact_ordered.impact_size();
+		size_t postings_location = postings.tell();
 
 		/*
 			Write out each pointer to an impact header.
 		*/
+		size_t number_of_impacts = postings_list.segments.size();
 		uint64_t offset = postings_location + number_of_impacts * sizeof(offset);
 		uint64_t impact_header_size = sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint64_t) + sizeof(uint32_t);
 		for (size_t which = 0; which < number_of_impacts; which++)
@@ -78,71 +125,37 @@ namespace JASS
 			}
 
 		/*
-			Write out each impact header, and compress as we go so we know where the data will be stored.
+			Write out each impact header, now that we know where each segment will be stored.
 		*/
 		size_t start_of_postings = offset + impact_header_size;									// +1 because there's a 0 terminator at the end
 		auto wastage = allocator::realign(start_of_postings, alignment);						// Pad the start of the postings to be on a word boundary
 		start_of_postings += wastage;
 
-		uint8_t *compress_into = &compressed_buffer[0];
-		auto compress_into_size = compressed_buffer.size();
-		compressed_segments.clear();
-		for (auto &header : reverse(impact_ordered))
+		for (const auto &header : postings_list.segments)
 			{
 			/*
 				Impact score (uint16_t).
 			*/
-			uint16_t score = static_cast<uint16_t>(header.impact_score);
-			postings.write(&score, sizeof(score));
+			postings.write(&header.impact_score, sizeof(header.impact_score));
 
 			/*
 				Start loction on disk (uint64_t).
 			*/
 			uint64_t start_location = start_of_postings;
-
 			postings.write(&start_location, sizeof(start_location));
 
-			/*
-				This is where compression happens.
-				First D1 encode, then use the encoder to compress.
-			*/
-			compress_integer::d1_encode(header.begin(), header.begin(), header.size());
-			*header.begin() -= 1;			// JASS v1 counts documents from 0.
-			auto took = encoder->encode(compress_into, compress_into_size, header.begin(), header.size());
-			if (took == 0)
-				{
-				/*
-					Compression failed - exit
-				*/
-				std::cout <<  "Failed to compress postings list while serialising" << std::ends;
-				exit(1);
-				}
-				
-			/*
-				Round up to the next word-aligned boundary
-			*/
-			auto padding = allocator::realign(took, alignment);
-
-			/*
-				Store it for writing out later
-			*/
-			compressed_segments.push_back(slice(compress_into, took + padding));
-			compress_into += took;
-			compress_into_size -= took;
-
 			/*
 				End location on disk (uint64_t).
 			*/
-			uint64_t finish_location = start_of_postings + took;
+			uint64_t finish_location = start_of_postings + header.length;
 			postings.write(&finish_location, sizeof(finish_location));
 
 			/*
 				The number of document ids with this impact score (length of the impact segment measured in doc_ids).
 			*/
-			uint32_t frequency = static_cast<uint32_t>(header.size());
-			postings.write(&frequency, sizeof(frequency));
+			postings.write(&header.frequency, sizeof(header.frequency));
 
-			start_of_postings = finish_location + padding;
+			start_of_postings = finish_location + allocator::realign(header.length, alignment);
 			}
 
 		/*
@@ -157,10 +170,9 @@ namespace JASS
 		postings.write(zero, wastage);			
 
 		/*
-			Write out each postings list segment.
+			Write out the postings list segments.
 		*/
-		for (auto &header : compressed_segments)
-			postings.write(header.address(), header.size());
+		postings.write(postings_list.data.data(), postings_list.data.size());
 
 		/*
 			Return the location of the postings list on disk
@@ -169,18 +181,15 @@ namespace JASS
 		}
 
 	/*
-		SERIALISE_JASS_V1::OPERATOR()()
+		SERIALISE_JASS_V1::WRITE_TERM()
 		-------------------------------
 	*/
-	void serialise_jass_v1::operator()(const slice &term, const index_postings &postings, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
+	void serialise_jass_v1::write_term(const slice &term, const compressed_postings &postings_list)
 		{
 		/*
 			Write the postings list to disk and keep a track of where it is.
 		*/
-		size_t number_of_impact_scores;
-
-		size_t postings_location;
-		postings_location = write_postings(postings, number_of_impact_scores, document_frequency, document_ids, term_frequencies);
+		size_t postings_location = write_postings(postings_list);
 
 		/*
 			Find out where we are in the vocabulary strings file - which will be the start of the term before we write it.
@@ -193,10 +202,111 @@ namespace JASS
 		vocabulary_strings.write(term.address(), term.size());
 		vocabulary_strings.write("\0", 1);
 		
+		/*
+			Summarise the segments (for the JASS v2 vocabulary)
+		*/
+		uint64_t postings_count = 0;
+		uint16_t highest_impact = 0;
+		uint16_t lowest_impact = (std::numeric_limits<uint16_t>::max)();
+		for (const auto &segment : postings_list.segments)
+			{
+			postings_count += segment.frequency;
+			highest_impact = (std::max)(highest_impact, segment.impact_score);
+			lowest_impact = (std::min)(lowest_impact, segment.impact_score);
+			}
+
 		/*
 			Keep a copy of the term and the detals of the postings list for later sorting and writing to CIvocab.bin
 		*/
-		index_key.push_back(vocab_tripple(term, term_offset, postings_location, number_of_impact_scores));
+		index_key.push_back(vocab_tripple(term, term_offset, postings_location, postings_list.segments.size(), postings_count, highest_impact, lowest_impact));
+		}
+
+	/*
+		SERIALISE_JASS_V1::COMPRESS_QUEUE()
+		-----------------------------------
+	*/
+	void serialise_jass_v1::compress_queue(size_t which)
+		{
+		compressor &worker = *compressors[which];
+		size_t current;
+		while ((current = next_to_compress++) < queued)
+			{
+			queued_postings &list = queue[current];
+			worker.compress(documents, alignment, list.document_frequency, list.document_ids.data(), list.term_frequencies.data(), list.compressed);
+			}
+		}
+
+	/*
+		SERIALISE_JASS_V1::FLUSH()
+		--------------------------
+	*/
+	void serialise_jass_v1::flush(void)
+		{
+		if (queued == 0)
+			return;
+
+		/*
+			Compress on all the threads (this one included)
+		*/
+		next_to_compress = 0;
+		std::vector<thread> workers;
+		for (size_t which = 1; which < compressors.size(); which++)
+			workers.push_back(thread(&serialise_jass_v1::compress_queue, this, which));
+		compress_queue(0);
+		for (auto &worker : workers)
+			worker.join();
+
+		/*
+			Write in the order the postings lists arrived
+		*/
+		for (size_t which = 0; which < queued; which++)
+			write_term(queue[which].term, queue[which].compressed);
+
+		/*
+			The entries are re-used, so free those that held a long postings list (else each keeps the capacity of the longest list it has ever
+			held, and memory grows well past queue_postings)
+		*/
+		for (size_t which = 0; which < queued; which++)
+			{
+			queued_postings &list = queue[which];
+			if (list.document_ids.capacity() > queue_slot_postings || list.compressed.data.capacity() > queue_slot_postings * sizeof(compress_integer::integer) || list.compressed.segments.capacity() > queue_slot_postings)
+				list = queued_postings();
+			}
+
+		queued = 0;
+		queued_postings_count = 0;
+		}
+
+	/*
+		SERIALISE_JASS_V1::OPERATOR()()
+		-------------------------------
+	*/
+	void serialise_jass_v1::operator()(const slice &term, const index_postings &postings, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies)
+		{
+		/*
+			With one thread, compress and write straight away
+		*/
+		if (compressors.size() == 1)
+			{
+			compressors[0]->compress(documents, alignment, document_frequency, document_ids, term_frequencies, compressed);
+			write_term(term, compressed);
+			return;
+			}
+
+		/*
+			Otherwise queue a copy of the postings list (the caller re-uses document_ids and term_frequencies), and compress the queue once it is full
+		*/
+		if (queued == queue.size())
+			queue.emplace_back();
+		queued_postings &list = queue[queued++];
+		list.term = term;
+		list.document_frequency = document_frequency;
+		list.document_ids.assign(document_ids, document_ids + document_frequency);
+		list.term_frequencies.assign(term_frequencies, term_frequencies + document_frequency);
+		queued_postings_count += document_frequency;
+
+		if (queued >= queue_terms || queued_postings_count >= queue_postings)
+			flush();
 		}
 
 	/*
@@ -255,31 +365,34 @@ namespace JASS
 		index_manager_sequential::unittest_build_index(index, unittest_data::ten_documents);
 		
 		/*
-			Serialise the index.
+			Serialise the index with one thread and then with several (which must produce the same index).
 		*/
-		{
-		serialise_jass_v1 serialiser(index.get_highest_document_id(), jass_v1_codex::qmx, 16);
-		index.iterate(serialiser);
-		}
+		for (size_t threads = 1; threads <= 3; threads += 2)
+			{
+			{
+			serialise_jass_v1 serialiser(index.get_highest_document_id(), jass_v1_codex::qmx, 16, threads);
+			index.iterate(serialiser);
+			}
 
-		/*
-			Checksum the index to make sure its correct.
-		*/
-		auto checksum = checksum::fletcher_16_file("CIvocab.bin");
+			/*
+				Checksum the index to make sure its correct.
+			*/
+			auto checksum = checksum::fletcher_16_file("CIvocab.bin");
 //std::cout << "CIvocab.bin checksum:" << checksum << "\n";
-		JASS_assert(checksum == 10231);
+			JASS_assert(checksum == 10231);
 
-		checksum = checksum::fletcher_16_file("CIvocab_terms.bin");
+			checksum = checksum::fletcher_16_file("CIvocab_terms.bin");
 //std::cout << "CIvocab_terms.bin checksum:" << checksum << "\n";
-		JASS_assert(checksum == 25057);
+			JASS_assert(checksum == 25057);
 
-		checksum = checksum::fletcher_16_file("CIpostings.bin");
+			checksum = checksum::fletcher_16_file("CIpostings.bin");
 //std::cout << "CIpostings.bin checksum:" << checksum << "\n";
-		JASS_assert(checksum == 43058);
+			JASS_assert(checksum == 51833);
 
-		checksum = checksum::fletcher_16_file("CIdoclist.bin");
+			checksum = checksum::fletcher_16_file("CIdoclist.bin");
 //std::cout << "CIdoclist.bin checksum:" << checksum << "\n";
-		JASS_assert(checksum == 3045);
+			JASS_assert(checksum == 3045);
+			}
 
 		puts("serialise_jass_v1::PASSED");
 		}
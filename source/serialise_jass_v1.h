@@ -12,9 +12,13 @@
 */
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include "file.h"
 #include "slice.h"
-#include "allocator_cpp.h"
+#include "allocator_pool.h"
 #include "index_postings.h"
 #include "index_manager.h"
 #include "compress_integer_qmx_jass_v1.h"
@@ -66,10 +70,15 @@ namespace JASS
 		seperately. These lists do not have the impact score stored at the start and do not have 0 terminators on them. This 
 		means score-at-a-time processing is the only paradigm, even if term-at-a-time processing is done score-at-a-time for 
 		each term. ATIRE could do either (but it was a compile time flag).
+
+		When constructed with more than one thread, the postings lists are queued (copied) as they arrive.  Once enough have
+		been queued the threads impact order and compress them concurrently, each into the queue entry's own buffer, and
+		then they are written to disk in the order they arrived (fixing up the pointers in the headers to the place they are
+		written).  The index is the same as that written with one thread.
 	*/
 	class serialise_jass_v1 : public index_manager::delegate
 		{
-		private:
+		protected:
 			/*
 				CLASS SERIALISE_JASS_V1::VOCAB_TRIPPLE
 				--------------------------------------
@@ -84,6 +93,9 @@ namespace JASS
 					uint64_t term;				///< The pointer to the \0 terminated string in the CI_vovab_terms.bin file.
 					uint64_t offset;			///< The pointer to the postings stored in the CIpostings.bin file.
 					uint64_t impacts;			///< The number of impacts that exist for this term.
+					uint64_t postings;		///< The number of postings (document ids) in the postings list (not written to a JASS v1 index).
+					uint16_t highest_impact;	///< The largest impact score of the term (not written to a JASS v1 index).
+					uint16_t lowest_impact;		///< The smallest impact score of the term (not written to a JASS v1 index).
 
 				public:
 					/*
@@ -96,12 +108,18 @@ namespace JASS
 						@param term [in] The location of this term in CIvocab_terms.bin.
 						@param offset [in] The offset of the postings list in CIpostings.bin.
 						@param impacts [in] The number of impacts in the postings list.
+						@param postings [in] The number of postings in the postings list.
+						@param highest_impact [in] The largest impact score in the postings list.
+						@param lowest_impact [in] The smallest impact score in the postings list.
 					*/
-					vocab_tripple(const slice &string, uint64_t term, uint64_t offset, uint64_t impacts) :
+					vocab_tripple(const slice &string, uint64_t term, uint64_t offset, uint64_t impacts, uint64_t postings, uint16_t highest_impact, uint16_t lowest_impact) :
 						token(string),
 						term(term),
 						offset(offset),
-						impacts(impacts)
+						impacts(impacts),
+						postings(postings),
+						highest_impact(highest_impact),
+						lowest_impact(lowest_impact)
 						{
 						/* Nothing */
 						}
@@ -142,74 +160,223 @@ namespace JASS
 				elias_delta_simd = 'D'			///< Postings are compressed using Elias delta SIMD encoding.
 				};
 
+		protected:
+			/*
+				CLASS SERIALISE_JASS_V1::COMPRESSED_POSTINGS
+				--------------------------------------------
+			*/
+			/*!
+				@brief A postings list that has been impact ordered and compressed, but not yet written to CIpostings.bin.
+			*/
+			class compressed_postings
+				{
+				public:
+					/*
+						CLASS SERIALISE_JASS_V1::COMPRESSED_POSTINGS::SEGMENT
+						-----------------------------------------------------
+					*/
+					/*!
+						@brief The details of one impact segment (needed to write its impact header).
+					*/
+					class segment
+						{
+						public:
+							uint16_t impact_score;		///< The impact score of the segment
+							uint64_t length;				///< The length (in bytes) of the compressed segment (excluding the padding)
+							uint32_t frequency;			///< The number of document ids in the segment
+						};
+
+				public:
+					std::vector<segment> segments;	///< The segments, in the order they are written
+					std::vector<uint8_t> data;			///< The compressed segments one after the other, each padded (with zeros) to the alignment
+				};
+
+			/*
+				CLASS SERIALISE_JASS_V1::COMPRESSOR
+				-----------------------------------
+			*/
+			/*!
+				@brief Everything one thread needs to impact order and compress postings lists.
+			*/
+			class compressor
+				{
+				public:
+					allocator_pool memory;									///< Memory used to store the impact-ordered postings list.
+					index_postings_impact impact_ordered;				///< The re-used impact ordered postings list.
+					std::unique_ptr<compress_integer> encoder;		///< The integer encoder used to compress postings lists.
+					std::vector<uint8_t> compressed_buffer;			///< The buffer used to compress postings into.
+
+				public:
+					/*
+						SERIALISE_JASS_V1::COMPRESSOR::COMPRESSOR()
+						-------------------------------------------
+					*/
+					/*!
+						@brief Constructor
+						@param documents [in] The number of documents in the collection.
+						@param codex [in] The codex to compress with.
+						@param alignment [in] The alignment of each compressed segment.
+					*/
+					compressor(size_t documents, jass_v1_codex codex, uint8_t alignment) :
+						memory(1024 * 1024),								///< The allocation block size is currently 1MB, big enough for most postings lists (but it'll grow for larger ones).
+						impact_ordered(documents, memory)
+						{
+						std::string name;
+						int32_t d_ness;
+						encoder = get_compressor(codex, name, d_ness);
+
+						/*
+							allocate space for storing the compressed postings.  But, allocate too much space as some
+							encoders can't write a sequence smaller than a minimum size, and each segment might be padded.
+						*/
+						compressed_buffer.resize((documents + 1024) * sizeof(compress_integer::integer) + (index_postings_impact::largest_impact + 1) * alignment);
+						}
+
+					/*
+						SERIALISE_JASS_V1::COMPRESSOR::COMPRESS()
+						-----------------------------------------
+					*/
+					/*!
+						@brief Impact order and compress a postings list.
+						@param documents [in] The number of documents in the collection.
+						@param alignment [in] Each compressed segment is padded to this alignment.
+						@param document_frequency [in] The document frequency of the term
+						@param document_ids [in] An array (of length document_frequency) of document ids.
+						@param term_frequencies [in] An array (of length document_frequency) of term frequencies (corresponding to document_ids).
+						@param into [out] The compressed postings list.
+					*/
+					void compress(size_t documents, uint8_t alignment, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies, compressed_postings &into);
+				};
+
+			/*
+				CLASS SERIALISE_JASS_V1::QUEUED_POSTINGS
+				----------------------------------------
+			*/
+			/*!
+				@brief A postings list waiting to be compressed by one of the threads.
+			*/
+			class queued_postings
+				{
+				public:
+					slice term;																		///< The term
+					compress_integer::integer document_frequency;							///< The document frequency of the term
+					std::vector<compress_integer::integer> document_ids;					///< A copy of the document ids
+					std::vector<index_postings_impact::impact_type> term_frequencies;	///< A copy of the term frequencies
+					compressed_postings compressed;												///< The compressed postings list
+				};
+
+		private:
+			static constexpr size_t queue_terms = 16384;						///< Compress the queue once it holds this many terms
+			static constexpr size_t queue_postings = 4 * 1024 * 1024;		///< Or once it holds this many postings
+			static constexpr size_t queue_slot_postings = queue_postings / queue_terms;		///< A queue entry that has grown to hold more postings than this is freed once written
+
 		private:
 			file vocabulary_strings;							///< The concatination of UTS-8 encoded unique tokens in the collection.
-			file vocabulary;										///< Details about the term (including a pointer to the term, a pointer to the postings, and the quantum count.
-			file postings;											///< The postings lists.
 			file primary_keys;									///< The list of external identifiers (document primary keys).
-			std::vector<vocab_tripple> index_key;			///< The entry point into the JASS v1 index is CIvocab.bin, the index key.
 			std::vector<uint64_t> primary_key_offsets;	///< A list of locations (on disk) of each primary key.
-			allocator_pool memory;								///< Memory used to store the impact-ordered postings list.
-			index_postings_impact impact_ordered;			///< The re-used impact ordered postings list.
-			std::string compressor_name;						///< The name of the compresson algorithm
-			int compressor_d_ness;								///< The d-ness of the compression algorithm
-			std::unique_ptr<compress_integer> encoder;							///< The integer encoder used to compress postings lists.
-			allocator_cpp<uint8_t> allocator;				///< C++ allocator between memory object and std::vector object
-			std::vector<uint8_t, allocator_cpp<uint8_t>> compressed_buffer;		///< The buffer used to compress postings into.
-			std::vector<slice, allocator_cpp<slice>> compressed_segments;			///< vector of pointers (and lengths) to the compressed postings.
+			std::vector<std::unique_ptr<compressor>> compressors;		///< One compressor per thread
+			compressed_postings compressed;					///< The re-used compressed postings list (when there is only one thread)
+			std::vector<queued_postings> queue;				///< The postings lists waiting to be compressed (when there is more than one thread)
+			size_t queued;											///< The number of postings lists in the queue
+			size_t queued_postings_count;						///< The number of postings in the queue
+			std::atomic<size_t> next_to_compress;			///< The next postings list in the queue for a thread to compress
+
+		protected:
+			file vocabulary;										///< Details about the term (including a pointer to the term, a pointer to the postings, and the quantum count.
+			std::vector<vocab_tripple> index_key;			///< The entry point into the JASS v1 index is CIvocab.bin, the index key.
+			file postings;											///< The postings lists.
 			uint8_t alignment;									///< Postings lists are padded to this alignment (used for codexes that require word alignment).
 
-		private:
+		protected:
 			/*
 				SERIALISE_JASS_V1::WRITE_POSTINGS()
 				-----------------------------------
 			*/
 			/*!
-				@brief Convert the postings list to the JASS v1 format and serialise it to disk.
-				@param postings [in] The postings list to serialise.
-				@param number_of_impacts [out] The number of distinct impact scores seen in the postings list.
-				@param document_frequency [in] The document frequency of the term
-				@param document_ids [in] An array (of length document_frequency) of document ids.
-				@param term_frequencies [in] An array (of length document_frequency) of term frequencies (corresponding to document_ids).
+				@brief Serialise a compressed postings list to disk.
+				@param postings_list [in] The compressed postings list.
 				@return The location (in CIpostings.bin) of the start of the serialised postings list.
 			*/
-			size_t write_postings(const index_postings &postings, size_t &number_of_impacts, compress_integer::integer document_frequency, compress_integer::integer *document_ids, index_postings_impact::impact_type *term_frequencies);
+			virtual size_t write_postings(const compressed_postings &postings_list);
+
+			/*
+				SERIALISE_JASS_V1::FLUSH()
+				--------------------------
+			*/
+			/*!
+				@brief Compress the queued postings lists (using all the threads), write them to disk in order, and empty the queue.
+			*/
+			void flush(void);
 
-		public:
 			/*
 				SERIALISE_JASS_V1::SERIALISE_JASS_V1()
 				--------------------------------------
 			*/
 			/*!
-				@brief Constructor
+				@brief Constructor used by sub-classes that write their own header at the start of CIpostings.bin.
 				@param documents [in] The number of documents in the collection (used to allocate re-usable buffers).
-				@param encoder [in] An shared pointer to a codex responsible for performing the compression of postings lists (default = compress_integer_QMX_jass_v1()).
-				@param alignment [in] The start address of a postings list is padded to start on these boundaries (needed for compress_integer_QMX_jass_v1 (use 16), and others).  Default = 0.
+				@param codex [in] The codex used to compress the postings lists.
+				@param alignment [in] The start address of each compressed segment is padded to start on these boundaries.
+				@param threads [in] The number of threads to compress with.
+				@param write_codex [in] Should the codex be written as the first byte of CIpostings.bin (as it is in a JASS v1 index)?
 			*/
-			serialise_jass_v1(size_t documents, jass_v1_codex codex = jass_v1_codex::elias_gamma_simd, int8_t alignment = 1) :
+			serialise_jass_v1(size_t documents, jass_v1_codex codex, int8_t alignment, size_t threads, bool write_codex) :
 				index_manager::delegate(documents),
 				vocabulary_strings("CIvocab_terms.bin", "w+b"),
+				primary_keys("CIdoclist.bin", "w+b"),
+				queued(0),
+				queued_postings_count(0),
+				next_to_compress(0),
 				vocabulary("CIvocab.bin", "w+b"),
 				postings("CIpostings.bin", "w+b"),
-				primary_keys("CIdoclist.bin", "w+b"),
-				memory(1024 * 1024),								///< The allocation block size is currently 1MB, big enough for most postings lists (but it'll grow for larger ones).
-				impact_ordered(documents, memory),
-				encoder(get_compressor(codex, compressor_name, compressor_d_ness)),
-				allocator(memory),
-				compressed_buffer(allocator),
-				compressed_segments(allocator),
 				alignment(alignment)
 				{
-				/*
-					allocate space for storing the compressed postings.  But, allocate too much space as some
-					encoders can't write a sequence smaller than a minimum size,
-				*/
-				compressed_buffer.resize((documents + 1024) * sizeof(compress_integer::integer));
-				compressed_segments.reserve(index_postings_impact::largest_impact);
+				for (size_t which = 0; which < (threads == 0 ? 1 : threads); which++)
+					compressors.push_back(std::make_unique<compressor>(documents, codex, alignment));
+
+				if (write_codex)
+					postings.write(&codex, 1);
+				}
+
+		private:
 
-// std::cout << compressor_name << "-D" << compressor_d_ness << "\n";
+			/*
+				SERIALISE_JASS_V1::WRITE_TERM()
+				-------------------------------
+			*/
+			/*!
+				@brief Serialise a compressed postings list and its term to disk, and remember them for CIvocab.bin.
+				@param term [in] The term.
+				@param postings_list [in] The compressed postings list.
+			*/
+			void write_term(const slice &term, const compressed_postings &postings_list);
+
+			/*
+				SERIALISE_JASS_V1::COMPRESS_QUEUE()
+				-----------------------------------
+			*/
+			/*!
+				@brief Compress postings lists from the queue until there are none left (called from each thread).
+				@param which [in] The compressor (thread) to use.
+			*/
+			void compress_queue(size_t which);
 
-				postings.write(&codex, 1);
+		public:
+			/*
+				SERIALISE_JASS_V1::SERIALISE_JASS_V1()
+				--------------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param documents [in] The number of documents in the collection (used to allocate re-usable buffers).
+				@param encoder [in] An shared pointer to a codex responsible for performing the compression of postings lists (default = compress_integer_QMX_jass_v1()).
+				@param alignment [in] The start address of a postings list is padded to start on these boundaries (needed for compress_integer_QMX_jass_v1 (use 16), and others).  Default = 0.
+				@param threads [in] The number of threads to compress with.  Default = 1.
+			*/
+			serialise_jass_v1(size_t documents, jass_v1_codex codex = jass_v1_codex::elias_gamma_simd, int8_t alignment = 1, size_t threads = 1) :
+				serialise_jass_v1(documents, codex, alignment, threads, true)
+				{
+				/* Nothing */
 				}
 
 			/*
@@ -0,0 +1,323 @@
+/*
+	SERIALISE_JASS_V2.CPP
+	---------------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <string.h>
+
+#include <string>
+#include <vector>
+#include <limits>
+#include <iostream>
+
+#include "file.h"
+#include "asserts.h"
+#include "allocator.h"
+#include "unittest_data.h"
+#include "vocabulary_hash.h"
+#include "serialise_jass_v2.h"
+#include "deserialised_jass_v1.h"
+#include "index_manager_sequential.h"
+
+namespace JASS
+	{
+	/*
+		SERIALISE_JASS_V2::~SERIALISE_JASS_V2()
+		---------------------------------------
+	*/
+	serialise_jass_v2::~serialise_jass_v2()
+		{
+		/*
+			Write any postings lists still in the queue now, as the destructor of the base class would write them as JASS v1 postings lists
+		*/
+		flush();
+
+		/*
+			Sort then serialise the contents of CIvocab.bin (leaving nothing for the destructor of the base class to write)
+		*/
+		std::sort(index_key.begin(), index_key.end());
+
+		static const uint8_t padding[vocabulary_record_size - 4 * sizeof(uint64_t) - 2 * sizeof(uint16_t)] = {};
+		for (const auto &line : index_key)
+			{
+			vocabulary.write(&line.term, sizeof(line.term));
+			vocabulary.write(&line.offset, sizeof(line.offset));
+			vocabulary.write(&line.impacts, sizeof(line.impacts));
+			vocabulary.write(&line.postings, sizeof(line.postings));
+			vocabulary.write(&line.highest_impact, sizeof(line.highest_impact));
+			vocabulary.write(&line.lowest_impact, sizeof(line.lowest_impact));
+			vocabulary.write(padding, sizeof(padding));
+			}
+
+		/*
+			Serialise the hash table that maps each term to its record in CIvocab.bin
+		*/
+		if (index_key.size() >= std::numeric_limits<uint32_t>::max())
+			{
+			std::cout << "Vocabulary is too large to serialise" << std::ends;
+			exit(1);
+			}
+
+		std::vector<slice> terms;
+		terms.reserve(index_key.size());
+		for (const auto &line : index_key)
+			terms.push_back(line.token);
+		auto table = vocabulary_hash::build(terms);
+		vocabulary_table.write(table.data(), table.size() * sizeof(table[0]));
+
+		index_key.clear();
+		}
+
+	/*
+		SERIALISE_JASS_V2::WRITE_POSTINGS()
+		-----------------------------------
+	*/
+	size_t serialise_jass_v2::write_postings(const compressed_postings &postings_list)
+		{
+		static const uint8_t zero[256] = {};
+
+		/*
+			Pad so that the postings are on a word boundary, then write out the postings list segments.
+		*/
+		postings.write(zero, allocator::realign(postings.tell(), alignment));
+		uint64_t start_of_postings = postings.tell();
+		postings.write(postings_list.data.data(), postings_list.data.size());
+
+		/*
+			Write out the segment headers as a struct of arrays: the offsets, the frequencies, the lengths, then the impacts.
+		*/
+		size_t segments_location = segments.tell();
+		for (const auto &header : postings_list.segments)
+			{
+			segments.write(&start_of_postings, sizeof(start_of_postings));
+			start_of_postings += header.length + allocator::realign(header.length, alignment);
+			}
+
+		for (const auto &header : postings_list.segments)
+			segments.write(&header.frequency, sizeof(header.frequency));
+
+		for (const auto &header : postings_list.segments)
+			{
+			if (header.length > std::numeric_limits<uint32_t>::max())
+				{
+				std::cout << "Compressed segment is too large to serialise" << std::ends;
+				exit(1);
+				}
+			uint32_t length = static_cast<uint32_t>(header.length);
+			segments.write(&length, sizeof(length));
+			}
+
+		for (const auto &header : postings_list.segments)
+			segments.write(&header.impact_score, sizeof(header.impact_score));
+
+		/*
+			Pad so that the next term's segment headers are aligned
+		*/
+		segments.write(zero, allocator::realign(segments.tell(), sizeof(uint64_t)));
+
+		/*
+			Return the location of the segment headers on disk
+		*/
+		return segments_location;
+		}
+
+	/*
+		SERIALISE_JASS_V2::UNITTEST()
+		-----------------------------
+	*/
+	void serialise_jass_v2::unittest(void)
+		{
+		/*
+			Build an index.
+		*/
+		index_manager_sequential index;
+		index_manager_sequential::unittest_build_index(index, unittest_data::ten_documents);
+
+		/*
+			Serialise it as a JASS v1 index and keep the segments of each term (as <impact, frequency, compressed bytes> triples)
+		*/
+		std::vector<std::string> expected;
+		do
+			{
+			{
+			serialise_jass_v1 serialiser(index.get_highest_document_id(), jass_v1_codex::qmx, 16);
+			index.iterate(serialiser);
+			}
+
+			deserialised_jass_v1 reader;
+			JASS_assert(reader.read_index() != 0);
+			JASS_assert(reader.version() == 1);
+			JASS_assert(reader.begin()->highest_impact == 0 && reader.begin()->document_frequency == 0);
+			for (const auto &term : reader)
+				{
+				std::string segments(reinterpret_cast<char *>(term.term.address()), term.term.size());
+				for (uint64_t which = 0; which < term.impacts; which++)
+					{
+					auto header = reader.segment(term, which);
+					segments += ":" + std::to_string(header.impact) + "," + std::to_string(header.segment_frequency) + ",";
+					segments += std::string(reinterpret_cast<const char *>(reader.postings() + header.offset), header.end - header.offset);
+					}
+				expected.push_back(segments);
+				}
+			}
+		while (0);
+
+		/*
+			Serialise as a JASS v2 index with one thread and then with several, which must hold the same segments (aligned)
+		*/
+		for (size_t threads = 1; threads <= 3; threads += 2)
+			{
+			{
+			serialise_jass_v2 serialiser(index.get_highest_document_id(), jass_v1_codex::qmx, 16, threads);
+			index.iterate(serialiser);
+			}
+
+			deserialised_jass_v1 reader;
+			JASS_assert(reader.read_index() != 0);
+			JASS_assert(reader.version() == 2);
+			JASS_assert(reader.codex_id() == jass_v1_codex::qmx);
+			JASS_assert(reader.document_count() == 10);
+
+			std::string codex_name;
+			int32_t d_ness;
+			reader.codex(codex_name, d_ness);
+			JASS_assert(d_ness == 1);
+
+			size_t term_number = 0;
+			for (const auto &term : reader)
+				{
+				auto list = reader.segments(term);
+				JASS_assert(reinterpret_cast<uintptr_t>(list.offset) % sizeof(uint64_t) == 0);
+
+				/*
+					The vocabulary summarises the segments
+				*/
+				uint64_t postings = 0;
+				for (uint64_t which = 0; which < term.impacts; which++)
+					{
+					postings += list.segment_frequency[which];
+					JASS_assert(list.impact[which] <= term.highest_impact && list.impact[which] >= term.lowest_impact);
+					}
+				JASS_assert(postings == term.document_frequency);
+				JASS_assert(term.highest_impact == list.impact[0] && term.lowest_impact == list.impact[term.impacts - 1]);
+
+				std::string segments(reinterpret_cast<char *>(term.term.address()), term.term.size());
+				for (uint64_t which = 0; which < term.impacts; which++)
+					{
+					JASS_assert(list.offset[which] % 16 == 0);
+
+					auto header = reader.segment(term, which);
+					JASS_assert(header.impact == list.impact[which] && header.segment_frequency == list.segment_frequency[which]);
+					segments += ":" + std::to_string(header.impact) + "," + std::to_string(header.segment_frequency) + ",";
+					segments += std::string(reinterpret_cast<const char *>(reader.postings() + header.offset), header.end - header.offset);
+					}
+				JASS_assert(term_number < expected.size());
+				JASS_assert(segments == expected[term_number]);
+				term_number++;
+				}
+			JASS_assert(term_number == expected.size());
+
+			/*
+				Each term is found through the hash table (CIvocab_hash.bin), and a term that is not in the vocabulary is not
+			*/
+			JASS_assert(reader.term_count() == expected.size());
+			for (const auto &term : reader)
+				{
+				deserialised_jass_v1::metadata found;
+				JASS_assert(reader.postings_details(found, query_term(term.term)));
+				JASS_assert(found.term == term.term && found.offset == term.offset && found.impacts == term.impacts);
+				JASS_assert(found.document_frequency == term.document_frequency && found.highest_impact == term.highest_impact);
+				}
+			deserialised_jass_v1::metadata missing;
+			JASS_assert(!reader.postings_details(missing, query_term(slice("tens"))));
+			JASS_assert(!reader.postings_details(missing, query_term(slice("th"))));
+			}
+
+		/*
+			A damaged index must not be read outside its files: a hash table pointing past the vocabulary, a record pointing past the segment
+			headers (found through the hash table, then through the sorted vocabulary), and a segment pointing past the postings.  Record 0
+			is damaged, record 1 is not.
+		*/
+		std::string hash_file;
+		std::string vocab_file;
+		std::string segments_file;
+		file::read_entire_file("CIvocab_hash.bin", hash_file);
+		file::read_entire_file("CIvocab.bin", vocab_file);
+		file::read_entire_file("CIsegments.bin", segments_file);
+
+		std::vector<std::string> term_list;
+		do
+			{
+			deserialised_jass_v1 reader;
+			JASS_assert(reader.read_index() != 0);
+			for (const auto &term : reader)
+				term_list.push_back(std::string(reinterpret_cast<char *>(term.term.address()), term.term.size()));
+			}
+		while (0);
+		slice first_term(const_cast<char *>(term_list[0].c_str()), term_list[0].size());
+		slice second_term(const_cast<char *>(term_list[1].c_str()), term_list[1].size());
+		deserialised_jass_v1::metadata found;
+
+		do
+			{
+			std::string damaged = hash_file;
+			for (size_t where = vocabulary_hash::header_size; where < damaged.size(); where += sizeof(uint64_t))
+				{
+				uint64_t slot;
+				memcpy(&slot, &damaged[where], sizeof(slot));
+				if (slot != 0)
+					slot |= 0xFFFFFFF0;
+				memcpy(&damaged[where], &slot, sizeof(slot));
+				}
+			file::write_entire_file("CIvocab_hash.bin", damaged);
+
+			deserialised_jass_v1 reader;
+			JASS_assert(reader.read_index() != 0);
+			JASS_assert(!reader.postings_details(found, query_term(first_term)));
+			JASS_assert(!reader.postings_details(found, query_term(second_term)));
+			}
+		while (0);
+
+		do
+			{
+			std::string damaged = vocab_file;
+			uint64_t past_the_end = segments_file.size();
+			memcpy(&damaged[sizeof(uint64_t)], &past_the_end, sizeof(past_the_end));
+			file::write_entire_file("CIvocab.bin", damaged);
+			file::write_entire_file("CIvocab_hash.bin", hash_file);
+
+			deserialised_jass_v1 reader;
+			JASS_assert(reader.read_index() != 0);
+			JASS_assert(!reader.postings_details(found, query_term(first_term)));
+			JASS_assert(reader.postings_details(found, query_term(second_term)));
+
+			file::write_entire_file("CIvocab_hash.bin", "");
+			deserialised_jass_v1 unhashed;
+			JASS_assert(unhashed.read_index() == 0);
+			}
+		while (0);
+		file::write_entire_file("CIvocab.bin", vocab_file);
+		file::write_entire_file("CIvocab_hash.bin", hash_file);
+
+		do
+			{
+			std::string damaged = segments_file;
+			uint64_t where;
+			memcpy(&where, &vocab_file[sizeof(uint64_t)], sizeof(where));
+			uint64_t past_the_end = std::numeric_limits<uint64_t>::max() - 1;
+			memcpy(&damaged[where], &past_the_end, sizeof(past_the_end));
+			file::write_entire_file("CIsegments.bin", damaged);
+
+			deserialised_jass_v1 reader;
+			JASS_assert(reader.read_index() != 0);
+			JASS_assert(!reader.segments_are_valid(*reader.begin()));
+			JASS_assert(!reader.postings_details(found, query_term(first_term)));
+			JASS_assert(reader.postings_details(found, query_term(second_term)));
+			}
+		while (0);
+		file::write_entire_file("CIsegments.bin", segments_file);
+
+		puts("serialise_jass_v2::PASSED");
+		}
+	}
@@ -0,0 +1,115 @@
+/*
+	SERIALISE_JASS_V2.H
+	-------------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief Serialise an index in the JASS v2 format (a JASS v1 index with the segment headers stored as arrays beside the vocabulary).
+	@author Andrew Trotman
+	@copyright 2021 Andrew Trotman
+*/
+#pragma once
+
+#include <algorithm>
+
+#include "file.h"
+#include "serialise_jass_v1.h"
+
+namespace JASS
+	{
+	/*
+		CLASS SERIALISE_JASS_V2
+		-----------------------
+	*/
+	/*!
+		@brief Serialise an index in the JASS v2 format (a JASS v1 index with the segment headers stored as arrays beside the vocabulary).
+		@details In a JASS v1 index each postings list starts with an array of pointers to its segment headers, and each header is a packed
+		(unaligned) 22-byte structure.  Finding the segments of a term therefore means following one pointer per segment into the middle of the
+		postings.  The JASS v2 index is made up of 6 files: CIvocab_terms.bin, CIvocab.bin, CIvocab_hash.bin, CIsegments.bin, CIpostings.bin,
+		and CIdoclist.bin.
+
+		CIvocab_terms.bin and CIdoclist.bin are the same as those in a JASS v1 index (see serialise_jass_v1).
+
+		CIvocab.bin: A list of 40-byte records (sorted as in JASS v1), one per term.  Each is the uint64_t term, offset, and impacts of a JASS v1
+		index (except that offset is the offset of the term's segment headers in CIsegments.bin), then the uint64_t number of postings in the
+		postings list, then the uint16_t largest and uint16_t smallest impact score of the term, then 4 bytes of padding.  So planning a query
+		(e.g. computing the largest possible rsv) need not touch the segment headers.
+
+		CIvocab_hash.bin: A hash table mapping each term to its record in CIvocab.bin (see vocabulary_hash), so that looking up a query term
+		takes constant time and the vocabulary need not be decoded when the index is loaded.
+
+		CIsegments.bin: For each term, the segment headers stored as a struct of arrays, each array impacts long.  First the uint64_t offset (in
+		CIpostings.bin) of the start of each compressed segment, then the uint32_t number of document ids in each segment, then the uint32_t
+		length (in bytes) of each compressed segment, then the uint16_t impact score of each segment.  The arrays are ordered from the widest type
+		to the narrowest so that each is naturally aligned, and the headers of each term are padded to a multiple of 8 bytes.
+
+		CIpostings.bin: An 8-byte header ("JASSv2", the codex (as in JASS v1), then a 0) followed by the compressed segments.  As the first byte
+		is not a JASS v1 codex an older reader rejects the index rather than misreading it.
+	*/
+	class serialise_jass_v2 : public serialise_jass_v1
+		{
+		public:
+			static constexpr uint8_t signature[] = {'J', 'A', 'S', 'S', 'v', '2'};		///< The first bytes of CIpostings.bin (followed by the codex and a 0)
+			static constexpr size_t header_size = 8;												///< The size (in bytes) of the header at the start of CIpostings.bin
+			static constexpr size_t vocabulary_record_size = 40;								///< The size (in bytes) of each record in CIvocab.bin
+
+		private:
+			file segments;					///< The segment headers of each postings list (CIsegments.bin)
+			file vocabulary_table;		///< The hash table used to look up terms in CIvocab.bin (CIvocab_hash.bin)
+
+		protected:
+			/*
+				SERIALISE_JASS_V2::WRITE_POSTINGS()
+				-----------------------------------
+			*/
+			/*!
+				@brief Serialise a compressed postings list to CIpostings.bin and its segment headers to CIsegments.bin.
+				@param postings_list [in] The compressed postings list.
+				@return The location (in CIsegments.bin) of the segment headers of the postings list.
+			*/
+			virtual size_t write_postings(const compressed_postings &postings_list);
+
+		public:
+			/*
+				SERIALISE_JASS_V2::SERIALISE_JASS_V2()
+				--------------------------------------
+			*/
+			/*!
+				@brief Constructor
+				@param documents [in] The number of documents in the collection (used to allocate re-usable buffers).
+				@param codex [in] The codex used to compress the postings lists (default = elias_gamma_simd).
+				@param alignment [in] The start address of each compressed segment is padded to start on these boundaries (needed for compress_integer_QMX_jass_v1 (use 16), and others).  Default = 1.
+				@param threads [in] The number of threads to compress with.  Default = 1.
+			*/
+			serialise_jass_v2(size_t documents, jass_v1_codex codex = jass_v1_codex::elias_gamma_simd, int8_t alignment = 1, size_t threads = 1) :
+				serialise_jass_v1(documents, codex, alignment, threads, false),
+				segments("CIsegments.bin", "w+b"),
+				vocabulary_table("CIvocab_hash.bin", "w+b")
+				{
+				uint8_t header[header_size] = {};
+				std::copy(signature, signature + sizeof(signature), header);
+				header[sizeof(signature)] = static_cast<uint8_t>(codex);
+				postings.write(header, sizeof(header));
+				}
+
+			/*
+				SERIALISE_JASS_V2::~SERIALISE_JASS_V2()
+				---------------------------------------
+			*/
+			/*!
+				@brief Destructor
+			*/
+			virtual ~serialise_jass_v2();
+
+			/*
+				SERIALISE_JASS_V2::UNITTEST()
+				-----------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+	}
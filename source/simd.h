@@ -21,6 +21,7 @@
 
 #include "asserts.h"
 #include "forceinline.h"
+#include "instruction_set.h"
 
 /*
 	Here we can choose between individual writes or block writes on AVX512:
@@ -494,7 +495,7 @@ namespace JASS
 				@param elements [in] The 32-bit integers.
 				@return An AVX512 register holding the cumulative sums.
 			*/
-			forceinline static __m512i cumulative_sum(__m512i elements)
+			JASS_TARGET_AVX512 forceinline static __m512i cumulative_sum(__m512i elements)
 				{
 				/*
 					shift left by 1 integer and add
@@ -537,11 +538,12 @@ namespace JASS
 			*/
 			/*!
 				@brief Calculate (inplace) the cumulative sum of the array of integers.
-				@details As this uses AVX512 instrucrtions is can read and write more than length load of integers
+				@details As this uses AVX512 instrucrtions is can read and write more than length load of integers.  This is compiled
+				for AVX512 whatever the build flags, so only call it if instruction_set::current() is instruction_set::AVX512.
 				@param data [in/out] The integers to sum (and result).
 				@param length [in] The number of integrers to sum.
 			*/
-			static void cumulative_sum_512(uint32_t *data, size_t length)
+			JASS_TARGET_AVX512 static void cumulative_sum_512(uint32_t *data, size_t length)
 				{
 				/*
 					previous cumulative sum is zero
@@ -631,6 +633,24 @@ namespace JASS
 					previous_max = _mm256_permute2x128_si256(current_set, current_set, 3 | (3 << 4));
 					}
 				}
+
+			/*
+				SIMD::CUMULATIVE_SUM()
+				----------------------
+			*/
+			/*!
+				@brief Calculate (inplace) the cumulative sum of the array of integers using the widest instruction set the CPU supports.
+				@details This can read and write up to 16 integers past the end of the array (see cumulative_sum_512()).
+				@param data [in/out] The integers to sum (and result).
+				@param length [in] The number of integrers to sum.
+			*/
+			static void cumulative_sum(uint32_t *data, size_t length)
+				{
+				if (instruction_set::current() == instruction_set::AVX512)
+					cumulative_sum_512(data, length);
+				else
+					cumulative_sum_256(data, length);
+				}
 			/*
 				SIMD::POPCOUNT()
 				----------------
@@ -818,6 +838,21 @@ namespace JASS
 				uint32_t sum_answer[8] = {0, 1, 3, 6, 10, 15, 21, 28};
 				JASS_assert(::memcmp(destination_32, sum_answer, sizeof(sum_answer)) == 0);
 
+				/*
+					Check the AVX2 and AVX512 cumulative sums agree (across several blocks)
+				*/
+				uint32_t sequence_256[64];
+				uint32_t sequence_512[64];
+				for (uint32_t pos = 0; pos < 64; pos++)
+					sequence_256[pos] = sequence_512[pos] = pos % 7 + 1;
+				cumulative_sum_256(sequence_256, 48);
+				if (instruction_set::current() == instruction_set::AVX512)
+					cumulative_sum_512(sequence_512, 48);
+				else
+					cumulative_sum(sequence_512, 48);
+				JASS_assert(::memcmp(sequence_256, sequence_512, 48 * sizeof(uint32_t)) == 0);
+				JASS_assert(sequence_256[47] == 189);
+
 #ifdef __AVX512F__
 				uint32_t numbers[] = {0, 1, 3, 7, 15, 31, 63, 127, 255, 511, 1023, 2047, 4095, 8191, 16383, 32767};
 				__m512i bit_vector = _mm512_loadu_si512(numbers);
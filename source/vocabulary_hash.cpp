@@ -0,0 +1,155 @@
+/*
+	VOCABULARY_HASH.CPP
+	-------------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+#include <string.h>
+
+#include <string>
+
+#include "asserts.h"
+#include "vocabulary_hash.h"
+
+namespace JASS
+	{
+	/*
+		VOCABULARY_HASH::BUILD()
+		------------------------
+	*/
+	std::vector<uint64_t> vocabulary_hash::build(const std::vector<slice> &vocabulary)
+		{
+		/*
+			The smallest power of 2 that keeps the table no more than 3/4 full (and with at least one empty slot)
+		*/
+		uint64_t table_slots = 1;
+		while (table_slots * 3 < vocabulary.size() * 4 || table_slots <= vocabulary.size())
+			table_slots *= 2;
+
+		std::vector<uint64_t> file(header_size / sizeof(uint64_t) + table_slots, 0);
+		file[0] = table_slots;
+		file[1] = vocabulary.size();
+		uint64_t *slot_list = &file[header_size / sizeof(uint64_t)];
+
+		/*
+			Insert each term at the first empty slot at or after its hash
+		*/
+		for (uint64_t record = 0; record < vocabulary.size(); record++)
+			{
+			uint64_t key = hash(vocabulary[record]);
+			uint64_t slot = key & (table_slots - 1);
+			while (slot_list[slot] != 0)
+				slot = (slot + 1) & (table_slots - 1);
+			slot_list[slot] = (key & 0xFFFFFFFF00000000) | (record + 1);
+			}
+
+		return file;
+		}
+
+	/*
+		VOCABULARY_HASH::READ()
+		-----------------------
+	*/
+	size_t vocabulary_hash::read(const uint8_t *memory, size_t bytes)
+		{
+		table = nullptr;
+		slots = terms = 0;
+
+		if (memory == nullptr || bytes < header_size)
+			return 0;
+
+		const uint64_t *header = reinterpret_cast<const uint64_t *>(memory);
+		uint64_t table_slots = header[0];
+		uint64_t table_terms = header[1];
+
+		/*
+			Check the header matches the table (a power of 2 slots, with at least one empty)
+		*/
+		if (table_slots == 0 || (table_slots & (table_slots - 1)) != 0 || table_terms >= table_slots || table_slots != (bytes - header_size) / sizeof(uint64_t) || (bytes - header_size) % sizeof(uint64_t) != 0)
+			return 0;
+
+		table = header + header_size / sizeof(uint64_t);
+		slots = table_slots;
+		terms = table_terms;
+
+		return terms;
+		}
+
+	/*
+		VOCABULARY_HASH::UNITTEST()
+		---------------------------
+	*/
+	void vocabulary_hash::unittest(void)
+		{
+		/*
+			Enough terms that some collide
+		*/
+		std::vector<std::string> strings;
+		for (size_t term = 0; term < 1000; term++)
+			strings.push_back("term" + std::to_string(term));
+		strings.push_back("");
+
+		std::vector<slice> vocabulary;
+		for (const auto &term : strings)
+			vocabulary.push_back(slice(const_cast<char *>(term.c_str()), term.size()));
+
+		std::vector<uint64_t> file = build(vocabulary);
+		JASS_assert(file[0] == 2048);
+		JASS_assert(file[1] == vocabulary.size());
+
+		vocabulary_hash table;
+		JASS_assert(table.read(reinterpret_cast<const uint8_t *>(file.data()), file.size() * sizeof(uint64_t)) == vocabulary.size());
+		JASS_assert(table.size() == vocabulary.size());
+
+		/*
+			Every term is found at its record, and a term that isn't there isn't found
+		*/
+		auto same = [&vocabulary](const slice &term)
+			{
+			return [&vocabulary, &term](size_t record){return vocabulary[record] == term;};
+			};
+
+		for (size_t which = 0; which < vocabulary.size(); which++)
+			{
+			size_t record = 0;
+			JASS_assert(table.find(vocabulary[which], same(vocabulary[which]), record));
+			JASS_assert(record == which);
+			}
+
+		size_t record = 0;
+		slice missing("term1000");
+		JASS_assert(!table.find(missing, same(missing), record));
+		slice prefix("term10");
+		JASS_assert(table.find(prefix, same(prefix), record) && record == 10);
+
+		/*
+			A damaged slot that points past the end of the vocabulary is never checked against it, and a damaged table with no empty slot
+			is searched at most once around
+		*/
+		for (size_t slot = 0; slot < file[0]; slot++)
+			if (file[header_size / sizeof(uint64_t) + slot] != 0)
+				file[header_size / sizeof(uint64_t) + slot] |= 0xFFFFFFF0;
+		JASS_assert(table.read(reinterpret_cast<const uint8_t *>(file.data()), file.size() * sizeof(uint64_t)) == vocabulary.size());
+		JASS_assert(!table.find(prefix, same(prefix), record));
+
+		std::vector<uint64_t> full = {4, 3, 1, 2, 3, 4};
+		JASS_assert(table.read(reinterpret_cast<const uint8_t *>(full.data()), full.size() * sizeof(uint64_t)) == 3);
+		JASS_assert(!table.find(prefix, [](size_t record){return true;}, record));
+
+		/*
+			Files that are not a table, and an empty vocabulary
+		*/
+		JASS_assert(table.read(reinterpret_cast<const uint8_t *>(file.data()), file.size() * sizeof(uint64_t) - 8) == 0);
+		JASS_assert(!table.find(prefix, same(prefix), record));
+		file[0] = 1000;
+		JASS_assert(table.read(reinterpret_cast<const uint8_t *>(file.data()), file.size() * sizeof(uint64_t)) == 0);
+		JASS_assert(table.read(nullptr, 0) == 0);
+
+		std::vector<uint64_t> empty = build(std::vector<slice>());
+		JASS_assert(empty.size() == 3 && empty[0] == 1 && empty[1] == 0);
+		JASS_assert(table.read(reinterpret_cast<const uint8_t *>(empty.data()), empty.size() * sizeof(uint64_t)) == 0);
+		JASS_assert(!table.find(prefix, same(prefix), record));
+
+		puts("vocabulary_hash::PASSED");
+		}
+	}
@@ -0,0 +1,168 @@
+/*
+	VOCABULARY_HASH.H
+	-----------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@file
+	@brief A hash table, built when the index is built and used in place when it is searched, for looking up terms in the vocabulary.
+	@author Andrew Trotman
+	@copyright 2021 Andrew Trotman
+*/
+#pragma once
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "slice.h"
+
+namespace JASS
+	{
+	/*
+		CLASS VOCABULARY_HASH
+		---------------------
+	*/
+	/*!
+		@brief A hash table, built when the index is built and used in place when it is searched, for looking up terms in the vocabulary.
+		@details Searching the sorted vocabulary takes log2(n) string compares and needs the vocabulary decoded into an array when the index
+		is loaded.  This table maps the hash of a term straight to the term's record in CIvocab.bin.  It is an open addressed (linear probing)
+		table with a power of 2 number of slots, no more than 3/4 full.  Each slot is a uint64_t, the high 32 bits are a fingerprint (the
+		high 32 bits of the hash of the term) and the low 32 bits are one more than the record number of the term (0 is an empty slot).  So
+		a slot only needs to be checked against the vocabulary when the fingerprints match, and a term not in the vocabulary almost never is.
+		The file (CIvocab_hash.bin) is the uint64_t number of slots, then the uint64_t number of terms, then the slots.
+	*/
+	class vocabulary_hash
+		{
+		public:
+			static constexpr size_t header_size = 2 * sizeof(uint64_t);		///< The size (in bytes) of the header at the start of the file
+
+		private:
+			const uint64_t *table;				///< The slots of the hash table
+			uint64_t slots;						///< The number of slots in the table (a power of 2)
+			uint64_t terms;						///< The number of terms in the table
+
+		public:
+			/*
+				VOCABULARY_HASH::VOCABULARY_HASH()
+				----------------------------------
+			*/
+			/*!
+				@brief Constructor (of an empty table)
+			*/
+			vocabulary_hash() :
+				table(nullptr),
+				slots(0),
+				terms(0)
+				{
+				/* Nothing */
+				}
+
+			/*
+				VOCABULARY_HASH::HASH()
+				-----------------------
+			*/
+			/*!
+				@brief Hash a term (FNV-1a then the MurmurHash3 finaliser, so that the low bits are as well mixed as the high bits).
+				@param term [in] The term to hash.
+				@return The 64-bit hash of the term.
+			*/
+			static uint64_t hash(const slice &term)
+				{
+				uint64_t result = 0xCBF29CE484222325;
+				const uint8_t *start = reinterpret_cast<const uint8_t *>(term.address());
+				const uint8_t *end = start + term.size();
+				for (const uint8_t *byte = start; byte < end; byte++)
+					result = (result ^ *byte) * 0x100000001B3;
+
+				result ^= result >> 33;
+				result *= 0xFF51AFD7ED558CCD;
+				result ^= result >> 33;
+				result *= 0xC4CEB9FE1A85EC53;
+				result ^= result >> 33;
+
+				return result;
+				}
+
+			/*
+				VOCABULARY_HASH::BUILD()
+				------------------------
+			*/
+			/*!
+				@brief Build the hash table (in the format of CIvocab_hash.bin) for a vocabulary.
+				@param vocabulary [in] The terms, in the order of their records in CIvocab.bin (there must be fewer than 2^32-1 of them).
+				@return The contents of CIvocab_hash.bin (as uint64_t words).
+			*/
+			static std::vector<uint64_t> build(const std::vector<slice> &vocabulary);
+
+			/*
+				VOCABULARY_HASH::READ()
+				-----------------------
+			*/
+			/*!
+				@brief Point the table at the contents of CIvocab_hash.bin (which is not copied and must outlive the table).
+				@param memory [in] The contents of CIvocab_hash.bin (aligned on a uint64_t boundary).
+				@param bytes [in] The length of CIvocab_hash.bin.
+				@return The number of terms in the table, or 0 if this is not a valid CIvocab_hash.bin (in which case the table is empty).
+			*/
+			size_t read(const uint8_t *memory, size_t bytes);
+
+			/*
+				VOCABULARY_HASH::SIZE()
+				-----------------------
+			*/
+			/*!
+				@brief Return the number of terms in the table.
+				@return The number of terms (0 if no table has been read).
+			*/
+			size_t size(void) const
+				{
+				return terms;
+				}
+
+			/*
+				VOCABULARY_HASH::FIND()
+				-----------------------
+			*/
+			/*!
+				@brief Find the record number of a term.
+				@details A slot holding a record number that is not less than the number of terms (from a damaged table) never matches, and at
+				most every slot is looked at (so a damaged table with no empty slot cannot loop forever).
+				@param term [in] The term to look for.
+				@param same [in] A function that, given a record number, returns whether or not that record is term (used to check candidates).
+				@param record [out] The record number of the term, if found.
+				@return true if the term is in the vocabulary, else false.
+			*/
+			template <typename SAME>
+			bool find(const slice &term, SAME same, size_t &record) const
+				{
+				if (slots == 0)
+					return false;
+
+				uint64_t key = hash(term);
+				uint64_t fingerprint = key >> 32;
+				uint64_t slot = key & (slots - 1);
+				for (uint64_t probe = 0; probe < slots && table[slot] != 0; probe++, slot = (slot + 1) & (slots - 1))
+					{
+					uint64_t candidate = (table[slot] & 0xFFFFFFFF) - 1;
+					if ((table[slot] >> 32) == fingerprint && candidate < terms && same(candidate))
+						{
+						record = candidate;
+						return true;
+						}
+					}
+
+				return false;
+				}
+
+			/*
+				VOCABULARY_HASH::UNITTEST()
+				---------------------------
+			*/
+			/*!
+				@brief Unit test this class
+			*/
+			static void unittest(void);
+		};
+	}
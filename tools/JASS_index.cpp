@@ -12,10 +12,14 @@
 */
 #include <string.h>
 
+#include <mutex>
+#include <deque>
 #include <vector>
 #include <filesystem>
+#include <condition_variable>
 
 #include "timer.h"
+#include "threads.h"
 #include "parser.h"
 #include "version.h"
 #include "quantize.h"
@@ -25,15 +29,25 @@
 #include "serialise_ci.h"
 #include "quantize_none.h"
 #include "instream_file.h"
+#include "instream_file_mmap.h"
 #include "instream_memory.h"
 #include "instream_deflate.h"
+#include "instream_read_ahead.h"
 #include "compress_integer.h"
 #include "serialise_jass_v1.h"
+#include "serialise_jass_v2.h"
+#include "index_container.h"
+#include "deserialised_jass_v1.h"
 #include "serialise_integers.h"
+#include "reorder_remap.h"
+#include "reorder_bisection.h"
 #include "parser_unicoil_json.h"
 #include "instream_document_trec.h"
+#include "instream_document_warc.h"
 #include "instream_document_fasta.h"
 #include "serialise_forward_index.h"
+#include "index_manager_external.h"
+#include "index_manager_parallel.h"
 #include "index_manager_sequential.h"
 #include "ranking_function_atire_bm25.h"
 #include "instream_directory_iterator.h"
@@ -43,20 +57,28 @@
 	Declare the command line parameters
 */
 bool parameter_jass_v1_index = false;
+bool parameter_jass_v2_index = false;
+bool parameter_index_container = false;
 bool parameter_compiled_index = false;
 bool parameter_uint32_index = false;
 bool parameter_forward_index = false;
+bool parameter_reorder = false;
 std::string parameter_filename = "";
 bool parameter_quiet = false;
 bool parameter_help = false;
 size_t parameter_report_every_n = (std::numeric_limits<size_t>::max)();
 bool parameter_atire_similar = false;
 size_t parameter_fasta_kmer_length = 0;
+size_t parameter_threads = 1;
+size_t parameter_memory_budget = 0;
+bool parameter_read_ahead = false;
+bool parameter_mmap = false;
 
 bool parameter_stem_porter = false;
 
 bool parameter_document_format_trec = true;
 bool parameter_document_format_JSON_uniCOIL = false;
+bool parameter_document_format_WARC = false;
 
 auto command_line_parameters = std::make_tuple
 	(
@@ -69,12 +91,21 @@ auto command_line_parameters = std::make_tuple
 	JASS::commandline::note("\nREPORTING\n---------"),
 	JASS::commandline::parameter("-N", "--report-every", "<n> Report time and memory every <n> documents.", parameter_report_every_n),
 
+	JASS::commandline::note("\nTHREADING\n---------"),
+	JASS::commandline::parameter("-T", "--threads", "<n> Parse, index, and compress (-I1 or -I2) with <n> threads (and one more to read the documents), and decompress a directory of .gz files with <n> threads [default = -T1]", parameter_threads),
+
+	JASS::commandline::note("\nMEMORY\n------"),
+	JASS::commandline::parameter("-M", "--memory", "<MB> Index in runs of about <MB> megabytes, each written to disk and merged at the end (with -T1) [default = all in memory]", parameter_memory_budget),
+
 	JASS::commandline::note("\nFILE HANDLING\n-------------"),
 	JASS::commandline::parameter("-f", "--filename", "<filename> Filename to index.", parameter_filename),
+	JASS::commandline::parameter("-R", "--read_ahead", "Read (and decompress) the input on its own thread, ahead of the parser.", parameter_read_ahead),
+	JASS::commandline::parameter("-m", "--mmap", "Memory map the input file and (for TREC and WARC) index the documents in place, without copying them.", parameter_mmap),
 
 	JASS::commandline::note("\nDOCUMENT FORMATS\n-------------"),
 	JASS::commandline::parameter("-dt",  "--document_TREC", "TREC format: <DOC><DOCNO></DOCNO></DOC> formatted documents (default)", parameter_document_format_trec),
 	JASS::commandline::parameter("-djc", "--document_JSON_uniCOIL", "JSON uniCOIL forward index format: {\"id\": \"0\", \"vector\": {\"term\": 94 }}", parameter_document_format_JSON_uniCOIL),
+	JASS::commandline::parameter("-dw", "--document_WARC", "WARC format: the response records of a WARC file (.warc or .warc.gz) or of a directory of them (ClueWeb)", parameter_document_format_WARC),
 
 	JASS::commandline::note("\nCOMPATIBILITY\n-------------"),
 	JASS::commandline::parameter("-A", "--atire", "ATIRE-like parsing (errors and all)", parameter_atire_similar),
@@ -84,10 +115,13 @@ auto command_line_parameters = std::make_tuple
 
 	JASS::commandline::note("\nINDEX GENERATION\n----------------"),
 	JASS::commandline::parameter("-I1", "--index_jass_v1", "Generate a JASS version 1 index.", parameter_jass_v1_index),
+	JASS::commandline::parameter("-I2", "--index_jass_v2", "Generate a JASS version 2 index (JASS version 1 with the segment headers as arrays in CIsegments.bin).", parameter_jass_v2_index),
+	JASS::commandline::parameter("-IC", "--index_container", "Pack the JASS index (-I1 or -I2) into a single checksummed file (JASS.index).", parameter_index_container),
 	JASS::commandline::parameter("-Ib", "--index_binary", "Generate a binary dump of just the postings segments.", parameter_uint32_index),
 	JASS::commandline::parameter("-Ic", "--index_compiled", "Generate a JASS compiled index.", parameter_compiled_index),
 	JASS::commandline::parameter("-If", "--index_forward", "Generate a forward index.", parameter_forward_index),
-	JASS::commandline::parameter("-IF", "--index_FASTA", "<k> Generate a k-mer index from FASTA documents.", parameter_fasta_kmer_length)
+	JASS::commandline::parameter("-IF", "--index_FASTA", "<k> Generate a k-mer index from FASTA documents.", parameter_fasta_kmer_length),
+	JASS::commandline::parameter("-r", "--reorder", "Re-number the documents (recursive graph bisection) so that similar documents have close ids, and report the bits per posting before and after.", parameter_reorder)
 	);
 
 
@@ -100,7 +134,8 @@ enum document_format
 	NONE,
 	TREC,
 	K_MER,
-	JSON_uniCOIL
+	JSON_uniCOIL,
+	WARC
 	};
 
 /*
@@ -119,11 +154,7 @@ uint8_t usage(const std::string &exename)
 */
 document_format get_document_format()
 	{
-	if
-		(
-		parameter_fasta_kmer_length != 0 &&
-		parameter_document_format_JSON_uniCOIL
-		)
+	if ((parameter_fasta_kmer_length != 0) + parameter_document_format_JSON_uniCOIL + parameter_document_format_WARC > 1)
 		return document_format::NONE;
 
 
@@ -131,10 +162,264 @@ document_format get_document_format()
 		return document_format::K_MER;
 	else if (parameter_document_format_JSON_uniCOIL)
 		return document_format::JSON_uniCOIL;
+	else if (parameter_document_format_WARC)
+		return document_format::WARC;
 	else
 		return document_format::TREC;
 	}
 
+/*
+	NEW_PARSER()
+	------------
+*/
+/*!
+	@brief Create a parser for the given document format.
+	@param format [in] The format of the documents.
+	@return A new parser (which the caller must delete).
+*/
+JASS::parser *new_parser(document_format format)
+	{
+	switch (format)
+		{
+		case TREC:
+			return new JASS::parser();
+		case K_MER:
+			return new JASS::parser_fasta(parameter_fasta_kmer_length);
+		case JSON_uniCOIL:
+			return new JASS::parser_unicoil_json();
+		case WARC:
+			return new JASS::parser();
+		default:
+			std::cout << "Unknown parser type";
+			exit(1);
+		}
+	}
+
+/*
+	READ_AHEAD()
+	------------
+*/
+/*!
+	@brief If reading ahead (-R) then put an instream_read_ahead after the given instream.
+	@param source [in] The instream to read from.
+	@return The instream the document reader should read from.
+*/
+std::shared_ptr<JASS::instream> read_ahead(std::shared_ptr<JASS::instream> &source)
+	{
+	if (!parameter_read_ahead)
+		return source;
+
+	return std::shared_ptr<JASS::instream>(new JASS::instream_read_ahead(source));
+	}
+
+/*
+	INDEX_DOCUMENT()
+	----------------
+*/
+/*!
+	@brief Parse a document and add it to the index.
+	@param index [in/out] The index to add the document to.
+	@param parser [in] The parser to use.
+	@param stem [in] The stemmer to use (or nullptr for no stemming).
+	@param document [in] The document.
+	@return The length of the document (in terms).
+*/
+JASS::compress_integer::integer index_document(JASS::index_manager &index, JASS::parser &parser, JASS::stem *stem, JASS::document &document)
+	{
+	parser.set_document(document);
+	index.begin_document(document.primary_key);
+
+	/*
+		Process each token
+	*/
+	bool finished = false;
+	JASS::compress_integer::integer document_length = 0;				// measured in terms
+	do
+		{
+		auto &token = const_cast<JASS::parser::token &>(parser.get_next_token());
+//std::cout << "[" << token.lexeme << "," << token.count << "]\n";
+		switch (token.type)
+			{
+			case JASS::parser::token::eof:
+				finished = true;
+				break;
+			case JASS::parser::token::alpha:
+				document_length++;
+				if (stem != nullptr && token.lexeme.size() > 2)
+					stem->tostem(token, token);
+				index.term(token);
+				break;
+			case JASS::parser::token::numeric:
+				document_length++;
+				index.term(token);
+				break;
+			case JASS::parser::token::xml_start_tag:
+				break;
+			case JASS::parser::token::xml_end_tag:
+				break;
+			default:
+				break;
+			}
+		}
+	while (!finished);
+
+	/*
+		ATIRE has a bug that results in the document length calculation being off by one (one too large in ATIRE)
+	*/
+	index.end_document(document_length + (parameter_atire_similar ? 1 : 0));
+
+	return document_length;
+	}
+
+/*
+	CLASS DOCUMENT_BATCH
+	--------------------
+*/
+/*!
+	@brief A batch of consecutive documents from the collection, passed from the reading thread to an indexing thread.
+*/
+class document_batch
+	{
+	public:
+		static constexpr size_t size = 256;										///< The (maximum) number of documents in a batch
+
+	public:
+		std::vector<std::unique_ptr<JASS::document>> document;			///< The documents (re-used from batch to batch)
+		size_t documents;																///< The number of documents in this batch
+		JASS::compress_integer::integer first_document_id;					///< The document id of the first document in the batch (counting from 1)
+
+	public:
+		/*
+			DOCUMENT_BATCH::DOCUMENT_BATCH()
+			--------------------------------
+		*/
+		/*!
+			@brief Constructor
+		*/
+		document_batch() :
+			documents(0),
+			first_document_id(0)
+			{
+			for (size_t which = 0; which < size; which++)
+				document.push_back(std::make_unique<JASS::document>());
+			}
+	};
+
+/*
+	CLASS BATCH_QUEUE
+	-----------------
+*/
+/*!
+	@brief A blocking first-in first-out queue of batches of documents, shared between threads.
+*/
+class batch_queue
+	{
+	private:
+		std::mutex mutex;										///< Guards the queue
+		std::condition_variable changed;					///< Signalled when a batch is added or the queue is closed
+		std::deque<document_batch *> queue;				///< The batches
+		bool closed;											///< No more batches will be added
+
+	public:
+		/*
+			BATCH_QUEUE::BATCH_QUEUE()
+			--------------------------
+		*/
+		/*!
+			@brief Constructor
+		*/
+		batch_queue() :
+			closed(false)
+			{
+			/* Nothing */
+			}
+
+		/*
+			BATCH_QUEUE::PUSH()
+			-------------------
+		*/
+		/*!
+			@brief Add a batch to the end of the queue.
+			@param batch [in] The batch.
+		*/
+		void push(document_batch *batch)
+			{
+			{
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.push_back(batch);
+			}
+			changed.notify_one();
+			}
+
+		/*
+			BATCH_QUEUE::POP()
+			------------------
+		*/
+		/*!
+			@brief Remove the batch at the front of the queue, waiting for one if the queue is empty.
+			@return The batch, or nullptr if the queue is empty and has been closed.
+		*/
+		document_batch *pop(void)
+			{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [this]{return queue.size() != 0 || closed;});
+			if (queue.size() == 0)
+				return nullptr;
+
+			document_batch *batch = queue.front();
+			queue.pop_front();
+			return batch;
+			}
+
+		/*
+			BATCH_QUEUE::CLOSE()
+			--------------------
+		*/
+		/*!
+			@brief Mark the end of the queue, after which pop() returns nullptr once the queue is empty.
+		*/
+		void close(void)
+			{
+			{
+			std::lock_guard<std::mutex> lock(mutex);
+			closed = true;
+			}
+			changed.notify_all();
+			}
+	};
+
+/*
+	INDEX_BATCHES()
+	---------------
+*/
+/*!
+	@brief An indexing thread: parse and index batches of documents into one part of the index until there are no more.
+	@param index [in/out] The index.
+	@param which [in] The part of the index this thread indexes into.
+	@param format [in] The format of the documents.
+	@param full [in] The queue of batches to index.
+	@param empty [out] Batches are returned here once indexed.
+	@param collection_length [out] The total length (in terms) of the documents this thread indexed.
+*/
+void index_batches(JASS::index_manager_parallel &index, size_t which, document_format format, batch_queue &full, batch_queue &empty, uint64_t &collection_length)
+	{
+	std::unique_ptr<JASS::parser> parser(new_parser(format));
+	std::unique_ptr<JASS::stem> stem(parameter_stem_porter ? new JASS::stem_porter : nullptr);
+	JASS::index_manager_sequential &part = index.part(which);
+
+	uint64_t length = 0;
+	document_batch *batch;
+	while ((batch = full.pop()) != nullptr)
+		{
+		index.begin_batch(which, batch->first_document_id);
+		for (size_t current = 0; current < batch->documents; current++)
+			length += index_document(part, *parser, stem.get(), *batch->document[current]);
+		empty.push(batch);
+		}
+
+	collection_length = length;
+	}
+
 /*
 	MAIN()
 	------
@@ -177,66 +462,97 @@ int main(int argc, const char *argv[])
 	/*
 		Check to make sure we'll actually be exporting the index
 	*/
-	if (!(parameter_jass_v1_index | parameter_uint32_index | parameter_compiled_index | parameter_forward_index | parameter_fasta_kmer_length))
+	if (!(parameter_jass_v1_index | parameter_jass_v2_index | parameter_uint32_index | parameter_compiled_index | parameter_forward_index | parameter_fasta_kmer_length))
 		{
 		std::cout << "You must specify an index file format or else no index will be generated\n";
 		return 1;
 		}
 
 	/*
-		Decode the input filename
+		JASS version 1 and JASS version 2 indexes use the same file names
 	*/
-	if (parameter_filename == "")
-		std::cout << "filename needed";
+	if (parameter_jass_v1_index && parameter_jass_v2_index)
+		{
+		std::cout << "-I1 and -I2 cannot both be used\n";
+		return 1;
+		}
+	if (parameter_index_container && !(parameter_jass_v1_index || parameter_jass_v2_index))
+		{
+		std::cout << "-IC needs a JASS index (-I1 or -I2) to pack\n";
+		return 1;
+		}
 
 	/*
-		Set up the parser
+		Indexing in runs is only supported single threaded
 	*/
-	JASS::parser *parser;
-	switch (format)
+	if (parameter_memory_budget != 0 && parameter_threads > 1)
 		{
-		case TREC:
-			parser = new JASS::parser();
-			break;
-		case K_MER:
-			parser = new JASS::parser_fasta(parameter_fasta_kmer_length);
-			break;
-		case JSON_uniCOIL:
-			parser = new JASS::parser_unicoil_json();
-			break;
-		default:
-			std::cout << "Unknown parser type";
-			exit(1);
-			break;
+		std::cout << "-M (indexing in runs) cannot be used with -T (more than one thread)\n";
+		return 1;
 		}
 
+	/*
+		Decode the input filename
+	*/
+	if (parameter_filename == "")
+		std::cout << "filename needed";
+
 	/*
 		Set up the input pipeline
 	*/
-	std::shared_ptr<JASS::instream> file(new JASS::instream_file(parameter_filename));
+	std::shared_ptr<JASS::instream> file;
+	if (parameter_mmap)
+		file.reset(new JASS::instream_file_mmap(parameter_filename));
+	else
+		file.reset(new JASS::instream_file(parameter_filename));
 	JASS::instream *data_source;
 	switch (format)
 		{
 		case TREC:
-			data_source = new JASS::instream_document_trec(file);
+			{
+			auto stream = parameter_mmap ? file : read_ahead(file);		// the document reader must read directly from the mapped file to avoid copying (and the kernel reads ahead)
+			data_source = new JASS::instream_document_trec(stream);
 			break;
+			}
 		case K_MER:
-			data_source = new JASS::instream_document_fasta(file);
+			{
+			auto stream = read_ahead(file);
+			data_source = new JASS::instream_document_fasta(stream);
 			break;
+			}
 		case JSON_uniCOIL:
 			{
 			if (std::filesystem::is_directory(std::filesystem::path(parameter_filename)))
 				{
-				std::shared_ptr<JASS::instream> source(new JASS::instream_directory_iterator(parameter_filename));
-				data_source = new JASS::instream_document_unicoil_json(source);
+				std::shared_ptr<JASS::instream> directory(new JASS::instream_directory_iterator(parameter_filename, parameter_threads));
+				auto stream = read_ahead(directory);
+				data_source = new JASS::instream_document_unicoil_json(stream);
 				}
 			else
 				{
 				std::shared_ptr<JASS::instream> deflater(new JASS::instream_deflate(file));
-				data_source = new JASS::instream_document_unicoil_json(deflater);
+				auto stream = read_ahead(deflater);
+				data_source = new JASS::instream_document_unicoil_json(stream);
 				}
 			break;
 			}
+		case WARC:
+			{
+			/*
+				A directory of WARC files (decompressed with -T threads), a compressed WARC file, or a WARC file (read in place with -m)
+			*/
+			std::shared_ptr<JASS::instream> archive;
+			if (std::filesystem::is_directory(std::filesystem::path(parameter_filename)))
+				archive.reset(new JASS::instream_directory_iterator(parameter_filename, parameter_threads));
+			else if (parameter_filename.size() > 3 && parameter_filename.compare(parameter_filename.size() - 3, 3, ".gz") == 0)
+				archive.reset(new JASS::instream_deflate(file));
+			else
+				archive = file;
+
+			auto stream = parameter_mmap && archive == file ? file : read_ahead(archive);
+			data_source = new JASS::instream_document_warc(stream);
+			break;
+			}
 		default:
 			std::cout << "Unknown parser type";
 			exit(1);
@@ -245,17 +561,10 @@ int main(int argc, const char *argv[])
 
 	std::shared_ptr<JASS::instream> source(data_source);
 
-	/*
-		Set up the stemmer
-	*/
-	JASS::stem *stem = nullptr;
-	if (parameter_stem_porter)
-		stem = new JASS::stem_porter;
-
 	/*
 		Now call JASS
 	*/
-	JASS::index_manager_sequential index;
+	std::unique_ptr<JASS::index_manager> index;
 	JASS::document document;
 	size_t total_documents = 0;
 
@@ -265,74 +574,118 @@ int main(int argc, const char *argv[])
 		Parse the instream to get document (which are then indexed)
 	*/
 	uint64_t collection_length = 0;		// measured in terms
-	do
+	if (parameter_threads <= 1)
 		{
-		/*
-			Reuse memory from before
-		*/
-		document.rewind();
-
-		/*
-			get the next document
-		*/
-		source->read(document);
-		if (document.isempty())
-			break;
+		std::unique_ptr<JASS::index_manager> sequential;
+		JASS::index_manager_external *external = nullptr;
+		if (parameter_memory_budget == 0)
+			sequential = std::make_unique<JASS::index_manager_sequential>();
+		else
+			{
+			external = new JASS::index_manager_external(parameter_memory_budget * 1024 * 1024);
+			sequential.reset(external);
+			}
+		std::unique_ptr<JASS::parser> parser(new_parser(format));
+		std::unique_ptr<JASS::stem> stem(parameter_stem_porter ? new JASS::stem_porter : nullptr);
 
-		total_documents++;
-		if (total_documents % parameter_report_every_n == 0)
+		do
 			{
-			auto took = JASS::timer::stop(timer).nanoseconds();
-			std::cout << "Documents:" << total_documents << " in:" << took << " ns" << "\n";
+			/*
+				Reuse memory from before
+			*/
+			document.rewind();
+
+			/*
+				get the next document
+			*/
+			source->read(document);
+			if (document.isempty())
+				break;
+
+			total_documents++;
+			if (total_documents % parameter_report_every_n == 0)
+				{
+				auto took = JASS::timer::stop(timer).nanoseconds();
+				std::cout << "Documents:" << total_documents << " in:" << took << " ns" << "\n";
+				}
+
+			/*
+				parse and index the current document
+			*/
+			collection_length += index_document(*sequential, *parser, stem.get(), document);
 			}
+		while (!document.isempty());
 
 		/*
-			parse the current document
+			Write the last run to disk
 		*/
-		parser->set_document(document);
-		index.begin_document(document.primary_key);
+		if (external != nullptr)
+			{
+			external->finish();
+			std::cout << "Runs     :" << external->get_runs() << '\n';
+			}
 
+		index = std::move(sequential);
+		}
+	else
+		{
 		/*
-			Process each token
+			This thread reads batches of documents and the workers parse and index them, each into its own part of the index.
+			There are only a few batches so the reader cannot get far ahead of the workers.
 		*/
-		bool finished = false;
-		JASS::compress_integer::integer document_length = 0;				// measured in terms
-		do
+		auto parallel = std::make_unique<JASS::index_manager_parallel>(parameter_threads);
+		std::vector<document_batch> batches(parameter_threads * 2);
+		batch_queue full;
+		batch_queue empty;
+		for (auto &batch : batches)
+			empty.push(&batch);
+
+		std::vector<uint64_t> worker_collection_length(parameter_threads);
+		std::vector<JASS::thread> workers;
+		for (size_t which = 0; which < parameter_threads; which++)
+			workers.push_back(JASS::thread(index_batches, std::ref(*parallel), which, format, std::ref(full), std::ref(empty), std::ref(worker_collection_length[which])));
+
+		bool more = true;
+		while (more)
 			{
-			auto &token = const_cast<JASS::parser::token &>(parser->get_next_token());
-//std::cout << "[" << token.lexeme << "," << token.count << "]\n";
-			switch (token.type)
+			document_batch *batch = empty.pop();
+			batch->first_document_id = static_cast<JASS::compress_integer::integer>(total_documents + 1);
+			batch->documents = 0;
+			while (batch->documents < document_batch::size)
 				{
-				case JASS::parser::token::eof:
-					finished = true;
-					break;
-				case JASS::parser::token::alpha:
-					document_length++;
-					if (stem != nullptr && token.lexeme.size() > 2)
-						stem->tostem(token, token);
-					index.term(token);
-					break;
-				case JASS::parser::token::numeric:
-					document_length++;
-					index.term(token);
-					break;
-				case JASS::parser::token::xml_start_tag:
-					break;
-				case JASS::parser::token::xml_end_tag:
-					break;
-				default:
+				JASS::document &current = *batch->document[batch->documents];
+				current.rewind();
+				source->read(current);
+				if (current.isempty())
+					{
+					more = false;
 					break;
+					}
+
+				batch->documents++;
+				total_documents++;
+				if (total_documents % parameter_report_every_n == 0)
+					{
+					auto took = JASS::timer::stop(timer).nanoseconds();
+					std::cout << "Documents:" << total_documents << " in:" << took << " ns" << "\n";
+					}
 				}
+			if (batch->documents != 0)
+				full.push(batch);
 			}
-		while (!finished);
-		collection_length += document_length;
+		full.close();
+
+		for (auto &worker : workers)
+			worker.join();
+		for (auto length : worker_collection_length)
+			collection_length += length;
 
 		/*
-			ATIRE has a bug that results in the document length calculation being off by one (one too large in ATIRE)
+			Merge the document lengths, primary keys, and vocabularies of the parts
 		*/
-		index.end_document(document_length + (parameter_atire_similar ? 1 : 0));
+		parallel->finish();
+		index = std::move(parallel);
 		}
-	while (!document.isempty());
 
 	auto time_to_end_parse = JASS::timer::stop(timer).nanoseconds();
 
@@ -342,7 +695,7 @@ int main(int argc, const char *argv[])
 	/*
 		quantize the index
 	*/
-	std::shared_ptr<JASS::ranking_function_atire_bm25> ranker(new JASS::ranking_function_atire_bm25(0.9, 0.4, index.get_document_length_vector()));
+	std::shared_ptr<JASS::ranking_function_atire_bm25> ranker(new JASS::ranking_function_atire_bm25(0.9, 0.4, index->get_document_length_vector()));
 
 	JASS::quantize<JASS::ranking_function_atire_bm25> *quantizer;
 	if (format == JSON_uniCOIL)
@@ -350,29 +703,67 @@ int main(int argc, const char *argv[])
 	else
 		{
 		quantizer = new JASS::quantize<JASS::ranking_function_atire_bm25>(total_documents, ranker);
-		index.iterate(*quantizer);
+		index->iterate(*quantizer);
 		}
 
 	auto time_to_end_quantization = JASS::timer::stop(timer).nanoseconds();
 
 	/*
-		Decode the export formats and encode into a vector
+		Decode the export formats and encode into a vector (the re-orderer is only built if re-ordering, but must outlive the exporters as they refer to its new document ids)
 	*/
+	std::unique_ptr<JASS::reorder_bisection> reorderer;
 	std::vector<std::unique_ptr<JASS::index_manager::delegate>> exporters;
 	if (parameter_compiled_index)
-		exporters.push_back(std::make_unique<JASS::serialise_ci>(index.get_highest_document_id()));
+		exporters.push_back(std::make_unique<JASS::serialise_ci>(index->get_highest_document_id()));
 	if (parameter_jass_v1_index)
-		exporters.push_back(std::make_unique<JASS::serialise_jass_v1>(index.get_highest_document_id()));
+		exporters.push_back(std::make_unique<JASS::serialise_jass_v1>(index->get_highest_document_id(), JASS::serialise_jass_v1::jass_v1_codex::elias_gamma_simd, 1, parameter_threads));
+	if (parameter_jass_v2_index)
+		exporters.push_back(std::make_unique<JASS::serialise_jass_v2>(index->get_highest_document_id(), JASS::serialise_jass_v1::jass_v1_codex::elias_gamma_simd, 1, parameter_threads));
 	if (parameter_uint32_index)
-		exporters.push_back(std::make_unique<JASS::serialise_integers>(index.get_highest_document_id()));
+		exporters.push_back(std::make_unique<JASS::serialise_integers>(index->get_highest_document_id()));
 	if (parameter_forward_index)
-		exporters.push_back(std::make_unique<JASS::serialise_forward_index>(index.get_highest_document_id()));
+		exporters.push_back(std::make_unique<JASS::serialise_forward_index>(index->get_highest_document_id()));
+
+	/*
+		Re-number the documents so that similar documents have close document ids (and so the d-gaps are small), the primary keys move with the documents.
+	*/
+	if (parameter_reorder && exporters.size() != 0)
+		{
+		reorderer = std::make_unique<JASS::reorder_bisection>(index->get_highest_document_id());
+		index->iterate(*reorderer);
+		auto &new_id = reorderer->compute();
+		std::cout << "Bits per posting before reordering:" << reorderer->bits_per_posting() << '\n';
+		std::cout << "Bits per posting after reordering :" << reorderer->bits_per_posting(&new_id) << '\n';
+
+		for (auto &exporter : exporters)
+			exporter = std::make_unique<JASS::reorder_remap>(new_id, std::move(exporter));
+		}
+
+	auto time_to_end_reorder = JASS::timer::stop(timer).nanoseconds();
 
 	/*
 		Write out the index in the desired formats.
 	*/
 	if (exporters.size() != 0)
-		quantizer->serialise_index(index, exporters);
+		quantizer->serialise_index(*index, exporters);
+
+	/*
+		Pack the JASS index into a single file (once the serialisers have finished writing it).
+	*/
+	if (parameter_index_container)
+		{
+		exporters.clear();
+		std::vector<std::string> files = {"CIdoclist.bin", "CIvocab.bin", "CIvocab_terms.bin", "CIpostings.bin"};
+		if (parameter_jass_v2_index)
+			{
+			files.push_back("CIsegments.bin");
+			files.push_back("CIvocab_hash.bin");
+			}
+		if (!JASS::index_container::write(JASS::deserialised_jass_v1::container_name, files, parameter_jass_v2_index ? 2 : 1, JASS::serialise_jass_v1::jass_v1_codex::elias_gamma_simd))
+			exit(printf("Cannot write the index container (%s)\n", JASS::deserialised_jass_v1::container_name));
+		for (const auto &name : files)
+			::remove(name.c_str());
+		}
 
 	/*
 		Dump the statistics to the console.
@@ -380,16 +771,18 @@ int main(int argc, const char *argv[])
 	auto time_to_end = JASS::timer::stop(timer).nanoseconds();
 	auto parse_time = time_to_end_parse - preamble_time;
 	auto quantization_time = time_to_end_quantization - time_to_end_parse;
-	auto serialise_time = time_to_end - time_to_end_quantization;
+	auto reorder_time = time_to_end_reorder - time_to_end_quantization;
+	auto serialise_time = time_to_end - time_to_end_reorder;
 
 	std::cout << "Preamble time    :" << preamble_time << "ns (" << preamble_time / 1000000000 << " seconds)\n";
 	std::cout << "Parse time       :" << parse_time << "ns (" << parse_time / 1000000000 << " seconds)\n";
 	std::cout << "Quantization time:" << quantization_time << "ns (" << quantization_time / 1000000000 << " seconds)\n";
+	if (parameter_reorder)
+		std::cout << "Reorder time     :" << reorder_time << "ns (" << reorder_time / 1000000000 << " seconds)\n";
 	std::cout << "Serialise time   :" << serialise_time << "ns (" << serialise_time / 1000000000 << " seconds)\n";
 	std::cout << "=================\n";
 	std::cout << "Total time       :" << time_to_end << "ns (" << time_to_end / 1000000000 << " seconds)\n";
 
-	delete parser;
 	delete quantizer;
 
 	/*
@@ -0,0 +1,262 @@
+/*
+	JASS_MERGE.CPP
+	--------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*!
+	@brief Fold one or more delta indexes into a main index, writing the merged index into the current directory.
+	@details New documents are indexed (with JASS_index) into a small delta index in a directory of its own.  JASS_anytime --delta
+	searches the deltas alongside the main index, and this tool (which can run in the background while JASS_anytime is serving
+	the main index and the deltas) merges them into a new main index.  The postings lists are decoded and concatenated rather than
+	re-built from the documents, so the documents of the first delta follow those of the main index, those of the second delta
+	follow those of the first, and so on (the order JASS_anytime --delta uses).  The impact scores are copied from the indexes they come
+	from, they are not re-quantized.  The merged index has the version (JASS v1 or JASS v2) and the codex of the main index.
+*/
+#include <stdio.h>
+#include <stdint.h>
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+
+#include "slice.h"
+#include "commandline.h"
+#include "allocator_pool.h"
+#include "index_postings.h"
+#include "compress_integer.h"
+#include "serialise_jass_v1.h"
+#include "serialise_jass_v2.h"
+#include "deserialised_jass_v1.h"
+
+/*
+	PARAMETERS
+	----------
+*/
+std::string parameter_index;						///< The directory holding the main index (it cannot be the current directory)
+std::string parameter_delta;						///< Comma separated list of directories holding the delta indexes (oldest first)
+size_t parameter_threads = 1;						///< The number of threads to compress with
+bool parameter_help = false;
+
+std::string parameters_errors;						///< Any errors as a result of command line parsing
+auto parameters = std::make_tuple					///< The  command line parameter block
+	(
+	JASS::commandline::parameter("-?", "--help",    "Print this help.", parameter_help),
+	JASS::commandline::parameter("-i", "--index",   "<dir>             The directory holding the main index (not the current directory, where the merged index is written)", parameter_index),
+	JASS::commandline::parameter("-d", "--delta",   "<dir[,dir...]>    The directories holding the delta indexes, oldest first", parameter_delta),
+	JASS::commandline::parameter("-T", "--threads", "<threadcount>     The number of threads to compress with [default = -T1]", parameter_threads)
+	);
+
+typedef std::pair<JASS::compress_integer::integer, JASS::index_postings_impact::impact_type> posting;		///< A <document_id, impact> pair
+
+/*
+	READ_INDEX()
+	------------
+*/
+/*!
+	@brief Read the JASS v1 (or JASS v2) index in the given directory.
+	@param directory [in] The directory holding the index.
+	@return The index (exits on failure).
+*/
+std::unique_ptr<JASS::deserialised_jass_v1> read_index(const std::string &directory)
+	{
+	auto index = std::make_unique<JASS::deserialised_jass_v1>(false);
+	if (index->read_index_directory(directory, parameter_threads) == 0)
+		exit(printf("Cannot read the index in %s\n", directory.c_str()));
+
+	return index;
+	}
+
+/*
+	DECODE()
+	--------
+*/
+/*!
+	@brief Decode a postings list and append its postings (with JASS v2 document ids, counting from 1) to a list.
+	@param into [out] The postings are appended to this list.
+	@param index [in] The index holding the postings list.
+	@param term [in] The term (and so the postings list) to decode.
+	@param decoder [in] The decompressor for this index.
+	@param d_ness [in] Whether the decompressed postings are D1 encoded (1) or not (0).
+	@param buffer [in] A buffer large enough to decode any segment of this index into.
+	@param first_document_id [in] The number of documents that come before those of this index.
+*/
+void decode(std::vector<posting> &into, const JASS::deserialised_jass_v1 &index, const JASS::deserialised_jass_v1::metadata &term, JASS::compress_integer &decoder, int32_t d_ness, std::vector<JASS::compress_integer::integer> &buffer, size_t first_document_id)
+	{
+	if (!index.segments_are_valid(term))
+		exit(printf("The postings of term %*.*s are damaged\n", static_cast<int>(term.term.size()), static_cast<int>(term.term.size()), reinterpret_cast<char *>(term.term.address())));
+
+	for (uint64_t current_segment = 0; current_segment < term.impacts; current_segment++)
+		{
+		const auto header = index.segment(term, current_segment);
+
+		if (header.impact > JASS::index_postings_impact::largest_impact)
+			exit(printf("Impact score %u of term %*.*s is too large to index\n", static_cast<unsigned>(header.impact), static_cast<int>(term.term.size()), static_cast<int>(term.term.size()), reinterpret_cast<char *>(term.term.address())));
+
+		decoder.decode(&buffer[0], header.segment_frequency, index.postings() + header.offset, header.end - header.offset);
+		if (d_ness == 1)
+			JASS::compress_integer::d1_decode(&buffer[0], &buffer[0], header.segment_frequency);
+
+		/*
+			JASS v1 counts documents from 0, JASS v2 from 1.
+		*/
+		for (uint32_t which = 0; which < header.segment_frequency; which++)
+			into.push_back(posting(static_cast<JASS::compress_integer::integer>(buffer[which] + 1 + first_document_id), static_cast<JASS::index_postings_impact::impact_type>(header.impact)));
+		}
+	}
+
+/*
+	USAGE()
+	-------
+*/
+/*!
+	@brief Print the usage line
+*/
+uint8_t usage(const std::string &exename)
+	{
+	std::cout << JASS::commandline::usage(exename, parameters) << "\n";
+
+	return 1;
+	}
+
+/*
+	MAIN()
+	------
+*/
+/*!
+	@brief Fold one or more delta indexes into a main index.
+*/
+int main(int argc, const char *argv[])
+	{
+	auto success = JASS::commandline::parse(argc, argv, parameters, parameters_errors);
+	if (!success)
+		{
+		std::cout << parameters_errors;
+		exit(1);
+		}
+	if (parameter_help || parameter_index.size() == 0 || parameter_delta.size() == 0)
+		exit(usage(argv[0]));
+
+	/*
+		The main index then the deltas.  The merged index is written to the current directory so none of them can be read from there, which is
+		checked before anything is loaded.
+	*/
+	std::vector<std::string> directories = {parameter_index};
+	for (size_t start = 0; start < parameter_delta.size(); )
+		{
+		size_t comma = parameter_delta.find(',', start);
+		std::string directory = parameter_delta.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+		start = comma == std::string::npos ? parameter_delta.size() : comma + 1;
+		if (directory.size() != 0)
+			directories.push_back(directory);
+		}
+
+	for (const auto &directory : directories)
+		{
+		std::error_code error;
+		if (std::filesystem::equivalent(directory, ".", error))
+			exit(printf("The merged index is written to the current directory so it cannot also be read from there (%s)\n", directory.c_str()));
+		}
+
+	std::vector<std::unique_ptr<JASS::deserialised_jass_v1>> index;
+	for (const auto &directory : directories)
+		index.push_back(read_index(directory));
+
+	/*
+		Each index has its own decompressor and numbers its documents from after those of the indexes before it
+	*/
+	std::vector<std::unique_ptr<JASS::compress_integer>> decoder;
+	std::vector<int32_t> d_ness(index.size());
+	std::vector<size_t> first_document_id;
+	size_t documents = 0;
+	size_t largest_index = 0;
+	for (size_t which = 0; which < index.size(); which++)
+		{
+		std::string codex_name;
+		decoder.push_back(index[which]->codex(codex_name, d_ness[which]));
+		first_document_id.push_back(documents);
+		documents += index[which]->document_count();
+		largest_index = (std::max)(largest_index, index[which]->document_count());
+		}
+	std::vector<JASS::compress_integer::integer> buffer(largest_index + 1024);		// the decompressors can write past the end of the segment
+
+	std::cout << "Merging " << index.size() - 1 << " delta" << (index.size() == 2 ? "" : "s") << " into an index of " << documents << " documents\n";
+
+	/*
+		The merged index uses the codex (and the version) of the main index
+	*/
+	auto codex = static_cast<JASS::serialise_jass_v1::jass_v1_codex>(index[0]->codex_id());
+	int8_t alignment = codex == JASS::serialise_jass_v1::jass_v1_codex::qmx ? 16 : 1;
+	std::unique_ptr<JASS::serialise_jass_v1> serialiser;
+	if (index[0]->version() == 2)
+		serialiser = std::make_unique<JASS::serialise_jass_v2>(documents, codex, alignment, parameter_threads);
+	else
+		serialiser = std::make_unique<JASS::serialise_jass_v1>(documents, codex, alignment, parameter_threads);
+
+	/*
+		Walk the (sorted) vocabularies in step, concatenating the postings lists of each term
+	*/
+	std::vector<decltype(index[0]->begin())> current;
+	for (auto &each : index)
+		current.push_back(each->begin());
+
+	JASS::allocator_pool memory;
+	JASS::index_postings unused(memory);
+	std::vector<posting> postings;
+	std::vector<JASS::compress_integer::integer> document_ids;
+	std::vector<JASS::index_postings_impact::impact_type> impacts;
+	while (true)
+		{
+		const JASS::slice *term = nullptr;
+		for (size_t which = 0; which < index.size(); which++)
+			if (current[which] != index[which]->end())
+				if (term == nullptr || JASS::slice::strict_weak_order_less_than(current[which]->term, *term))
+					term = &current[which]->term;
+
+		if (term == nullptr)
+			break;
+		JASS::slice token = *term;
+
+		postings.clear();
+		for (size_t which = 0; which < index.size(); which++)
+			if (current[which] != index[which]->end() && current[which]->term == token)
+				{
+				decode(postings, *index[which], *current[which], *decoder[which], d_ness[which], buffer, first_document_id[which]);
+				++current[which];
+				}
+
+		/*
+			A term with no postings (a vocabulary record with no segments) isn't carried into the merged index
+		*/
+		if (postings.size() == 0)
+			continue;
+
+		/*
+			The serialiser wants the postings in document order
+		*/
+		std::sort(postings.begin(), postings.end());
+		document_ids.resize(postings.size());
+		impacts.resize(postings.size());
+		for (size_t which = 0; which < postings.size(); which++)
+			{
+			document_ids[which] = postings[which].first;
+			impacts[which] = postings[which].second;
+			}
+
+		(*serialiser)(token, unused, static_cast<JASS::compress_integer::integer>(postings.size()), document_ids.data(), impacts.data());
+		}
+
+	/*
+		The primary keys (the serialiser counts documents from 1 so the first is a placeholder)
+	*/
+	size_t document_id = 0;
+	(*serialiser)(document_id, JASS::slice("-"));
+	for (const auto &each : index)
+		for (const auto &key : each->primary_keys())
+			(*serialiser)(++document_id, JASS::slice(const_cast<char *>(key.data()), key.size()));
+
+	return 0;
+	}
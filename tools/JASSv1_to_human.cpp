@@ -15,6 +15,7 @@
 
 #include "file.h"
 #include "commandline.h"
+#include "query_heap_clean.h"
 #include "deserialised_jass_v1.h"
 
 /*
@@ -115,9 +116,9 @@ class printer
 /*!
 	@brief Walk the index, term by term, and print each posting from each postings list.
 	@param index [in] Reference to a JASS v1 deserialised index object.
-	@param decompressor [in] reference to an object that can decompress a postings list segment.
+	@param decompressor [in] reference to a query object (holding the codex) that can decompress a postings list segment.
 */
-void walk_index(JASS::deserialised_jass_v1 &index, JASS::compress_integer &decompressor)
+void walk_index(JASS::deserialised_jass_v1 &index, JASS::query_heap_clean<> &decompressor)
 	{
 	printer out_stream;
 
@@ -136,8 +137,7 @@ void walk_index(JASS::deserialised_jass_v1 &index, JASS::compress_integer &decom
 			*/
 			for (uint64_t current_segment = 0; current_segment < term.impacts; current_segment++)
 				{
-				uint64_t *postings = (uint64_t *)term.offset + current_segment;
-				const JASS::deserialised_jass_v1::segment_header &header = *reinterpret_cast<const JASS::deserialised_jass_v1::segment_header *>(index.postings() + *postings);
+				const JASS::deserialised_jass_v1::segment_header header = index.segment(term, current_segment);
 
 				decompressor.set_impact(header.impact);
 				decompressor.decode_with_writer(out_stream, header.segment_frequency, index.postings() + header.offset, header.end - header.offset);
@@ -188,14 +188,15 @@ int main(int argc, const char *argv[])
 			Open and read the index
 		*/
 		JASS::deserialised_jass_v1 index(false);
-		index.read_index();
+		index.read_index_directory(".");
 
 		/*
 			Get the encoding scheme and the d-ness of the index
 		*/
 		std::string codex_name;
 		int32_t d_ness;
-		std::unique_ptr<JASS::compress_integer> decompressor = index.codex(codex_name, d_ness);
+		auto decompressor = std::make_unique<JASS::query_heap_clean<>>();
+		decompressor->set_codex(index.codex(codex_name, d_ness));
 		decompressor->init(index.primary_keys(), index.document_count());
 
 		if (!parameter_look_like_atire)
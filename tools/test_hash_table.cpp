@@ -0,0 +1,198 @@
+/*
+	TEST_HASH_TABLE.CPP
+	-------------------
+	Copyright (c) 2021 Andrew Trotman
+	Released under the 2-clause BSD license (See:https://en.wikipedia.org/wiki/BSD_licenses)
+*/
+/*
+	Compare the speed of the indexer's dictionaries (hash_table and hash_table_open) on the terms of a real collection.
+	The collection (in TREC format) is parsed the same way JASS_index parses it, and the token stream is kept in memory.
+	Each dictionary then has every token added to it (counting the occurences of each term), which is the work the
+	indexer does for each term (less the postings).  The time, memory, and the order of iteration are reported.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <limits>
+#include <vector>
+#include <iostream>
+
+#include "timer.h"
+#include "parser.h"
+#include "document.h"
+#include "hash_table.h"
+#include "commandline.h"
+#include "instream_file.h"
+#include "allocator_pool.h"
+#include "hash_table_open.h"
+#include "instream_document_trec.h"
+
+/*
+	CLASS COUNTER
+	-------------
+*/
+/*!
+	@brief The dictionary's element, the number of times the term has been seen.
+*/
+class counter
+	{
+	public:
+		size_t count;			///< The number of occurences of the term
+
+	public:
+		/*
+			COUNTER::COUNTER()
+			------------------
+		*/
+		/*!
+			@brief Constructor
+			@param pool [in] Unused.
+		*/
+		counter(JASS::allocator &pool) :
+			count(0)
+			{
+			/* Nothing */
+			}
+	};
+
+/*
+	TIME_DICTIONARY()
+	-----------------
+*/
+/*!
+	@brief Add each token to the dictionary and report how long it took.
+	@param name [in] The name of the dictionary (for reporting).
+	@param tokens [in] The token stream.
+	@param times [in] The number of times to repeat the experiment (the fastest is reported).
+	@tparam DICTIONARY The type of the dictionary.
+	@return A checksum of the iteration order (which should be the same for each dictionary).
+*/
+template <typename DICTIONARY>
+uint64_t time_dictionary(const char *name, const std::vector<JASS::slice> &tokens, size_t times)
+	{
+	auto fastest = (std::numeric_limits<decltype(JASS::timer::stop(JASS::timer::start()).nanoseconds())>::max)();
+	size_t memory = 0;
+	size_t terms = 0;
+	uint64_t checksum = 0;
+
+	for (size_t repeat = 0; repeat < times; repeat++)
+		{
+		JASS::allocator_pool pool;
+		DICTIONARY dictionary(pool);
+
+		auto timer = JASS::timer::start();
+		for (const auto &token : tokens)
+			dictionary[token].count++;
+		auto took = JASS::timer::stop(timer).nanoseconds();
+
+		if (took < fastest)
+			fastest = took;
+		memory = pool.size();
+
+		checksum = 0;
+		terms = 0;
+		for (const auto &[term, element] : dictionary)
+			{
+			checksum = checksum * 31 + term.size() * 7 + element.count;
+			terms++;
+			}
+		}
+
+	std::cout << name << '\n';
+	std::cout << "  Unique terms       :" << terms << '\n';
+	std::cout << "  Time               :" << fastest << " ns (" << (double)fastest / tokens.size() << " ns per token)\n";
+	std::cout << "  Memory             :" << memory << " bytes\n";
+	std::cout << "  Iteration checksum :" << checksum << '\n';
+
+	return checksum;
+	}
+
+/*
+	USAGE()
+	-------
+*/
+/*!
+	@brief Explain how to use this tool.
+	@param exename [in] The name of this program.
+	@param command_line_parameters [in] The command line parameters.
+	@tparam TYPE The type of the command line parameters.
+*/
+template <typename TYPE>
+void usage(const char *exename, TYPE &command_line_parameters)
+	{
+	std::cout << JASS::commandline::usage(exename, command_line_parameters);
+	}
+
+/*
+	MAIN()
+	------
+*/
+int main(int argc, const char *argv[])
+	{
+	std::string filename;
+	size_t times = 3;
+	bool help = false;
+
+	auto all_parameters = std::make_tuple
+		(
+		JASS::commandline::parameter("-?", "--help", "Print this help.", help),
+		JASS::commandline::parameter("-f", "--filename", "<filename> The TREC-formatted collection to take the terms from.", filename),
+		JASS::commandline::parameter("-n", "--times", "<n> Repeat each experiment <n> times and report the fastest [default = 3].", times)
+		);
+
+	std::string error;
+	if (!JASS::commandline::parse(argc, argv, all_parameters, error))
+		{
+		std::cout << error;
+		usage(argv[0], all_parameters);
+		return 1;
+		}
+	if (help || filename == "")
+		{
+		usage(argv[0], all_parameters);
+		return 1;
+		}
+
+	/*
+		Parse the collection and keep the token stream
+	*/
+	JASS::allocator_pool memory;
+	std::vector<JASS::slice> tokens;
+	JASS::parser parser;
+	JASS::document document;
+	std::shared_ptr<JASS::instream> file(new JASS::instream_file(filename));
+	JASS::instream_document_trec source(file);
+
+	size_t documents = 0;
+	while (true)
+		{
+		document.rewind();
+		source.read(document);
+		if (document.isempty())
+			break;
+		documents++;
+
+		parser.set_document(document);
+		for (const auto *token = &parser.get_next_token(); token->type != JASS::parser::token::eof; token = &parser.get_next_token())
+			if (token->type == JASS::parser::token::alpha || token->type == JASS::parser::token::numeric)
+				tokens.push_back(JASS::slice(memory, token->lexeme));
+		}
+
+	std::cout << "Documents            :" << documents << '\n';
+	std::cout << "Tokens               :" << tokens.size() << '\n';
+
+	/*
+		Time each dictionary
+	*/
+	auto chained = time_dictionary<JASS::hash_table<JASS::slice, counter, 24>>("hash_table<slice, counter, 24> (Pearson hash, chained binary trees)", tokens, times);
+	auto open = time_dictionary<JASS::hash_table_open<counter, 24>>("hash_table_open<counter, 24> (word-at-a-time hash, linear probing)", tokens, times);
+
+	if (chained != open)
+		{
+		std::cout << "The dictionaries iterate in a different order\n";
+		return 1;
+		}
+
+	return 0;
+	}
@@ -26,6 +26,7 @@
 #include "statistics.h"
 #include "evaluate_f.h"
 #include "hash_table.h"
+#include "hash_table_open.h"
 #include "run_export.h"
 #include "top_k_heap.h"
 #include "stem_porter.h"
@@ -40,6 +41,7 @@
 #include "parser_fasta.h"
 #include "channel_file.h"
 #include "channel_trec.h"
+#include "channel_socket.h"
 #include "query_bucket.h"
 #include "dynamic_array.h"
 #include "allocator_cpp.h"
@@ -51,14 +53,24 @@
 #include "accumulator_2d.h"
 #include "channel_buffer.h"
 #include "instream_memory.h"
+#include "instream_read_ahead.h"
+#include "instruction_set.h"
 #include "run_export_trec.h"
+#include "reorder_remap.h"
 #include "evaluate_recall.h"
+#include "query_heap_clean.h"
 #include "hardware_support.h"
 #include "allocator_memory.h"
 #include "ranking_function.h"
 #include "serialise_jass_v1.h"
+#include "serialise_jass_v2.h"
+#include "index_container.h"
+#include "primary_key_list.h"
+#include "vocabulary_hash.h"
+#include "reorder_bisection.h"
 #include "serialise_integers.h"
 #include "evaluate_precision.h"
+#include "instream_file_mmap.h"
 #include "instream_file_star.h"
 #include "parser_unicoil_json.h"
 #include "query_maxblock_heap.h"
@@ -74,6 +86,8 @@
 #include "evaluate_buying_power4k.h"
 #include "instream_document_fasta.h"
 #include "serialise_forward_index.h"
+#include "index_manager_external.h"
+#include "index_manager_parallel.h"
 #include "index_manager_sequential.h"
 #include "compress_integer_carry_8b.h"
 #include "compress_integer_simple_9.h"
@@ -205,10 +219,10 @@ int main(void)
 			}
 
 		puts("accumulator_counter");
-		JASS::accumulator_counter<uint32_t, 1, 8>::unittest();
+		JASS::accumulator_counter<uint32_t, 8>::unittest();
 
 		puts("accumulator_counter_interleaved");
-		JASS::accumulator_counter_interleaved<uint32_t, 1, 8>::unittest();
+		JASS::accumulator_counter_interleaved<uint32_t, 8>::unittest();
 
 		puts("stem_porter");
 		JASS::stem_porter::unittest();
@@ -228,6 +242,9 @@ int main(void)
 		puts("hardware_support");
 		JASS::hardware_support::unittest();
 
+		puts("instruction_set");
+		JASS::instruction_set::unittest();
+
 		puts("threads");
 		JASS::thread::unittest();
 		
@@ -330,12 +347,18 @@ int main(void)
 		puts("instream_file");
 		JASS::instream_file::unittest();
 
+		puts("instream_file_mmap");
+		JASS::instream_file_mmap::unittest();
+
 		puts("instream_file_star");
 		JASS::instream_file_star::unittest();
 
 		puts("instream_memory");
 		JASS::instream_memory::unittest();
 
+		puts("instream_read_ahead");
+		JASS::instream_read_ahead::unittest();
+
 		puts("instream_document_trec");
 		JASS::instream_document_trec::unittest();
 
@@ -353,6 +376,9 @@ int main(void)
 		puts("channel_file");
 		JASS::channel_file::unittest();
 
+		puts("channel_socket");
+		JASS::channel_socket::unittest();
+
 		puts("channel_trec");
 		JASS::channel_trec::unittest();
 
@@ -377,6 +403,9 @@ int main(void)
 		puts("hash_table");
 		JASS::hash_table<JASS::slice, JASS::slice>::unittest();
 
+		puts("hash_table_open");
+		JASS::hash_table_open<JASS::slice>::unittest();
+
 		puts("dynamic_array");
 		JASS::dynamic_array<JASS::slice>::unittest();
 
@@ -392,18 +421,42 @@ int main(void)
 		puts("index_manager_sequential");
 		JASS::index_manager_sequential::unittest();
 
+		puts("index_manager_parallel");
+		JASS::index_manager_parallel::unittest();
+
+		puts("index_manager_external");
+		JASS::index_manager_external::unittest();
+
 		puts("serialise_ci");
 		JASS::serialise_ci::unittest();
 
 		puts("serialise_jass_v1");
 		JASS::serialise_jass_v1::unittest();
 
+		puts("serialise_jass_v2");
+		JASS::serialise_jass_v2::unittest();
+
+		puts("index_container");
+		JASS::index_container::unittest();
+
+		puts("primary_key_list");
+		JASS::primary_key_list::unittest();
+
+		puts("vocabulary_hash");
+		JASS::vocabulary_hash::unittest();
+
 		puts("serialise_integers");
 		JASS::serialise_integers::unittest();
 
 		puts("serialise_forward_index");
 		JASS::serialise_forward_index::unittest();
 
+		puts("reorder_bisection");
+		JASS::reorder_bisection::unittest();
+
+		puts("reorder_remap");
+		JASS::reorder_remap::unittest();
+
 		puts("compress_integer_elias_gamma_bitwise");
 		JASS::compress_integer_elias_gamma_bitwise::unittest();
 
@@ -465,7 +518,7 @@ int main(void)
 		JASS::compress_integer_bitpack_128::unittest();
 
 		puts("accumulator_2d");
-		JASS::accumulator_2d<uint32_t, 1>::unittest();
+		JASS::accumulator_2d<uint32_t>::unittest();
 
 		puts("pointer_box");
 		JASS::pointer_box<int>::unittest();
@@ -477,16 +530,22 @@ int main(void)
 		JASS::top_k_heap<int>::unittest();
 
 		puts("query_heap");
-		JASS::query_heap::unittest();
+		JASS::query_heap<>::unittest();
+
+		puts("query_heap_clean");
+		JASS::query_heap_clean<>::unittest();
+		JASS::query_heap_clean<JASS::accumulator_counter<JASS::query::ACCUMULATOR_TYPE, 8>>::unittest();
 
 		puts("query_maxblock");
-		JASS::query_maxblock::unittest();
+		JASS::query_maxblock<>::unittest();
+		JASS::query_maxblock<JASS::accumulator_counter<JASS::query::ACCUMULATOR_TYPE, 4>>::unittest();
 
 		puts("query_maxblock_heap");
-		JASS::query_maxblock_heap::unittest();
+		JASS::query_maxblock_heap<>::unittest();
 
 		puts("query_bucket");
-		JASS::query_bucket::unittest();
+		JASS::query_bucket<>::unittest();
+		JASS::query_bucket<JASS::accumulator_counter_interleaved<JASS::query::ACCUMULATOR_TYPE, 8>>::unittest();
 
 		puts("run_export_trec");
 		JASS::run_export_trec::unittest();